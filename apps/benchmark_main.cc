@@ -0,0 +1,244 @@
+#include <core/mix_kernel.h>
+#include <core/music_note.h>
+#include <core/piano_keybinder.h>
+#include <core/sound_json_parser.h>
+#include <visualizer/piano.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using synther::PianoKeybinder;
+using synther::audio::SoundJsonParser;
+using synther::music::Accidental;
+using synther::music::Note;
+using synther::visualizer::Piano;
+using synther::visualizer::PianoKey;
+
+namespace {
+
+// Every benchmark is calibrated to run for at least this long, then repeated
+// so that the spread between runs shows how noisy the machine is
+const double kMinRepetitionSeconds = 0.1;
+const size_t kRepetitions = 5;
+
+// Manifests as large as the piano's, and far larger than any instrument's
+const std::vector<size_t> kManifestSizes{88, 1000, 10000};
+
+// Match the keyboard of the app
+const int kFirstSemitoneIndex = 9;
+const size_t kKeyCount = 88;
+const size_t kViewWhitekeyCount = 10;
+const int kOctaveDistance = 7;
+
+const std::vector<std::string> kNoteNames{"C",  "Db", "D",  "Eb", "E",  "F",
+                                          "Gb", "G",  "Ab", "A",  "Bb", "B"};
+
+// Results are added here, so the compiler can't discard the work measured
+volatile size_t sink;
+
+void PrintUsage() {
+  std::cerr << "Usage: synther-bench [output json] [name filter]" << std::endl;
+}
+
+/**
+ * Runs a benchmark body until it has been timed for long enough, then times
+ *   it kRepetitions more times
+ * @tparam Body a callable that takes no arguments and returns a size_t
+ *   computed from the work it did
+ * @param name the name the results are reported under
+ * @param operations the number of operations every call of the body does
+ * @param body the work to measure
+ * @return the benchmark's results
+ */
+template <typename Body>
+nlohmann::json RunBenchmark(const std::string& name, size_t operations,
+                            Body body) {
+  auto time_iterations = [&body](size_t iterations) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t iteration = 0; iteration < iterations; iteration++) {
+      sink = sink + body();
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+  };
+
+  size_t iterations = 1;
+  while (time_iterations(iterations) < kMinRepetitionSeconds) {
+    iterations *= 2;
+  }
+
+  std::vector<double> nanoseconds_per_operation;
+  for (size_t repetition = 0; repetition < kRepetitions; repetition++) {
+    double seconds = time_iterations(iterations);
+    nanoseconds_per_operation.push_back(seconds * 1e9 /
+                                        (iterations * operations));
+  }
+  std::sort(nanoseconds_per_operation.begin(),
+            nanoseconds_per_operation.end());
+
+  std::cerr << name << ": " << nanoseconds_per_operation[kRepetitions / 2]
+            << " ns" << std::endl;
+  return {{"name", name},
+          {"iterations", iterations},
+          {"operations_per_iteration", operations},
+          {"repetitions", kRepetitions},
+          {"time_unit", "ns"},
+          {"median_time", nanoseconds_per_operation[kRepetitions / 2]},
+          {"min_time", nanoseconds_per_operation.front()},
+          {"max_time", nanoseconds_per_operation.back()}};
+}
+
+/**
+ * Builds an instrument manifest with a sound file for every note from C0
+ *   upwards
+ * @param note_count the number of notes in the manifest
+ * @return the manifest as JSON text
+ */
+std::string MakeManifest(size_t note_count) {
+  nlohmann::json manifest{{"instrument", "Synthetic"},
+                          {"organization", "Synther"},
+                          {"performer", "synther-bench"}};
+  nlohmann::json sound_files = nlohmann::json::object();
+  for (size_t index = 0; index < note_count; index++) {
+    std::string note_string = kNoteNames[index % kNoteNames.size()] +
+                              std::to_string(index / kNoteNames.size());
+    sound_files[note_string] = "Synthetic." + note_string + ".mp3";
+  }
+  manifest["soundFiles"] = sound_files;
+  return manifest.dump();
+}
+
+}  // namespace
+
+// Times the core types of the app and writes the results as JSON, so runs on
+// different commits can be compared
+int main(int argc, char* argv[]) {
+  if (argc > 3) {
+    PrintUsage();
+    return 1;
+  }
+  std::string output_path = argc > 1 ? argv[1] : "";
+  std::string filter = argc > 2 ? argv[2] : "";
+
+  nlohmann::json benchmarks = nlohmann::json::array();
+  auto run = [&benchmarks, &filter](const std::string& name, size_t operations,
+                                    std::function<size_t()> body) {
+    if (name.find(filter) != std::string::npos) {
+      benchmarks.push_back(RunBenchmark(name, operations, body));
+    }
+  };
+
+  // music::Note
+  run("note/from_semitone", 128, []() {
+    size_t checksum = 0;
+    for (int semitone = 0; semitone < 128; semitone++) {
+      checksum += Note(semitone, Accidental::Sharp).GetLetter();
+    }
+    return checksum;
+  });
+
+  // SoundJsonParser
+  std::vector<std::string> note_strings;
+  for (int octave = 0; octave < 9; octave++) {
+    for (const std::string& note_name : kNoteNames) {
+      note_strings.push_back(note_name + std::to_string(octave));
+    }
+  }
+  run("sound_json_parser/parse_note_string", note_strings.size(),
+      [&note_strings]() {
+        size_t checksum = 0;
+        for (const std::string& note_string : note_strings) {
+          checksum +=
+              SoundJsonParser::ParseNoteString(note_string).GetSemitoneIndex();
+        }
+        return checksum;
+      });
+
+  for (size_t manifest_size : kManifestSizes) {
+    std::string manifest = MakeManifest(manifest_size);
+    std::string suffix = "/" + std::to_string(manifest_size);
+    run("sound_json_parser/construct" + suffix, 1, [&manifest]() {
+      std::stringstream json(manifest);
+      SoundJsonParser parser(json);
+      return parser.GetInstrumentName().size();
+    });
+
+    std::stringstream json(manifest);
+    SoundJsonParser parser(json);
+    run("sound_json_parser/get_note_files" + suffix, 1,
+        [&parser]() { return parser.GetNoteFiles().size(); });
+    run("sound_json_parser/get_notes" + suffix, 1,
+        [&parser]() { return parser.GetNotes().size(); });
+  }
+
+  // Piano
+  Piano piano(glm::dvec2(0, 0), 1000, 400, kFirstSemitoneIndex, kKeyCount,
+              kViewWhitekeyCount);
+  run("piano/set_keys", 1, [&piano]() {
+    piano.SetKeys(kFirstSemitoneIndex, kKeyCount, kViewWhitekeyCount);
+    return piano.GetKeyCount();
+  });
+  run("piano/get_piano_keys_in_view", 1,
+      [&piano]() { return piano.GetPianoKeysInView().size(); });
+  run("piano/shift_view", 2, [&piano]() {
+    piano.ShiftView(kOctaveDistance);
+    piano.ShiftView(-kOctaveDistance);
+    return piano.GetKeyCount();
+  });
+
+  // PianoKeybinder
+  PianoKeybinder keybinder;
+  std::vector<PianoKey> keys_in_view = piano.GetPianoKeysInView();
+  run("piano_keybinder/set_key_binds", 1, [&keybinder, &keys_in_view]() {
+    keybinder.SetKeyBinds(keys_in_view);
+    return keys_in_view.size();
+  });
+
+  keybinder.SetKeyBinds(keys_in_view);
+  const std::vector<int> key_codes{
+      ci::app::KeyEvent::KEY_a, ci::app::KeyEvent::KEY_s,
+      ci::app::KeyEvent::KEY_d, ci::app::KeyEvent::KEY_f,
+      ci::app::KeyEvent::KEY_g, ci::app::KeyEvent::KEY_h};
+  run("piano_keybinder/press_and_release_key", key_codes.size(),
+      [&keybinder, &key_codes]() {
+        size_t checksum = 0;
+        for (int key_code : key_codes) {
+          checksum += keybinder.PressKey(key_code).GetSemitoneIndex();
+          keybinder.ReleaseKey(key_code);
+        }
+        return checksum;
+      });
+  run("piano_keybinder/get_note_chars", 1,
+      [&keybinder]() { return keybinder.GetNoteChars().size(); });
+
+  nlohmann::json results{
+      {"context",
+       {{"mix_kernel", synther::audio::GetMixKernelName()},
+#ifdef NDEBUG
+        {"build_type", "release"},
+#else
+        {"build_type", "debug"},
+#endif
+        {"min_repetition_seconds", kMinRepetitionSeconds}}},
+      {"benchmarks", benchmarks}};
+
+  if (output_path.empty()) {
+    std::cout << results.dump(2) << std::endl;
+    return 0;
+  }
+  std::ofstream output(output_path);
+  if (!output.is_open()) {
+    std::cerr << "Could not open " << output_path << std::endl;
+    return 1;
+  }
+  output << results.dump(2) << std::endl;
+  return 0;
+}
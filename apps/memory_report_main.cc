@@ -0,0 +1,111 @@
+#include <core/sample_loader.h>
+#include <core/sound_json_parser.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+using synther::audio::SampleBufferRef;
+using synther::audio::SampleFormat;
+using synther::audio::SampleLoader;
+using synther::audio::SoundJsonParser;
+
+namespace {
+
+const size_t kDefaultSampleRate = 44100;
+const double kBytesPerMegabyte = 1024 * 1024;
+
+void PrintUsage() {
+  std::cerr << "Usage: synther-memory <sounds directory> [sample rate]"
+            << std::endl;
+}
+
+size_t GetMemorySize(const std::map<int, SampleBufferRef>& samples) {
+  size_t memory_size = 0;
+  for (const auto& sample_pair : samples) {
+    memory_size += sample_pair.second->GetMemorySize();
+  }
+  return memory_size;
+}
+
+size_t CountMonoSamples(const std::map<int, SampleBufferRef>& samples) {
+  size_t mono_count = 0;
+  for (const auto& sample_pair : samples) {
+    if (sample_pair.second->GetNumChannels() == 1) {
+      mono_count++;
+    }
+  }
+  return mono_count;
+}
+
+}  // namespace
+
+// Reports the sample memory of every instrument in a sounds directory, stored
+// as decoded floats and in the compact storage used by the app
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    PrintUsage();
+    return 1;
+  }
+  ci::fs::path sounds_directory(argv[1]);
+  size_t sample_rate = argc > 2 ? std::stoul(argv[2]) : kDefaultSampleRate;
+
+  // Decode every file, so the cache's storage doesn't affect the report
+  SampleLoader float_loader(sample_rate);
+  SampleLoader compact_loader(sample_rate);
+  compact_loader.SetStorage(SampleFormat::Int16, true);
+
+  std::vector<ci::fs::path> instrument_directories;
+  for (ci::fs::directory_iterator entry(sounds_directory), end; entry != end;
+       ++entry) {
+    if (ci::fs::exists(entry->path() / "details.json")) {
+      instrument_directories.push_back(entry->path());
+    }
+  }
+  std::sort(instrument_directories.begin(), instrument_directories.end());
+
+  std::cout << std::left << std::setw(20) << "Instrument" << std::right
+            << std::setw(8) << "Samples" << std::setw(8) << "Mono"
+            << std::setw(12) << "Float MB" << std::setw(12) << "Compact MB"
+            << std::setw(8) << "Ratio" << std::endl;
+  std::cout << std::fixed << std::setprecision(1);
+
+  size_t total_float_size = 0;
+  size_t total_compact_size = 0;
+  for (const ci::fs::path& instrument_directory : instrument_directories) {
+    std::fstream details_json((instrument_directory / "details.json").string());
+    SoundJsonParser sound_parser(details_json);
+    auto note_paths = SampleLoader::ResolvePaths(sound_parser.GetNoteFiles(),
+                                                 instrument_directory);
+
+    size_t float_size = GetMemorySize(float_loader.LoadSamples(note_paths));
+    auto compact_samples = compact_loader.LoadSamples(note_paths);
+    size_t compact_size = GetMemorySize(compact_samples);
+    total_float_size += float_size;
+    total_compact_size += compact_size;
+
+    std::cout << std::left << std::setw(20)
+              << sound_parser.GetInstrumentName() << std::right
+              << std::setw(8) << compact_samples.size() << std::setw(8)
+              << CountMonoSamples(compact_samples) << std::setw(12)
+              << float_size / kBytesPerMegabyte << std::setw(12)
+              << compact_size / kBytesPerMegabyte << std::setw(7)
+              << static_cast<double>(float_size) /
+                     std::max<size_t>(compact_size, 1)
+              << "x"
+              << std::endl;
+  }
+
+  std::cout << std::left << std::setw(36) << "Total" << std::right
+            << std::setw(12) << total_float_size / kBytesPerMegabyte
+            << std::setw(12) << total_compact_size / kBytesPerMegabyte
+            << std::setw(7)
+            << static_cast<double>(total_float_size) /
+                   std::max<size_t>(total_compact_size, 1)
+            << "x" << std::endl;
+  return 0;
+}
@@ -0,0 +1,104 @@
+#include <core/event_list_parser.h>
+#include <core/midi_file_parser.h>
+#include <core/offline_renderer.h>
+#include <core/sample_loader.h>
+#include <core/sound_json_parser.h>
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using synther::audio::EventListParser;
+using synther::audio::MidiFileParser;
+using synther::audio::OfflineRenderer;
+using synther::audio::OfflineRenderStats;
+using synther::audio::SampleLoader;
+using synther::audio::SoundJsonParser;
+using synther::audio::TimedNoteEvent;
+
+namespace {
+
+// Match the resonation of the app
+const double kStandardResonation = 0.4;
+const double kMaxTailDuration = 10.0;
+const size_t kDefaultSampleRate = 44100;
+const size_t kNumChannels = 2;
+
+void PrintUsage() {
+  std::cerr << "Usage: synther-render <instrument directory> "
+               "<events json or MIDI file> <output wav> [sample rate] "
+               "[decode threads]"
+            << std::endl;
+}
+
+bool IsMidiFile(const std::string& path) {
+  std::string extension = ci::fs::path(path).extension().string();
+  return extension == ".mid" || extension == ".midi";
+}
+
+}  // namespace
+
+// Renders a list of note events or a MIDI file through an instrument to a
+// WAV file, as fast as possible and without an audio device
+int main(int argc, char* argv[]) {
+  if (argc < 4) {
+    PrintUsage();
+    return 1;
+  }
+  ci::fs::path instrument_directory(argv[1]);
+  std::string events_path(argv[2]);
+  std::string output_path(argv[3]);
+  size_t sample_rate = argc > 4 ? std::stoul(argv[4]) : kDefaultSampleRate;
+  // 0 decodes on every core. Pass 1 to compare against serial decoding
+  size_t decode_threads = argc > 5 ? std::stoul(argv[5]) : 0;
+
+  // Load the instrument's samples
+  std::fstream details_json((instrument_directory / "details.json").string());
+  if (!details_json.is_open()) {
+    std::cerr << "Could not open details.json in " << instrument_directory
+              << std::endl;
+    return 1;
+  }
+  SoundJsonParser sound_parser(details_json);
+  SampleLoader loader(sample_rate, decode_threads);
+  loader.SetCacheDirectory(SampleLoader::GetDefaultCacheDirectory());
+  auto samples = loader.LoadSamples(SampleLoader::ResolvePaths(
+      sound_parser.GetNoteFiles(), instrument_directory));
+  std::cout << sound_parser.GetInstrumentName() << ": loaded "
+            << samples.size() << " samples (" << loader.GetLastCacheHitCount()
+            << " cached) on " << loader.GetNumThreads() << " threads in "
+            << loader.GetLastLoadDuration() << " s" << std::endl;
+
+  // Load the performance
+  std::ifstream events_file(events_path, std::ios::binary);
+  if (!events_file.is_open()) {
+    std::cerr << "Could not open " << events_path << std::endl;
+    return 1;
+  }
+  std::vector<TimedNoteEvent> events;
+  try {
+    if (IsMidiFile(events_path)) {
+      events = MidiFileParser(events_file).GetEvents();
+    } else {
+      events = EventListParser(events_file).GetEvents();
+    }
+  } catch (const std::invalid_argument& error) {
+    std::cerr << events_path << ": " << error.what() << std::endl;
+    return 1;
+  }
+
+  OfflineRenderer renderer(sample_rate, kNumChannels, kStandardResonation);
+  renderer.SetSamples(samples);
+  OfflineRenderStats stats = renderer.Render(events, kMaxTailDuration);
+
+  std::ofstream output(output_path, std::ios::binary);
+  renderer.WriteWav(output);
+
+  std::cout << sound_parser.GetInstrumentName() << ": rendered "
+            << stats.rendered_seconds_ << " s of audio in "
+            << stats.wall_seconds_ << " s (" << stats.GetRealtimeFactor()
+            << "x real time)" << std::endl;
+  return 0;
+}
@@ -0,0 +1,123 @@
+#ifndef SYNTHER_CONVOLUTION_REVERB_H
+#define SYNTHER_CONVOLUTION_REVERB_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "core/convolver.h"
+#include "core/sample_buffer.h"
+
+namespace synther {
+
+namespace audio {
+
+typedef std::shared_ptr<class ConvolutionReverb> ConvolutionReverbRef;
+
+/**
+ * Places the output of the Sampler in a recorded space by convolving every
+ *   channel with an impulse response. Impulses are loaded like instrument
+ *   samples, so they are resampled to the output rate when decoded.
+ *
+ * Every output channel has its own Convolver. Channels past the last
+ *   channel of the impulse use its last channel, so a mono impulse
+ *   reverberates both channels of a stereo output alike.
+ *
+ * The tails of long impulses are convolved on a background thread, so the
+ *   audio thread only convolves the first few thousand frames of the
+ *   impulse, however long it is. Without the thread, the whole impulse is
+ *   convolved on the thread that renders, which suits offline rendering.
+ */
+class ConvolutionReverb {
+ public:
+  /**
+   * Computes the spectra of an impulse response, and starts the tail thread
+   *   if there is one. Must not be called from the audio thread
+   * @param impulse the impulse response, at the rate of the output
+   * @param num_channels the number of output channels to reverberate
+   * @param sample_rate the rate of the output, which paces the tail thread
+   * @param wet_gain the gain of the reverberated signal
+   * @param dry_gain the gain of the original signal
+   * @param is_tail_threaded true to convolve the tail on a background thread
+   * @param head_partition the number of frames in every partition convolved
+   *   on the audio thread, which delays the reverberated signal
+   * @param tail_partition the number of frames in every partition convolved
+   *   on the tail thread
+   */
+  ConvolutionReverb(const SampleBuffer& impulse, size_t num_channels,
+                    double sample_rate, float wet_gain, float dry_gain = 1.0f,
+                    bool is_tail_threaded = true,
+                    size_t head_partition = Convolver::kDefaultHeadPartition,
+                    size_t tail_partition = Convolver::kDefaultTailPartition);
+
+  /**
+   * Stops the tail thread
+   */
+  ~ConvolutionReverb();
+
+  ConvolutionReverb(const ConvolutionReverb&) = delete;
+  ConvolutionReverb& operator=(const ConvolutionReverb&) = delete;
+
+  /**
+   * Replaces a buffer with the mix of its dry and reverberated signals.
+   *   Never allocates or locks. Called from the audio thread
+   * @param buffer a non-interleaved buffer holding num_channels contiguous
+   *   channels of num_frames samples each. Channels past the reverb's
+   *   channels are left dry
+   * @param num_channels the number of channels in buffer
+   * @param num_frames the number of frames in every channel
+   */
+  void Process(float* buffer, size_t num_channels, size_t num_frames);
+
+  /**
+   * Get how far the reverberated signal is delayed behind the dry signal
+   * @return the latency, in frames
+   */
+  size_t GetLatency() const;
+
+  /**
+   * Get the number of tail partitions that weren't convolved in time and
+   *   were left out. Safe to call from any thread
+   * @return the total number of tail underruns over every channel
+   */
+  uint64_t GetUnderrunCount() const;
+
+  /**
+   * Get the number of frames in the impulse response
+   * @return the length of the impulse
+   */
+  size_t GetImpulseFrames() const;
+
+ private:
+  std::vector<std::unique_ptr<Convolver>> convolvers_;
+  size_t impulse_frames_;
+  float wet_gain_;
+  float dry_gain_;
+  // The reverberated frames of one channel, reused by every call
+  std::vector<float> wet_frames_;
+  std::atomic<bool> is_stopping_;
+  // How long the tail thread sleeps when every tail is up to date, which is
+  // half a tail partition, so it wakes in time for the next one
+  std::chrono::microseconds idle_sleep_;
+  std::thread tail_thread_;
+
+  // Longest run of frames reverberated at once
+  static constexpr size_t kMaxRunFrames = 1024;
+  static constexpr double kMicrosecondsPerSecond = 1e6;
+
+  /**
+   * Convolves the tails of every channel until the reverb is destroyed.
+   *   Runs on the tail thread
+   */
+  void Run();
+};
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_CONVOLUTION_REVERB_H
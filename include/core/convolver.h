@@ -0,0 +1,195 @@
+#ifndef SYNTHER_CONVOLVER_H
+#define SYNTHER_CONVOLVER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "core/fft.h"
+
+namespace synther {
+
+namespace audio {
+
+/**
+ * Convolves one channel of audio with an impulse response, using uniformly
+ *   partitioned FFT convolution. The impulse is cut into equal partitions
+ *   whose spectra are computed once, and every block of input is multiplied
+ *   with all of them in the frequency domain, so the cost per frame grows
+ *   with the number of partitions instead of the number of impulse frames.
+ *
+ * The impulse is split between two partition sizes. The head, the first
+ *   2 * tail_partition frames, is convolved on the audio thread in small
+ *   partitions, which keeps the latency low. The rest is convolved in large
+ *   partitions, which are cheaper per frame but take longer to collect. A
+ *   tail partition is computed a whole partition before it is heard, so it
+ *   may run on a background thread that calls ProcessTail(). Tail partitions
+ *   that aren't ready in time are left out and counted as underruns.
+ *
+ * Input frames are collected into head partitions before they are
+ *   convolved, so the output is delayed by one head partition. Every buffer
+ *   is allocated when the Convolver is constructed, so Process() never
+ *   allocates or locks.
+ */
+class Convolver {
+ public:
+  /**
+   * Constructs a convolver with silent history
+   * @param impulse the frames of the impulse response
+   * @param impulse_frames the number of frames in the impulse
+   * @param is_tail_threaded true if another thread calls ProcessTail(),
+   *   false to convolve the tail inside Process()
+   * @param head_partition the number of frames in every head partition,
+   *   which is the latency of the output. Rounded up to a power of two
+   * @param tail_partition the number of frames in every tail partition.
+   *   Rounded up to a power of two, and to at least head_partition
+   */
+  Convolver(const float* impulse, size_t impulse_frames,
+            bool is_tail_threaded,
+            size_t head_partition = kDefaultHeadPartition,
+            size_t tail_partition = kDefaultTailPartition);
+
+  Convolver(const Convolver&) = delete;
+  Convolver& operator=(const Convolver&) = delete;
+
+  /**
+   * Convolves the next frames of the input. Called from the audio thread
+   * @param input the next frames of the input
+   * @param output receives the convolution, GetLatency() frames behind the
+   *   input. May be the same array as input
+   * @param num_frames the number of frames to convolve
+   */
+  void Process(const float* input, float* output, size_t num_frames);
+
+  /**
+   * Convolves the next tail partition, if its input has been collected.
+   *   Must only be called from one thread, and only if the tail is threaded
+   * @return true if a partition was convolved, false if there was nothing
+   *   to do
+   */
+  bool ProcessTail();
+
+  /**
+   * Get how far the output is delayed behind the input
+   * @return the latency, in frames
+   */
+  size_t GetLatency() const;
+
+  /**
+   * Get the number of tail partitions that weren't convolved in time and
+   *   were left out of the output. Safe to call from any thread
+   * @return the total number of tail underruns
+   */
+  uint64_t GetUnderrunCount() const;
+
+  /**
+   * Get the number of frames in every tail partition, after rounding
+   * @return the tail partition, in frames
+   */
+  size_t GetTailPartition() const;
+
+  static constexpr size_t kDefaultHeadPartition = 64;
+  static constexpr size_t kDefaultTailPartition = 1024;
+
+ private:
+  // Tail partitions of input that may wait for the tail thread, and of
+  // output that may wait for the audio thread
+  static constexpr size_t kInputRingBlocks = 4;
+  static constexpr size_t kOutputSlotCount = 4;
+
+  // One stage of the uniformly partitioned convolution, which convolves the
+  // input with a range of the impulse in partitions of the same size
+  struct Stage {
+    explicit Stage(size_t partition);
+
+    /**
+     * Computes the spectra of the impulse frames covered by the stage
+     * @param impulse the first impulse frame covered by the stage
+     * @param impulse_frames the number of impulse frames covered
+     */
+    void SetImpulse(const float* impulse, size_t impulse_frames);
+
+    /**
+     * Convolves the next partition of input with every partition of the
+     *   impulse
+     * @param input the partition's frames
+     * @param output receives the partition's frames of the convolution, or
+     *   nullptr to only remember the input for later partitions
+     */
+    void Process(const float* input, float* output);
+
+    size_t partition_;
+    Fft fft_;
+    size_t bin_count_;
+    size_t partition_count_;
+    // The spectra of the impulse partitions, scaled to normalize the inverse
+    // transform, and of the last partition_count_ input windows
+    std::vector<float> filter_real_;
+    std::vector<float> filter_imag_;
+    std::vector<float> history_real_;
+    std::vector<float> history_imag_;
+    // The history slot of the newest input window
+    size_t history_position_;
+    // The previous and the current input partitions
+    std::vector<float> window_;
+    std::vector<float> sum_real_;
+    std::vector<float> sum_imag_;
+    std::vector<float> transformed_;
+  };
+
+  size_t head_partition_;
+  size_t tail_partition_;
+  bool has_tail_;
+  bool is_tail_threaded_;
+
+  // Only used by the audio thread
+  Stage head_;
+  // Frames of the partition being collected, and the output of the last one
+  std::vector<float> input_partition_;
+  std::vector<float> output_partition_;
+  size_t partition_fill_;
+  // The number of head partitions convolved so far
+  size_t partition_count_;
+  // The tail partition being added to the output
+  std::vector<float> tail_output_;
+
+  // Only used by the thread that calls ProcessTail()
+  Stage tail_;
+  std::vector<float> tail_input_;
+  size_t next_tail_block_;
+
+  // Input frames handed to the tail, kInputRingBlocks tail partitions long.
+  // The audio thread publishes the number of frames written, and the end of
+  // the last partition it dropped because the ring was full. The tail
+  // publishes the number of frames it has read
+  std::vector<float> input_ring_;
+  std::atomic<size_t> input_frame_count_;
+  std::atomic<size_t> lost_frame_end_;
+  std::atomic<size_t> read_frame_count_;
+  // Convolved tail partitions handed back to the audio thread. Each slot is
+  // tagged with one more than the index of the partition it holds, and the
+  // audio thread publishes how many partitions it is done with
+  std::vector<float> output_slots_;
+  std::atomic<size_t> slot_tags_[kOutputSlotCount];
+  std::atomic<size_t> consumed_block_count_;
+  std::atomic<uint64_t> underrun_count_;
+
+  /**
+   * Convolves the collected head partition and prepares its output
+   */
+  void ProcessPartition();
+
+  /**
+   * Takes the tail partition that is heard from the current head partition
+   *   onwards, or silence if it isn't ready
+   * @param block the index of the tail partition
+   */
+  void TakeTailBlock(size_t block);
+};
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_CONVOLVER_H
@@ -0,0 +1,95 @@
+#ifndef SYNTHER_ENVELOPE_H
+#define SYNTHER_ENVELOPE_H
+
+#include <cstddef>
+
+namespace synther {
+
+namespace audio {
+
+/**
+ * The gain envelope of a single voice: a linear attack from silence to full
+ *   gain, a sustain at full gain while the note is held, and a linear release
+ *   back to silence. The envelope is a level and a per-frame step, which is
+ *   exactly the gain ramp that MixVoices() applies, clamped between 0 and 1.
+ *   Stages therefore end on the frame the ramp reaches its target, even in
+ *   the middle of a block.
+ *
+ * The envelope is plain data and never allocates, so it is started, released
+ *   and advanced on the audio thread as events arrive.
+ */
+class Envelope {
+ public:
+  /**
+   * Constructs an envelope that has finished, at silence
+   */
+  Envelope();
+
+  /**
+   * Starts the attack from silence
+   * @param attack_frames the number of frames the attack takes. Less than 1
+   *   starts at full gain
+   */
+  void Start(double attack_frames);
+
+  /**
+   * Starts the release from the current level. A release that is already in
+   *   progress restarts at the new speed
+   * @param release_frames the number of frames until silence. Less than 1
+   *   silences the envelope from the next frame
+   */
+  void Release(double release_frames);
+
+  /**
+   * Releases the envelope at least as fast as a fade. Releases that would
+   *   already reach silence sooner keep their speed
+   * @param fade_frames the most frames that the envelope may take to reach
+   *   silence. Less than 1 silences the envelope from the next frame
+   */
+  void FadeOut(double fade_frames);
+
+  /**
+   * Moves the envelope past a rendered block, ending the attack or the
+   *   release if its ramp reached its target within the block
+   * @param num_frames the number of frames in the block
+   */
+  void Advance(size_t num_frames);
+
+  /**
+   * Get the gain of the next frame
+   * @return the gain, between 0 and 1
+   */
+  float GetLevel() const;
+
+  /**
+   * Get the change in gain per frame
+   * @return the step to pass to MixVoices() with GetLevel()
+   */
+  float GetStep() const;
+
+  /**
+   * Checks whether the envelope has been released
+   * @return true once Release() or FadeOut() has been called
+   */
+  bool IsReleased() const;
+
+  /**
+   * Checks whether the release has reached silence, at which point the
+   *   voice can be freed
+   * @return true if the envelope is released and silent
+   */
+  bool IsFinished() const;
+
+ private:
+  enum class Stage { Attack, Sustain, Release };
+
+  Stage stage_;
+  float level_;
+  float step_;
+};
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_ENVELOPE_H
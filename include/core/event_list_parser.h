@@ -0,0 +1,54 @@
+#ifndef SYNTHER_EVENT_LIST_PARSER_H
+#define SYNTHER_EVENT_LIST_PARSER_H
+
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+#include "core/note_event.h"
+
+namespace synther {
+
+namespace audio {
+
+/**
+ * Parses a list of timestamped note events from JSON, for rendering
+ *   performances without a keyboard. The JSON must contain an "events" array,
+ *   where every event has a "time" in seconds and a "type":
+ *   - "noteOn" and "noteOff" events name a "note", written like the notes in
+ *     an instrument's details.json (e.g. "C4", "Db4", "Fs2")
+ *   - "sustain" events set whether the sustain pedal is "down"
+ */
+class EventListParser {
+ public:
+  /**
+   * Construct a parser using a stream of event list JSON data
+   * @param json a stream of JSON data containing an "events" array
+   */
+  explicit EventListParser(std::istream& json);
+
+  /**
+   * Converts every event in the JSON into a TimedNoteEvent. Sustain events
+   *   become SustainOn and SustainOff events. Throws an exception if an event
+   *   is malformed
+   * @return a vector of events sorted by time. Events with equal times keep
+   *   the order in which they appear in the JSON
+   */
+  std::vector<TimedNoteEvent> GetEvents() const;
+
+ private:
+  nlohmann::json event_list_;
+
+  static const std::string kEventsKey;
+  static const std::string kTimeKey;
+  static const std::string kTypeKey;
+  static const std::string kNoteKey;
+  static const std::string kDownKey;
+};
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_EVENT_LIST_PARSER_H
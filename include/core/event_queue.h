@@ -0,0 +1,170 @@
+#ifndef SYNTHER_EVENT_QUEUE_H
+#define SYNTHER_EVENT_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace synther {
+
+namespace audio {
+
+/**
+ * A wait-free single-producer/single-consumer ring buffer. One thread may push
+ *   items while another thread pops them, without either thread ever taking a
+ *   lock or allocating memory after construction.
+ *
+ * Items pushed together with TryPushAll() are published at once, so a
+ *   consumer that drains the queue sees either all of them or none of them.
+ * @tparam T a copyable item type. Items should be small, since they are copied
+ *   into and out of the ring
+ */
+template <typename T>
+class EventQueue {
+ public:
+  /**
+   * Constructs an empty queue
+   * @param capacity the minimum number of items the queue can hold. Rounded up
+   *   to the next power of two
+   */
+  explicit EventQueue(size_t capacity);
+
+  /**
+   * Pushes an item onto the back of the queue. Must only be called from the
+   *   producer thread
+   * @param item the item to push
+   * @return true if the item was pushed, false if the queue was full
+   */
+  bool TryPush(const T& item);
+
+  /**
+   * Pushes several items onto the back of the queue, publishing them to the
+   *   consumer at once. Must only be called from the producer thread
+   * @param items a pointer to the first item to push
+   * @param count the number of items to push
+   * @return true if every item was pushed, false if there was not enough room
+   *   for all of them, in which case none are pushed
+   */
+  bool TryPushAll(const T* items, size_t count);
+
+  /**
+   * Pops the item at the front of the queue. Must only be called from the
+   *   consumer thread
+   * @param item set to the popped item if the queue was not empty
+   * @return true if an item was popped, false if the queue was empty
+   */
+  bool TryPop(T& item);
+
+  /**
+   * Pops every item that had been published when Drain() was called, passing
+   *   each one to a handler in order. Must only be called from the consumer
+   *   thread
+   * @param handler a callable that takes a const T&
+   * @return the number of items that were popped
+   */
+  template <typename Handler>
+  size_t Drain(Handler handler);
+
+  /**
+   * Get the maximum number of items the queue can hold
+   * @return the capacity of the queue
+   */
+  size_t GetCapacity() const;
+
+ private:
+  static constexpr size_t kCacheLineSize = 64;
+
+  std::vector<T> items_;
+  size_t mask_;
+
+  // The consumer owns head_ and the producer owns tail_. Both only increase,
+  // and are kept on separate cache lines so the two threads don't contend
+  alignas(kCacheLineSize) std::atomic<size_t> head_;
+  alignas(kCacheLineSize) std::atomic<size_t> tail_;
+
+  /**
+   * Rounds a capacity up to the next power of two, so indices can be wrapped
+   *   with a mask
+   */
+  static size_t RoundUpCapacity(size_t capacity);
+};
+
+template <typename T>
+constexpr size_t EventQueue<T>::kCacheLineSize;
+
+template <typename T>
+EventQueue<T>::EventQueue(size_t capacity)
+    : items_(RoundUpCapacity(capacity)),
+      mask_(items_.size() - 1),
+      head_(0),
+      tail_(0) {
+}
+
+template <typename T>
+bool EventQueue<T>::TryPush(const T& item) {
+  return TryPushAll(&item, 1);
+}
+
+template <typename T>
+bool EventQueue<T>::TryPushAll(const T* items, size_t count) {
+  size_t tail = tail_.load(std::memory_order_relaxed);
+  size_t head = head_.load(std::memory_order_acquire);
+  if (items_.size() - (tail - head) < count) {
+    return false;
+  }
+
+  for (size_t index = 0; index < count; index++) {
+    items_[(tail + index) & mask_] = items[index];
+  }
+
+  // Publish every item with a single store
+  tail_.store(tail + count, std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+bool EventQueue<T>::TryPop(T& item) {
+  size_t head = head_.load(std::memory_order_relaxed);
+  if (head == tail_.load(std::memory_order_acquire)) {
+    return false;
+  }
+
+  item = items_[head & mask_];
+  head_.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+template <typename Handler>
+size_t EventQueue<T>::Drain(Handler handler) {
+  size_t head = head_.load(std::memory_order_relaxed);
+  size_t tail = tail_.load(std::memory_order_acquire);
+
+  for (size_t index = head; index != tail; index++) {
+    handler(items_[index & mask_]);
+  }
+
+  // Free every drained slot at once
+  head_.store(tail, std::memory_order_release);
+  return tail - head;
+}
+
+template <typename T>
+size_t EventQueue<T>::GetCapacity() const {
+  return items_.size();
+}
+
+template <typename T>
+size_t EventQueue<T>::RoundUpCapacity(size_t capacity) {
+  size_t rounded = 1;
+  while (rounded < capacity) {
+    rounded <<= 1;
+  }
+  return rounded;
+}
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_EVENT_QUEUE_H
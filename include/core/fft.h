@@ -0,0 +1,92 @@
+#ifndef SYNTHER_FFT_H
+#define SYNTHER_FFT_H
+
+#include <cstddef>
+#include <vector>
+
+namespace synther {
+
+namespace audio {
+
+/**
+ * A fast Fourier transform of real signals whose size is a power of two.
+ *   A signal of N samples is transformed through a complex transform of N / 2
+ *   points, so real signals cost half as much as complex ones.
+ *
+ * Spectra hold the N / 2 + 1 bins from 0 Hz to the Nyquist frequency, with
+ *   their real and imaginary parts in separate arrays, which is the layout
+ *   that ComplexMultiplyAccumulate() works on.
+ *
+ * Every table and buffer is allocated when the Fft is constructed, so
+ *   transforms never allocate and may run on the audio thread. They share
+ *   scratch space, so an Fft must only be used by one thread at a time.
+ */
+class Fft {
+ public:
+  /**
+   * Constructs a transform of a fixed size
+   * @param size the number of samples in every signal. Must be a power of
+   *   two, and at least 2
+   */
+  explicit Fft(size_t size);
+
+  /**
+   * Transforms a signal into its spectrum
+   * @param input the GetSize() samples of the signal
+   * @param real receives the real parts of GetBinCount() bins
+   * @param imag receives the imaginary parts of GetBinCount() bins
+   */
+  void Forward(const float* input, float* real, float* imag);
+
+  /**
+   * Transforms a spectrum back into a signal. The inverse isn't normalized,
+   *   so a signal that is transformed forwards and back comes out scaled by
+   *   GetSize()
+   * @param real the real parts of GetBinCount() bins
+   * @param imag the imaginary parts of GetBinCount() bins. The imaginary
+   *   parts of the first and last bins are ignored
+   * @param output receives the GetSize() samples of the signal
+   */
+  void Inverse(const float* real, const float* imag, float* output);
+
+  /**
+   * Get the number of samples in every signal
+   * @return the size of the transform
+   */
+  size_t GetSize() const;
+
+  /**
+   * Get the number of bins in every spectrum
+   * @return GetSize() / 2 + 1
+   */
+  size_t GetBinCount() const;
+
+ private:
+  size_t size_;
+  // The size of the complex transform
+  size_t half_size_;
+  // Where every point of the complex transform is read from
+  std::vector<size_t> bit_reversal_;
+  // e^(-2 pi i k / half_size_) for the butterflies of the complex transform
+  std::vector<float> twiddle_real_;
+  std::vector<float> twiddle_imag_;
+  // e^(-2 pi i k / size_), which separates the even and odd samples
+  std::vector<float> rotation_real_;
+  std::vector<float> rotation_imag_;
+  // The points of the complex transform, reused by every call
+  std::vector<float> work_real_;
+  std::vector<float> work_imag_;
+
+  /**
+   * Runs the complex transform in place on the work buffers, which must
+   *   already be in bit-reversed order
+   * @param is_inverse true to transform with the conjugate twiddles
+   */
+  void Transform(bool is_inverse);
+};
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_FFT_H
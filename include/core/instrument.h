@@ -0,0 +1,47 @@
+#ifndef SYNTHER_INSTRUMENT_H
+#define SYNTHER_INSTRUMENT_H
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/music_note.h"
+#include "core/sample_buffer.h"
+
+namespace synther {
+
+namespace audio {
+
+/**
+ * An instrument that has been prepared for playback: its details, where its
+ *   sound files are, and the samples that have been loaded so far. Prepared
+ *   instruments can be handed back to the Player without reading any files
+ */
+struct Instrument {
+  std::string name_;
+  // Every note listed in the instrument's details, in ascending order
+  std::vector<music::Note> notes_;
+  // Maps semitones to the full paths of sound files that exist
+  std::map<int, std::string> note_paths_;
+  // Maps semitones to loaded samples. With lazy loading, only some of the
+  // notes in note_paths_ are loaded at a time
+  std::map<int, SampleBufferRef> samples_;
+  // Seconds spent loading sound files when the instrument was prepared
+  double load_duration_;
+
+  /**
+   * Get the memory held by the instrument's loaded samples
+   * @return the total size of the loaded samples, in bytes
+   */
+  size_t GetMemorySize() const;
+};
+
+using InstrumentRef = std::shared_ptr<Instrument>;
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_INSTRUMENT_H
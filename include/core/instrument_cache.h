@@ -0,0 +1,99 @@
+#ifndef SYNTHER_INSTRUMENT_CACHE_H
+#define SYNTHER_INSTRUMENT_CACHE_H
+
+#include <cstddef>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "core/instrument.h"
+
+namespace synther {
+
+namespace audio {
+
+/**
+ * Keeps recently used instruments prepared, so switching back to one does
+ *   not read or decode any files. When the samples of every cached
+ *   instrument take more memory than the budget, the least recently used
+ *   instruments are dropped. The most recently used instrument is always
+ *   kept, even if it alone exceeds the budget
+ */
+class InstrumentCache {
+ public:
+  /**
+   * Constructs an empty cache
+   * @param byte_budget the memory that cached samples may take, in bytes
+   */
+  explicit InstrumentCache(size_t byte_budget);
+
+  /**
+   * Finds a cached instrument, and marks it as the most recently used
+   * @param key the key the instrument was inserted with
+   * @return the cached instrument, or nullptr if it is not cached
+   */
+  InstrumentRef Find(const std::string& key);
+
+  /**
+   * Caches an instrument as the most recently used, replacing any instrument
+   *   with the same key. Drops instruments to stay within the budget
+   * @param key the key to find the instrument by, such as its directory
+   * @param instrument the prepared instrument
+   */
+  void Insert(const std::string& key, const InstrumentRef& instrument);
+
+  /**
+   * Drops least recently used instruments until the cache is within its
+   *   budget. Cached instruments may grow as their notes are lazily loaded,
+   *   so this should be called after loading samples
+   */
+  void Trim();
+
+  /**
+   * Sets the memory that cached samples may take. Drops instruments if the
+   *   new budget is smaller
+   * @param byte_budget the new budget, in bytes
+   */
+  void SetByteBudget(size_t byte_budget);
+
+  /**
+   * Get the number of instruments in the cache
+   * @return the number of cached instruments
+   */
+  size_t GetSize() const;
+
+  /**
+   * Get the memory taken by the samples of every cached instrument
+   * @return the size of the cached samples, in bytes
+   */
+  size_t GetResidentBytes() const;
+
+  /**
+   * Get the number of calls to Find() that returned an instrument
+   * @return the number of cache hits
+   */
+  size_t GetHitCount() const;
+
+  /**
+   * Get the number of calls to Find() that returned nullptr
+   * @return the number of cache misses
+   */
+  size_t GetMissCount() const;
+
+ private:
+  using Entry = std::pair<std::string, InstrumentRef>;
+
+  // Ordered from most to least recently used
+  std::list<Entry> entries_;
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+  size_t byte_budget_;
+  size_t hit_count_;
+  size_t miss_count_;
+};
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_INSTRUMENT_CACHE_H
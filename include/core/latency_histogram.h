@@ -0,0 +1,111 @@
+#ifndef SYNTHER_LATENCY_HISTOGRAM_H
+#define SYNTHER_LATENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace synther {
+
+namespace audio {
+
+/**
+ * A histogram of latencies that any number of threads record into while
+ *   other threads read it. Recording never locks or allocates, so it is safe
+ *   on the audio thread and the render workers that help it.
+ *
+ * Latencies are counted in log-linear buckets, in the style of an HDR
+ *   histogram: every power of two is split into kSubBucketCount equal
+ *   buckets, so every reported latency is within about 3% of the recorded
+ *   one, from nanoseconds up to about a minute. Longer latencies are counted
+ *   in the last bucket.
+ */
+class LatencyHistogram {
+ public:
+  /**
+   * Constructs an empty histogram
+   */
+  LatencyHistogram();
+
+  LatencyHistogram(const LatencyHistogram&) = delete;
+  LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+  /**
+   * Counts a latency. Safe to call from any thread, including several at
+   *   once
+   * @param nanoseconds the latency to count
+   */
+  void Record(uint64_t nanoseconds);
+
+  /**
+   * Forgets every recorded latency. Latencies recorded while the histogram
+   *   is being reset may be partly kept
+   */
+  void Reset();
+
+  /**
+   * Get the number of latencies recorded since the last reset. Safe to call
+   *   from any thread
+   * @return the number of recorded latencies
+   */
+  uint64_t GetCount() const;
+
+  /**
+   * Get the latency that a percentage of the recorded latencies are at or
+   *   below. Safe to call from any thread
+   * @param percentile the percentage of latencies, between 0 and 100
+   * @return the highest latency in the bucket holding the percentile, in
+   *   nanoseconds, or 0 if nothing was recorded
+   */
+  uint64_t GetPercentile(double percentile) const;
+
+  /**
+   * Get the longest latency recorded since the last reset. Safe to call from
+   *   any thread
+   * @return the longest latency in nanoseconds, or 0 if nothing was recorded
+   */
+  uint64_t GetMax() const;
+
+  /**
+   * Get the current time of the clock that latencies are measured with
+   * @return the time in nanoseconds since an arbitrary epoch. Never 0
+   */
+  static uint64_t Now();
+
+  // Buckets per power of two. Latencies of up to 2 * kSubBucketCount
+  // nanoseconds are counted exactly
+  static constexpr size_t kSubBucketBits = 5;
+  static constexpr size_t kSubBucketCount = size_t(1) << kSubBucketBits;
+
+  // Latencies of 2^kMaxExponent nanoseconds, about 68 seconds, or longer
+  // are counted in the last bucket
+  static constexpr size_t kMaxExponent = 36;
+  static constexpr size_t kBucketCount =
+      (kMaxExponent - kSubBucketBits + 1) * kSubBucketCount;
+
+ private:
+  std::vector<std::atomic<uint64_t>> counts_;
+  std::atomic<uint64_t> total_count_;
+  std::atomic<uint64_t> max_;
+
+  /**
+   * Get the bucket that counts a latency
+   * @param nanoseconds the latency
+   * @return the index of the bucket, below kBucketCount
+   */
+  static size_t GetBucket(uint64_t nanoseconds);
+
+  /**
+   * Get the highest latency that a bucket counts
+   * @param bucket the index of the bucket
+   * @return the highest latency in nanoseconds
+   */
+  static uint64_t GetBucketLimit(size_t bucket);
+};
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_LATENCY_HISTOGRAM_H
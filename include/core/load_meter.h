@@ -0,0 +1,88 @@
+#ifndef SYNTHER_LOAD_METER_H
+#define SYNTHER_LOAD_METER_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace synther {
+
+namespace audio {
+
+/**
+ * Measures how much of its real-time budget the audio thread spends
+ *   rendering. The budget of a block is the time it takes to play, so a load
+ *   of 1 means the block was rendered just in time, and blocks rendered with
+ *   a load above 1 are late and heard as a dropout.
+ *
+ * One thread records blocks while other threads read the load. Recording
+ *   never locks or allocates, so it is safe on the audio thread.
+ */
+class LoadMeter {
+ public:
+  /**
+   * Constructs a meter that hasn't measured any blocks
+   * @param time_constant the number of seconds of audio over which the
+   *   smoothed load moves most of the way to a new load
+   */
+  explicit LoadMeter(double time_constant = kDefaultTimeConstant);
+
+  LoadMeter(const LoadMeter&) = delete;
+  LoadMeter& operator=(const LoadMeter&) = delete;
+
+  /**
+   * Measures a rendered block. Must only be called from one thread
+   * @param busy_nanoseconds the time spent rendering the block
+   * @param budget_nanoseconds the time the block takes to play
+   */
+  void Record(uint64_t busy_nanoseconds, uint64_t budget_nanoseconds);
+
+  /**
+   * Get the load, exponentially smoothed over the time constant. Safe to
+   *   call from any thread
+   * @return the fraction of the budget spent rendering
+   */
+  double GetLoad() const;
+
+  /**
+   * Get the highest load of a single block since the last reset. Safe to
+   *   call from any thread
+   * @return the highest fraction of a block's budget spent rendering it
+   */
+  double GetPeakLoad() const;
+
+  /**
+   * Get the number of blocks that took longer to render than to play. Safe
+   *   to call from any thread
+   * @return the number of late blocks since the last reset
+   */
+  uint64_t GetLateBlockCount() const;
+
+  /**
+   * Get the number of blocks measured. Safe to call from any thread
+   * @return the number of blocks since the last reset
+   */
+  uint64_t GetBlockCount() const;
+
+  /**
+   * Forgets the peak load and the block counts, so a new measurement can
+   *   start. The smoothed load is kept. Safe to call from any thread
+   */
+  void Reset();
+
+  static constexpr double kDefaultTimeConstant = 0.5;
+
+ private:
+  double time_constant_;
+  // Only touched by the recording thread, and published through load_
+  double smoothed_load_;
+  std::atomic<double> load_;
+  std::atomic<double> peak_load_;
+  std::atomic<uint64_t> late_block_count_;
+  std::atomic<uint64_t> block_count_;
+};
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_LOAD_METER_H
@@ -0,0 +1,62 @@
+#ifndef SYNTHER_MAPPED_FILE_H
+#define SYNTHER_MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+namespace synther {
+
+namespace audio {
+
+/**
+ * A file mapped into memory for reading. The mapping is copy-on-write, so
+ *   writes through GetData() are private to the process and never reach the
+ *   file. The file is unmapped when the object is destroyed
+ */
+class MappedFile {
+ public:
+  /**
+   * Maps an entire file into memory. Check IsOpen() to see if it succeeded
+   * @param path the path of the file to map
+   */
+  explicit MappedFile(const std::string& path);
+
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  /**
+   * Check whether the file was mapped
+   * @return false if the file could not be opened or was empty
+   */
+  bool IsOpen() const;
+
+  /**
+   * Get a pointer to the first byte of the file
+   * @return a pointer to GetSize() bytes, or nullptr if the file is not open
+   */
+  char* GetData() const;
+
+  /**
+   * Get the size of the mapped file
+   * @return the size of the file in bytes
+   */
+  size_t GetSize() const;
+
+  /**
+   * Reads every page of the file into memory now, so that later reads, such
+   *   as from the audio thread, do not stall on disk access
+   */
+  void Prefault() const;
+
+ private:
+  char* data_;
+  size_t size_;
+};
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_MAPPED_FILE_H
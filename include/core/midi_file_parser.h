@@ -0,0 +1,50 @@
+#ifndef SYNTHER_MIDI_FILE_PARSER_H
+#define SYNTHER_MIDI_FILE_PARSER_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "core/note_event.h"
+
+namespace synther {
+
+namespace audio {
+
+/**
+ * Parses the note events of a Standard MIDI File, so performances recorded
+ *   on a keyboard or exported from a sequencer can be played or rendered.
+ *   Every track and channel plays through the same instrument, and the
+ *   tracks of format 2 files are merged like those of format 1 files:
+ *   - Note On and Note Off messages become NoteOn and NoteOff events, where
+ *     a Note On with a velocity of 0 is a Note Off. MIDI note 60 is C4
+ *   - Control Change 64 becomes SustainOn and SustainOff events
+ *   - Set Tempo meta events change the length of a tick from then on, in
+ *     every track. Other messages are skipped
+ */
+class MidiFileParser {
+ public:
+  /**
+   * Construct a parser using a stream of MIDI file data
+   * @param midi a binary stream holding a Standard MIDI File
+   */
+  explicit MidiFileParser(std::istream& midi);
+
+  /**
+   * Converts every note and sustain message in the file into a
+   *   TimedNoteEvent. Throws an exception if the file is malformed
+   * @return a vector of events sorted by time in seconds from the start of
+   *   the file. Events with equal times keep their order within their track,
+   *   and earlier tracks come first
+   */
+  std::vector<TimedNoteEvent> GetEvents() const;
+
+ private:
+  std::string bytes_;
+};
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_MIDI_FILE_PARSER_H
@@ -0,0 +1,212 @@
+#ifndef SYNTHER_MIX_KERNEL_H
+#define SYNTHER_MIX_KERNEL_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Instruction sets the kernels were compiled for. SSE2 is part of every
+// x86-64 target, while AVX2 must be enabled with the SYNTHER_ENABLE_AVX2 CMake
+// option since not every CPU supports it
+#if defined(__AVX2__)
+#define SYNTHER_MIX_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SYNTHER_MIX_SSE2 1
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SYNTHER_MIX_NEON 1
+#endif
+
+namespace synther {
+
+namespace audio {
+
+// Scales 16-bit samples to the [-1, 1] range of float samples
+constexpr float kPcmScale = 1.0f / 32768.0f;
+
+/**
+ * One channel of a voice to be mixed into an output block. The gain follows
+ *   a linear ramp over the block: frame i is scaled by gain_ + i * gain_step_,
+ *   clamped between 0 and 1, so a fade can end part-way through the block.
+ *
+ * Samples stored as 16-bit integers are converted to floats as they are
+ *   mixed, so they are never expanded into a separate buffer
+ */
+struct MixSource {
+  // At least as many samples as the number of frames being mixed. Ignored if
+  // pcm_samples_ is set
+  const float* samples_;
+  float gain_;
+  float gain_step_;
+  // If not nullptr, the source is mixed from these samples instead, each
+  // scaled by kPcmScale
+  const int16_t* pcm_samples_;
+};
+
+/**
+ * Adds every source into an output block, applying each source's gain ramp in
+ *   the same pass. Uses the widest instruction set that was compiled in
+ * @param sources a pointer to the first source to mix
+ * @param source_count the number of sources
+ * @param output the block that the sources are added to
+ * @param num_frames the number of frames in the block
+ */
+void MixVoices(const MixSource* sources, size_t source_count, float* output,
+               size_t num_frames);
+
+/**
+ * Reference implementation of MixVoices() that processes one frame at a time.
+ *   The vectorized kernels must produce the same output within rounding error
+ */
+void MixVoicesScalar(const MixSource* sources, size_t source_count,
+                     float* output, size_t num_frames);
+
+#ifdef SYNTHER_MIX_SSE2
+/**
+ * Implementation of MixVoices() that mixes four frames at a time with SSE2
+ */
+void MixVoicesSse2(const MixSource* sources, size_t source_count,
+                   float* output, size_t num_frames);
+#endif
+
+#ifdef SYNTHER_MIX_AVX2
+/**
+ * Implementation of MixVoices() that mixes eight frames at a time with AVX2
+ */
+void MixVoicesAvx2(const MixSource* sources, size_t source_count,
+                   float* output, size_t num_frames);
+#endif
+
+#ifdef SYNTHER_MIX_NEON
+/**
+ * Implementation of MixVoices() that mixes four frames at a time with NEON
+ */
+void MixVoicesNeon(const MixSource* sources, size_t source_count,
+                   float* output, size_t num_frames);
+#endif
+
+/**
+ * Computes the sum of the products of two arrays. Used to apply the filter
+ *   taps of the resampler. Uses the widest instruction set that was compiled
+ *   in
+ * @param first a pointer to the first array
+ * @param second a pointer to the second array
+ * @param count the number of elements in each array
+ * @return the dot product of the arrays
+ */
+float DotProduct(const float* first, const float* second, size_t count);
+
+/**
+ * Reference implementation of DotProduct() that multiplies one element at a
+ *   time. The vectorized kernels must produce the same result within
+ *   rounding error
+ */
+float DotProductScalar(const float* first, const float* second, size_t count);
+
+#ifdef SYNTHER_MIX_SSE2
+/**
+ * Implementation of DotProduct() that multiplies four elements at a time with
+ *   SSE2
+ */
+float DotProductSse2(const float* first, const float* second, size_t count);
+#endif
+
+#ifdef SYNTHER_MIX_AVX2
+/**
+ * Implementation of DotProduct() that multiplies eight elements at a time
+ *   with AVX2
+ */
+float DotProductAvx2(const float* first, const float* second, size_t count);
+#endif
+
+#ifdef SYNTHER_MIX_NEON
+/**
+ * Implementation of DotProduct() that multiplies four elements at a time with
+ *   NEON
+ */
+float DotProductNeon(const float* first, const float* second, size_t count);
+#endif
+
+/**
+ * Multiplies two arrays of complex numbers element by element and adds the
+ *   products to a third. Every array is split into separate real and
+ *   imaginary parts. Used to convolve spectra in the frequency domain. Uses
+ *   the widest instruction set that was compiled in
+ * @param first_real the real parts of the first array
+ * @param first_imag the imaginary parts of the first array
+ * @param second_real the real parts of the second array
+ * @param second_imag the imaginary parts of the second array
+ * @param output_real the real parts that the products are added to
+ * @param output_imag the imaginary parts that the products are added to
+ * @param count the number of elements in each array
+ */
+void ComplexMultiplyAccumulate(const float* first_real,
+                               const float* first_imag,
+                               const float* second_real,
+                               const float* second_imag, float* output_real,
+                               float* output_imag, size_t count);
+
+/**
+ * Reference implementation of ComplexMultiplyAccumulate() that multiplies one
+ *   element at a time. The vectorized kernels must produce the same result
+ *   within rounding error
+ */
+void ComplexMultiplyAccumulateScalar(const float* first_real,
+                                     const float* first_imag,
+                                     const float* second_real,
+                                     const float* second_imag,
+                                     float* output_real, float* output_imag,
+                                     size_t count);
+
+#ifdef SYNTHER_MIX_SSE2
+/**
+ * Implementation of ComplexMultiplyAccumulate() that multiplies four elements
+ *   at a time with SSE2
+ */
+void ComplexMultiplyAccumulateSse2(const float* first_real,
+                                   const float* first_imag,
+                                   const float* second_real,
+                                   const float* second_imag,
+                                   float* output_real, float* output_imag,
+                                   size_t count);
+#endif
+
+#ifdef SYNTHER_MIX_AVX2
+/**
+ * Implementation of ComplexMultiplyAccumulate() that multiplies eight
+ *   elements at a time with AVX2
+ */
+void ComplexMultiplyAccumulateAvx2(const float* first_real,
+                                   const float* first_imag,
+                                   const float* second_real,
+                                   const float* second_imag,
+                                   float* output_real, float* output_imag,
+                                   size_t count);
+#endif
+
+#ifdef SYNTHER_MIX_NEON
+/**
+ * Implementation of ComplexMultiplyAccumulate() that multiplies four elements
+ *   at a time with NEON
+ */
+void ComplexMultiplyAccumulateNeon(const float* first_real,
+                                   const float* first_imag,
+                                   const float* second_real,
+                                   const float* second_imag,
+                                   float* output_real, float* output_imag,
+                                   size_t count);
+#endif
+
+/**
+ * Get the name of the kernel used by MixVoices(), DotProduct() and
+ *   ComplexMultiplyAccumulate(), for reporting
+ * @return the name of the instruction set used by MixVoices()
+ */
+const char* GetMixKernelName();
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_MIX_KERNEL_H
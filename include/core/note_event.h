@@ -0,0 +1,83 @@
+#ifndef SYNTHER_NOTE_EVENT_H
+#define SYNTHER_NOTE_EVENT_H
+
+#include <cstdint>
+
+namespace synther {
+
+namespace audio {
+
+/**
+ * A compact message sent from the main thread to the audio thread. Events are
+ *   applied by the Sampler at the start of the next rendered block
+ */
+struct NoteEvent {
+  enum class Type { NoteOn, NoteOff, ResonateChange, SustainOn, SustainOff };
+
+  Type type_;
+  // The semitone index of the note, for NoteOn and NoteOff
+  int semitone_;
+  // The new resonate duration in seconds, for ResonateChange
+  float value_;
+  // When the event was posted, from LatencyHistogram::Now(), or 0 if the
+  // latency of a NoteOn is not measured
+  uint64_t post_time_;
+
+  /**
+   * Creates an event that starts a new voice for a note
+   * @param semitone the semitone index of the note to play
+   * @param post_time when the event is posted, to measure how long the note
+   *   takes to be heard. 0 doesn't measure it
+   */
+  static NoteEvent NoteOn(int semitone, uint64_t post_time = 0) {
+    return {Type::NoteOn, semitone, 0, post_time};
+  }
+
+  /**
+   * Creates an event that releases the held voices of a note
+   * @param semitone the semitone index of the note to release
+   */
+  static NoteEvent NoteOff(int semitone) {
+    return {Type::NoteOff, semitone, 0, 0};
+  }
+
+  /**
+   * Creates an event that changes how long released notes resonate
+   * @param resonate_duration the new resonate duration, in seconds
+   */
+  static NoteEvent ResonateChange(double resonate_duration) {
+    return {Type::ResonateChange, 0, static_cast<float>(resonate_duration),
+            0};
+  }
+
+  /**
+   * Creates an event that presses the sustain pedal. Notes released while
+   *   the pedal is down keep sounding until it is lifted
+   */
+  static NoteEvent SustainOn() {
+    return {Type::SustainOn, 0, 0, 0};
+  }
+
+  /**
+   * Creates an event that lifts the sustain pedal, releasing every note that
+   *   the pedal was sustaining
+   */
+  static NoteEvent SustainOff() {
+    return {Type::SustainOff, 0, 0, 0};
+  }
+};
+
+/**
+ * A NoteEvent scheduled at a point in time, measured in seconds from the
+ *   start of a performance
+ */
+struct TimedNoteEvent {
+  double time_;
+  NoteEvent event_;
+};
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_NOTE_EVENT_H
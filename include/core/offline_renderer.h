@@ -0,0 +1,108 @@
+#ifndef SYNTHER_OFFLINE_RENDERER_H
+#define SYNTHER_OFFLINE_RENDERER_H
+
+#include <cstddef>
+#include <map>
+#include <ostream>
+#include <vector>
+
+#include "core/note_event.h"
+#include "core/sample_buffer.h"
+#include "core/sampler.h"
+
+namespace synther {
+
+namespace audio {
+
+/**
+ * Timing of an offline render
+ */
+struct OfflineRenderStats {
+  // Duration of the rendered audio
+  double rendered_seconds_;
+  // Wall-clock time spent rendering
+  double wall_seconds_;
+
+  /**
+   * Get the render throughput as a multiple of real time
+   * @return how many seconds of audio were rendered per second of wall time
+   */
+  double GetRealtimeFactor() const;
+};
+
+/**
+ * Renders a list of timed note events through a Sampler as fast as the CPU
+ *   allows, without an audio device. Events are played as a performance by
+ *   Sampler::PlaySequence(), which applies them on the exact frame of their
+ *   timestamp just like live playback, so a render is fully reproducible.
+ *   Used for headless regression tests, for rendering MIDI files to WAV, and
+ *   as a load generator for profiling the engine.
+ */
+class OfflineRenderer {
+ public:
+  /**
+   * Constructs a renderer without any samples
+   * @param sample_rate the sample rate of the rendered audio in Hz
+   * @param num_channels the number of channels of the rendered audio
+   * @param resonate_duration the initial resonate duration of the sampler
+   * @param polyphony the maximum number of voices that may sound at once
+   */
+  OfflineRenderer(size_t sample_rate, size_t num_channels,
+                  double resonate_duration,
+                  size_t polyphony = Sampler::kDefaultPolyphony);
+
+  /**
+   * Replaces every sample used for rendering
+   * @param samples a map from semitone indices to decoded samples, which must
+   *   have been decoded at the renderer's sample rate
+   */
+  void SetSamples(const std::map<int, SampleBufferRef>& samples);
+
+  /**
+   * Renders a performance, replacing any previous output. Rendering continues
+   *   after the last event until every voice has finished sounding, or until
+   *   max_tail_duration has passed
+   * @param events the events to render, sorted by time
+   * @param max_tail_duration the longest time to keep rendering after the
+   *   last event, in seconds
+   * @return the duration of the rendered audio and the time it took to render
+   */
+  OfflineRenderStats Render(const std::vector<TimedNoteEvent>& events,
+                            double max_tail_duration);
+
+  /**
+   * Get the audio produced by the last call to Render()
+   * @return the rendered samples, interleaved by channel
+   */
+  const std::vector<float>& GetOutput() const;
+
+  /**
+   * Writes the audio produced by the last call to Render() as a WAV file
+   * @param out a binary output stream
+   */
+  void WriteWav(std::ostream& out) const;
+
+  // Number of frames rendered at a time, matching a typical device block
+  static constexpr size_t kBlockFrames = 64;
+
+ private:
+  Sampler sampler_;
+  size_t sample_rate_;
+  size_t num_channels_;
+  // Non-interleaved scratch buffer for one block
+  std::vector<float> block_;
+  std::vector<float> output_;
+
+  /**
+   * Renders frames in blocks of at most kBlockFrames, appending them to the
+   *   output
+   * @param num_frames the number of frames to render
+   */
+  void RenderFrames(size_t num_frames);
+};
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_OFFLINE_RENDERER_H
@@ -0,0 +1,34 @@
+#ifndef SYNTHER_PARALLEL_FOR_H
+#define SYNTHER_PARALLEL_FOR_H
+
+#include <cstddef>
+#include <functional>
+
+namespace synther {
+
+namespace audio {
+
+/**
+ * Get the number of worker threads that fit the machine
+ * @return the number of hardware threads, or 1 if it cannot be detected
+ */
+size_t GetHardwareThreadCount();
+
+/**
+ * Runs a task once for every index in [0, count), spread over a pool of
+ *   worker threads. Each worker claims the next unclaimed index, so slow
+ *   tasks do not hold up the others. Returns once every task has finished
+ * @param count the number of tasks to run
+ * @param num_threads the maximum number of threads to run tasks on. 0 uses
+ *   one thread per hardware thread. The calling thread is one of the workers
+ * @param task the function to call with each index. Must not throw, and must
+ *   be safe to call from several threads at once
+ */
+void ParallelFor(size_t count, size_t num_threads,
+                 const std::function<void(size_t)>& task);
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_PARALLEL_FOR_H
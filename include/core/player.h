@@ -5,12 +5,21 @@
 #ifndef SYNTHER_PLAYER_H
 #define SYNTHER_PLAYER_H
 
+#include <cstdint>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "cinder/audio/audio.h"
+#include "core/convolution_reverb.h"
+#include "core/instrument.h"
 #include "core/music_note.h"
+#include "core/note_event.h"
+#include "core/sample_buffer.h"
+#include "core/sample_loader.h"
+#include "core/sample_prefetcher.h"
+#include "core/sampler_node.h"
 
 namespace synther {
 
@@ -20,17 +29,273 @@ namespace audio {
  * Handles audio playback using discrete notes, mapping music::Notes to
  *   sound files. Offers methods for playing notes and simple sound processing
  *   to mimic a real piano
+ *
+ * Every note is rendered by a single SamplerNode connected to the output of
+ *   the master audio context, so only the notes that are sounding cost any
+ *   processing time. Note methods only queue events for the audio thread, so
+ *   they never wait on audio rendering
  */
 class Player {
  public:
   /**
    * Constructs an empty Player object. Does not initialize any voices, so a
    *   constructed Player cannot immediately be used for audio playback
+   * @param resonate_duration the number of seconds a note resonates after
+   *   StopNote() is called
+   * @param polyphony the maximum number of voices that may sound at once.
+   *   Every call to PlayNote() starts a new voice, so a note struck again
+   *   while it resonates keeps its previous tail ringing
+   * @param steal_policy decides which voice is cut off when a note is played
+   *   while the polyphony has been reached
    */
-  explicit Player(double resonate_duration);
+  explicit Player(double resonate_duration,
+                  size_t polyphony = Sampler::kDefaultPolyphony,
+                  StealPolicy steal_policy = StealPolicy::Oldest);
 
   /**
-   * Sets up a map from music::Notes to audio voices. Enables audio playback
+   * Loads only the notes near the keyboard's view instead of every note of
+   *   the instrument. Notes are loaded in the background as the view moves,
+   *   and notes that leave the range are unloaded once they are silent.
+   *   Takes effect on the next call to LoadInstrument()
+   * @param lazy_loading true to load notes as they come into range, false
+   *   to load every note in LoadInstrument()
+   * @param neighbor_octaves the number of octaves on each side of the view
+   *   that are kept loaded, so nearby notes are ready before they are shown
+   */
+  void SetLazyLoading(bool lazy_loading,
+                      size_t neighbor_octaves = kDefaultNeighborOctaves);
+
+  /**
+   * Holds only the first part of every long sample in memory and streams
+   *   the rest from disk while the note plays, which bounds memory for large
+   *   libraries. Takes effect on the next instrument that is set
+   * @param head_duration the number of seconds of every sample held in
+   *   memory. Must cover the time taken to start reading from disk. 0 holds
+   *   whole samples in memory
+   */
+  void SetStreaming(double head_duration);
+
+  /**
+   * Loads only every Nth sample of an instrument, which divides the memory
+   *   taken by its samples by about N. Notes without a loaded sample play
+   *   the nearest loaded sample, pitch-shifted. Takes effect on the next call
+   *   to LoadInstrument()
+   * @param sample_stride the distance in semitones between loaded samples.
+   *   1 loads every sample. Samples further apart than the stride are all
+   *   loaded, so gaps in an instrument are never widened
+   */
+  void SetSampleStride(size_t sample_stride);
+
+  /**
+   * Stores samples as 16-bit integers and downmixes stereo files recorded in
+   *   mono, which cuts sample memory by 2 to 4 times. Takes effect on the next
+   *   call to LoadInstrument()
+   * @param format the type to store samples as
+   * @param is_downmixed true to keep one channel of mono-compatible samples
+   */
+  void SetStorage(SampleFormat format, bool is_downmixed);
+
+  /**
+   * Opens an output device and moves the audio graph onto it, while the
+   *   loaded instrument keeps playing. The device is asked to keep the
+   *   current sample rate, which the loaded samples were resampled to.
+   *   Smaller blocks lower the latency at the cost of more callbacks, each
+   *   with less time to render
+   * @param device_name the name of the output device, as returned by
+   *   GetOutputDeviceNames(), or an empty string for the default device
+   * @param frames_per_block the number of frames the device is asked to
+   *   request in every callback. Clamped between kMinFramesPerBlock and
+   *   kMaxFramesPerBlock. Devices may round it to a size they support
+   * @return true if the device was opened, false if no output device has
+   *   the name or the device can't run at the current sample rate, in which
+   *   case the graph keeps playing through the current device
+   */
+  bool SetOutputDevice(const std::string& device_name,
+                       size_t frames_per_block);
+
+  /**
+   * Get the name of the output device the audio graph plays through
+   * @return the name of the output device
+   */
+  std::string GetOutputDeviceName() const;
+
+  /**
+   * Get the number of frames the output device requests in every callback,
+   *   which may differ from the number asked for in SetOutputDevice()
+   * @return the number of frames per block
+   */
+  size_t GetFramesPerBlock() const;
+
+  /**
+   * Get how long a block takes to play at the output's sample rate. A note
+   *   is heard up to one block after it is rendered, on top of the latency
+   *   in the latency histogram
+   * @return the duration of one block, in seconds
+   */
+  double GetBlockLatency() const;
+
+  /**
+   * Get the names of every output device that SetOutputDevice() can open
+   * @return the names of the output devices
+   */
+  static std::vector<std::string> GetOutputDeviceNames();
+
+  /**
+   * Places every note in the space recorded by an impulse response. The
+   *   impulse is decoded like an instrument sample, at the output's sample
+   *   rate, and the parts of long impulses that are heard later are
+   *   convolved on a background thread. Kept when the instrument changes
+   * @param impulse_file the relative path from the assets directory to the
+   *   sound file of the impulse response
+   * @param wet_gain the gain of the reverberated notes, which are mixed
+   *   with the notes at full gain
+   * @return true if the impulse was loaded, false if the file cannot be
+   *   read, in which case the previous reverb is kept
+   */
+  bool SetReverb(const std::string& impulse_file, float wet_gain);
+
+  /**
+   * Stops reverberating the notes
+   */
+  void RemoveReverb();
+
+  /**
+   * Check whether the notes are reverberated
+   * @return true if a reverb has been set
+   */
+  bool HasReverb() const;
+
+  /**
+   * Prepares an instrument for playback without changing the instrument
+   *   being played. Decoded sound files are cached on disk, so preparing the
+   *   same instrument again maps the cached samples instead of decoding them.
+   *   With lazy loading, no notes are loaded until the instrument is set and
+   *   SetView() is called. May be called from a background thread while the
+   *   Player is used on the main thread, as long as the loading options
+   *   aren't changed meanwhile
+   * @param name the name of the instrument
+   * @param note_files a std::map from music::Notes to strings of file names.
+   *   If a file cannot be read, the note is not playable
+   * @param instrument_directory the relative path from the assets directory
+   *   to the directory containing the instrument sound files
+   * @return the prepared instrument
+   */
+  InstrumentRef LoadInstrument(
+      const std::string& name,
+      const std::map<music::Note, std::string>& note_files,
+      const std::string& instrument_directory) const;
+
+  /**
+   * Switches playback to a prepared instrument. Its loaded samples are handed
+   *   to the audio thread at once, so switching back to an instrument that
+   *   was prepared earlier does not read any files. The previous instrument
+   *   keeps playing until the swap, and its sounding notes fade out over
+   *   kCrossfadeDuration instead of being cut off. With lazy loading, the
+   *   swap waits in Update() until the notes in view are loaded. Enables
+   *   audio playback
+   * @param instrument an instrument returned by LoadInstrument(). The Player
+   *   keeps its loaded samples up to date as notes are lazily loaded
+   */
+  void SetInstrument(const InstrumentRef& instrument);
+
+  /**
+   * Get the instrument being played
+   * @return the current instrument, or nullptr if none has been set
+   */
+  const InstrumentRef& GetInstrument() const;
+
+  /**
+   * Loads the samples an instrument needs to play a range of notes, which
+   *   includes the samples just outside of the range that are pitch-shifted
+   *   into it. Samples that are already loaded are kept, so instruments
+   *   loaded without lazy loading are left as they are. May be called from
+   *   a background thread for an instrument that isn't being played
+   * @param instrument an instrument returned by LoadInstrument()
+   * @param lowest_semitone the semitone index of the lowest note to load
+   * @param highest_semitone the semitone index of the highest note to load
+   */
+  void LoadRange(Instrument& instrument, int lowest_semitone,
+                 int highest_semitone) const;
+
+  /**
+   * Finds the sound files LoadRange() would load, without reading them, so
+   *   an instrument that is being played can have them decoded in the
+   *   background and merged in afterwards
+   * @param instrument an instrument returned by LoadInstrument()
+   * @param lowest_semitone the semitone index of the lowest note to load
+   * @param highest_semitone the semitone index of the highest note to load
+   * @return the full paths of the samples the range needs that aren't
+   *   loaded, by the note of the sample
+   */
+  std::map<music::Note, ci::fs::path> GetRangePaths(
+      const Instrument& instrument, int lowest_semitone,
+      int highest_semitone) const;
+
+  /**
+   * Decodes sound files like the samples of a loaded instrument. May be
+   *   called from a background thread
+   * @param note_paths the full paths of the sound files, by note
+   * @return a map from semitone indices to the samples that could be read
+   */
+  std::map<int, SampleBufferRef> LoadSampleFiles(
+      const std::map<music::Note, ci::fs::path>& note_paths) const;
+
+  /**
+   * Plays a prepared instrument alongside the current instrument, on its own
+   *   range of notes and at its own gain. Layers whose ranges overlap sound
+   *   together, while layers with adjacent ranges split the keyboard. Every
+   *   layer is rendered by the same SamplerNode, and layers of the same
+   *   instrument share its samples. The notes of an instrument the layer
+   *   played before fade out over kCrossfadeDuration. Samples the range
+   *   needs are loaded with LoadRange() first, so the layer isn't lazily
+   *   loaded as the view moves. Callers that mustn't block can decode them
+   *   beforehand with GetRangePaths() and LoadSampleFiles()
+   * @param layer the layer, between 1 and Sampler::kMaxLayers - 1. Layer 0
+   *   plays the instrument set with SetInstrument()
+   * @param instrument an instrument returned by LoadInstrument()
+   * @param lowest_semitone the semitone index of the lowest note the layer
+   *   plays
+   * @param highest_semitone the semitone index of the highest note the
+   *   layer plays
+   * @param gain the gain of the layer, between 0 and 1
+   * @return true if the layer was set, false if it is out of range
+   */
+  bool SetLayer(size_t layer, const InstrumentRef& instrument,
+                int lowest_semitone, int highest_semitone, float gain);
+
+  /**
+   * Stops playing the instrument of a layer. Its sounding notes fade out
+   *   over kCrossfadeDuration
+   * @param layer the layer, between 1 and Sampler::kMaxLayers - 1
+   */
+  void RemoveLayer(size_t layer);
+
+  /**
+   * Get the instrument played by a layer
+   * @param layer the layer, below Sampler::kMaxLayers
+   * @return the instrument of the layer, or nullptr if it plays none
+   */
+  InstrumentRef GetLayerInstrument(size_t layer) const;
+
+  /**
+   * Sets the notes a layer plays, so the current instrument can be split
+   *   from the other layers. Kept when instruments change
+   * @param layer the layer, below Sampler::kMaxLayers
+   * @param lowest_semitone the semitone index of the lowest note played
+   * @param highest_semitone the semitone index of the highest note played
+   */
+  void SetLayerRange(size_t layer, int lowest_semitone, int highest_semitone);
+
+  /**
+   * Sets the gain a layer is mixed at. Kept when instruments change
+   * @param layer the layer, below Sampler::kMaxLayers
+   * @param gain the gain of the layer, between 0 and 1
+   */
+  void SetLayerGain(size_t layer, float gain);
+
+  /**
+   * Sets up a map from music::Notes to audio voices. Enables audio playback.
+   *   Equivalent to setting an instrument returned by LoadInstrument()
    * @param note_files a std::map from music::Notes to strings of file names.
    *   If a file cannot be read, does not initialize the voice at that note
    * @param instrument_directory the relative path from the assets directory
@@ -39,14 +304,46 @@ class Player {
   void SetUpVoices(const std::map<music::Note, std::string>& note_files,
                    const std::string& instrument_directory);
 
+  /**
+   * Sets the range of notes shown on the keyboard. With lazy loading, the
+   *   notes in view are loaded first, followed by their neighbors in the
+   *   direction the view moved. Does nothing without lazy loading
+   * @param lowest_semitone the semitone index of the lowest note in view
+   * @param highest_semitone the semitone index of the highest note in view
+   */
+  void SetView(int lowest_semitone, int highest_semitone);
+
+  /**
+   * Hands notes that finished loading to the audio thread, and unloads notes
+   *   that are out of range and silent. Swaps in an instrument or layer that
+   *   is ready, and frees the samples of instruments that have faded out.
+   *   Should be called once per frame
+   */
+  void Update();
+
+  /**
+   * Check whether an instrument has been set but not swapped in yet, in
+   *   which case the previous instrument is still playing
+   * @return true if the current instrument is still loading
+   */
+  bool IsLoadingInstrument() const;
+
   /**
    * Plays the note corresponding to the specified note from the default
    *   audio device. The note will play for the entire duration of the
-   *   sound file, unless StopNote is called
+   *   sound file, unless StopNote is called. The time it takes the note to
+   *   be heard is recorded in the latency histogram
    * @param note a music::Note representing the note to start playing
    */
   void PlayNote(const music::Note& note);
 
+  /**
+   * Plays several notes at once. All of the notes are guaranteed to start in
+   *   the same audio block
+   * @param notes a vector of music::Notes to start playing
+   */
+  void PlayChord(const std::vector<music::Note>& notes);
+
   /**
    * Stops playing the note corresponding to the specified note. The note
    *   will resonate for a small amount of time to mimic a classic piano.
@@ -70,6 +367,108 @@ class Player {
    */
   double GetResonateDuration() const;
 
+  /**
+   * Press or lift the sustain pedal. Notes stopped while the pedal is down
+   *   keep sounding until it is lifted, and then resonate as usual. Posts a
+   *   single event to the audio thread
+   * @param is_down true to press the pedal, false to lift it
+   */
+  void SetSustain(bool is_down);
+
+  /**
+   * Check whether the sustain pedal is down
+   * @return true if the sustain pedal is down
+   */
+  bool IsSustainDown() const;
+
+  /**
+   * Finds the sound files of the current instrument that a performance
+   *   needs and that aren't loaded, without reading them, so they can be
+   *   decoded in the background with LoadSampleFiles()
+   * @param events the events of the performance
+   * @return the full paths of the samples the NoteOn events play, by the
+   *   note of the sample
+   */
+  std::map<music::Note, ci::fs::path> GetSequencePaths(
+      const std::vector<TimedNoteEvent>& events) const;
+
+  /**
+   * Plays a performance, such as the events of a MIDI file, through the
+   *   instrument and all of its layers. Every event is applied by the audio
+   *   thread on its exact frame, and the previous performance is stopped.
+   *   With lazy loading, the notes the performance plays stay loaded until
+   *   it ends, wherever the view is
+   * @param events the events to play, timed in seconds from now
+   * @param samples samples of the current instrument decoded for the
+   *   performance, such as those found by GetSequencePaths(). Notes that are
+   *   already loaded keep their samples
+   * @return true if the performance was queued, false if there is no
+   *   instrument or earlier performances have not been collected yet by
+   *   TakeSequenceEvents()
+   */
+  bool PlaySequence(const std::vector<TimedNoteEvent>& events,
+                    const std::map<int, SampleBufferRef>& samples =
+                        std::map<int, SampleBufferRef>());
+
+  /**
+   * Stops the performance being played, releasing the notes it holds
+   * @return true if the stop was queued, false if there is no instrument or
+   *   earlier performances have not been collected yet
+   */
+  bool StopSequence();
+
+  /**
+   * Check whether a performance is being played
+   * @return true until the last event of the performance has been applied or
+   *   it has been stopped
+   */
+  bool IsPlayingSequence() const;
+
+  /**
+   * Takes the NoteOn and NoteOff events the performance has played so far,
+   *   so the notes can be shown as they sound. Should be called every frame
+   *   while a performance is playing
+   * @return the events in the order they were played
+   */
+  std::vector<NoteEvent> TakeSequenceEvents();
+
+  /**
+   * Get how long the current instrument spent loading sound files when it
+   *   was prepared. Files are decoded on one thread per core, or mapped from
+   *   the cache
+   * @return the wall-clock loading time, in seconds
+   */
+  double GetLastLoadDuration() const;
+
+  /**
+   * Set the maximum number of voices that may sound at once. If more voices
+   *   are sounding, the excess voices are cut off according to the steal policy
+   * @param polyphony the new polyphony, between 1 and Sampler::kMaxPolyphony
+   */
+  void SetPolyphony(size_t polyphony);
+
+  /**
+   * Set the policy that decides which voice is cut off when a note is played
+   *   while the polyphony has been reached
+   * @param steal_policy the new steal policy
+   */
+  void SetStealPolicy(StealPolicy steal_policy);
+
+  /**
+   * Set how long notes take to rise from silence to full gain when played
+   * @param attack_duration the attack duration, in seconds. 0 plays notes at
+   *   full gain from their first frame
+   */
+  void SetAttackDuration(double attack_duration);
+
+  /**
+   * Set the number of threads that mix the notes of every block, so dense
+   *   playing is spread over several cores
+   * @param thread_count the number of threads, including the audio thread,
+   *   between 1 and Sampler::kMaxRenderThreads
+   */
+  void SetRenderThreadCount(size_t thread_count);
+
   /**
    * Gets a vector of all the notes that are playable in the current state of
    *   the player. In other words, returns a vector of all of notes currently
@@ -78,15 +477,145 @@ class Player {
    */
   std::vector<music::Note> GetPlayableNotes() const;
 
+  /**
+   * Get the number of notes whose samples are currently loaded
+   * @return the number of loaded notes
+   */
+  size_t GetLoadedNoteCount() const;
+
+  /**
+   * Get the number of times a streamed note was not read from disk in time,
+   *   which is heard as a dropout
+   * @return the total number of stream underruns
+   */
+  uint64_t GetStreamUnderrunCount() const;
+
+  /**
+   * Get the latencies of the notes played so far, from PlayNote() or
+   *   PlayChord() being called to the note's first non-zero rendered frame
+   * @return the histogram of note latencies, or nullptr if no instrument has
+   *   been set
+   */
+  const LatencyHistogram* GetLatencyHistogram() const;
+
+  /**
+   * Get how much of every audio block's real-time budget was spent
+   *   rendering it. Blocks that take longer than their budget are heard as
+   *   dropouts
+   * @return the meter of the rendering load, or nullptr if no instrument has
+   *   been set
+   */
+  const LoadMeter* GetLoadMeter() const;
+
+  // Octaves kept loaded on each side of the view with lazy loading
+  static constexpr size_t kDefaultNeighborOctaves = 1;
+
+  // Seconds over which the notes of the previous instrument fade out when
+  // an instrument is set
+  static constexpr double kCrossfadeDuration = 0.05;
+
+  // Range of block sizes that may be asked of an output device
+  static constexpr size_t kMinFramesPerBlock = 32;
+  static constexpr size_t kMaxFramesPerBlock = 1024;
+
  private:
-  struct NoteVoice {
-    ci::audio::GainNodeRef gain_;
-    ci::audio::BufferPlayerNodeRef buffer_player_;
-    bool is_playing_;
-  };
-  // Maps semitones to voices
-  std::map<int, NoteVoice> voices_;
+  InstrumentRef instrument_;
+  SamplerNodeRef sampler_;
+  ConvolutionReverbRef reverb_;
   double resonate_duration_;
+  size_t polyphony_;
+  StealPolicy steal_policy_;
+  double attack_duration_;
+  size_t render_thread_count_;
+  bool is_sustain_down_;
+
+  /**
+   * An instrument played alongside the current instrument, or the range and
+   *   gain of the current instrument itself
+   */
+  struct Layer {
+    // Only set for layers above 0
+    InstrumentRef instrument_;
+    // The samples handed to the sampler, which share the instrument's data
+    std::map<int, SampleBufferRef> samples_;
+    int lowest_semitone_;
+    int highest_semitone_;
+    float gain_;
+    // Set until the samples have been handed to the sampler
+    bool is_swap_pending_;
+  };
+  std::vector<Layer> layers_;
+  // 0 when samples are held whole in memory
+  double stream_head_duration_;
+  size_t sample_stride_;
+  SampleFormat storage_format_;
+  bool is_downmixed_;
+
+  // Lazy loading
+  bool lazy_loading_;
+  size_t neighbor_octaves_;
+  // Created by the first lazily loaded instrument, and reused by later ones
+  std::unique_ptr<SamplePrefetcher> prefetcher_;
+  bool is_prefetching_;
+  // Set until the current instrument has been handed to the sampler
+  bool is_swap_pending_;
+  int view_lowest_semitone_;
+  int view_highest_semitone_;
+  // Notes outside of this range are unloaded once they are silent
+  int resident_lowest_semitone_;
+  int resident_highest_semitone_;
+  // The range of notes the last performance plays, which stay loaded while
+  // it is playing
+  int sequence_lowest_semitone_;
+  int sequence_highest_semitone_;
+  // Set from PlaySequence() until the audio thread starts the performance
+  bool is_sequence_starting_;
+
+  static constexpr int kSemitonesPerOctave = 12;
+
+  // Channels of the reverb, which match the stereo SamplerNode
+  static constexpr size_t kReverbChannels = 2;
+
+  /**
+   * Check whether a note should stay loaded with lazy loading
+   * @param semitone the semitone index of the note
+   * @return true if the note is within the neighbor octaves of the view or
+   *   the range of the performance being played, or if a note within them
+   *   plays its sample
+   */
+  bool IsResident(int semitone) const;
+
+  /**
+   * Check whether a range of notes needs a note's sample
+   * @param semitone the semitone index of the note
+   * @param lowest_semitone the semitone index of the lowest note in range
+   * @param highest_semitone the semitone index of the highest note in range
+   * @return true if the note is in range, or if a note in range plays its
+   *   sample
+   */
+  bool IsInRange(int semitone, int lowest_semitone,
+                 int highest_semitone) const;
+
+  /**
+   * Finds the sample that plays a note of the current instrument, which is
+   *   the nearest playable note within Sampler::kMaxPitchShift
+   * @param semitone the semitone index of the note
+   * @return the semitone index of the sample, or -1 if there is none
+   */
+  int FindSampleSemitone(int semitone) const;
+
+  /**
+   * Check whether every playable note in view has been loaded
+   * @return true once SetView() has been called for the current instrument
+   *   and the notes in view are ready
+   */
+  bool IsViewLoaded() const;
+
+  /**
+   * Creates a loader for the sample rate of the audio device
+   * @return a loader that caches and streams samples as configured
+   */
+  std::shared_ptr<SampleLoader> MakeLoader() const;
 };
 
 }  // namespace audio
@@ -0,0 +1,79 @@
+#ifndef SYNTHER_REALTIME_GUARD_H
+#define SYNTHER_REALTIME_GUARD_H
+
+#include <cstdint>
+
+namespace synther {
+
+namespace audio {
+
+/**
+ * Marks the current thread as rendering audio for as long as the guard is
+ *   alive. Code that runs under a guard must not allocate or free memory,
+ *   since the allocator may take a lock and stall the audio device.
+ *
+ * When compiled with SYNTHER_CHECK_REALTIME, the global operator new and
+ *   operator delete are replaced with versions that report every call made
+ *   under a guard, so a hidden allocation on the audio thread fails loudly
+ *   in tests instead of causing an occasional dropout. Without the flag,
+ *   guards only mark the thread and allocations are not checked.
+ */
+class RealtimeGuard {
+ public:
+  /**
+   * Marks the current thread as rendering. Guards may be nested
+   */
+  RealtimeGuard();
+
+  /**
+   * Unmarks the current thread once the outermost guard is destroyed
+   */
+  ~RealtimeGuard();
+
+  RealtimeGuard(const RealtimeGuard&) = delete;
+  RealtimeGuard& operator=(const RealtimeGuard&) = delete;
+
+  /**
+   * Check whether the current thread is inside a guard
+   * @return true if a guard is alive on the current thread
+   */
+  static bool IsActive();
+
+  /**
+   * Check whether allocations under a guard are reported
+   * @return true if compiled with SYNTHER_CHECK_REALTIME
+   */
+  static bool IsChecking();
+
+  /**
+   * Reports an allocation or deallocation if the current thread is inside
+   *   a guard. Called by the replaced operator new and operator delete
+   */
+  static void CheckAllocation();
+
+  /**
+   * Get the number of allocations and deallocations made under a guard, on
+   *   any thread, since the last reset
+   * @return the number of violations
+   */
+  static uint64_t GetViolationCount();
+
+  /**
+   * Forgets every violation counted so far
+   */
+  static void ResetViolationCount();
+
+  /**
+   * Sets whether a violation aborts the program, like a failed assert, or
+   *   is only counted. Aborting is the default, so violations are never
+   *   missed. Tests that check the count turn it off
+   * @param is_aborting true to abort on the first violation
+   */
+  static void SetAbortOnViolation(bool is_aborting);
+};
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_REALTIME_GUARD_H
@@ -0,0 +1,186 @@
+#ifndef SYNTHER_RENDER_WORKERS_H
+#define SYNTHER_RENDER_WORKERS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace synther {
+
+namespace audio {
+
+/**
+ * A pool of threads that help the audio thread render a block. The audio
+ *   thread hands out a number of tasks with Run(), runs tasks itself
+ *   alongside the workers, and returns once every task has finished.
+ *
+ * Workers never lock, allocate or sleep while they are needed. Tasks are
+ *   claimed through a single atomic word that holds the number of the job,
+ *   its task count and the next unclaimed task, so a worker that wakes up
+ *   late can't claim a task of a job that has already finished. A worker
+ *   that hasn't woken up at all only means the audio thread runs more of
+ *   the tasks itself.
+ *
+ * Workers spin while jobs arrive, and only sleep once they have been idle
+ *   for kIdleSleepThresholdMilliseconds, so they respond within microseconds
+ *   while audio is rendered. On Linux, every worker is pinned to its own core.
+ *
+ * The thread that calls Run() waits for tasks the workers have claimed, so
+ *   the workers copy its scheduling: its real-time policy and priority on
+ *   Linux, or its time constraint on macOS. A worker that is preempted while
+ *   it holds a task would otherwise stall the audio thread behind threads of
+ *   lower priority. Platforms that refuse to raise the workers leave them
+ *   at normal priority.
+ */
+class RenderWorkers {
+ public:
+  typedef std::function<void(size_t)> Task;
+
+  /**
+   * Starts the workers
+   * @param num_workers the number of threads started to help the calling
+   *   thread
+   * @param task the function called with the index of every task. Must be
+   *   safe to call from several threads at once, and must not allocate,
+   *   lock or throw
+   * @param is_pinned true to pin every worker to its own core, where the
+   *   platform supports it
+   */
+  RenderWorkers(size_t num_workers, const Task& task, bool is_pinned = true);
+
+  /**
+   * Stops the workers
+   */
+  ~RenderWorkers();
+
+  RenderWorkers(const RenderWorkers&) = delete;
+  RenderWorkers& operator=(const RenderWorkers&) = delete;
+
+  /**
+   * Runs the task once for every index in [0, count), on the calling thread
+   *   and the workers. Returns once every task has finished. Must only be
+   *   called from one thread
+   * @param count the number of tasks, at most kMaxTasks
+   */
+  void Run(size_t count);
+
+  /**
+   * Get the number of threads that help the calling thread
+   * @return the number of workers
+   */
+  size_t GetWorkerCount() const;
+
+  /**
+   * Get the number of tasks the workers have run, as opposed to the thread
+   *   that called Run(). Safe to call from any thread
+   * @return the total number of tasks run by workers
+   */
+  uint64_t GetHelpedTaskCount() const;
+
+  // The claim word holds the job number above kJobShift, then the task
+  // count, then the next task
+  static constexpr size_t kMaxTasks = 0xFFFF;
+
+ private:
+  static constexpr int kCountShift = 16;
+  static constexpr int kJobShift = 32;
+  // How long an idle worker keeps spinning, and how long it then sleeps
+  // between checks for work
+  static constexpr int kIdleSleepThresholdMilliseconds = 20;
+  static constexpr int kIdleSleepMicroseconds = 500;
+
+  /**
+   * How a thread is scheduled, in the terms of the platform
+   */
+  struct Scheduling {
+    // POSIX policy and priority
+    int policy_;
+    int priority_;
+    // Mach time constraint in absolute time units, with a period of 0 if the
+    // thread isn't time constrained
+    uint32_t period_;
+    uint32_t computation_;
+    uint32_t constraint_;
+  };
+
+  Task task_;
+  std::vector<std::thread> threads_;
+  std::atomic<bool> is_stopping_;
+  std::atomic<uint64_t> helped_task_count_;
+  // Only used by the thread that calls Run()
+  uint64_t job_;
+  std::thread::id caller_;
+
+  // The scheduling of the thread that calls Run(), published whenever that
+  // thread changes. The version is odd while the fields are written, and
+  // workers only copy fields read between two equal even versions
+  std::atomic<uint64_t> scheduling_version_;
+  std::atomic<int> caller_policy_;
+  std::atomic<int> caller_priority_;
+  std::atomic<uint32_t> caller_period_;
+  std::atomic<uint32_t> caller_computation_;
+  std::atomic<uint32_t> caller_constraint_;
+
+  // Written by every thread that runs tasks. The pool is allocated by its
+  // owner, which can't rely on over-aligned allocation in C++11, so these
+  // aren't aligned to cache lines
+  std::atomic<uint64_t> claim_;
+  std::atomic<size_t> finished_count_;
+
+  /**
+   * Claims and runs tasks of a job until none are left, or another job has
+   *   started
+   * @param claim the value of the claim word for the job
+   * @param is_worker true if called by a worker rather than the thread that
+   *   called Run()
+   */
+  void RunTasks(uint64_t claim, bool is_worker);
+
+  /**
+   * Runs the tasks of every job until the workers are stopped. Runs on
+   *   every worker thread
+   */
+  void Work();
+
+  /**
+   * Publishes the scheduling of the current thread for the workers to copy.
+   *   Called by Run() when it is called from a new thread
+   */
+  void PublishCallerScheduling();
+
+  /**
+   * Gives the current worker the published scheduling of the thread that
+   *   calls Run()
+   * @param version the version of the scheduling read by the worker
+   * @return true if the scheduling was copied, false if it was being
+   *   published and should be read again
+   */
+  bool CopyCallerScheduling(uint64_t version);
+
+  /**
+   * Get how the current thread is scheduled
+   * @return the scheduling of the current thread
+   */
+  static Scheduling GetThreadScheduling();
+
+  /**
+   * Schedules the current thread, if the platform allows it
+   * @param scheduling the scheduling to apply
+   */
+  static void SetThreadScheduling(const Scheduling& scheduling);
+
+  /**
+   * Pins the current thread to one core, if the platform supports it
+   * @param core the index of the core
+   */
+  static void PinToCore(size_t core);
+};
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_RENDER_WORKERS_H
@@ -0,0 +1,96 @@
+#ifndef SYNTHER_RESAMPLER_H
+#define SYNTHER_RESAMPLER_H
+
+#include <cstddef>
+#include <vector>
+
+namespace synther {
+
+namespace audio {
+
+/**
+ * Converts audio between two sample rates with a polyphase windowed-sinc
+ *   filter. The rate ratio is reduced to L / M, and the filter is split into
+ *   L phases, one for every position an output frame can fall between two
+ *   input frames. Every output frame is then a single dot product of one
+ *   phase's taps with the neighboring input frames, computed with the
+ *   vectorized DotProduct() kernel.
+ *
+ * The filter is designed once on construction, so a Resampler should be
+ *   reused for every buffer converted between the same rates. Conversion is
+ *   meant to happen when samples are loaded, so playback never resamples.
+ */
+class Resampler {
+ public:
+  /**
+   * Designs the filter for a conversion between two rates
+   * @param input_rate the sample rate of the audio to convert, in Hz
+   * @param output_rate the sample rate to convert to, in Hz
+   * @param tap_count the number of input frames each output frame is
+   *   computed from when upsampling. Downsampling uses proportionally more
+   *   taps, so the filter keeps the same transition width. Higher counts
+   *   give a sharper cutoff at a higher cost
+   */
+  Resampler(size_t input_rate, size_t output_rate,
+            size_t tap_count = kDefaultTapCount);
+
+  /**
+   * Get the number of frames that converting a buffer produces
+   * @param input_frames the number of frames in the buffer to convert
+   * @return the number of frames in the converted buffer
+   */
+  size_t GetOutputFrames(size_t input_frames) const;
+
+  /**
+   * Converts a single channel. Frames before the start and after the end of
+   *   the input are treated as silence
+   * @param input a pointer to input_frames contiguous samples
+   * @param input_frames the number of frames to convert
+   * @param output a pointer to room for GetOutputFrames() samples
+   */
+  void Process(const float* input, size_t input_frames, float* output) const;
+
+  /**
+   * Get the number of phases the filter was split into
+   * @return the number of phases, at most kMaxPhases
+   */
+  size_t GetPhaseCount() const;
+
+  /**
+   * Get the number of taps in every phase of the filter
+   * @return the number of input frames each output frame is computed from
+   */
+  size_t GetTapCount() const;
+
+  static constexpr size_t kDefaultTapCount = 32;
+
+  // Ratios that need more phases, such as 44100 to 47999 Hz, round every
+  // output frame to the nearest of kMaxPhases positions
+  static constexpr size_t kMaxPhases = 1024;
+
+ private:
+  size_t input_rate_;
+  size_t output_rate_;
+  // The rate ratio reduced to lowest terms. Output frame n falls at input
+  // position n * downsample_factor_ / upsample_factor_
+  size_t upsample_factor_;
+  size_t downsample_factor_;
+  size_t phase_count_;
+  size_t tap_count_;
+  // phase_count_ runs of tap_count_ taps, one run per phase
+  std::vector<float> taps_;
+
+  // Passband as a fraction of the lower of the two Nyquist frequencies. The
+  // rest is left for the filter's transition band
+  static constexpr double kCutoff = 0.9;
+  // Shape of the Kaiser window. 8 attenuates aliases by about 80 dB
+  static constexpr double kKaiserBeta = 8.0;
+  // Taps are padded to a multiple of the widest vector
+  static constexpr size_t kTapAlignment = 8;
+};
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_RESAMPLER_H
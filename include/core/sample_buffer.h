@@ -0,0 +1,211 @@
+#ifndef SYNTHER_SAMPLE_BUFFER_H
+#define SYNTHER_SAMPLE_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "core/stream_source.h"
+
+namespace synther {
+
+namespace audio {
+
+/**
+ * The type that a SampleBuffer stores its samples as
+ */
+enum class SampleFormat {
+  // 32-bit floats, as samples are decoded
+  Float32,
+  // 16-bit integers, which take half the memory. They are converted to floats
+  // by the mixer, scaled by kPcmScale
+  Int16
+};
+
+/**
+ * Decoded PCM audio for a single sound file. Samples are stored in a
+ *   non-interleaved, channel-major layout, so every channel is a contiguous
+ *   array of GetNumFrames() samples. Float32 buffers match the layout of
+ *   ci::audio::Buffer, which allows sample data to be copied over directly.
+ *
+ * Every channel is followed by kPaddingFrames frames of silence. A voice may
+ *   read up to kPaddingFrames past the end of its sample, which lets the mixer
+ *   process whole blocks without checking where each sample ends.
+ *
+ * A buffer may hold only the head of a long sample, with the rest of the
+ *   sample streamed from disk. Streamed buffers have a StreamSource, which
+ *   describes the whole sample.
+ */
+class SampleBuffer {
+ public:
+  /**
+   * Constructs a silent buffer of the specified size
+   * @param num_channels the number of channels in the buffer
+   * @param num_frames the number of frames (samples per channel) in the buffer
+   * @param format the type to store samples as
+   */
+  SampleBuffer(size_t num_channels, size_t num_frames,
+               SampleFormat format = SampleFormat::Float32);
+
+  /**
+   * Constructs a buffer over sample data stored elsewhere, such as a
+   *   memory-mapped cache file. The data must use the same layout as a buffer
+   *   that owns its samples, including the padding after every channel
+   * @param num_channels the number of channels in the buffer
+   * @param num_frames the number of frames (samples per channel) in the buffer
+   * @param data a pointer to GetStorageSize() samples of the given format,
+   *   kept alive by the buffer for as long as the buffer exists
+   * @param format the type that the data stores samples as
+   */
+  SampleBuffer(size_t num_channels, size_t num_frames,
+               std::shared_ptr<void> data,
+               SampleFormat format = SampleFormat::Float32);
+
+  /**
+   * Get a pointer to the first sample of a channel of a Float32 buffer
+   * @param channel the index of the channel. Must be less than
+   *   GetNumChannels()
+   * @return a pointer to GetNumFrames() contiguous samples
+   */
+  float* GetChannel(size_t channel);
+
+  /**
+   * Get a read-only pointer to the first sample of a channel of a Float32
+   *   buffer
+   * @param channel the index of the channel. Must be less than
+   *   GetNumChannels()
+   * @return a pointer to GetNumFrames() contiguous samples
+   */
+  const float* GetChannel(size_t channel) const;
+
+  /**
+   * Get a pointer to the first sample of a channel of an Int16 buffer
+   * @param channel the index of the channel. Must be less than
+   *   GetNumChannels()
+   * @return a pointer to GetNumFrames() contiguous samples
+   */
+  int16_t* GetPcmChannel(size_t channel);
+
+  /**
+   * Get a read-only pointer to the first sample of a channel of an Int16
+   *   buffer
+   * @param channel the index of the channel. Must be less than
+   *   GetNumChannels()
+   * @return a pointer to GetNumFrames() contiguous samples
+   */
+  const int16_t* GetPcmChannel(size_t channel) const;
+
+  /**
+   * Copies frames of a channel as floats, whatever the buffer's format
+   * @param channel the index of the channel. Must be less than
+   *   GetNumChannels()
+   * @param first_frame the index of the first frame to copy
+   * @param num_frames the number of frames to copy, which may run into the
+   *   padding after the channel
+   * @param output the array that receives num_frames samples
+   */
+  void CopyFrames(size_t channel, size_t first_frame, size_t num_frames,
+                  float* output) const;
+
+  /**
+   * Get the type that the buffer stores its samples as
+   * @return the format of the buffer's samples
+   */
+  SampleFormat GetFormat() const;
+
+  /**
+   * Get the number of channels in the buffer
+   * @return the number of channels in the buffer
+   */
+  size_t GetNumChannels() const;
+
+  /**
+   * Get the number of frames in the buffer
+   * @return the number of frames (samples per channel) in the buffer
+   */
+  size_t GetNumFrames() const;
+
+  /**
+   * Marks the buffer as the head of a longer sample that is streamed
+   * @param stream_source the location of the whole sample on disk
+   */
+  void SetStreamSource(const StreamSourceRef& stream_source);
+
+  /**
+   * Get the location of the whole sample, if the buffer only holds its head
+   * @return the stream source, or nullptr if the whole sample is in memory
+   */
+  const StreamSourceRef& GetStreamSource() const;
+
+  /**
+   * Get the length of the whole sample, including any streamed frames
+   * @return the number of frames in the whole sample
+   */
+  size_t GetTotalFrames() const;
+
+  /**
+   * Get the memory held by the buffer's samples. Streamed frames are not
+   *   counted, since they are never held in memory
+   * @return the size of the buffer's samples in bytes, including padding
+   */
+  size_t GetMemorySize() const;
+
+  /**
+   * Checks whether every channel holds the same audio, such as a mono
+   *   recording that was saved as stereo. Such a buffer can be downmixed
+   *   without changing how it sounds
+   * @return true if no two channels differ by more than kMonoTolerance
+   */
+  bool IsMonoCompatible() const;
+
+  /**
+   * Copies the buffer into a more compact form. Streamed buffers can't be
+   *   converted, since their streams read the original layout
+   * @param format the type to store the copy's samples as
+   * @param is_downmixed true to average every channel into one
+   * @return the converted copy
+   */
+  std::shared_ptr<SampleBuffer> Convert(SampleFormat format,
+                                        bool is_downmixed) const;
+
+  /**
+   * Get the number of samples needed to store a buffer, including padding
+   * @param num_channels the number of channels in the buffer
+   * @param num_frames the number of frames in the buffer
+   * @return the number of samples that the buffer's channels span
+   */
+  static size_t GetStorageSize(size_t num_channels, size_t num_frames);
+
+  /**
+   * Get the size of a single sample
+   * @param format the type of the sample
+   * @return the number of bytes that one sample takes
+   */
+  static size_t GetSampleSize(SampleFormat format);
+
+  // Frames of silence stored after the end of every channel
+  static constexpr size_t kPaddingFrames = 256;
+
+  // The furthest two channels of a mono-compatible buffer may differ, about
+  // -60 dB below full scale
+  static constexpr float kMonoTolerance = 1e-3f;
+
+ private:
+  size_t num_channels_;
+  size_t num_frames_;
+  // Distance between the starts of consecutive channels, including padding
+  size_t channel_stride_;
+  SampleFormat format_;
+  std::shared_ptr<void> data_;
+  StreamSourceRef stream_source_;
+};
+
+// Sample data is shared read-only between the loader and the audio thread
+using SampleBufferRef = std::shared_ptr<const SampleBuffer>;
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_SAMPLE_BUFFER_H
@@ -0,0 +1,115 @@
+#ifndef SYNTHER_SAMPLE_CACHE_H
+#define SYNTHER_SAMPLE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "core/sample_buffer.h"
+
+namespace synther {
+
+namespace audio {
+
+/**
+ * An on-disk cache of decoded samples. Every entry stores a SampleBuffer in
+ *   its in-memory layout, padding included, so a cached sample is loaded by
+ *   memory-mapping its file instead of decoding the original sound file.
+ *
+ * Entries are keyed by a hash of the sound file's contents, the sample rate
+ *   it was decoded at and the form it is stored in, so editing a sound file,
+ *   changing the output device's rate or switching to compact samples never
+ *   returns stale audio.
+ *
+ * The entries of a directory are kept within a byte budget. Loading an entry
+ *   marks it as used, and storing one removes the entries that were used
+ *   least recently until the rest fit, so entries for rates, forms and
+ *   recordings that are no longer played are removed in time. Entries
+ *   written by a different build are removed when they are opened.
+ */
+class SampleCache {
+ public:
+  /**
+   * Constructs a cache that stores its entries in a directory
+   * @param directory the path of an existing directory to store entries in
+   * @param byte_budget the most bytes the entries of the directory may take
+   *   up. Entries that are streamed from must fit, since a removed entry
+   *   streams as silence
+   */
+  explicit SampleCache(const std::string& directory,
+                       uint64_t byte_budget = kDefaultByteBudget);
+
+  /**
+   * Computes the cache key of a sound file
+   * @param source_path the path of the sound file
+   * @param sample_rate the rate in Hz that the file is decoded at
+   * @param format the type that the decoded samples are stored as
+   * @param is_downmixed true if mono-compatible samples are downmixed
+   * @return the key of the decoded file, or an empty string if the file
+   *   cannot be read
+   */
+  static std::string ComputeKey(const std::string& source_path,
+                                size_t sample_rate,
+                                SampleFormat format = SampleFormat::Float32,
+                                bool is_downmixed = false);
+
+  /**
+   * Loads a cached sample by mapping its entry into memory. The pages of the
+   *   entry are read in before returning, so the audio thread never waits on
+   *   the disk
+   * @param key a key returned by ComputeKey()
+   * @return the cached sample, or nullptr if there is no valid entry
+   */
+  SampleBufferRef Load(const std::string& key) const;
+
+  /**
+   * Loads the first frames of a cached sample into memory, and streams the
+   *   rest of the sample from the cache entry. Samples that are barely
+   *   longer than the head, or have too many channels to stream, are loaded
+   *   whole with Load()
+   * @param key a key returned by ComputeKey()
+   * @param head_frames the number of frames to hold in memory
+   * @return the head of the cached sample with its StreamSource set, or
+   *   nullptr if there is no valid entry
+   */
+  SampleBufferRef LoadHead(const std::string& key, size_t head_frames) const;
+
+  /**
+   * Writes a sample to the cache. The entry is written to a temporary file
+   *   and then renamed, so other readers never see a partial entry. Older
+   *   entries are then removed until the directory fits in the budget
+   * @param key a key returned by ComputeKey()
+   * @param sample the decoded sample to store
+   * @return true if the entry was written
+   */
+  bool Store(const std::string& key, const SampleBuffer& sample) const;
+
+  /**
+   * Get the path of the file that stores an entry
+   * @param key a key returned by ComputeKey()
+   * @return the path of the entry's file, which may not exist
+   */
+  std::string GetPath(const std::string& key) const;
+
+  /**
+   * Removes the least recently used entries of the directory until the rest
+   *   fit in the byte budget. Entries that can't be removed, such as ones
+   *   mapped on Windows, are skipped
+   * @param kept_path the path of an entry that is never removed, such as
+   *   the one just stored
+   */
+  void Prune(const std::string& kept_path = "") const;
+
+  // Enough for every instrument at two device rates
+  static constexpr uint64_t kDefaultByteBudget = 2ULL * 1024 * 1024 * 1024;
+
+ private:
+  std::string directory_;
+  uint64_t byte_budget_;
+};
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_SAMPLE_CACHE_H
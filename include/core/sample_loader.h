@@ -0,0 +1,144 @@
+#ifndef SYNTHER_SAMPLE_LOADER_H
+#define SYNTHER_SAMPLE_LOADER_H
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "cinder/DataSource.h"
+#include "cinder/Filesystem.h"
+#include "core/music_note.h"
+#include "core/sample_buffer.h"
+#include "core/sample_cache.h"
+
+namespace synther {
+
+namespace audio {
+
+/**
+ * Decodes instrument sound files into SampleBuffers. Loading does not require
+ *   an audio device, so the same loader serves the Player and offline
+ *   rendering. Files are decoded in parallel, since an instrument has dozens
+ *   of compressed files that are each decoded independently
+ */
+class SampleLoader {
+ public:
+  /**
+   * Constructs a loader that decodes sound files at a fixed sample rate
+   * @param sample_rate the rate in Hz that every sample is converted to
+   * @param num_threads the number of files decoded at once. 0 decodes one
+   *   file per hardware thread
+   */
+  explicit SampleLoader(size_t sample_rate, size_t num_threads = 0);
+
+  /**
+   * Keeps decoded samples in an on-disk cache. Later loads of the same sound
+   *   files at the same sample rate map the cached samples instead of
+   *   decoding them again
+   * @param directory the directory to store the cache in. Created if it does
+   *   not exist. If it cannot be created, samples are not cached
+   */
+  void SetCacheDirectory(const ci::fs::path& directory);
+
+  /**
+   * Holds only the head of long samples in memory, and streams the rest from
+   *   the cache while they play. Has no effect without a cache directory
+   * @param head_duration the number of seconds of every sample held in
+   *   memory. 0 holds whole samples in memory
+   */
+  void SetStreaming(double head_duration);
+
+  /**
+   * Stores samples in a more compact form than the floats they are decoded
+   *   to. Both options are off by default
+   * @param format the type to store samples as. Int16 halves their memory
+   * @param is_downmixed true to keep a single channel of samples whose
+   *   channels all hold the same audio, which halves the memory of stereo
+   *   files recorded in mono
+   */
+  void SetStorage(SampleFormat format, bool is_downmixed);
+
+  /**
+   * Decodes a single sound file, converting it to the loader's sample rate
+   *   with a Resampler if the file was recorded at a different rate, and then
+   *   to the loader's storage
+   * @param source a Cinder data source for the sound file
+   * @return the decoded sample, or nullptr if the file cannot be decoded
+   */
+  SampleBufferRef LoadSample(const ci::DataSourceRef& source) const;
+
+  /**
+   * Loads a single sound file, from the cache if it has been decoded before.
+   *   Safe to call from several threads at once
+   * @param path the path of the sound file
+   * @param is_cached if not nullptr, set to true when the sample was found in
+   *   the cache
+   * @return the decoded sample, or nullptr if the file cannot be read
+   */
+  SampleBufferRef LoadSampleFile(const ci::fs::path& path,
+                                 bool* is_cached = nullptr) const;
+
+  /**
+   * Decodes the sound file of every note, spread over the loader's threads.
+   *   Blocks until every file has been decoded
+   * @param note_paths a map from music::Notes to the paths of their sound
+   *   files. Notes whose files cannot be read are skipped
+   * @return a map from semitone indices to decoded samples
+   */
+  std::map<int, SampleBufferRef> LoadSamples(
+      const std::map<music::Note, ci::fs::path>& note_paths);
+
+  /**
+   * Resolves the sound files of an instrument that lives outside of the
+   *   assets directory
+   * @param note_files a map from music::Notes to sound file names, as
+   *   returned by SoundJsonParser::GetNoteFiles()
+   * @param instrument_directory the directory containing the sound files
+   * @return a map from music::Notes to the full paths of their sound files
+   */
+  static std::map<music::Note, ci::fs::path> ResolvePaths(
+      const std::map<music::Note, std::string>& note_files,
+      const ci::fs::path& instrument_directory);
+
+  /**
+   * Get the directory that decoded samples are cached in by default
+   * @return a directory inside the system's temporary directory
+   */
+  static ci::fs::path GetDefaultCacheDirectory();
+
+  /**
+   * Get the number of threads used to decode files
+   * @return the number of files decoded at once
+   */
+  size_t GetNumThreads() const;
+
+  /**
+   * Get how long the last call to LoadSamples() took
+   * @return the wall-clock duration of the last load, in seconds
+   */
+  double GetLastLoadDuration() const;
+
+  /**
+   * Get how many samples the last call to LoadSamples() found in the cache
+   * @return the number of samples that were mapped instead of decoded
+   */
+  size_t GetLastCacheHitCount() const;
+
+ private:
+  size_t sample_rate_;
+  size_t num_threads_;
+  // 0 when samples are not streamed
+  size_t stream_head_frames_;
+  SampleFormat format_;
+  bool is_downmixed_;
+  // nullptr when samples are not cached
+  std::unique_ptr<SampleCache> cache_;
+  double last_load_duration_;
+  size_t last_cache_hit_count_;
+};
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_SAMPLE_LOADER_H
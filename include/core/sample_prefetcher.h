@@ -0,0 +1,104 @@
+#ifndef SYNTHER_SAMPLE_PREFETCHER_H
+#define SYNTHER_SAMPLE_PREFETCHER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "core/sample_buffer.h"
+
+namespace synther {
+
+namespace audio {
+
+/**
+ * Loads the samples of individual notes on a background thread, so the notes
+ *   that are about to be played can be loaded while the app stays responsive.
+ *
+ * Notes are loaded one at a time in the order they were requested. A new
+ *   request replaces every note that has not started loading yet, so the
+ *   queue follows the keyboard as it moves instead of finishing stale work.
+ */
+class SamplePrefetcher {
+ public:
+  // Loads the sample of a semitone, returning nullptr if it cannot be loaded
+  using LoadFunction = std::function<SampleBufferRef(int semitone)>;
+
+  /**
+   * Starts a background thread that waits for requests
+   * @param load_sample the function that loads a single note. Called only
+   *   from the background thread
+   */
+  explicit SamplePrefetcher(const LoadFunction& load_sample);
+
+  /**
+   * Stops the background thread, waiting for the note being loaded to finish
+   */
+  ~SamplePrefetcher();
+
+  SamplePrefetcher(const SamplePrefetcher&) = delete;
+  SamplePrefetcher& operator=(const SamplePrefetcher&) = delete;
+
+  /**
+   * Switches to loading notes of a different instrument. Forgets every
+   *   request and every loaded sample that has not been taken. Does not wait
+   *   for the note being loaded, whose sample is discarded when it finishes
+   * @param load_sample the function that loads a single note of the new
+   *   instrument
+   */
+  void Reset(const LoadFunction& load_sample);
+
+  /**
+   * Replaces the notes waiting to be loaded. Notes that are being loaded, or
+   *   that have been loaded but not taken, are not loaded again
+   * @param semitones the semitone indices to load, most urgent first
+   */
+  void Request(const std::vector<int>& semitones);
+
+  /**
+   * Takes every sample that finished loading since the last call
+   * @return a map from semitone indices to loaded samples. Notes that could
+   *   not be loaded are mapped to nullptr
+   */
+  std::map<int, SampleBufferRef> TakeLoaded();
+
+  /**
+   * Check whether every requested note has been loaded
+   * @return true if no note is waiting or being loaded
+   */
+  bool IsIdle() const;
+
+ private:
+  // Guards every member below
+  mutable std::mutex mutex_;
+  std::condition_variable wake_;
+  LoadFunction load_sample_;
+  std::deque<int> pending_;
+  std::map<int, SampleBufferRef> loaded_;
+  // The semitone being loaded, or kNotLoading
+  int loading_;
+  // Increased by Reset(), so loads started before it are discarded
+  uint64_t generation_;
+  bool is_stopping_;
+
+  // Started last, once every member it uses has been constructed
+  std::thread worker_;
+
+  static constexpr int kNotLoading = -1;
+
+  /**
+   * Loads requested notes until the prefetcher is destroyed
+   */
+  void Run();
+};
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_SAMPLE_PREFETCHER_H
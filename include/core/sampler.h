@@ -0,0 +1,780 @@
+#ifndef SYNTHER_SAMPLER_H
+#define SYNTHER_SAMPLER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "core/convolution_reverb.h"
+#include "core/event_queue.h"
+#include "core/latency_histogram.h"
+#include "core/load_meter.h"
+#include "core/mix_kernel.h"
+#include "core/note_event.h"
+#include "core/render_workers.h"
+#include "core/sample_buffer.h"
+#include "core/stream_pool.h"
+#include "core/voice_pool.h"
+
+namespace synther {
+
+namespace audio {
+
+/**
+ * A polyphonic sample playback engine. The Sampler owns the decoded sample
+ *   of every note in an instrument and mixes the voices that are currently
+ *   sounding into a single output buffer. Voices that are silent are not
+ *   visited while rendering, so the cost of Render() depends on the number of
+ *   sounding notes rather than the number of samples in the instrument.
+ *
+ * Every strike of a note is given its own voice from a preallocated
+ *   VoicePool, so the tail of a released note keeps ringing when the same
+ *   note is struck again. The number of sounding voices is capped by the
+ *   polyphony of the pool.
+ *
+ * Everything that Render() touches is allocated when the Sampler is
+ *   constructed or its samples are set, so the audio thread never allocates.
+ *
+ * Notes are played by posting NoteEvents from a single producer thread. The
+ *   events travel through a wait-free queue and are applied at the start of
+ *   the next Render() call, so playing notes never blocks the audio thread.
+ *   The sustain pedal is an event too: notes released while it is down are
+ *   marked as sustained, and lifting it releases only those voices.
+ *
+ * Samples that only hold the head of a long recording are streamed: once a
+ *   voice plays past the head, the rest of the sample is read from disk by
+ *   a StreamPool, which keeps memory bounded for large libraries. Streams
+ *   are read ahead in real time, so streamed samples should not be rendered
+ *   faster than real time.
+ *
+ * Instruments with gaps between their samples can be played with a zone
+ *   map: every note without a sample plays the nearest sample, resampled in
+ *   real time by the distance between the two notes.
+ *
+ * Several instruments may be played at once as layers, each with its own
+ *   samples, range of notes and gain. A note struck within the ranges of
+ *   several layers starts a voice in each of them, so layers on the same
+ *   notes stack and layers with adjacent ranges split the keyboard. Every
+ *   layer is mixed by the same Render() call, so a layer only costs the
+ *   voices it is sounding, and layers holding the same SampleBufferRefs
+ *   share their sample data. Methods that take no layer act on layer 0.
+ *
+ * NoteOn events that carry the time they were posted have their latency
+ *   measured: once the note's first non-zero frame is rendered, the time
+ *   from posting to that frame is recorded in a LatencyHistogram. The
+ *   frame's offset within the rendered buffer is included, while the time
+ *   the audio device takes to play the buffer is not.
+ *
+ * The time spent in every Render() call is measured against the time its
+ *   frames take to play, so the load of the audio thread can be watched
+ *   while it runs.
+ *
+ * The mix of every voice may be passed through a ConvolutionReverb, which
+ *   is applied at the end of every Render() call.
+ *
+ * Dense playing may be mixed on several cores. The sounding voices are then
+ *   split into chunks that RenderWorkers mix into private buffers, which the
+ *   audio thread adds up in a fixed order, so the mix doesn't depend on
+ *   which thread mixed which chunk.
+ *
+ * A whole instrument can be replaced with SwapSamples() without locking out
+ *   the audio thread. The new samples are published with a single push
+ *   through a wait-free queue, and notes of the old instrument fade out
+ *   instead of being cut off.
+ *
+ * The Sampler does not depend on an audio device, and is driven by
+ *   SamplerNode when used inside a Cinder audio graph.
+ */
+class Sampler {
+ public:
+  /**
+   * Constructs a Sampler without any samples
+   * @param resonate_duration the number of seconds a note takes to fade away
+   *   after NoteOff() is called
+   * @param polyphony the maximum number of voices that may sound at once
+   * @param steal_policy the policy used to choose which voice is cut off when
+   *   the polyphony is reached
+   */
+  explicit Sampler(double resonate_duration,
+                   size_t polyphony = kDefaultPolyphony,
+                   StealPolicy steal_policy = StealPolicy::Oldest);
+
+  ~Sampler();
+
+  Sampler(const Sampler&) = delete;
+  Sampler& operator=(const Sampler&) = delete;
+
+  /**
+   * Sets the rate at which Render() produces frames. Must be called before
+   *   rendering so that resonate durations map onto the correct frame counts
+   * @param sample_rate the output sample rate in Hz
+   */
+  void SetSampleRate(double sample_rate);
+
+  /**
+   * Replaces every sample of a layer. All sounding voices of the layer are
+   *   stopped
+   * @param samples a map from semitone indices to decoded samples. Semitones
+   *   outside of [0, kSemitoneCount) are ignored
+   * @param layer the layer whose samples are replaced, below kMaxLayers.
+   *   Other layers are ignored
+   */
+  void SetSamples(const std::map<int, SampleBufferRef>& samples,
+                  size_t layer = 0);
+
+  /**
+   * Replaces every sample of a layer at the start of the next Render() call,
+   *   without locking out the audio thread. Voices of the old samples are
+   *   released and fade out over the crossfade duration, while notes played
+   *   after the swap use the new samples. Voices of other layers, including
+   *   ones still fading from an earlier swap, are left alone. Must only be
+   *   called from one thread, which must also call CollectRetiredSamples()
+   * @param samples a map from semitone indices to decoded samples. Semitones
+   *   outside of [0, kSemitoneCount) are ignored
+   * @param crossfade_duration the number of seconds over which the voices of
+   *   the old samples fade out
+   * @param layer the layer whose samples are replaced, below kMaxLayers
+   * @return true if the swap was published, false if kMaxPendingSwaps
+   *   earlier swaps have not been collected yet or the layer is out of
+   *   range, in which case nothing changes
+   */
+  bool SwapSamples(const std::map<int, SampleBufferRef>& samples,
+                   double crossfade_duration, size_t layer = 0);
+
+  /**
+   * Destroys the samples replaced by SwapSamples() once no voice plays them
+   *   and no stream reads them, so they are never freed on the audio thread.
+   *   Must be called from the thread that calls SwapSamples()
+   */
+  void CollectRetiredSamples();
+
+  /**
+   * Maps a single semitone of a layer to a sample, leaving the other samples
+   *   in place. Voices of other notes keep sounding, while voices of the
+   *   layer still playing a replaced sample are stopped
+   * @param semitone the semitone index of the note. Semitones outside of
+   *   [0, kSemitoneCount) are ignored
+   * @param sample the decoded sample of the note
+   * @param layer the layer the sample is added to, below kMaxLayers
+   */
+  void AddSample(int semitone, const SampleBufferRef& sample,
+                 size_t layer = 0);
+
+  /**
+   * Removes the sample of a note from a layer, unless the sample is still
+   *   sounding
+   * @param semitone the semitone index of the note
+   * @param layer the layer the sample is removed from
+   * @return true if the note has no sample in the layer anymore, false if it
+   *   is still sounding and its sample was kept
+   */
+  bool UnloadSample(int semitone, size_t layer = 0);
+
+  /**
+   * Sets the notes a layer plays. Notes outside of the range don't start
+   *   voices in the layer, while its voices that are already sounding keep
+   *   sounding. Every layer plays every note until its range is set
+   * @param layer the layer, below kMaxLayers
+   * @param lowest_semitone the semitone index of the lowest note played
+   * @param highest_semitone the semitone index of the highest note played.
+   *   Below the lowest semitone, the layer plays no notes
+   */
+  void SetLayerRange(size_t layer, int lowest_semitone, int highest_semitone);
+
+  /**
+   * Sets the gain every voice of a layer is mixed at, from the next block
+   *   onwards. Every layer has a gain of 1 until it is set
+   * @param layer the layer, below kMaxLayers
+   * @param gain the gain of the layer, clamped between 0 and 1 like the
+   *   gain of every voice
+   */
+  void SetLayerGain(size_t layer, float gain);
+
+  /**
+   * Get the gain every voice of a layer is mixed at
+   * @param layer the layer, below kMaxLayers
+   * @return the gain of the layer
+   */
+  float GetLayerGain(size_t layer) const;
+
+  /**
+   * Lets notes without a sample play the nearest sample, pitch-shifted to
+   *   the note. Notes with their own samples are not affected
+   * @param max_shift the furthest a sample may be shifted, in semitones.
+   *   Clamped between 0 and kMaxPitchShift. 0 only plays notes with samples
+   */
+  void SetMaxPitchShift(int max_shift);
+
+  /**
+   * Check whether any voice of a note is sounding, including voices that
+   *   have been released but have not faded away yet
+   * @param semitone the semitone index of the note
+   * @return true if the note is sounding
+   */
+  bool IsSounding(int semitone) const;
+
+  /**
+   * Queues an event to be applied at the start of the next Render() call.
+   *   Must only be called from one producer thread, which may differ from
+   *   the thread calling Render()
+   * @param event the event to queue
+   * @return true if the event was queued, false if the queue was full
+   */
+  bool PostEvent(const NoteEvent& event);
+
+  /**
+   * Queues several events at once. Events posted together are always applied
+   *   within the same Render() call, so a chord starts on the same frame
+   * @param events a pointer to the first event to queue
+   * @param count the number of events to queue
+   * @return true if every event was queued, false if the queue did not have
+   *   room for all of them, in which case none are queued
+   */
+  bool PostEvents(const NoteEvent* events, size_t count);
+
+  /**
+   * Plays a performance from the start of the next Render() call. The time
+   *   of every event is converted to a frame at the current sample rate, and
+   *   the audio thread applies the event on exactly that frame by splitting
+   *   the block around it, so the timing doesn't depend on the block size or
+   *   on when blocks are rendered. Notes the previous performance left held
+   *   are released, even if it has ended. Must only be called from one
+   *   thread
+   * @param events the events to play, timed in seconds from the start of
+   *   the performance. Events with equal times keep their order
+   * @return true if the performance was queued, false if
+   *   kMaxPendingSequences earlier performances have not been collected yet
+   */
+  bool PlaySequence(const std::vector<TimedNoteEvent>& events);
+
+  /**
+   * Stops the performance at the start of the next Render() call, releasing
+   *   the notes it holds and lifting the sustain pedal if it pressed it. Must
+   *   only be called from the thread that calls PlaySequence()
+   * @return true if the stop was queued, false if kMaxPendingSequences
+   *   earlier performances have not been collected yet
+   */
+  bool StopSequence();
+
+  /**
+   * Check whether a performance is being played. Safe to call from any
+   *   thread
+   * @return true from the block a performance starts in until its last event
+   *   has been applied or it has been stopped
+   */
+  bool IsPlayingSequence() const;
+
+  /**
+   * Takes the NoteOn and NoteOff events the performance has applied so far,
+   *   including the releases of notes it held when it stopped, so they can
+   *   be shown. Destroys the performances that have ended. Must only be
+   *   called from the thread that calls PlaySequence()
+   * @return the events in the order they were applied. Events are dropped
+   *   once kEventQueueCapacity of them are waiting to be taken
+   */
+  std::vector<NoteEvent> TakeSequenceEvents();
+
+  /**
+   * Sets the maximum number of voices that may sound at once. Voices above
+   *   the new limit are stolen, and fade out over kStealFadeDuration
+   * @param polyphony the new polyphony, between 1 and kMaxPolyphony
+   */
+  void SetPolyphony(size_t polyphony);
+
+  /**
+   * Sets the policy used to choose which voice is cut off when a note is
+   *   struck while the polyphony has been reached
+   * @param steal_policy the new steal policy
+   */
+  void SetStealPolicy(StealPolicy steal_policy);
+
+  /**
+   * Sets how long notes struck from now on take to rise from silence to
+   *   full gain. Short attacks remove clicks from samples that don't start at
+   *   silence
+   * @param attack_duration the attack duration, in seconds. 0 starts every
+   *   note at full gain
+   */
+  void SetAttackDuration(double attack_duration);
+
+  /**
+   * Passes the mix through a reverb, or stops reverberating it. Must not be
+   *   called while Render() runs
+   * @param reverb the reverb, with at least as many channels as are
+   *   rendered, or nullptr to render the dry mix
+   */
+  void SetReverb(const ConvolutionReverbRef& reverb);
+
+  /**
+   * Get the reverb the mix is passed through
+   * @return the reverb, or nullptr if the dry mix is rendered
+   */
+  const ConvolutionReverbRef& GetReverb() const;
+
+  /**
+   * Sets the number of threads that mix the voices of every block,
+   *   including the thread calling Render(). Blocks with fewer than
+   *   kMinChunkVoices voices per thread use fewer threads. Must not be called
+   *   while Render() runs
+   * @param thread_count the number of threads, between 1 and
+   *   kMaxRenderThreads. 1 mixes every voice on the audio thread
+   */
+  void SetRenderThreadCount(size_t thread_count);
+
+  /**
+   * Starts the workers for a number of render threads, without handing them
+   *   to the sampler, so threads are never started while the audio thread
+   *   is locked out. Must not be called from the audio thread
+   * @param thread_count the number of threads, clamped between 1 and
+   *   kMaxRenderThreads
+   * @return the workers, or nullptr if the audio thread mixes alone
+   */
+  std::unique_ptr<RenderWorkers> MakeRenderWorkers(size_t thread_count);
+
+  /**
+   * Replaces the render workers. Must not be called while Render() runs.
+   *   The previous workers are returned, so they can be stopped once the
+   *   audio thread may run again
+   * @param workers workers made by MakeRenderWorkers()
+   * @return the previous workers
+   */
+  std::unique_ptr<RenderWorkers> SwapRenderWorkers(
+      std::unique_ptr<RenderWorkers> workers);
+
+  /**
+   * Get the number of threads that mix the voices of every block
+   * @return the number of threads, including the thread calling Render()
+   */
+  size_t GetRenderThreadCount() const;
+
+  /**
+   * Applies every queued event, then mixes all sounding voices into an output
+   *   buffer, overwriting its previous contents. Never allocates, frees,
+   *   locks or throws, which is checked under a RealtimeGuard
+   * @param output a non-interleaved buffer holding num_channels contiguous
+   *   channels of num_frames samples each
+   * @param num_channels the number of channels in output. Mono samples are
+   *   copied into every channel
+   * @param num_frames the number of frames to render
+   */
+  void Render(float* output, size_t num_channels, size_t num_frames) noexcept;
+
+  /**
+   * Get the number of voices that are currently sounding
+   * @return the number of sounding voices
+   */
+  size_t GetActiveVoiceCount() const;
+
+  /**
+   * Get the number of voices that have been stolen to respect the polyphony
+   * @return the total number of stolen voices
+   */
+  size_t GetStolenVoiceCount() const;
+
+  /**
+   * Get the number of times a streamed voice was not read from disk in time.
+   *   Safe to call from any thread
+   * @return the total number of stream underruns
+   */
+  uint64_t GetStreamUnderrunCount() const;
+
+  /**
+   * Get the latencies of every note whose NoteOn event carried the time it
+   *   was posted, from posting to the note's first non-zero rendered frame.
+   *   May be read from any thread
+   * @return the histogram of note latencies
+   */
+  LatencyHistogram& GetLatencyHistogram();
+
+  /**
+   * Get how much of the real-time budget of every Render() call was spent
+   *   rendering, including the events applied at its start. May be read
+   *   from any thread
+   * @return the meter of the rendering load
+   */
+  LoadMeter& GetLoadMeter();
+
+  // Semitone indices from C0 that can be mapped to samples
+  static constexpr size_t kSemitoneCount = 128;
+
+  // Number of instruments that may be layered or split at once
+  static constexpr size_t kMaxLayers = 4;
+
+  // Number of preallocated voices, which bounds the polyphony
+  static constexpr size_t kMaxPolyphony = 256;
+  static constexpr size_t kDefaultPolyphony = 64;
+
+  // Seconds over which a stolen voice fades out, and the number of voices
+  // reserved beyond the polyphony for stolen voices to fade in
+  static constexpr double kStealFadeDuration = 0.005;
+  static constexpr size_t kStealFadeVoices = 32;
+
+  // Number of events that may be waiting for the next rendered block
+  static constexpr size_t kEventQueueCapacity = 1024;
+
+  // Longest run of frames mixed at once. Voices that aren't pitch-shifted
+  // read ahead by at most this many frames, which the padding of every
+  // sample buffer covers
+  static constexpr size_t kMaxBlockFrames = SampleBuffer::kPaddingFrames;
+
+  // Furthest a sample may be shifted to play a note without a sample. A
+  // voice shifted up an octave reads two sample frames per output frame
+  static constexpr int kMaxPitchShift = 12;
+
+  // Number of voices that may stream at once, and how far each stream reads
+  // ahead of its voice
+  static constexpr size_t kMaxStreams = 64;
+  static constexpr size_t kStreamRingFrames = 16384;
+
+  // Number of swapped sample sets that may be waiting to be applied or
+  // collected at once
+  static constexpr size_t kMaxPendingSwaps = 4;
+
+  // Number of performances that may be waiting to be played or collected at
+  // once
+  static constexpr size_t kMaxPendingSequences = 4;
+
+  // Most threads that may mix a block, and the fewest voices each of them
+  // mixes. Chunks smaller than that cost more to hand out than to mix
+  static constexpr size_t kMaxRenderThreads = 8;
+  static constexpr size_t kMinChunkVoices = 16;
+
+  // Most channels that are mixed on several threads. Blocks with more
+  // channels are mixed on the audio thread
+  static constexpr size_t kMaxChunkChannels = 8;
+
+ private:
+  /**
+   * Every sample of an instrument, indexed by semitone. Handed between
+   *   threads by SwapSamples(), which never allocates on the audio thread
+   */
+  struct SampleSet {
+    std::vector<SampleBufferRef> samples_;
+    double crossfade_duration_;
+    size_t layer_;
+  };
+
+  /**
+   * An event of a performance, scheduled on a frame from its start
+   */
+  struct ScheduledEvent {
+    uint64_t frame_;
+    NoteEvent event_;
+  };
+
+  /**
+   * Every event of a performance, sorted by frame. Handed between threads by
+   *   PlaySequence(), like the sample sets
+   */
+  struct Sequence {
+    std::vector<ScheduledEvent> events_;
+  };
+
+  /**
+   * One of the instruments that are played at once
+   */
+  struct Layer {
+    std::vector<SampleBufferRef> samples_;
+    // The semitone of the sample that plays every note, or -1 if no sample
+    // is near enough. Rebuilt whenever samples_ changes
+    std::vector<int> zones_;
+    int lowest_semitone_;
+    int highest_semitone_;
+    float gain_;
+  };
+
+  std::vector<Layer> layers_;
+  int max_pitch_shift_;
+  VoicePool voices_;
+  EventQueue<NoteEvent> events_;
+  // Scratch space for one channel of every voice, reused by every block
+  std::vector<MixSource> mix_sources_;
+  // One channel of every pitch-shifted voice, resampled for the current block
+  std::vector<float> shifted_frames_;
+
+  double sample_rate_;
+  double resonate_duration_;
+  double attack_duration_;
+  bool is_sustain_down_;
+  ConvolutionReverbRef reverb_;
+  LatencyHistogram latencies_;
+  LoadMeter load_meter_;
+
+  // Swapped sets published for the audio thread, and the sets of replaced
+  // samples handed back once they are silent
+  EventQueue<SampleSet*> pending_sets_;
+  EventQueue<SampleSet*> retired_sets_;
+  // The replaced samples that fading voices of every layer are still
+  // playing, or nullptr if no voice of the layer is fading
+  std::vector<SampleSet*> fading_sets_;
+  // Sets published by SwapSamples() that have not been collected yet
+  size_t pending_swap_count_;
+  // Collected sets whose samples may still be read by a stream
+  std::vector<std::unique_ptr<SampleSet>> collected_sets_;
+
+  // Performances published for the audio thread, and the performances
+  // handed back once they have ended or been replaced
+  EventQueue<Sequence*> pending_sequences_;
+  EventQueue<Sequence*> retired_sequences_;
+  // Performances published that have not been collected yet
+  size_t pending_sequence_count_;
+  // The performance being played, its next event, and the frame of the
+  // performance that is rendered next
+  Sequence* sequence_;
+  size_t sequence_index_;
+  uint64_t sequence_frame_;
+  // The notes the performance holds down, and whether it pressed the
+  // sustain pedal
+  std::vector<char> sequence_notes_;
+  bool is_sequence_sustain_down_;
+  std::atomic<bool> is_sequence_playing_;
+  // NoteOn and NoteOff events the performance applied, waiting to be shown
+  EventQueue<NoteEvent> sequence_events_;
+
+  // Streamed samples that were replaced while the I/O thread may still read
+  // them. Destroyed once their streams are closed
+  std::vector<SampleBufferRef> retired_samples_;
+  // Declared after the samples so it stops reading before they are destroyed
+  StreamPool streams_;
+  // Whether a voice used each stream in the current block
+  std::vector<char> stream_used_;
+  // Frames read from every stream for the current block, one run of
+  // kMaxReadFrames per channel
+  std::vector<float> stream_frames_;
+  // The frame after the last one consumed from every stream, and that last
+  // frame for every channel. A pitch-shifted voice may read it again in the
+  // next block
+  std::vector<size_t> stream_next_frames_;
+  std::vector<float> stream_last_frames_;
+
+  /**
+   * The block that is being mixed on several threads. Written by the audio
+   *   thread before the chunks are handed out
+   */
+  struct ChunkedBlock {
+    float* output_;
+    size_t num_channels_;
+    size_t channel_stride_;
+    size_t num_frames_;
+    uint64_t block_time_;
+    size_t voice_count_;
+    size_t chunk_count_;
+  };
+
+  std::unique_ptr<RenderWorkers> render_workers_;
+  ChunkedBlock chunked_block_;
+  // The private mix of every chunk but the first, which is mixed straight
+  // into the output. kMaxChunkChannels channels of kMaxBlockFrames each
+  std::vector<float> chunk_frames_;
+  // Scratch space for adding the chunks into the output
+  std::vector<MixSource> chunk_sources_;
+
+  // Longest run of sample frames read by a voice in one block
+  static constexpr size_t kMaxReadFrames = 2 * kMaxBlockFrames + 2;
+
+  // Default rate used until SetSampleRate() is called
+  static constexpr double kDefaultSampleRate = 44100;
+
+  static constexpr double kNanosecondsPerSecond = 1e9;
+
+  /**
+   * Switches to the sample sets published by SwapSamples(), releasing every
+   *   sounding voice of their layers, and hands back every replaced set once
+   *   its voices have faded away. Called wherever samples_ may be changed
+   */
+  void ApplySwaps();
+
+  /**
+   * Check whether voices of a layer are still fading from a swap
+   * @param layer the layer, below kMaxLayers
+   * @return true if a voice of the layer plays replaced samples
+   */
+  bool IsLayerFading(size_t layer) const;
+
+  /**
+   * Queues a performance for the audio thread, after destroying the
+   *   performances it handed back
+   * @param sequence the performance to play. An empty performance stops the
+   *   current one
+   * @return true if the performance was queued, false if too many earlier
+   *   performances have not been collected yet
+   */
+  bool PublishSequence(std::unique_ptr<Sequence> sequence);
+
+  /**
+   * Switches to the performances published by PlaySequence(), releasing the
+   *   notes held by the performances before them
+   */
+  void ApplySequences();
+
+  /**
+   * Applies every event of the performance that is due on the next frame,
+   *   and finds how many frames can be rendered before the next event. Hands
+   *   the performance back once its last event has been applied
+   * @param max_frames the most frames that are rendered next
+   * @return the number of frames to render before calling this again, at
+   *   least 1 if max_frames is
+   */
+  size_t ApplySequenceEvents(size_t max_frames);
+
+  /**
+   * Applies an event of the performance, keeping track of the notes it
+   *   holds and queueing the event to be shown
+   * @param event the event to apply
+   */
+  void ApplySequenceEvent(const NoteEvent& event);
+
+  /**
+   * Releases every note the performance holds, and lifts the sustain pedal
+   *   if it pressed it
+   */
+  void ReleaseSequence();
+
+  /**
+   * Points every note of a layer at the nearest sample within the maximum
+   *   pitch shift
+   * @param layer the layer whose samples changed
+   */
+  void MapZones(size_t layer);
+
+  /**
+   * Check whether any voice is playing a sample, including voices of other
+   *   notes that play it pitch-shifted
+   * @param sample the sample to check
+   * @return true if a sounding voice reads the sample
+   */
+  bool IsPlaying(const SampleBuffer* sample) const;
+
+  /**
+   * Get the number of sample frames a voice reads to render a block. Voices
+   *   that are pitch-shifted read a different number of frames than they
+   *   render, including the frame after the block for interpolation
+   * @param voice a sounding voice
+   * @param num_frames the number of frames in the block
+   * @return the number of frames read from the voice's position onwards
+   */
+  size_t GetReadFrames(const Voice& voice, size_t num_frames) const;
+
+  /**
+   * Applies a single event on the audio thread
+   * @param event the event to apply
+   */
+  void HandleEvent(const NoteEvent& event);
+
+  /**
+   * Starts a new voice playing the sample mapped to a semitone in every
+   *   layer whose range holds the note. Earlier voices of the same note keep
+   *   sounding. Does nothing if the note is already held down
+   * @param semitone the semitone index of the note to play
+   * @param post_time when the NoteOn event was posted, or 0 if the note's
+   *   latency isn't measured
+   */
+  void StartNote(int semitone, uint64_t post_time);
+
+  /**
+   * Releases every held voice of a note. The voices fade to silence over the
+   *   resonate duration, and stop sounding once their gain reaches zero.
+   *   While the sustain pedal is down, the voices are sustained instead
+   * @param semitone the semitone index of the note to release
+   */
+  void ReleaseNote(int semitone);
+
+  /**
+   * Lifts the sustain pedal, releasing every sustained voice
+   */
+  void ReleaseSustainedNotes();
+
+  /**
+   * Sets the number of seconds a note takes to fade away after it is
+   *   released. If the new duration is shorter, notes that are already fading
+   *   are shortened to fade over the new duration
+   * @param resonate_duration the new resonate duration, in seconds
+   */
+  void ChangeResonateDuration(double resonate_duration);
+
+  /**
+   * Releases the envelope of a voice, so that it fades from its current gain
+   *   to silence over the resonate duration
+   * @param voice the voice that is being released
+   */
+  void StartRelease(Voice& voice) const;
+
+  /**
+   * Keeps a replaced sample alive until no stream reads it. Samples that
+   *   are held fully in memory are not kept
+   * @param sample the sample that is being replaced
+   */
+  void RetireSample(const SampleBufferRef& sample);
+
+  /**
+   * Destroys the retired samples that are no longer streamed
+   */
+  void PurgeRetiredSamples();
+
+  /**
+   * Copies the frames a streamed voice reads for a block into its stream's
+   *   frames, taking the frames that are held in memory from the head of
+   *   the sample
+   * @param voice a voice with an open stream
+   * @param read_frames the number of frames the voice reads for the block
+   */
+  void ReadStream(const Voice& voice, size_t read_frames);
+
+  /**
+   * Records the latency of every voice whose first non-zero frame is in the
+   *   block that was just mixed, and stops measuring those voices
+   * @param first_voice the index of the first voice that was mixed
+   * @param last_voice the index after the last voice that was mixed
+   * @param num_frames the number of frames in the block
+   * @param block_time when the first frame of the block was rendered, from
+   *   LatencyHistogram::Now()
+   */
+  void RecordLatencies(size_t first_voice, size_t last_voice,
+                       size_t num_frames, uint64_t block_time);
+
+  /**
+   * Mixes a range of the active voices into a block, without advancing them.
+   *   Voices in different ranges may be mixed on different threads at once
+   * @param first_voice the index of the first voice to mix
+   * @param last_voice the index after the last voice to mix
+   * @param output a pointer to the first frame of the block in channel 0
+   * @param num_channels the number of channels in output
+   * @param channel_stride the distance between consecutive channels in output
+   * @param num_frames the number of frames in the block
+   * @param block_time when the first frame of the block was rendered, from
+   *   LatencyHistogram::Now()
+   */
+  void MixVoiceRange(size_t first_voice, size_t last_voice, float* output,
+                     size_t num_channels, size_t channel_stride,
+                     size_t num_frames, uint64_t block_time);
+
+  /**
+   * Mixes one chunk of the voices of the chunked block. The first chunk is
+   *   mixed into the output, and every other chunk into its private frames.
+   *   Runs on the audio thread or a render worker
+   * @param chunk the index of the chunk
+   */
+  void MixChunk(size_t chunk);
+
+  /**
+   * Mixes every active voice into a block of at most kMaxBlockFrames frames,
+   *   then advances the voices and frees the ones that have finished
+   * @param output a pointer to the first frame of the block in channel 0
+   * @param num_channels the number of channels in output
+   * @param channel_stride the distance between consecutive channels in output
+   * @param num_frames the number of frames in the block
+   * @param block_time when the first frame of the block was rendered, from
+   *   LatencyHistogram::Now()
+   */
+  void RenderBlock(float* output, size_t num_channels, size_t channel_stride,
+                   size_t num_frames, uint64_t block_time);
+};
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_SAMPLER_H
@@ -0,0 +1,223 @@
+#ifndef SYNTHER_SAMPLER_NODE_H
+#define SYNTHER_SAMPLER_NODE_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "cinder/audio/InputNode.h"
+#include "core/sample_buffer.h"
+#include "core/sampler.h"
+
+namespace synther {
+
+namespace audio {
+
+typedef std::shared_ptr<class SamplerNode> SamplerNodeRef;
+
+/**
+ * A Cinder audio node that renders every note of an instrument. The node
+ *   owns a Sampler, and the audio graph pulls a single node no matter how many
+ *   samples the instrument has.
+ *
+ * Note events, performances and instrument swaps may be posted from one
+ *   main thread without locking. They are queued and applied by the audio
+ *   thread at the start of the next block.
+ *   Methods that change the instrument or voice pool synchronize with the
+ *   audio thread through the context mutex, like Cinder's own nodes.
+ */
+class SamplerNode : public ci::audio::InputNode {
+ public:
+  /**
+   * Constructs a sampler node without any samples
+   * @param resonate_duration the number of seconds a note takes to fade away
+   *   after it is released
+   * @param format the Cinder node format. Defaults to stereo output
+   */
+  explicit SamplerNode(double resonate_duration,
+                       const Format& format = Format().channels(2));
+
+  /**
+   * Replaces every sample of a layer rendered by the node. All sounding notes
+   *   of the layer are stopped
+   * @param samples a map from semitone indices to decoded samples
+   * @param layer the layer, below Sampler::kMaxLayers
+   */
+  void SetSamples(const std::map<int, SampleBufferRef>& samples,
+                  size_t layer = 0);
+
+  /**
+   * Replaces every sample of a layer rendered by the node without locking
+   *   out the audio thread. Sounding notes of the layer fade out over the
+   *   crossfade duration
+   * @param samples a map from semitone indices to decoded samples
+   * @param crossfade_duration the number of seconds over which sounding
+   *   notes fade out
+   * @param layer the layer, below Sampler::kMaxLayers
+   * @return true if the swap was queued, false if too many earlier swaps
+   *   have not been collected yet
+   */
+  bool SwapSamples(const std::map<int, SampleBufferRef>& samples,
+                   double crossfade_duration, size_t layer = 0);
+
+  /**
+   * Destroys the samples replaced by SwapSamples() that are no longer played.
+   *   Should be called regularly from the main thread
+   */
+  void CollectRetiredSamples();
+
+  /**
+   * Adds samples to a layer without stopping the notes that are sounding
+   * @param samples a map from semitone indices to decoded samples
+   * @param layer the layer, below Sampler::kMaxLayers
+   */
+  void AddSamples(const std::map<int, SampleBufferRef>& samples,
+                  size_t layer = 0);
+
+  /**
+   * Removes the samples of notes that are no longer sounding from a layer
+   * @param semitones the semitone indices of the notes to unload
+   * @param layer the layer, below Sampler::kMaxLayers
+   * @return the semitones that were unloaded. Notes that are still sounding
+   *   keep their samples
+   */
+  std::vector<int> UnloadSamples(const std::vector<int>& semitones,
+                                 size_t layer = 0);
+
+  /**
+   * Sets the notes a layer plays, which splits the keyboard between layers
+   * @param layer the layer, below Sampler::kMaxLayers
+   * @param lowest_semitone the semitone index of the lowest note played
+   * @param highest_semitone the semitone index of the highest note played
+   */
+  void SetLayerRange(size_t layer, int lowest_semitone, int highest_semitone);
+
+  /**
+   * Sets the gain every note of a layer is mixed at
+   * @param layer the layer, below Sampler::kMaxLayers
+   * @param gain the gain of the layer, between 0 and 1
+   */
+  void SetLayerGain(size_t layer, float gain);
+
+  /**
+   * Lets notes without a sample play the nearest sample, pitch-shifted
+   * @param max_shift the furthest a sample may be shifted, in semitones,
+   *   between 0 and Sampler::kMaxPitchShift
+   */
+  void SetMaxPitchShift(int max_shift);
+
+  /**
+   * Queues an event for the audio thread without blocking
+   * @param event the event to queue
+   * @return true if the event was queued, false if the event queue was full
+   */
+  bool PostEvent(const NoteEvent& event);
+
+  /**
+   * Queues several events that are applied within the same block
+   * @param events a pointer to the first event to queue
+   * @param count the number of events to queue
+   * @return true if every event was queued, false if none were queued
+   */
+  bool PostEvents(const NoteEvent* events, size_t count);
+
+  /**
+   * Queues a performance that the audio thread plays on the exact frame of
+   *   every event, without blocking
+   * @param events the events to play, timed in seconds from the start of
+   *   the next block
+   * @return true if the performance was queued, false if too many earlier
+   *   performances have not been collected yet
+   */
+  bool PlaySequence(const std::vector<TimedNoteEvent>& events);
+
+  /**
+   * Queues a stop of the performance being played, without blocking
+   * @return true if the stop was queued, false if too many earlier
+   *   performances have not been collected yet
+   */
+  bool StopSequence();
+
+  /**
+   * Check whether a performance is being played
+   * @return true until the last event of the performance has been applied or
+   *   it has been stopped
+   */
+  bool IsPlayingSequence() const;
+
+  /**
+   * Takes the NoteOn and NoteOff events the performance has applied, and
+   *   destroys the performances that have ended. Should be called regularly
+   *   from the main thread
+   * @return the events in the order they were applied
+   */
+  std::vector<NoteEvent> TakeSequenceEvents();
+
+  /**
+   * Sets the maximum number of voices that may sound at once
+   * @param polyphony the new polyphony, between 1 and Sampler::kMaxPolyphony
+   */
+  void SetPolyphony(size_t polyphony);
+
+  /**
+   * Sets the policy used to choose which voice is cut off when the polyphony
+   *   has been reached
+   * @param steal_policy the new steal policy
+   */
+  void SetStealPolicy(StealPolicy steal_policy);
+
+  /**
+   * Sets how long notes struck from now on take to rise to full gain
+   * @param attack_duration the attack duration, in seconds
+   */
+  void SetAttackDuration(double attack_duration);
+
+  /**
+   * Sets the number of threads that mix the notes of every block
+   * @param thread_count the number of threads, including the audio thread,
+   *   between 1 and Sampler::kMaxRenderThreads
+   */
+  void SetRenderThreadCount(size_t thread_count);
+
+  /**
+   * Passes the rendered notes through a reverb, or stops reverberating them
+   * @param reverb a reverb with as many channels as the node, or nullptr
+   *   to render the dry notes
+   */
+  void SetReverb(const ConvolutionReverbRef& reverb);
+
+  /**
+   * Get the number of times a streamed note was not read from disk in time
+   * @return the total number of stream underruns
+   */
+  uint64_t GetStreamUnderrunCount() const;
+
+  /**
+   * Get the latencies of notes posted with the time they were posted, from
+   *   posting to their first non-zero rendered frame
+   * @return the histogram of note latencies, which may be read from any
+   *   thread
+   */
+  LatencyHistogram& GetLatencyHistogram();
+
+  /**
+   * Get how much of every block's real-time budget was spent rendering it
+   * @return the meter of the rendering load, which may be read from any
+   *   thread
+   */
+  LoadMeter& GetLoadMeter();
+
+ protected:
+  void initialize() override;
+  void process(ci::audio::Buffer* buffer) override;
+
+ private:
+  Sampler sampler_;
+};
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_SAMPLER_NODE_H
@@ -72,7 +72,7 @@ class SoundJsonParser {
    *   Throws exception if note_string does not match the requirements
    * @return a music::Note object identical to the input note_string
    */
-  music::Note ParseNoteString(const std::string& note_string) const;
+  static music::Note ParseNoteString(const std::string& note_string);
 
  private:
   json sound_details_;
@@ -0,0 +1,181 @@
+#ifndef SYNTHER_STREAM_POOL_H
+#define SYNTHER_STREAM_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "core/stream_source.h"
+
+namespace synther {
+
+namespace audio {
+
+/**
+ * A fixed set of streams that read sample bodies from disk for the audio
+ *   thread. Every stream has a ring buffer that a background I/O thread keeps
+ *   filled ahead of the frame the audio thread is reading, so the audio
+ *   thread never touches the disk.
+ *
+ * Streams are opened, read and closed by the audio thread without locking or
+ *   allocating. If the I/O thread falls behind, the missing frames are
+ *   rendered as silence and counted as an underrun.
+ */
+class StreamPool {
+ public:
+  /**
+   * Constructs a pool of closed streams. No memory is allocated for the ring
+   *   buffers until Start() is called
+   * @param num_streams the number of streams that may be open at once
+   * @param ring_frames the number of frames buffered ahead by every stream.
+   *   Rounded up to a power of two
+   */
+  StreamPool(size_t num_streams, size_t ring_frames);
+
+  /**
+   * Stops the I/O thread
+   */
+  ~StreamPool();
+
+  StreamPool(const StreamPool&) = delete;
+  StreamPool& operator=(const StreamPool&) = delete;
+
+  /**
+   * Allocates the ring buffers and starts the I/O thread, if that has not
+   *   been done yet. May be called while the audio thread is running, but
+   *   not from it, and from only one thread at a time
+   */
+  void Start();
+
+  /**
+   * Check whether Start() has finished. Safe to call from any thread
+   * @return true if streams can be opened
+   */
+  bool IsStarted() const;
+
+  /**
+   * Opens a stream that reads a sample from a frame onwards. Called from the
+   *   audio thread
+   * @param source the sample to stream. Must stay alive until IsReading()
+   *   returns false for it
+   * @param first_frame the first frame that will be read from the stream
+   * @return the index of the stream, or -1 if every stream is in use
+   */
+  int Open(const StreamSource* source, size_t first_frame);
+
+  /**
+   * Copies the next frames of a stream into a channel-major buffer, then
+   *   lets the I/O thread reuse their space. Frames past the end of the
+   *   sample are silent. Called from the audio thread
+   * @param stream the index of an open stream
+   * @param first_frame the index of the first frame to copy. Must not be
+   *   lower than the frames already consumed
+   * @param num_frames the number of frames to copy
+   * @param output the buffer receiving one run of num_frames samples for
+   *   every channel of the source
+   * @param output_stride the distance between channels in output
+   * @return false if some frames had not been streamed yet and were silenced
+   */
+  bool Consume(int stream, size_t first_frame, size_t num_frames,
+               float* output, size_t output_stride);
+
+  /**
+   * Closes a stream. The I/O thread finishes with it before it can be opened
+   *   again. Called from the audio thread
+   * @param stream the index of an open stream
+   */
+  void Close(int stream);
+
+  /**
+   * Check whether a stream has been opened and not yet closed by the audio
+   *   thread. Called from the audio thread
+   * @param stream the index of the stream
+   * @return true if the stream is open
+   */
+  bool IsOpen(int stream) const;
+
+  /**
+   * Check whether any stream still reads a source. The I/O thread may use a
+   *   source for a short time after its stream is closed, so a source may
+   *   only be destroyed once this returns false. Safe to call while the
+   *   audio thread is running, as long as it can no longer open streams of
+   *   the source
+   * @param source the source to check
+   * @return true if a stream has not finished with the source
+   */
+  bool IsReading(const StreamSource* source) const;
+
+  /**
+   * Get the number of times frames were not streamed in time, or a stream
+   *   could not be opened because every stream was in use
+   * @return the total number of underruns
+   */
+  uint64_t GetUnderrunCount() const;
+
+  /**
+   * Get the number of streams in the pool
+   * @return the number of streams that may be open at once
+   */
+  size_t GetNumStreams() const;
+
+ private:
+  // The owner of a stream moves it between these states. The audio thread
+  // opens Free streams and closes them by setting Closing. The I/O thread
+  // moves Opening streams to Streaming and Closing streams back to Free
+  enum State { kFree, kOpening, kStreaming, kClosing };
+
+  struct Stream {
+    std::atomic<int> state_;
+    // Written by the audio thread before the stream is opened, and
+    // published by the store of kOpening
+    std::atomic<const StreamSource*> source_;
+    // Frames before read_frame_ have been consumed by the audio thread, and
+    // frames before write_frame_ have been streamed by the I/O thread
+    std::atomic<size_t> read_frame_;
+    std::atomic<size_t> write_frame_;
+    // One run of ring_frames_ samples per channel
+    std::vector<float> ring_;
+    // Only used by the audio thread
+    bool is_open_;
+    // Only used by the I/O thread
+    std::ifstream file_;
+  };
+
+  std::vector<std::unique_ptr<Stream>> streams_;
+  size_t ring_frames_;
+  std::atomic<uint64_t> underrun_count_;
+  std::atomic<bool> is_stopping_;
+  // Set once the rings are allocated and the I/O thread is running, which
+  // publishes the rings to the audio thread. io_thread_ itself is only used
+  // by Start() and the destructor
+  std::atomic<bool> is_started_;
+  std::thread io_thread_;
+
+  // Frames read from disk at once. Smaller reads are avoided unless they
+  // reach the end of the sample
+  static constexpr size_t kChunkFrames = 4096;
+  // How long the I/O thread sleeps when every stream is full
+  static constexpr int kIdleSleepMicroseconds = 1000;
+
+  /**
+   * Services every stream until the pool is destroyed. Runs on the I/O thread
+   */
+  void Run();
+
+  /**
+   * Reads the next chunk of a stream into its ring buffer, if there is room
+   * @param stream the stream to fill
+   * @return true if any frames were read
+   */
+  bool Fill(Stream& stream);
+};
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_STREAM_POOL_H
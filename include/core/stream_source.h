@@ -0,0 +1,82 @@
+#ifndef SYNTHER_STREAM_SOURCE_H
+#define SYNTHER_STREAM_SOURCE_H
+
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <string>
+
+namespace synther {
+
+namespace audio {
+
+enum class SampleFormat;
+
+/**
+ * The location of a decoded sample on disk, for samples whose bodies are
+ *   streamed instead of held in memory. The file stores the sample in the
+ *   layout of a SampleBuffer: every channel is a contiguous run of samples
+ *   followed by SampleBuffer::kPaddingFrames frames of silence
+ */
+class StreamSource {
+ public:
+  /**
+   * Describes a sample stored in a file
+   * @param path the path of the file
+   * @param data_offset the offset in bytes of the first sample in the file
+   * @param num_channels the number of channels in the sample
+   * @param num_frames the number of frames in the whole sample
+   * @param format the type that the file stores samples as
+   */
+  StreamSource(const std::string& path, size_t data_offset,
+               size_t num_channels, size_t num_frames, SampleFormat format);
+
+  /**
+   * Reads frames of one channel from the file, converted to floats
+   * @param file a binary stream opened on GetPath()
+   * @param channel the index of the channel to read
+   * @param first_frame the index of the first frame to read
+   * @param num_frames the number of frames to read
+   * @param output the array that receives num_frames samples
+   * @return true if every frame was read
+   */
+  bool Read(std::istream& file, size_t channel, size_t first_frame,
+            size_t num_frames, float* output) const;
+
+  /**
+   * Get the path of the file storing the sample
+   * @return the path of the file
+   */
+  const std::string& GetPath() const;
+
+  /**
+   * Get the number of channels in the sample
+   * @return the number of channels in the sample
+   */
+  size_t GetNumChannels() const;
+
+  /**
+   * Get the length of the whole sample
+   * @return the number of frames in the sample
+   */
+  size_t GetNumFrames() const;
+
+  // Streams carry at most this many channels, which bounds the memory of
+  // every stream's ring buffer
+  static constexpr size_t kMaxChannels = 2;
+
+ private:
+  std::string path_;
+  size_t data_offset_;
+  size_t num_channels_;
+  size_t num_frames_;
+  SampleFormat format_;
+};
+
+using StreamSourceRef = std::shared_ptr<const StreamSource>;
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_STREAM_SOURCE_H
@@ -0,0 +1,200 @@
+#ifndef SYNTHER_VOICE_POOL_H
+#define SYNTHER_VOICE_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "core/envelope.h"
+#include "core/sample_buffer.h"
+
+namespace synther {
+
+namespace audio {
+
+/**
+ * A single playback instance of a sample. Every strike of a note gets its own
+ *   voice, so a note that is struck again keeps its previous tail ringing
+ */
+struct Voice {
+  const SampleBuffer* sample_;
+  // The layer of the instrument whose sample the voice plays
+  size_t layer_;
+  int semitone_;
+  size_t position_;
+  Envelope envelope_;
+  bool is_held_;
+  // Set when the note was released while the sustain pedal was down. The
+  // voice keeps sounding until the pedal is lifted
+  bool is_sustained_;
+  // Set while the voice fades out after being stolen. Stolen voices don't
+  // count towards the polyphony
+  bool is_stolen_;
+  // Increases with every allocation, so lower orders belong to older voices
+  uint64_t order_;
+  // The stream reading the sample past its head, or -1 if the voice only
+  // plays the frames held in memory
+  int stream_;
+  // Sample frames played per output frame. 1 unless the voice plays the
+  // sample of another note, pitch-shifted
+  double rate_;
+  // How far the playback position is past position_, between 0 and 1
+  double fraction_;
+  // When the NoteOn that started the voice was posted, until the voice's
+  // first audible frame is rendered. 0 if the latency isn't measured
+  uint64_t strike_time_;
+};
+
+/**
+ * Decides which voice is stolen when a note is struck while every voice
+ *   allowed by the polyphony is already sounding
+ */
+enum class StealPolicy { Oldest, Quietest };
+
+/**
+ * A fixed-size pool of voices. Every voice is allocated on construction, and
+ *   Allocate() never allocates memory, so the pool can be used from the audio
+ *   thread.
+ *
+ * The number of voices that may sound at once is capped by the polyphony.
+ *   When the cap is reached, a sounding voice is stolen according to the
+ *   steal policy. Released voices are always stolen before held voices.
+ *
+ * Stolen voices fade out over a few milliseconds instead of being cut off
+ *   mid-waveform, which would click. They fade in voices reserved beyond
+ *   the capacity, and are only cut off once every reserved voice is fading.
+ */
+class VoicePool {
+ public:
+  /**
+   * Constructs a pool with every voice free
+   * @param capacity the number of voices that may sound at once. The
+   *   polyphony can never exceed the capacity
+   * @param polyphony the initial number of voices that may sound at once
+   * @param steal_policy the initial policy used to choose stolen voices
+   * @param fade_capacity the number of voices preallocated beyond the
+   *   capacity for stolen voices to fade out in
+   */
+  VoicePool(size_t capacity, size_t polyphony, StealPolicy steal_policy,
+            size_t fade_capacity = 0);
+
+  /**
+   * Sets the number of voices that may sound at once. If more voices are
+   *   sounding than the new polyphony allows, the excess voices are stolen
+   * @param polyphony the new polyphony. Clamped between 1 and the capacity
+   */
+  void SetPolyphony(size_t polyphony);
+
+  /**
+   * Get the number of voices that may sound at once
+   * @return the current polyphony of the pool
+   */
+  size_t GetPolyphony() const;
+
+  /**
+   * Sets the policy used to choose which voice is stolen
+   * @param steal_policy the new steal policy
+   */
+  void SetStealPolicy(StealPolicy steal_policy);
+
+  /**
+   * Sets how long stolen voices take to fade out. The owner of the pool
+   *   frees them once their envelope has finished
+   * @param fade_frames the number of frames the fade takes. Less than 1
+   *   frees stolen voices at once
+   */
+  void SetStealFade(double fade_frames);
+
+  /**
+   * Activates a voice, stealing a sounding voice if the polyphony has been
+   *   reached. Only the order and stolen flag of the voice are set; every
+   *   other field must be initialized by the caller
+   * @return a reference to the activated voice, which is the last active
+   *   voice until the pool is next modified
+   */
+  Voice& Allocate();
+
+  /**
+   * Returns an active voice to the pool. The last active voice takes the
+   *   place of the freed voice, so active indices after it are unchanged
+   * @param active_index the index of the voice among the active voices. Must
+   *   be less than GetActiveCount()
+   */
+  void Free(size_t active_index);
+
+  /**
+   * Frees every active voice
+   */
+  void Clear();
+
+  /**
+   * Get the number of voices that are currently active
+   * @return the number of active voices, including stolen voices that are
+   *   fading out
+   */
+  size_t GetActiveCount() const;
+
+  /**
+   * Get an active voice
+   * @param active_index the index of the voice among the active voices. Must
+   *   be less than GetActiveCount()
+   * @return a reference to the active voice
+   */
+  Voice& GetActive(size_t active_index);
+
+  /**
+   * Get a read-only active voice
+   * @param active_index the index of the voice among the active voices. Must
+   *   be less than GetActiveCount()
+   * @return a const reference to the active voice
+   */
+  const Voice& GetActive(size_t active_index) const;
+
+  /**
+   * Get the number of voices that have been stolen since construction
+   * @return the total number of stolen voices
+   */
+  size_t GetStolenCount() const;
+
+ private:
+  std::vector<Voice> voices_;
+  // Indices into voices_ of free and active voices
+  std::vector<size_t> free_voices_;
+  std::vector<size_t> active_voices_;
+
+  size_t capacity_;
+  size_t polyphony_;
+  StealPolicy steal_policy_;
+  double steal_fade_frames_;
+  uint64_t next_order_;
+  size_t stolen_count_;
+  // Active voices that are fading out after being stolen
+  size_t fading_count_;
+
+  /**
+   * Steals the voice chosen by the steal policy, fading it out or freeing
+   *   it at once
+   */
+  void Steal();
+
+  /**
+   * Chooses the active voice that will be stolen next according to the steal
+   *   policy. Must only be called while at least one voice is active and not
+   *   stolen
+   * @return the active index of the voice to steal
+   */
+  size_t FindVoiceToSteal() const;
+
+  /**
+   * Chooses the quietest of the stolen voices that are fading out. Must only
+   *   be called while at least one voice is fading
+   * @return the active index of the voice
+   */
+  size_t FindFadingVoice() const;
+};
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_VOICE_POOL_H
@@ -0,0 +1,28 @@
+#ifndef SYNTHER_WAV_WRITER_H
+#define SYNTHER_WAV_WRITER_H
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+namespace synther {
+
+namespace audio {
+
+/**
+ * Writes audio to a stream as a 32-bit floating point WAV file. Samples are
+ *   stored without any conversion, so rendering the same performance twice
+ *   produces byte-identical files
+ * @param out a binary output stream
+ * @param interleaved_samples the samples to write, interleaved by channel
+ * @param num_channels the number of channels in the audio
+ * @param sample_rate the sample rate of the audio in Hz
+ */
+void WriteWav(std::ostream& out, const std::vector<float>& interleaved_samples,
+              size_t num_channels, size_t sample_rate);
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_WAV_WRITER_H
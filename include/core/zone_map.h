@@ -0,0 +1,54 @@
+#ifndef SYNTHER_ZONE_MAP_H
+#define SYNTHER_ZONE_MAP_H
+
+#include <cmath>
+
+namespace synther {
+
+namespace audio {
+
+/**
+ * Finds the sample that plays a note of a sparsely sampled instrument. Every
+ *   note plays its own sample if it has one, and otherwise the nearest
+ *   sample, pitch-shifted by the distance between the two. Shifting a sample
+ *   down reads fewer frames and tends to sound more natural, so the sample
+ *   above is chosen when two are equally near
+ * @tparam HasSample a callable that takes a semitone index and returns true
+ *   if the note has a sample
+ * @param semitone the semitone index of the note to play
+ * @param max_shift the furthest a sample may be shifted, in semitones
+ * @param has_sample checks which notes have samples
+ * @return the semitone index of the sample to play, or -1 if no sample is
+ *   within max_shift semitones
+ */
+template <typename HasSample>
+int FindNearestSample(int semitone, int max_shift, HasSample has_sample) {
+  if (has_sample(semitone)) {
+    return semitone;
+  }
+  for (int distance = 1; distance <= max_shift; distance++) {
+    if (has_sample(semitone + distance)) {
+      return semitone + distance;
+    }
+    if (has_sample(semitone - distance)) {
+      return semitone - distance;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Get the rate at which a sample is played to sound at another pitch
+ * @param semitone the semitone index of the note to play
+ * @param sample_semitone the semitone index of the sample's own pitch
+ * @return the number of sample frames played per output frame
+ */
+inline double GetPitchRate(int semitone, int sample_semitone) {
+  return std::pow(2.0, (semitone - sample_semitone) / 12.0);
+}
+
+}  // namespace audio
+
+}  // namespace synther
+
+#endif  // SYNTHER_ZONE_MAP_H
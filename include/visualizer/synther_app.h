@@ -1,10 +1,14 @@
 #pragma once
 
+#include <future>
+#include <map>
 #include <string>
+#include <vector>
 
 #include "cinder/app/App.h"
 #include "cinder/app/RendererGl.h"
 #include "cinder/gl/gl.h"
+#include "core/instrument_cache.h"
 #include "core/piano_keybinder.h"
 #include "core/player.h"
 #include "visualizer/pedal.h"
@@ -26,6 +30,13 @@ class SyntherApp : public ci::app::App {
    */
   void setup() override;
 
+  /**
+   * Switches to an instrument that finished loading, hands newly loaded
+   *   notes to the audio thread and unloads notes that are no longer near the
+   *   keyboard's view
+   */
+  void update() override;
+
   /**
    * Draws all the components of the app on a window on the computer screen
    */
@@ -49,6 +60,12 @@ class SyntherApp : public ci::app::App {
    */
   void keyUp(ci::app::KeyEvent event) override;
 
+  /**
+   * Prints the latencies of the notes played during the session before the
+   *   app quits
+   */
+  void cleanup() override;
+
  private:
   // Window & Element positioning
   static constexpr double kWindowHeight = 700;
@@ -58,6 +75,8 @@ class SyntherApp : public ci::app::App {
   static constexpr double kBottomPadding = 25;
   static constexpr double kInstrumentTextPadding = 0;
   static constexpr double kInstrumentTextHeight = 100;
+  static constexpr double kLoadingTextHeight = 20;
+  static constexpr double kStatusLineHeight = 15;
   static constexpr double kPianoHeight = 450;
   static constexpr double kPedalHeight = 50;
   static constexpr double kPedalWidth = 200;
@@ -66,9 +85,11 @@ class SyntherApp : public ci::app::App {
   const std::string kBackgroundColor = "black";
   const std::string kMainFontName = "ToppanBunkyuGothicPr6N-DB";
   const std::string kInstrumentFontName = "SignPainter-HouseScript";
+  const std::string kLoadingText = "Loading...";
 
   // Metallic gold
   const ci::Color kInstrumentTextColor = ci::Color::hex(0xD4AF37);
+  const ci::Color kStatusTextColor = ci::Color::gray(0.6f);
 
   // Piano
   Piano piano_;
@@ -93,7 +114,61 @@ class SyntherApp : public ci::app::App {
   const std::string kDefaultSoundJson = "sounds/piano/";
   const std::string kJsonFilename = "details.json";
   static constexpr double kStandardResonation = 0.4;
-  static constexpr double kSustainedResonation = 5.0;
+  // Enough voices for long sustain-pedal passages, while bounding CPU load
+  static constexpr size_t kPolyphony = 96;
+  // Most threads that mix the notes of a block, capped by the cores
+  static constexpr size_t kMaxRenderThreads = 4;
+  // Only the notes in view and this many octaves around them are loaded
+  static constexpr size_t kNeighborOctaves = 1;
+  // Seconds of every long sample held in memory, with the rest streamed
+  static constexpr double kStreamHeadDuration = 0.5;
+  // Semitones between loaded samples. Raising it to 3 or 4 cuts sample memory
+  // by as much, with the notes in between pitch-shifted
+  static constexpr size_t kSampleStride = 1;
+  // Samples are kept as 16-bit integers, and stereo files recorded in mono
+  // keep one channel, which cuts sample memory by 2 to 4 times
+  static constexpr audio::SampleFormat kSampleFormat =
+      audio::SampleFormat::Int16;
+  static constexpr bool kIsDownmixed = true;
+  // Impulse response toggled with the reverb key, and the gain of the
+  // reverberated notes
+  const std::string kReverbImpulse = "impulses/reverb.wav";
+  static constexpr float kReverbWetGain = 0.3f;
+  // Layers played alongside the instrument: one stacked over every note at
+  // a lower gain, and one that takes the notes from kSplitSemitone upwards
+  static constexpr size_t kStackLayer = 1;
+  static constexpr size_t kSplitLayer = 2;
+  static constexpr float kStackLayerGain = 0.6f;
+  // Middle C
+  static constexpr int kSplitSemitone = 48;
+  static constexpr int kLowestSemitone = 0;
+  static constexpr int kHighestSemitone = 127;
+  // Directory the MIDI file dialog opens in, inside assets/
+  const std::string kScoreDirectory = "scores";
+  // The samples of the notes a MIDI file plays, which are decoded in the
+  // background before it is played in update()
+  std::future<std::map<int, audio::SampleBufferRef>> loading_sequence_;
+  std::vector<audio::TimedNoteEvent> loading_events_;
+  // The instrument the MIDI file's samples are decoded for
+  audio::InstrumentRef sequence_instrument_;
+
+  // Instruments
+  // Recently used instruments are kept prepared until their samples exceed
+  // this budget, so switching back to one is instant
+  audio::InstrumentCache instrument_cache_;
+  // Prepared on a background thread while the current instrument plays
+  std::future<audio::InstrumentRef> loading_instrument_;
+  std::string loading_directory_;
+  // The layer the loading instrument is played on, or 0 to switch to it
+  size_t loading_layer_;
+  // Samples decoded in the background for a cached instrument, which are
+  // merged into it once loading_instrument_ is ready
+  std::map<int, audio::SampleBufferRef> loading_samples_;
+  static constexpr size_t kInstrumentCacheBudget = 512 * 1024 * 1024;
+  static constexpr size_t kBytesPerMegabyte = 1024 * 1024;
+  static constexpr double kNanosecondsPerMillisecond = 1e6;
+  static constexpr double kPercent = 100;
+  static constexpr double kMillisecondsPerSecond = 1000;
 
   // Helper methods
   /**
@@ -116,12 +191,40 @@ class SyntherApp : public ci::app::App {
   void HandleShiftView(int displacement);
 
   /**
-   * Updates the state of the app to reflect a change in instrument
+   * Switches to the instrument in a directory, or plays it on a layer.
+   *   Cached instruments are switched to at once, while other instruments,
+   *   and the missing notes of cached instruments played on a layer, are
+   *   loaded in the background and applied in update(). Does nothing while
+   *   another instrument is loading
    * @param asset_directory the directory containing the instrument's sound
    *   files. The directory must contain a details.json file with information
    *   about the authors and note names of the sound files
+   * @param layer the layer the instrument is played on, or 0 to switch the
+   *   instrument
    */
-  void SetupInstrument(const std::string& asset_directory);
+  void SetupInstrument(const std::string& asset_directory, size_t layer = 0);
+
+  /**
+   * Updates the state of the app to reflect a change in instrument
+   * @param instrument the prepared instrument to play
+   */
+  void SwitchInstrument(const audio::InstrumentRef& instrument);
+
+  /**
+   * Plays an instrument on the stacked or split layer. Splitting the
+   *   keyboard leaves the notes below kSplitSemitone to the instrument
+   * @param layer kStackLayer or kSplitLayer
+   * @param instrument the prepared instrument to play
+   */
+  void SetInstrumentLayer(size_t layer,
+                          const audio::InstrumentRef& instrument);
+
+  /**
+   * Stops playing the instrument of a layer if it has one, and otherwise
+   *   prompts the user for an instrument to play on it
+   * @param layer kStackLayer or kSplitLayer
+   */
+  void ToggleLayer(size_t layer);
 
   /**
    * Toggles the resonate duration of the player. If duration is currently set
@@ -129,11 +232,46 @@ class SyntherApp : public ci::app::App {
    */
   void ToggleSustainPedal();
 
+  /**
+   * Moves playback to the next output device after the current one that
+   *   can run at the current sample rate, keeping the current block size
+   */
+  void SelectNextOutputDevice();
+
+  /**
+   * Turns the reverb on if it is off, and off if it is on. Does nothing if
+   *   the impulse response can't be loaded
+   */
+  void ToggleReverb();
+
+  /**
+   * Stops the MIDI file being played, or prompts the user for a MIDI file
+   *   and plays it once the notes it plays are loaded in the background.
+   *   Opens the file explorer in assets/scores/. Does nothing while another
+   *   MIDI file is loading
+   */
+  void ToggleMidiPlayback();
+
+  /**
+   * Presses and releases the piano keys of the notes the MIDI file has
+   *   played since the last update
+   */
+  void ShowSequenceNotes();
+
   /**
    * Sets keybinds based on the state of the piano's current view. Uses
-   *   updated keybinds to set corresponding labels on the piano
+   *   updated keybinds to set corresponding labels on the piano, and loads
+   *   the notes around the new view
    */
   void UpdateKeybindsAndLabels();
+
+  /**
+   * Summarizes how long the notes played so far took to be heard, from the
+   *   key being pressed to the note's first non-zero sample
+   * @return the number of notes and their median, 99th percentile and
+   *   longest latencies, and the output block the device adds to all of them
+   */
+  std::string GetLatencyReport() const;
 };
 
 }  // namespace visualizer
@@ -0,0 +1,101 @@
+#include "core/convolution_reverb.h"
+
+#include <algorithm>
+
+namespace synther {
+
+namespace audio {
+
+constexpr size_t ConvolutionReverb::kMaxRunFrames;
+constexpr double ConvolutionReverb::kMicrosecondsPerSecond;
+
+ConvolutionReverb::ConvolutionReverb(const SampleBuffer& impulse,
+                                     size_t num_channels, double sample_rate,
+                                     float wet_gain, float dry_gain,
+                                     bool is_tail_threaded,
+                                     size_t head_partition,
+                                     size_t tail_partition)
+    : impulse_frames_(impulse.GetNumFrames()),
+      wet_gain_(wet_gain),
+      dry_gain_(dry_gain),
+      wet_frames_(kMaxRunFrames),
+      is_stopping_(false),
+      idle_sleep_(0) {
+  // Impulses may be stored in any format, so every channel is copied out as
+  // floats
+  std::vector<float> impulse_frames(impulse_frames_);
+  for (size_t channel = 0; channel < num_channels; channel++) {
+    size_t impulse_channel = std::min(channel, impulse.GetNumChannels() - 1);
+    impulse.CopyFrames(impulse_channel, 0, impulse_frames_,
+                       impulse_frames.data());
+    convolvers_.emplace_back(new Convolver(impulse_frames.data(),
+                                           impulse_frames_, is_tail_threaded,
+                                           head_partition, tail_partition));
+  }
+
+  if (is_tail_threaded && !convolvers_.empty()) {
+    double partition_seconds =
+        convolvers_.front()->GetTailPartition() / sample_rate;
+    idle_sleep_ = std::chrono::microseconds(std::max<int64_t>(
+        static_cast<int64_t>(partition_seconds * kMicrosecondsPerSecond / 2),
+        1));
+    tail_thread_ = std::thread(&ConvolutionReverb::Run, this);
+  }
+}
+
+ConvolutionReverb::~ConvolutionReverb() {
+  is_stopping_.store(true);
+  if (tail_thread_.joinable()) {
+    tail_thread_.join();
+  }
+}
+
+void ConvolutionReverb::Process(float* buffer, size_t num_channels,
+                                size_t num_frames) {
+  size_t channel_count = std::min(num_channels, convolvers_.size());
+  for (size_t channel = 0; channel < channel_count; channel++) {
+    float* samples = buffer + channel * num_frames;
+    for (size_t offset = 0; offset < num_frames; offset += kMaxRunFrames) {
+      size_t run = std::min(kMaxRunFrames, num_frames - offset);
+      convolvers_[channel]->Process(samples + offset, wet_frames_.data(),
+                                    run);
+      for (size_t frame = 0; frame < run; frame++) {
+        samples[offset + frame] = dry_gain_ * samples[offset + frame] +
+                                  wet_gain_ * wet_frames_[frame];
+      }
+    }
+  }
+}
+
+size_t ConvolutionReverb::GetLatency() const {
+  return convolvers_.empty() ? 0 : convolvers_.front()->GetLatency();
+}
+
+uint64_t ConvolutionReverb::GetUnderrunCount() const {
+  uint64_t underrun_count = 0;
+  for (const auto& convolver : convolvers_) {
+    underrun_count += convolver->GetUnderrunCount();
+  }
+  return underrun_count;
+}
+
+size_t ConvolutionReverb::GetImpulseFrames() const {
+  return impulse_frames_;
+}
+
+void ConvolutionReverb::Run() {
+  while (!is_stopping_.load()) {
+    bool has_processed = false;
+    for (auto& convolver : convolvers_) {
+      has_processed = convolver->ProcessTail() || has_processed;
+    }
+
+    if (!has_processed) {
+      std::this_thread::sleep_for(idle_sleep_);
+    }
+  }
+}
+
+}  // namespace audio
+
+}  // namespace synther
@@ -0,0 +1,270 @@
+#include "core/convolver.h"
+
+#include <algorithm>
+
+#include "core/mix_kernel.h"
+
+namespace synther {
+
+namespace audio {
+
+namespace {
+
+size_t RoundUpPowerOfTwo(size_t value) {
+  size_t power = 1;
+  while (power < value) {
+    power *= 2;
+  }
+  return power;
+}
+
+}  // namespace
+
+constexpr size_t Convolver::kDefaultHeadPartition;
+constexpr size_t Convolver::kDefaultTailPartition;
+constexpr size_t Convolver::kInputRingBlocks;
+constexpr size_t Convolver::kOutputSlotCount;
+
+Convolver::Stage::Stage(size_t partition)
+    : partition_(partition),
+      fft_(2 * partition),
+      bin_count_(fft_.GetBinCount()),
+      partition_count_(0),
+      history_position_(0),
+      window_(2 * partition, 0.0f),
+      sum_real_(bin_count_),
+      sum_imag_(bin_count_),
+      transformed_(2 * partition) {
+}
+
+void Convolver::Stage::SetImpulse(const float* impulse,
+                                  size_t impulse_frames) {
+  partition_count_ = (impulse_frames + partition_ - 1) / partition_;
+  filter_real_.assign(partition_count_ * bin_count_, 0.0f);
+  filter_imag_.assign(partition_count_ * bin_count_, 0.0f);
+  history_real_.assign(partition_count_ * bin_count_, 0.0f);
+  history_imag_.assign(partition_count_ * bin_count_, 0.0f);
+  history_position_ = 0;
+
+  // Every partition is zero-padded to the size of the transform, so the
+  // second half of an input window is convolved without wrapping around.
+  // The inverse transform scales by its size, which is undone here once
+  std::vector<float> padded(2 * partition_);
+  float scale = 1.0f / static_cast<float>(2 * partition_);
+  for (size_t index = 0; index < partition_count_; index++) {
+    size_t first_frame = index * partition_;
+    size_t frames = std::min(partition_, impulse_frames - first_frame);
+    std::fill(padded.begin(), padded.end(), 0.0f);
+    for (size_t frame = 0; frame < frames; frame++) {
+      padded[frame] = impulse[first_frame + frame] * scale;
+    }
+    fft_.Forward(padded.data(), filter_real_.data() + index * bin_count_,
+                 filter_imag_.data() + index * bin_count_);
+  }
+}
+
+void Convolver::Stage::Process(const float* input, float* output) {
+  if (partition_count_ == 0) {
+    if (output) {
+      std::fill(output, output + partition_, 0.0f);
+    }
+    return;
+  }
+
+  // Overlap-save: the window holds the previous partition and this one, and
+  // only the second half of its convolution is free of wrapped frames
+  std::copy(window_.begin() + partition_, window_.end(), window_.begin());
+  std::copy(input, input + partition_, window_.begin() + partition_);
+  history_position_ = (history_position_ + 1) % partition_count_;
+  fft_.Forward(window_.data(),
+               history_real_.data() + history_position_ * bin_count_,
+               history_imag_.data() + history_position_ * bin_count_);
+  if (!output) {
+    return;
+  }
+
+  // The newest window meets the first impulse partition, the one before it
+  // the second, and so on
+  std::fill(sum_real_.begin(), sum_real_.end(), 0.0f);
+  std::fill(sum_imag_.begin(), sum_imag_.end(), 0.0f);
+  for (size_t index = 0; index < partition_count_; index++) {
+    size_t position = (history_position_ + partition_count_ - index) %
+                      partition_count_;
+    ComplexMultiplyAccumulate(
+        history_real_.data() + position * bin_count_,
+        history_imag_.data() + position * bin_count_,
+        filter_real_.data() + index * bin_count_,
+        filter_imag_.data() + index * bin_count_, sum_real_.data(),
+        sum_imag_.data(), bin_count_);
+  }
+  fft_.Inverse(sum_real_.data(), sum_imag_.data(), transformed_.data());
+  std::copy(transformed_.begin() + partition_, transformed_.end(), output);
+}
+
+Convolver::Convolver(const float* impulse, size_t impulse_frames,
+                     bool is_tail_threaded, size_t head_partition,
+                     size_t tail_partition)
+    : head_partition_(RoundUpPowerOfTwo(head_partition)),
+      tail_partition_(
+          std::max(RoundUpPowerOfTwo(tail_partition), head_partition_)),
+      has_tail_(impulse_frames > 2 * tail_partition_),
+      is_tail_threaded_(is_tail_threaded),
+      head_(head_partition_),
+      input_partition_(head_partition_, 0.0f),
+      output_partition_(head_partition_, 0.0f),
+      partition_fill_(0),
+      partition_count_(0),
+      tail_output_(tail_partition_, 0.0f),
+      tail_(tail_partition_),
+      tail_input_(tail_partition_),
+      next_tail_block_(0),
+      input_ring_(has_tail_ ? kInputRingBlocks * tail_partition_ : 0),
+      input_frame_count_(0),
+      lost_frame_end_(0),
+      read_frame_count_(0),
+      output_slots_(has_tail_ ? kOutputSlotCount * tail_partition_ : 0),
+      consumed_block_count_(0),
+      underrun_count_(0) {
+  for (std::atomic<size_t>& tag : slot_tags_) {
+    tag.store(0);
+  }
+
+  // The head covers the first two tail partitions of the impulse, which are
+  // heard before a tail partition can be convolved
+  size_t head_frames = has_tail_ ? 2 * tail_partition_ : impulse_frames;
+  head_.SetImpulse(impulse, head_frames);
+  if (has_tail_) {
+    tail_.SetImpulse(impulse + head_frames, impulse_frames - head_frames);
+  }
+}
+
+void Convolver::Process(const float* input, float* output,
+                        size_t num_frames) {
+  size_t frame = 0;
+  while (frame < num_frames) {
+    size_t run = std::min(head_partition_ - partition_fill_,
+                          num_frames - frame);
+    // The input is taken before the output is written, since they may be
+    // the same array
+    std::copy(input + frame, input + frame + run,
+              input_partition_.begin() + partition_fill_);
+    std::copy(output_partition_.begin() + partition_fill_,
+              output_partition_.begin() + partition_fill_ + run,
+              output + frame);
+    partition_fill_ += run;
+    frame += run;
+
+    if (partition_fill_ == head_partition_) {
+      ProcessPartition();
+      partition_fill_ = 0;
+    }
+  }
+}
+
+bool Convolver::ProcessTail() {
+  if (!has_tail_) {
+    return false;
+  }
+
+  size_t block = next_tail_block_;
+  size_t first_frame = block * tail_partition_;
+  if (input_frame_count_.load(std::memory_order_acquire) <
+      first_frame + tail_partition_) {
+    return false;
+  }
+  // A slot may only be reused once the audio thread is done with it
+  size_t consumed_count =
+      consumed_block_count_.load(std::memory_order_acquire);
+  if (block >= consumed_count + kOutputSlotCount) {
+    return false;
+  }
+
+  const float* ring_block =
+      input_ring_.data() + first_frame % input_ring_.size();
+  std::copy(ring_block, ring_block + tail_partition_, tail_input_.begin());
+  read_frame_count_.store(first_frame + tail_partition_,
+                          std::memory_order_release);
+
+  // Frames the audio thread dropped were never written to the ring. The
+  // block is convolved as silence, which keeps later blocks aligned with
+  // the impulse
+  if (lost_frame_end_.load(std::memory_order_acquire) > first_frame) {
+    std::fill(tail_input_.begin(), tail_input_.end(), 0.0f);
+  }
+
+  // Blocks the audio thread has given up on are only remembered
+  size_t slot = block % kOutputSlotCount;
+  bool is_heard = block >= consumed_count;
+  tail_.Process(tail_input_.data(),
+                is_heard ? output_slots_.data() + slot * tail_partition_
+                         : nullptr);
+  if (is_heard) {
+    slot_tags_[slot].store(block + 1, std::memory_order_release);
+  }
+  next_tail_block_++;
+  return true;
+}
+
+size_t Convolver::GetLatency() const {
+  return head_partition_;
+}
+
+size_t Convolver::GetTailPartition() const {
+  return tail_partition_;
+}
+
+uint64_t Convolver::GetUnderrunCount() const {
+  return underrun_count_.load(std::memory_order_relaxed);
+}
+
+void Convolver::ProcessPartition() {
+  size_t first_frame = partition_count_ * head_partition_;
+  head_.Process(input_partition_.data(), output_partition_.data());
+
+  if (has_tail_) {
+    // Hand the input to the tail, unless the tail has fallen so far behind
+    // that the ring is full
+    size_t frame_end = first_frame + head_partition_;
+    if (frame_end <= read_frame_count_.load(std::memory_order_acquire) +
+                         input_ring_.size()) {
+      std::copy(input_partition_.begin(), input_partition_.end(),
+                input_ring_.begin() + first_frame % input_ring_.size());
+    } else {
+      lost_frame_end_.store(frame_end, std::memory_order_relaxed);
+    }
+    input_frame_count_.store(frame_end, std::memory_order_release);
+    if (!is_tail_threaded_ && frame_end % tail_partition_ == 0) {
+      ProcessTail();
+    }
+
+    // Tail partition k is heard from frame (k + 2) * tail_partition_, one
+    // whole partition after its input was collected
+    if (first_frame >= 2 * tail_partition_) {
+      size_t offset = first_frame % tail_partition_;
+      if (offset == 0) {
+        TakeTailBlock(first_frame / tail_partition_ - 2);
+      }
+      for (size_t frame = 0; frame < head_partition_; frame++) {
+        output_partition_[frame] += tail_output_[offset + frame];
+      }
+    }
+  }
+  partition_count_++;
+}
+
+void Convolver::TakeTailBlock(size_t block) {
+  size_t slot = block % kOutputSlotCount;
+  if (slot_tags_[slot].load(std::memory_order_acquire) == block + 1) {
+    const float* slot_frames = output_slots_.data() + slot * tail_partition_;
+    std::copy(slot_frames, slot_frames + tail_partition_,
+              tail_output_.begin());
+  } else {
+    std::fill(tail_output_.begin(), tail_output_.end(), 0.0f);
+    underrun_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+  consumed_block_count_.store(block + 1, std::memory_order_release);
+}
+
+}  // namespace audio
+
+}  // namespace synther
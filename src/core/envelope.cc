@@ -0,0 +1,73 @@
+#include "core/envelope.h"
+
+#include <algorithm>
+
+namespace synther {
+
+namespace audio {
+
+Envelope::Envelope() : stage_(Stage::Release), level_(0), step_(0) {
+}
+
+void Envelope::Start(double attack_frames) {
+  if (attack_frames < 1) {
+    stage_ = Stage::Sustain;
+    level_ = 1;
+    step_ = 0;
+  } else {
+    stage_ = Stage::Attack;
+    level_ = 0;
+    step_ = static_cast<float>(1 / attack_frames);
+  }
+}
+
+void Envelope::Release(double release_frames) {
+  stage_ = Stage::Release;
+  if (release_frames < 1) {
+    level_ = 0;
+    step_ = 0;
+  } else {
+    step_ = static_cast<float>(-level_ / release_frames);
+  }
+}
+
+void Envelope::FadeOut(double fade_frames) {
+  if (stage_ != Stage::Release || fade_frames < 1) {
+    Release(fade_frames);
+  } else {
+    step_ = std::min(step_, static_cast<float>(-level_ / fade_frames));
+  }
+}
+
+void Envelope::Advance(size_t num_frames) {
+  float level = level_ + step_ * static_cast<float>(num_frames);
+  level_ = std::min(std::max(level, 0.0f), 1.0f);
+
+  // The mixer held the gain at the target from the frame it was reached
+  if (stage_ == Stage::Attack && level_ >= 1) {
+    stage_ = Stage::Sustain;
+    step_ = 0;
+  } else if (stage_ == Stage::Release && level_ <= 0) {
+    step_ = 0;
+  }
+}
+
+float Envelope::GetLevel() const {
+  return level_;
+}
+
+float Envelope::GetStep() const {
+  return step_;
+}
+
+bool Envelope::IsReleased() const {
+  return stage_ == Stage::Release;
+}
+
+bool Envelope::IsFinished() const {
+  return stage_ == Stage::Release && level_ <= 0;
+}
+
+}  // namespace audio
+
+}  // namespace synther
@@ -0,0 +1,57 @@
+#include "core/event_list_parser.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "core/music_note.h"
+#include "core/sound_json_parser.h"
+
+namespace synther {
+
+namespace audio {
+
+const std::string EventListParser::kEventsKey = "events";
+const std::string EventListParser::kTimeKey = "time";
+const std::string EventListParser::kTypeKey = "type";
+const std::string EventListParser::kNoteKey = "note";
+const std::string EventListParser::kDownKey = "down";
+
+EventListParser::EventListParser(std::istream& json) {
+  json >> event_list_;
+}
+
+std::vector<TimedNoteEvent> EventListParser::GetEvents() const {
+  std::vector<TimedNoteEvent> events;
+  for (const auto& event_json : event_list_.at(kEventsKey)) {
+    double time = event_json.at(kTimeKey).get<double>();
+    std::string type = event_json.at(kTypeKey).get<std::string>();
+
+    if (type == "noteOn" || type == "noteOff") {
+      std::string note_string = event_json.at(kNoteKey).get<std::string>();
+      int semitone =
+          SoundJsonParser::ParseNoteString(note_string).GetSemitoneIndex();
+      NoteEvent event = type == "noteOn" ? NoteEvent::NoteOn(semitone)
+                                         : NoteEvent::NoteOff(semitone);
+      events.push_back({time, event});
+    } else if (type == "sustain") {
+      bool is_down = event_json.at(kDownKey).get<bool>();
+      NoteEvent event =
+          is_down ? NoteEvent::SustainOn() : NoteEvent::SustainOff();
+      events.push_back({time, event});
+    } else {
+      throw std::invalid_argument("Unknown event type: " + type);
+    }
+  }
+
+  // Keep simultaneous events in file order, so a release and a re-strike at
+  // the same time are applied in the order they were written
+  std::stable_sort(events.begin(), events.end(),
+                   [](const TimedNoteEvent& lhs, const TimedNoteEvent& rhs) {
+                     return lhs.time_ < rhs.time_;
+                   });
+  return events;
+}
+
+}  // namespace audio
+
+}  // namespace synther
@@ -0,0 +1,137 @@
+#include "core/fft.h"
+
+#include <cmath>
+
+namespace synther {
+
+namespace audio {
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+
+}  // namespace
+
+Fft::Fft(size_t size)
+    : size_(size),
+      half_size_(size / 2),
+      bit_reversal_(half_size_),
+      twiddle_real_(half_size_ / 2),
+      twiddle_imag_(half_size_ / 2),
+      rotation_real_(half_size_ + 1),
+      rotation_imag_(half_size_ + 1),
+      work_real_(half_size_),
+      work_imag_(half_size_) {
+  size_t bits = 0;
+  while ((static_cast<size_t>(1) << bits) < half_size_) {
+    bits++;
+  }
+  for (size_t index = 0; index < half_size_; index++) {
+    size_t reversed = 0;
+    for (size_t bit = 0; bit < bits; bit++) {
+      reversed |= ((index >> bit) & 1) << (bits - 1 - bit);
+    }
+    bit_reversal_[index] = reversed;
+  }
+
+  // The tables are computed in double precision, so their rounding errors
+  // don't add up across the stages of the transform
+  for (size_t index = 0; index < twiddle_real_.size(); index++) {
+    double angle = -2 * kPi * static_cast<double>(index) /
+                   static_cast<double>(half_size_);
+    twiddle_real_[index] = static_cast<float>(std::cos(angle));
+    twiddle_imag_[index] = static_cast<float>(std::sin(angle));
+  }
+  for (size_t index = 0; index < rotation_real_.size(); index++) {
+    double angle = -2 * kPi * static_cast<double>(index) /
+                   static_cast<double>(size_);
+    rotation_real_[index] = static_cast<float>(std::cos(angle));
+    rotation_imag_[index] = static_cast<float>(std::sin(angle));
+  }
+}
+
+void Fft::Forward(const float* input, float* real, float* imag) {
+  // Even samples become the real parts and odd samples the imaginary parts
+  // of a complex signal half as long
+  for (size_t index = 0; index < half_size_; index++) {
+    work_real_[bit_reversal_[index]] = input[2 * index];
+    work_imag_[bit_reversal_[index]] = input[2 * index + 1];
+  }
+  Transform(false);
+
+  // Separate the spectra of the even and odd samples, then combine them
+  for (size_t bin = 0; bin <= half_size_; bin++) {
+    size_t index = bin % half_size_;
+    size_t mirror = (half_size_ - bin) % half_size_;
+    float even_real = 0.5f * (work_real_[index] + work_real_[mirror]);
+    float even_imag = 0.5f * (work_imag_[index] - work_imag_[mirror]);
+    float odd_real = 0.5f * (work_imag_[index] + work_imag_[mirror]);
+    float odd_imag = -0.5f * (work_real_[index] - work_real_[mirror]);
+    real[bin] = even_real + rotation_real_[bin] * odd_real -
+                rotation_imag_[bin] * odd_imag;
+    imag[bin] = even_imag + rotation_real_[bin] * odd_imag +
+                rotation_imag_[bin] * odd_real;
+  }
+}
+
+void Fft::Inverse(const float* real, const float* imag, float* output) {
+  // Undo the combination in Forward(), leaving out its halving, which scales
+  // the output by size_ along with the unnormalized complex transform
+  for (size_t bin = 0; bin < half_size_; bin++) {
+    size_t mirror = half_size_ - bin;
+    float mirror_imag = mirror == half_size_ ? 0.0f : imag[mirror];
+    float bin_imag = bin == 0 ? 0.0f : imag[bin];
+    float even_real = real[bin] + real[mirror];
+    float even_imag = bin_imag - mirror_imag;
+    float difference_real = real[bin] - real[mirror];
+    float difference_imag = bin_imag + mirror_imag;
+    float odd_real = difference_real * rotation_real_[bin] +
+                     difference_imag * rotation_imag_[bin];
+    float odd_imag = difference_imag * rotation_real_[bin] -
+                     difference_real * rotation_imag_[bin];
+    work_real_[bit_reversal_[bin]] = even_real - odd_imag;
+    work_imag_[bit_reversal_[bin]] = even_imag + odd_real;
+  }
+  Transform(true);
+
+  for (size_t index = 0; index < half_size_; index++) {
+    output[2 * index] = work_real_[index];
+    output[2 * index + 1] = work_imag_[index];
+  }
+}
+
+size_t Fft::GetSize() const {
+  return size_;
+}
+
+size_t Fft::GetBinCount() const {
+  return half_size_ + 1;
+}
+
+void Fft::Transform(bool is_inverse) {
+  float sign = is_inverse ? -1.0f : 1.0f;
+  for (size_t length = 2; length <= half_size_; length *= 2) {
+    size_t half_length = length / 2;
+    size_t stride = half_size_ / length;
+    for (size_t start = 0; start < half_size_; start += length) {
+      for (size_t offset = 0; offset < half_length; offset++) {
+        float twiddle_real = twiddle_real_[offset * stride];
+        float twiddle_imag = sign * twiddle_imag_[offset * stride];
+        size_t first = start + offset;
+        size_t second = first + half_length;
+        float product_real = work_real_[second] * twiddle_real -
+                             work_imag_[second] * twiddle_imag;
+        float product_imag = work_real_[second] * twiddle_imag +
+                             work_imag_[second] * twiddle_real;
+        work_real_[second] = work_real_[first] - product_real;
+        work_imag_[second] = work_imag_[first] - product_imag;
+        work_real_[first] += product_real;
+        work_imag_[first] += product_imag;
+      }
+    }
+  }
+}
+
+}  // namespace audio
+
+}  // namespace synther
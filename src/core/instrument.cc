@@ -0,0 +1,19 @@
+#include "core/instrument.h"
+
+namespace synther {
+
+namespace audio {
+
+size_t Instrument::GetMemorySize() const {
+  size_t memory_size = 0;
+  for (const auto& sample_pair : samples_) {
+    if (sample_pair.second) {
+      memory_size += sample_pair.second->GetMemorySize();
+    }
+  }
+  return memory_size;
+}
+
+}  // namespace audio
+
+}  // namespace synther
@@ -0,0 +1,71 @@
+#include "core/instrument_cache.h"
+
+namespace synther {
+
+namespace audio {
+
+InstrumentCache::InstrumentCache(size_t byte_budget)
+    : byte_budget_(byte_budget), hit_count_(0), miss_count_(0) {
+}
+
+InstrumentRef InstrumentCache::Find(const std::string& key) {
+  auto entry = index_.find(key);
+  if (entry == index_.end()) {
+    miss_count_++;
+    return nullptr;
+  }
+
+  hit_count_++;
+  entries_.splice(entries_.begin(), entries_, entry->second);
+  return entry->second->second;
+}
+
+void InstrumentCache::Insert(const std::string& key,
+                             const InstrumentRef& instrument) {
+  auto entry = index_.find(key);
+  if (entry != index_.end()) {
+    entries_.erase(entry->second);
+  }
+  entries_.emplace_front(key, instrument);
+  index_[key] = entries_.begin();
+  Trim();
+}
+
+void InstrumentCache::Trim() {
+  size_t resident_bytes = GetResidentBytes();
+  while (resident_bytes > byte_budget_ && entries_.size() > 1) {
+    const Entry& least_recent = entries_.back();
+    resident_bytes -= least_recent.second->GetMemorySize();
+    index_.erase(least_recent.first);
+    entries_.pop_back();
+  }
+}
+
+void InstrumentCache::SetByteBudget(size_t byte_budget) {
+  byte_budget_ = byte_budget;
+  Trim();
+}
+
+size_t InstrumentCache::GetSize() const {
+  return entries_.size();
+}
+
+size_t InstrumentCache::GetResidentBytes() const {
+  size_t resident_bytes = 0;
+  for (const Entry& entry : entries_) {
+    resident_bytes += entry.second->GetMemorySize();
+  }
+  return resident_bytes;
+}
+
+size_t InstrumentCache::GetHitCount() const {
+  return hit_count_;
+}
+
+size_t InstrumentCache::GetMissCount() const {
+  return miss_count_;
+}
+
+}  // namespace audio
+
+}  // namespace synther
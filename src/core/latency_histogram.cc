@@ -0,0 +1,114 @@
+#include "core/latency_histogram.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace synther {
+
+namespace audio {
+
+constexpr size_t LatencyHistogram::kSubBucketBits;
+constexpr size_t LatencyHistogram::kSubBucketCount;
+constexpr size_t LatencyHistogram::kMaxExponent;
+constexpr size_t LatencyHistogram::kBucketCount;
+
+LatencyHistogram::LatencyHistogram()
+    : counts_(kBucketCount), total_count_(0), max_(0) {
+  Reset();
+}
+
+void LatencyHistogram::Record(uint64_t nanoseconds) {
+  counts_[GetBucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+  total_count_.fetch_add(1, std::memory_order_relaxed);
+
+  uint64_t max = max_.load(std::memory_order_relaxed);
+  while (nanoseconds > max &&
+         !max_.compare_exchange_weak(max, nanoseconds,
+                                     std::memory_order_relaxed)) {
+  }
+}
+
+void LatencyHistogram::Reset() {
+  for (std::atomic<uint64_t>& count : counts_) {
+    count.store(0, std::memory_order_relaxed);
+  }
+  total_count_.store(0, std::memory_order_relaxed);
+  max_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetCount() const {
+  return total_count_.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetPercentile(double percentile) const {
+  // Sum the buckets rather than reading total_count_, so a latency recorded
+  // while walking the buckets can't push the rank past every bucket
+  uint64_t total = 0;
+  for (const std::atomic<uint64_t>& count : counts_) {
+    total += count.load(std::memory_order_relaxed);
+  }
+  if (total == 0) {
+    return 0;
+  }
+
+  double fraction = std::min(std::max(percentile, 0.0), 100.0) / 100;
+  uint64_t rank = static_cast<uint64_t>(std::ceil(fraction * total));
+  rank = std::max<uint64_t>(rank, 1);
+
+  uint64_t seen = 0;
+  for (size_t bucket = 0; bucket < kBucketCount; bucket++) {
+    seen += counts_[bucket].load(std::memory_order_relaxed);
+    if (seen >= rank) {
+      return std::min(GetBucketLimit(bucket), GetMax());
+    }
+  }
+  return GetMax();
+}
+
+uint64_t LatencyHistogram::GetMax() const {
+  return max_.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::Now() {
+  auto elapsed = std::chrono::steady_clock::now().time_since_epoch();
+  uint64_t nanoseconds = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+  // 0 marks events whose latency isn't measured
+  return std::max<uint64_t>(nanoseconds, 1);
+}
+
+size_t LatencyHistogram::GetBucket(uint64_t nanoseconds) {
+  if (nanoseconds < 2 * kSubBucketCount) {
+    return static_cast<size_t>(nanoseconds);
+  }
+
+  size_t exponent = 0;
+  while (exponent + 1 < kMaxExponent && (nanoseconds >> (exponent + 1)) != 0) {
+    exponent++;
+  }
+  if ((nanoseconds >> exponent) > 1) {
+    return kBucketCount - 1;
+  }
+
+  // The kSubBucketBits bits after the leading one pick the sub-bucket
+  size_t sub_bucket = static_cast<size_t>(
+      (nanoseconds >> (exponent - kSubBucketBits)) - kSubBucketCount);
+  return (exponent - kSubBucketBits + 1) * kSubBucketCount + sub_bucket;
+}
+
+uint64_t LatencyHistogram::GetBucketLimit(size_t bucket) {
+  if (bucket < 2 * kSubBucketCount) {
+    return bucket;
+  }
+
+  size_t exponent = bucket / kSubBucketCount + kSubBucketBits - 1;
+  uint64_t sub_bucket = bucket % kSubBucketCount;
+  size_t shift = exponent - kSubBucketBits;
+  return ((kSubBucketCount + sub_bucket) << shift) + (uint64_t(1) << shift) -
+         1;
+}
+
+}  // namespace audio
+
+}  // namespace synther
@@ -0,0 +1,74 @@
+#include "core/load_meter.h"
+
+#include <cmath>
+
+namespace synther {
+
+namespace audio {
+
+constexpr double LoadMeter::kDefaultTimeConstant;
+
+LoadMeter::LoadMeter(double time_constant)
+    : time_constant_(time_constant),
+      smoothed_load_(0),
+      load_(0),
+      peak_load_(0),
+      late_block_count_(0),
+      block_count_(0) {
+}
+
+void LoadMeter::Record(uint64_t busy_nanoseconds,
+                       uint64_t budget_nanoseconds) {
+  if (budget_nanoseconds == 0) {
+    return;
+  }
+
+  double load = static_cast<double>(busy_nanoseconds) / budget_nanoseconds;
+
+  // Weigh the block by how long it plays, so the smoothing doesn't depend on
+  // the block size
+  double weight = 1;
+  if (time_constant_ > 0) {
+    double budget = static_cast<double>(budget_nanoseconds) / 1e9;
+    weight = 1 - std::exp(-budget / time_constant_);
+  }
+  smoothed_load_ += (load - smoothed_load_) * weight;
+  load_.store(smoothed_load_, std::memory_order_relaxed);
+
+  double peak_load = peak_load_.load(std::memory_order_relaxed);
+  while (load > peak_load &&
+         !peak_load_.compare_exchange_weak(peak_load, load,
+                                           std::memory_order_relaxed)) {
+  }
+
+  if (busy_nanoseconds > budget_nanoseconds) {
+    late_block_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+  block_count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+double LoadMeter::GetLoad() const {
+  return load_.load(std::memory_order_relaxed);
+}
+
+double LoadMeter::GetPeakLoad() const {
+  return peak_load_.load(std::memory_order_relaxed);
+}
+
+uint64_t LoadMeter::GetLateBlockCount() const {
+  return late_block_count_.load(std::memory_order_relaxed);
+}
+
+uint64_t LoadMeter::GetBlockCount() const {
+  return block_count_.load(std::memory_order_relaxed);
+}
+
+void LoadMeter::Reset() {
+  peak_load_.store(0, std::memory_order_relaxed);
+  late_block_count_.store(0, std::memory_order_relaxed);
+  block_count_.store(0, std::memory_order_relaxed);
+}
+
+}  // namespace audio
+
+}  // namespace synther
@@ -0,0 +1,110 @@
+#include "core/mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace synther {
+
+namespace audio {
+
+namespace {
+
+// Smallest page size of the supported platforms. Touching one byte per page
+// is enough to fault the whole page in
+const size_t kPageSize = 4096;
+
+}  // namespace
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& path) : data_(nullptr), size_(0) {
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return;
+  }
+
+  LARGE_INTEGER file_size;
+  if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+    HANDLE mapping =
+        CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    if (mapping != nullptr) {
+      // The view keeps the mapping alive after its handle is closed
+      void* view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+      if (view != nullptr) {
+        data_ = static_cast<char*>(view);
+        size_ = static_cast<size_t>(file_size.QuadPart);
+      }
+      CloseHandle(mapping);
+    }
+  }
+  CloseHandle(file);
+}
+
+MappedFile::~MappedFile() {
+  if (data_) {
+    UnmapViewOfFile(data_);
+  }
+}
+#else
+MappedFile::MappedFile(const std::string& path) : data_(nullptr), size_(0) {
+  int file = open(path.c_str(), O_RDONLY);
+  if (file < 0) {
+    return;
+  }
+
+  struct stat file_status;
+  if (fstat(file, &file_status) == 0 && file_status.st_size > 0) {
+    size_t size = static_cast<size_t>(file_status.st_size);
+    // The mapping stays valid after the file is closed
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                         file, 0);
+    if (mapping != MAP_FAILED) {
+      data_ = static_cast<char*>(mapping);
+      size_ = size;
+    }
+  }
+  close(file);
+}
+
+MappedFile::~MappedFile() {
+  if (data_) {
+    munmap(data_, size_);
+  }
+}
+#endif
+
+bool MappedFile::IsOpen() const {
+  return data_ != nullptr;
+}
+
+char* MappedFile::GetData() const {
+  return data_;
+}
+
+size_t MappedFile::GetSize() const {
+  return size_;
+}
+
+void MappedFile::Prefault() const {
+#ifndef _WIN32
+  if (data_) {
+    madvise(data_, size_, MADV_WILLNEED);
+  }
+#endif
+  volatile char sink = 0;
+  for (size_t offset = 0; offset < size_; offset += kPageSize) {
+    sink = sink + data_[offset];
+  }
+}
+
+}  // namespace audio
+
+}  // namespace synther
@@ -0,0 +1,250 @@
+#include "core/midi_file_parser.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+
+namespace synther {
+
+namespace audio {
+
+namespace {
+
+// Microseconds per quarter note until a Set Tempo event, which is 120 bpm
+const uint32_t kDefaultTempo = 500000;
+const double kMicrosecondsPerSecond = 1e6;
+// MIDI note numbers start 12 semitones below C0
+const int kMidiNoteOffset = 12;
+const int kSustainController = 64;
+// Controller values from this one upwards press the pedal
+const int kSustainThreshold = 64;
+const size_t kHeaderLength = 6;
+
+/**
+ * A note, sustain or tempo message at a tick of its track
+ */
+struct MidiEvent {
+  uint64_t tick_;
+  bool is_tempo_;
+  // Microseconds per quarter note, for tempo events
+  uint32_t tempo_;
+  NoteEvent event_;
+};
+
+/**
+ * Reads big-endian fields from part of a MIDI file, throwing if they run past
+ *   its end
+ */
+class ByteReader {
+ public:
+  ByteReader(const std::string& bytes, size_t begin, size_t end)
+      : bytes_(bytes), position_(begin), end_(end) {
+  }
+
+  bool IsAtEnd() const {
+    return position_ >= end_;
+  }
+
+  size_t GetPosition() const {
+    return position_;
+  }
+
+  void Skip(size_t count) {
+    if (count > end_ - position_) {
+      throw std::invalid_argument("Truncated MIDI file");
+    }
+    position_ += count;
+  }
+
+  uint8_t ReadByte() {
+    Skip(1);
+    return static_cast<uint8_t>(bytes_[position_ - 1]);
+  }
+
+  uint32_t ReadWord(size_t size) {
+    uint32_t word = 0;
+    for (size_t index = 0; index < size; index++) {
+      word = (word << 8) | ReadByte();
+    }
+    return word;
+  }
+
+  // Delta times and lengths take 7 bits from each of up to 4 bytes, with the
+  // top bit set on every byte but the last
+  uint32_t ReadVariableLength() {
+    uint32_t value = 0;
+    for (int index = 0; index < 4; index++) {
+      uint8_t byte = ReadByte();
+      value = (value << 7) | (byte & 0x7F);
+      if ((byte & 0x80) == 0) {
+        return value;
+      }
+    }
+    throw std::invalid_argument("Variable-length quantity is too long");
+  }
+
+  std::string ReadChunkType() {
+    Skip(4);
+    return bytes_.substr(position_ - 4, 4);
+  }
+
+ private:
+  const std::string& bytes_;
+  size_t position_;
+  size_t end_;
+};
+
+/**
+ * Reads the note, sustain and tempo messages of a track chunk
+ * @param track a reader over the data of the chunk
+ * @param events the vector the messages are appended to
+ */
+void ReadTrack(ByteReader track, std::vector<MidiEvent>* events) {
+  uint64_t tick = 0;
+  // Channel messages may leave out their status byte if it repeats
+  uint8_t running_status = 0;
+  while (!track.IsAtEnd()) {
+    tick += track.ReadVariableLength();
+    uint8_t status = track.ReadByte();
+
+    // Meta and system exclusive events cancel the running status
+    if (status == 0xFF) {
+      uint8_t type = track.ReadByte();
+      uint32_t length = track.ReadVariableLength();
+      running_status = 0;
+      if (type == 0x2F) {
+        return;
+      }
+      if (type == 0x51 && length == 3) {
+        events->push_back({tick, true, track.ReadWord(3), NoteEvent()});
+      } else {
+        track.Skip(length);
+      }
+      continue;
+    }
+    if (status == 0xF0 || status == 0xF7) {
+      track.Skip(track.ReadVariableLength());
+      running_status = 0;
+      continue;
+    }
+
+    uint8_t first_data;
+    if (status < 0x80) {
+      if (running_status == 0) {
+        throw std::invalid_argument("Data byte without a status byte");
+      }
+      first_data = status;
+      status = running_status;
+    } else if (status < 0xF0) {
+      running_status = status;
+      first_data = track.ReadByte();
+    } else {
+      throw std::invalid_argument("Unexpected system message in track");
+    }
+
+    // Program Change and Channel Pressure carry a single data byte
+    uint8_t type = status & 0xF0;
+    uint8_t second_data = 0;
+    if (type != 0xC0 && type != 0xD0) {
+      second_data = track.ReadByte();
+    }
+
+    int semitone = (first_data & 0x7F) - kMidiNoteOffset;
+    if ((type == 0x80 || type == 0x90) && semitone >= 0) {
+      NoteEvent event = type == 0x90 && second_data > 0
+                            ? NoteEvent::NoteOn(semitone)
+                            : NoteEvent::NoteOff(semitone);
+      events->push_back({tick, false, 0, event});
+    } else if (type == 0xB0 && first_data == kSustainController) {
+      NoteEvent event = second_data >= kSustainThreshold
+                            ? NoteEvent::SustainOn()
+                            : NoteEvent::SustainOff();
+      events->push_back({tick, false, 0, event});
+    }
+  }
+}
+
+}  // namespace
+
+MidiFileParser::MidiFileParser(std::istream& midi)
+    : bytes_(std::istreambuf_iterator<char>(midi),
+             std::istreambuf_iterator<char>()) {
+}
+
+std::vector<TimedNoteEvent> MidiFileParser::GetEvents() const {
+  ByteReader file(bytes_, 0, bytes_.size());
+  if (file.ReadChunkType() != "MThd") {
+    throw std::invalid_argument("Not a Standard MIDI File");
+  }
+  uint32_t header_length = file.ReadWord(4);
+  if (header_length < kHeaderLength) {
+    throw std::invalid_argument("MIDI header is too short");
+  }
+  uint32_t format = file.ReadWord(2);
+  if (format > 2) {
+    throw std::invalid_argument("Unknown MIDI file format");
+  }
+  // Every track chunk is read, whatever the header counts
+  file.ReadWord(2);
+  uint32_t division = file.ReadWord(2);
+  file.Skip(header_length - kHeaderLength);
+
+  // Chunks of other types may be added by later versions of the format, and
+  // are skipped
+  std::vector<MidiEvent> midi_events;
+  while (!file.IsAtEnd()) {
+    std::string type = file.ReadChunkType();
+    uint32_t length = file.ReadWord(4);
+    size_t begin = file.GetPosition();
+    file.Skip(length);
+    if (type == "MTrk") {
+      ReadTrack(ByteReader(bytes_, begin, begin + length), &midi_events);
+    }
+  }
+
+  // A tempo change in any track applies to every track from its tick on, so
+  // the tracks are merged before ticks are converted to seconds
+  std::stable_sort(midi_events.begin(), midi_events.end(),
+                   [](const MidiEvent& lhs, const MidiEvent& rhs) {
+                     return lhs.tick_ < rhs.tick_;
+                   });
+
+  // Ticks are either a fraction of a quarter note, whose length is set by
+  // the tempo, or a fraction of a SMPTE frame, which ignores the tempo
+  bool is_smpte = (division & 0x8000) != 0;
+  if ((division & (is_smpte ? 0xFF : 0x7FFF)) == 0) {
+    throw std::invalid_argument("MIDI division is zero");
+  }
+  double ticks_per_quarter = division & 0x7FFF;
+  double seconds_per_tick = kDefaultTempo / kMicrosecondsPerSecond /
+                            ticks_per_quarter;
+  if (is_smpte) {
+    int frames_per_second = -static_cast<int8_t>(division >> 8);
+    double frame_rate = frames_per_second == 29 ? 29.97 : frames_per_second;
+    seconds_per_tick = 1.0 / (frame_rate * (division & 0xFF));
+  }
+
+  // Time is measured from the last tempo change, so rounding errors don't
+  // build up over long files
+  std::vector<TimedNoteEvent> events;
+  double tempo_time = 0;
+  uint64_t tempo_tick = 0;
+  for (const MidiEvent& midi_event : midi_events) {
+    double time =
+        tempo_time + (midi_event.tick_ - tempo_tick) * seconds_per_tick;
+    if (!midi_event.is_tempo_) {
+      events.push_back({time, midi_event.event_});
+    } else if (!is_smpte) {
+      tempo_time = time;
+      tempo_tick = midi_event.tick_;
+      seconds_per_tick = midi_event.tempo_ / kMicrosecondsPerSecond /
+                         ticks_per_quarter;
+    }
+  }
+  return events;
+}
+
+}  // namespace audio
+
+}  // namespace synther
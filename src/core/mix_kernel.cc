@@ -0,0 +1,456 @@
+#include "core/mix_kernel.h"
+
+#include <algorithm>
+
+#if defined(SYNTHER_MIX_AVX2)
+#include <immintrin.h>
+#elif defined(SYNTHER_MIX_SSE2)
+#include <emmintrin.h>
+#endif
+#if defined(SYNTHER_MIX_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace synther {
+
+namespace audio {
+
+namespace {
+
+/**
+ * Mixes frames [first_frame, last_frame) one at a time. Used by the reference
+ *   kernel, and by the vectorized kernels for frames left over after the last
+ *   full vector
+ */
+void MixFrameRange(const MixSource* sources, size_t source_count,
+                   float* output, size_t first_frame, size_t last_frame) {
+  for (size_t frame = first_frame; frame < last_frame; frame++) {
+    float mix = output[frame];
+    float frame_index = static_cast<float>(frame);
+    for (size_t index = 0; index < source_count; index++) {
+      const MixSource& source = sources[index];
+      float gain = source.gain_ + source.gain_step_ * frame_index;
+      gain = std::min(std::max(gain, 0.0f), 1.0f);
+      float sample = source.pcm_samples_
+                         ? source.pcm_samples_[frame] * kPcmScale
+                         : source.samples_[frame];
+      mix += sample * gain;
+    }
+    output[frame] = mix;
+  }
+}
+
+#ifdef SYNTHER_MIX_SSE2
+/**
+ * Loads four samples of a source from a frame onwards as floats
+ */
+inline __m128 LoadSamplesSse2(const MixSource& source, size_t frame) {
+  if (!source.pcm_samples_) {
+    return _mm_loadu_ps(source.samples_ + frame);
+  }
+  // Pairing every sample with itself and shifting the pair right by 16 bits
+  // sign-extends the sample to 32 bits
+  __m128i pcm = _mm_loadl_epi64(
+      reinterpret_cast<const __m128i*>(source.pcm_samples_ + frame));
+  __m128i wide = _mm_srai_epi32(_mm_unpacklo_epi16(pcm, pcm), 16);
+  return _mm_mul_ps(_mm_cvtepi32_ps(wide), _mm_set1_ps(kPcmScale));
+}
+#endif
+
+#ifdef SYNTHER_MIX_AVX2
+/**
+ * Loads eight samples of a source from a frame onwards as floats
+ */
+inline __m256 LoadSamplesAvx2(const MixSource& source, size_t frame) {
+  if (!source.pcm_samples_) {
+    return _mm256_loadu_ps(source.samples_ + frame);
+  }
+  __m128i pcm = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(source.pcm_samples_ + frame));
+  return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(pcm)),
+                       _mm256_set1_ps(kPcmScale));
+}
+#endif
+
+#ifdef SYNTHER_MIX_NEON
+/**
+ * Loads four samples of a source from a frame onwards as floats
+ */
+inline float32x4_t LoadSamplesNeon(const MixSource& source, size_t frame) {
+  if (!source.pcm_samples_) {
+    return vld1q_f32(source.samples_ + frame);
+  }
+  int32x4_t wide = vmovl_s16(vld1_s16(source.pcm_samples_ + frame));
+  return vmulq_n_f32(vcvtq_f32_s32(wide), kPcmScale);
+}
+#endif
+
+}  // namespace
+
+void MixVoicesScalar(const MixSource* sources, size_t source_count,
+                     float* output, size_t num_frames) {
+  MixFrameRange(sources, source_count, output, 0, num_frames);
+}
+
+#ifdef SYNTHER_MIX_SSE2
+void MixVoicesSse2(const MixSource* sources, size_t source_count,
+                   float* output, size_t num_frames) {
+  const size_t kWidth = 4;
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 lane_offsets = _mm_set_ps(3, 2, 1, 0);
+
+  // Mix two vectors per pass so every source's gain is loaded once for both
+  size_t frame = 0;
+  for (; frame + 2 * kWidth <= num_frames; frame += 2 * kWidth) {
+    __m128 index_a =
+        _mm_add_ps(_mm_set1_ps(static_cast<float>(frame)), lane_offsets);
+    __m128 index_b = _mm_add_ps(
+        _mm_set1_ps(static_cast<float>(frame + kWidth)), lane_offsets);
+    __m128 mix_a = _mm_loadu_ps(output + frame);
+    __m128 mix_b = _mm_loadu_ps(output + frame + kWidth);
+
+    for (size_t index = 0; index < source_count; index++) {
+      const MixSource& source = sources[index];
+      __m128 gain = _mm_set1_ps(source.gain_);
+      __m128 step = _mm_set1_ps(source.gain_step_);
+
+      __m128 gain_a = _mm_add_ps(gain, _mm_mul_ps(step, index_a));
+      __m128 gain_b = _mm_add_ps(gain, _mm_mul_ps(step, index_b));
+      gain_a = _mm_min_ps(_mm_max_ps(gain_a, zero), one);
+      gain_b = _mm_min_ps(_mm_max_ps(gain_b, zero), one);
+
+      __m128 samples_a = LoadSamplesSse2(source, frame);
+      __m128 samples_b = LoadSamplesSse2(source, frame + kWidth);
+      mix_a = _mm_add_ps(mix_a, _mm_mul_ps(samples_a, gain_a));
+      mix_b = _mm_add_ps(mix_b, _mm_mul_ps(samples_b, gain_b));
+    }
+
+    _mm_storeu_ps(output + frame, mix_a);
+    _mm_storeu_ps(output + frame + kWidth, mix_b);
+  }
+
+  MixFrameRange(sources, source_count, output, frame, num_frames);
+}
+#endif
+
+#ifdef SYNTHER_MIX_AVX2
+void MixVoicesAvx2(const MixSource* sources, size_t source_count,
+                   float* output, size_t num_frames) {
+  const size_t kWidth = 8;
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 lane_offsets = _mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0);
+
+  // Mix two vectors per pass so every source's gain is loaded once for both
+  size_t frame = 0;
+  for (; frame + 2 * kWidth <= num_frames; frame += 2 * kWidth) {
+    __m256 index_a =
+        _mm256_add_ps(_mm256_set1_ps(static_cast<float>(frame)), lane_offsets);
+    __m256 index_b = _mm256_add_ps(
+        _mm256_set1_ps(static_cast<float>(frame + kWidth)), lane_offsets);
+    __m256 mix_a = _mm256_loadu_ps(output + frame);
+    __m256 mix_b = _mm256_loadu_ps(output + frame + kWidth);
+
+    for (size_t index = 0; index < source_count; index++) {
+      const MixSource& source = sources[index];
+      __m256 gain = _mm256_set1_ps(source.gain_);
+      __m256 step = _mm256_set1_ps(source.gain_step_);
+
+      __m256 gain_a = _mm256_add_ps(gain, _mm256_mul_ps(step, index_a));
+      __m256 gain_b = _mm256_add_ps(gain, _mm256_mul_ps(step, index_b));
+      gain_a = _mm256_min_ps(_mm256_max_ps(gain_a, zero), one);
+      gain_b = _mm256_min_ps(_mm256_max_ps(gain_b, zero), one);
+
+      __m256 samples_a = LoadSamplesAvx2(source, frame);
+      __m256 samples_b = LoadSamplesAvx2(source, frame + kWidth);
+      mix_a = _mm256_add_ps(mix_a, _mm256_mul_ps(samples_a, gain_a));
+      mix_b = _mm256_add_ps(mix_b, _mm256_mul_ps(samples_b, gain_b));
+    }
+
+    _mm256_storeu_ps(output + frame, mix_a);
+    _mm256_storeu_ps(output + frame + kWidth, mix_b);
+  }
+
+  MixFrameRange(sources, source_count, output, frame, num_frames);
+}
+#endif
+
+#ifdef SYNTHER_MIX_NEON
+void MixVoicesNeon(const MixSource* sources, size_t source_count,
+                   float* output, size_t num_frames) {
+  const size_t kWidth = 4;
+  const float32x4_t zero = vdupq_n_f32(0.0f);
+  const float32x4_t one = vdupq_n_f32(1.0f);
+  const float kLaneOffsets[] = {0, 1, 2, 3};
+  const float32x4_t lane_offsets = vld1q_f32(kLaneOffsets);
+
+  size_t frame = 0;
+  for (; frame + kWidth <= num_frames; frame += kWidth) {
+    float32x4_t frame_index =
+        vaddq_f32(vdupq_n_f32(static_cast<float>(frame)), lane_offsets);
+    float32x4_t mix = vld1q_f32(output + frame);
+
+    for (size_t index = 0; index < source_count; index++) {
+      const MixSource& source = sources[index];
+      float32x4_t gain = vaddq_f32(
+          vdupq_n_f32(source.gain_),
+          vmulq_f32(vdupq_n_f32(source.gain_step_), frame_index));
+      gain = vminq_f32(vmaxq_f32(gain, zero), one);
+      float32x4_t samples = LoadSamplesNeon(source, frame);
+      mix = vaddq_f32(mix, vmulq_f32(samples, gain));
+    }
+
+    vst1q_f32(output + frame, mix);
+  }
+
+  MixFrameRange(sources, source_count, output, frame, num_frames);
+}
+#endif
+
+void MixVoices(const MixSource* sources, size_t source_count, float* output,
+               size_t num_frames) {
+#if defined(SYNTHER_MIX_AVX2)
+  MixVoicesAvx2(sources, source_count, output, num_frames);
+#elif defined(SYNTHER_MIX_SSE2)
+  MixVoicesSse2(sources, source_count, output, num_frames);
+#elif defined(SYNTHER_MIX_NEON)
+  MixVoicesNeon(sources, source_count, output, num_frames);
+#else
+  MixVoicesScalar(sources, source_count, output, num_frames);
+#endif
+}
+
+float DotProductScalar(const float* first, const float* second,
+                       size_t count) {
+  float sum = 0;
+  for (size_t index = 0; index < count; index++) {
+    sum += first[index] * second[index];
+  }
+  return sum;
+}
+
+#ifdef SYNTHER_MIX_SSE2
+float DotProductSse2(const float* first, const float* second, size_t count) {
+  const size_t kWidth = 4;
+
+  // Two independent sums hide the latency of the additions
+  __m128 sum_a = _mm_setzero_ps();
+  __m128 sum_b = _mm_setzero_ps();
+  size_t index = 0;
+  for (; index + 2 * kWidth <= count; index += 2 * kWidth) {
+    sum_a = _mm_add_ps(sum_a, _mm_mul_ps(_mm_loadu_ps(first + index),
+                                         _mm_loadu_ps(second + index)));
+    sum_b = _mm_add_ps(
+        sum_b, _mm_mul_ps(_mm_loadu_ps(first + index + kWidth),
+                          _mm_loadu_ps(second + index + kWidth)));
+  }
+
+  float lanes[kWidth];
+  _mm_storeu_ps(lanes, _mm_add_ps(sum_a, sum_b));
+  float sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+  return sum + DotProductScalar(first + index, second + index, count - index);
+}
+#endif
+
+#ifdef SYNTHER_MIX_AVX2
+float DotProductAvx2(const float* first, const float* second, size_t count) {
+  const size_t kWidth = 8;
+
+  // Two independent sums hide the latency of the additions
+  __m256 sum_a = _mm256_setzero_ps();
+  __m256 sum_b = _mm256_setzero_ps();
+  size_t index = 0;
+  for (; index + 2 * kWidth <= count; index += 2 * kWidth) {
+    sum_a = _mm256_add_ps(sum_a,
+                          _mm256_mul_ps(_mm256_loadu_ps(first + index),
+                                        _mm256_loadu_ps(second + index)));
+    sum_b = _mm256_add_ps(
+        sum_b, _mm256_mul_ps(_mm256_loadu_ps(first + index + kWidth),
+                             _mm256_loadu_ps(second + index + kWidth)));
+  }
+
+  float lanes[kWidth];
+  _mm256_storeu_ps(lanes, _mm256_add_ps(sum_a, sum_b));
+  float sum = ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) +
+              ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+  return sum + DotProductScalar(first + index, second + index, count - index);
+}
+#endif
+
+#ifdef SYNTHER_MIX_NEON
+float DotProductNeon(const float* first, const float* second, size_t count) {
+  const size_t kWidth = 4;
+
+  float32x4_t sum_vector = vdupq_n_f32(0.0f);
+  size_t index = 0;
+  for (; index + kWidth <= count; index += kWidth) {
+    sum_vector = vaddq_f32(sum_vector, vmulq_f32(vld1q_f32(first + index),
+                                                 vld1q_f32(second + index)));
+  }
+
+  float lanes[kWidth];
+  vst1q_f32(lanes, sum_vector);
+  float sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+  return sum + DotProductScalar(first + index, second + index, count - index);
+}
+#endif
+
+float DotProduct(const float* first, const float* second, size_t count) {
+#if defined(SYNTHER_MIX_AVX2)
+  return DotProductAvx2(first, second, count);
+#elif defined(SYNTHER_MIX_SSE2)
+  return DotProductSse2(first, second, count);
+#elif defined(SYNTHER_MIX_NEON)
+  return DotProductNeon(first, second, count);
+#else
+  return DotProductScalar(first, second, count);
+#endif
+}
+
+void ComplexMultiplyAccumulateScalar(const float* first_real,
+                                     const float* first_imag,
+                                     const float* second_real,
+                                     const float* second_imag,
+                                     float* output_real, float* output_imag,
+                                     size_t count) {
+  for (size_t index = 0; index < count; index++) {
+    output_real[index] += first_real[index] * second_real[index] -
+                          first_imag[index] * second_imag[index];
+    output_imag[index] += first_real[index] * second_imag[index] +
+                          first_imag[index] * second_real[index];
+  }
+}
+
+#ifdef SYNTHER_MIX_SSE2
+void ComplexMultiplyAccumulateSse2(const float* first_real,
+                                   const float* first_imag,
+                                   const float* second_real,
+                                   const float* second_imag,
+                                   float* output_real, float* output_imag,
+                                   size_t count) {
+  const size_t kWidth = 4;
+
+  size_t index = 0;
+  for (; index + kWidth <= count; index += kWidth) {
+    __m128 a_real = _mm_loadu_ps(first_real + index);
+    __m128 a_imag = _mm_loadu_ps(first_imag + index);
+    __m128 b_real = _mm_loadu_ps(second_real + index);
+    __m128 b_imag = _mm_loadu_ps(second_imag + index);
+    __m128 real = _mm_sub_ps(_mm_mul_ps(a_real, b_real),
+                             _mm_mul_ps(a_imag, b_imag));
+    __m128 imag = _mm_add_ps(_mm_mul_ps(a_real, b_imag),
+                             _mm_mul_ps(a_imag, b_real));
+    _mm_storeu_ps(output_real + index,
+                  _mm_add_ps(_mm_loadu_ps(output_real + index), real));
+    _mm_storeu_ps(output_imag + index,
+                  _mm_add_ps(_mm_loadu_ps(output_imag + index), imag));
+  }
+
+  ComplexMultiplyAccumulateScalar(first_real + index, first_imag + index,
+                                  second_real + index, second_imag + index,
+                                  output_real + index, output_imag + index,
+                                  count - index);
+}
+#endif
+
+#ifdef SYNTHER_MIX_AVX2
+void ComplexMultiplyAccumulateAvx2(const float* first_real,
+                                   const float* first_imag,
+                                   const float* second_real,
+                                   const float* second_imag,
+                                   float* output_real, float* output_imag,
+                                   size_t count) {
+  const size_t kWidth = 8;
+
+  size_t index = 0;
+  for (; index + kWidth <= count; index += kWidth) {
+    __m256 a_real = _mm256_loadu_ps(first_real + index);
+    __m256 a_imag = _mm256_loadu_ps(first_imag + index);
+    __m256 b_real = _mm256_loadu_ps(second_real + index);
+    __m256 b_imag = _mm256_loadu_ps(second_imag + index);
+    __m256 real = _mm256_sub_ps(_mm256_mul_ps(a_real, b_real),
+                                _mm256_mul_ps(a_imag, b_imag));
+    __m256 imag = _mm256_add_ps(_mm256_mul_ps(a_real, b_imag),
+                                _mm256_mul_ps(a_imag, b_real));
+    _mm256_storeu_ps(output_real + index,
+                     _mm256_add_ps(_mm256_loadu_ps(output_real + index),
+                                   real));
+    _mm256_storeu_ps(output_imag + index,
+                     _mm256_add_ps(_mm256_loadu_ps(output_imag + index),
+                                   imag));
+  }
+
+  ComplexMultiplyAccumulateScalar(first_real + index, first_imag + index,
+                                  second_real + index, second_imag + index,
+                                  output_real + index, output_imag + index,
+                                  count - index);
+}
+#endif
+
+#ifdef SYNTHER_MIX_NEON
+void ComplexMultiplyAccumulateNeon(const float* first_real,
+                                   const float* first_imag,
+                                   const float* second_real,
+                                   const float* second_imag,
+                                   float* output_real, float* output_imag,
+                                   size_t count) {
+  const size_t kWidth = 4;
+
+  size_t index = 0;
+  for (; index + kWidth <= count; index += kWidth) {
+    float32x4_t a_real = vld1q_f32(first_real + index);
+    float32x4_t a_imag = vld1q_f32(first_imag + index);
+    float32x4_t b_real = vld1q_f32(second_real + index);
+    float32x4_t b_imag = vld1q_f32(second_imag + index);
+    float32x4_t real = vld1q_f32(output_real + index);
+    float32x4_t imag = vld1q_f32(output_imag + index);
+    real = vmlsq_f32(vmlaq_f32(real, a_real, b_real), a_imag, b_imag);
+    imag = vmlaq_f32(vmlaq_f32(imag, a_real, b_imag), a_imag, b_real);
+    vst1q_f32(output_real + index, real);
+    vst1q_f32(output_imag + index, imag);
+  }
+
+  ComplexMultiplyAccumulateScalar(first_real + index, first_imag + index,
+                                  second_real + index, second_imag + index,
+                                  output_real + index, output_imag + index,
+                                  count - index);
+}
+#endif
+
+void ComplexMultiplyAccumulate(const float* first_real,
+                               const float* first_imag,
+                               const float* second_real,
+                               const float* second_imag, float* output_real,
+                               float* output_imag, size_t count) {
+#if defined(SYNTHER_MIX_AVX2)
+  ComplexMultiplyAccumulateAvx2(first_real, first_imag, second_real,
+                                second_imag, output_real, output_imag, count);
+#elif defined(SYNTHER_MIX_SSE2)
+  ComplexMultiplyAccumulateSse2(first_real, first_imag, second_real,
+                                second_imag, output_real, output_imag, count);
+#elif defined(SYNTHER_MIX_NEON)
+  ComplexMultiplyAccumulateNeon(first_real, first_imag, second_real,
+                                second_imag, output_real, output_imag, count);
+#else
+  ComplexMultiplyAccumulateScalar(first_real, first_imag, second_real,
+                                  second_imag, output_real, output_imag,
+                                  count);
+#endif
+}
+
+const char* GetMixKernelName() {
+#if defined(SYNTHER_MIX_AVX2)
+  return "AVX2";
+#elif defined(SYNTHER_MIX_SSE2)
+  return "SSE2";
+#elif defined(SYNTHER_MIX_NEON)
+  return "NEON";
+#else
+  return "Scalar";
+#endif
+}
+
+}  // namespace audio
+
+}  // namespace synther
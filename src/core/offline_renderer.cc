@@ -0,0 +1,96 @@
+#include "core/offline_renderer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "core/wav_writer.h"
+
+namespace synther {
+
+namespace audio {
+
+constexpr size_t OfflineRenderer::kBlockFrames;
+
+double OfflineRenderStats::GetRealtimeFactor() const {
+  if (wall_seconds_ <= 0) {
+    return 0;
+  }
+  return rendered_seconds_ / wall_seconds_;
+}
+
+OfflineRenderer::OfflineRenderer(size_t sample_rate, size_t num_channels,
+                                 double resonate_duration, size_t polyphony)
+    : sampler_(resonate_duration, polyphony),
+      sample_rate_(sample_rate),
+      num_channels_(num_channels),
+      block_(num_channels * kBlockFrames) {
+  sampler_.SetSampleRate(static_cast<double>(sample_rate));
+}
+
+void OfflineRenderer::SetSamples(
+    const std::map<int, SampleBufferRef>& samples) {
+  sampler_.SetSamples(samples);
+}
+
+OfflineRenderStats OfflineRenderer::Render(
+    const std::vector<TimedNoteEvent>& events, double max_tail_duration) {
+  output_.clear();
+  auto start = std::chrono::steady_clock::now();
+
+  // The sampler applies every event on its exact frame, the same way it
+  // plays performances live, so the performance is rendered in whole blocks
+  // up to the frame of its last event
+  sampler_.PlaySequence(events);
+  size_t last_frame = 0;
+  for (const TimedNoteEvent& timed_event : events) {
+    double event_time = std::max(timed_event.time_, 0.0);
+    last_frame = std::max(last_frame, static_cast<size_t>(std::llround(
+                                          event_time * sample_rate_)));
+  }
+  RenderFrames(last_frame);
+
+  // Let the last notes ring out. The first block is always rendered so that
+  // events posted at the very end are applied before checking for silence
+  size_t max_tail_frames =
+      static_cast<size_t>(std::llround(max_tail_duration * sample_rate_));
+  size_t tail_frames = 0;
+  while (tail_frames < max_tail_frames &&
+         (tail_frames == 0 || sampler_.GetActiveVoiceCount() > 0)) {
+    size_t block_frames = std::min(kBlockFrames, max_tail_frames - tail_frames);
+    RenderFrames(block_frames);
+    tail_frames += block_frames;
+  }
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  double rendered_seconds =
+      static_cast<double>(output_.size() / num_channels_) / sample_rate_;
+  return {rendered_seconds, elapsed.count()};
+}
+
+const std::vector<float>& OfflineRenderer::GetOutput() const {
+  return output_;
+}
+
+void OfflineRenderer::WriteWav(std::ostream& out) const {
+  audio::WriteWav(out, output_, num_channels_, sample_rate_);
+}
+
+void OfflineRenderer::RenderFrames(size_t num_frames) {
+  for (size_t offset = 0; offset < num_frames; offset += kBlockFrames) {
+    size_t block_frames = std::min(kBlockFrames, num_frames - offset);
+    sampler_.Render(block_.data(), num_channels_, block_frames);
+
+    // Interleave the block onto the end of the output
+    for (size_t frame = 0; frame < block_frames; frame++) {
+      for (size_t channel = 0; channel < num_channels_; channel++) {
+        output_.push_back(block_[channel * block_frames + frame]);
+      }
+    }
+  }
+}
+
+}  // namespace audio
+
+}  // namespace synther
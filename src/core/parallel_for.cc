@@ -0,0 +1,44 @@
+#include "core/parallel_for.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace synther {
+
+namespace audio {
+
+size_t GetHardwareThreadCount() {
+  // hardware_concurrency() returns 0 when the count is unknown
+  return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+}
+
+void ParallelFor(size_t count, size_t num_threads,
+                 const std::function<void(size_t)>& task) {
+  if (num_threads == 0) {
+    num_threads = GetHardwareThreadCount();
+  }
+  num_threads = std::min(num_threads, count);
+
+  std::atomic<size_t> next_index(0);
+  auto work = [&]() {
+    for (size_t index = next_index++; index < count; index = next_index++) {
+      task(index);
+    }
+  };
+
+  // The calling thread works alongside the helpers instead of idling
+  std::vector<std::thread> helpers;
+  for (size_t thread = 1; thread < num_threads; thread++) {
+    helpers.emplace_back(work);
+  }
+  work();
+  for (std::thread& helper : helpers) {
+    helper.join();
+  }
+}
+
+}  // namespace audio
+
+}  // namespace synther
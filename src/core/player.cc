@@ -4,134 +4,754 @@
 
 #include "core/player.h"
 
+#include <algorithm>
+
 #include "cinder/app/App.h"
+#include "core/zone_map.h"
 
 namespace synther {
 
 namespace audio {
 
-Player::Player(double resonate_duration)
-    : resonate_duration_(resonate_duration) {
+constexpr size_t Player::kDefaultNeighborOctaves;
+constexpr double Player::kCrossfadeDuration;
+constexpr size_t Player::kMinFramesPerBlock;
+constexpr size_t Player::kMaxFramesPerBlock;
+constexpr int Player::kSemitonesPerOctave;
+constexpr size_t Player::kReverbChannels;
+
+Player::Player(double resonate_duration, size_t polyphony,
+               StealPolicy steal_policy)
+    : resonate_duration_(resonate_duration),
+      polyphony_(polyphony),
+      steal_policy_(steal_policy),
+      attack_duration_(0),
+      render_thread_count_(1),
+      is_sustain_down_(false),
+      layers_(Sampler::kMaxLayers,
+              Layer{InstrumentRef(), std::map<int, SampleBufferRef>(), 0,
+                    static_cast<int>(Sampler::kSemitoneCount) - 1, 1.0f,
+                    false}),
+      stream_head_duration_(0),
+      sample_stride_(1),
+      storage_format_(SampleFormat::Float32),
+      is_downmixed_(false),
+      lazy_loading_(false),
+      neighbor_octaves_(kDefaultNeighborOctaves),
+      is_prefetching_(false),
+      is_swap_pending_(false),
+      view_lowest_semitone_(0),
+      view_highest_semitone_(-1),
+      resident_lowest_semitone_(0),
+      resident_highest_semitone_(-1),
+      sequence_lowest_semitone_(0),
+      sequence_highest_semitone_(-1),
+      is_sequence_starting_(false) {
 }
 
-void Player::SetUpVoices(const std::map<music::Note, std::string>& note_files,
-                         const std::string& instrument_directory) {
-  std::map<int, NoteVoice> voices;
+void Player::SetLazyLoading(bool lazy_loading, size_t neighbor_octaves) {
+  lazy_loading_ = lazy_loading;
+  neighbor_octaves_ = neighbor_octaves;
+}
+
+void Player::SetStreaming(double head_duration) {
+  stream_head_duration_ = head_duration;
+}
+
+void Player::SetSampleStride(size_t sample_stride) {
+  sample_stride_ = std::max<size_t>(sample_stride, 1);
+}
+
+void Player::SetStorage(SampleFormat format, bool is_downmixed) {
+  storage_format_ = format;
+  is_downmixed_ = is_downmixed;
+}
+
+bool Player::SetOutputDevice(const std::string& device_name,
+                             size_t frames_per_block) {
+  ci::audio::DeviceRef device =
+      device_name.empty() ? ci::audio::Device::getDefaultOutput()
+                          : ci::audio::Device::findOutputByName(device_name);
+  if (!device) {
+    return false;
+  }
+  frames_per_block = std::min(std::max(frames_per_block, kMinFramesPerBlock),
+                              kMaxFramesPerBlock);
+
+  // The graph is stopped while the device is reconfigured, so the audio
+  // thread never renders into a node that is being moved
   auto ctx = ci::audio::Context::master();
+  bool was_enabled = ctx->isEnabled();
+  ctx->disable();
 
-  for (const auto& note_file : note_files) {
-    // Load file
-    std::string filename = note_file.second;
-    std::string sourcefile_path = instrument_directory + filename;
-    ci::audio::SourceFileRef source_file;
-    try {
-      source_file = ci::audio::load(ci::app::loadAsset(sourcefile_path));
-    } catch (const std::exception& e) {
-      // Skip the unloadable sound file
-      continue;
+  size_t sample_rate = ctx->getSampleRate();
+  device->updateFormat(ci::audio::Device::Format()
+                           .sampleRate(sample_rate)
+                           .framesPerBlock(frames_per_block));
+
+  // The instrument, its layers and the reverb impulse were resampled to the
+  // current rate, and would play at the wrong pitch on a device that can't
+  // run at it
+  if (device->getSampleRate() != sample_rate) {
+    if (was_enabled) {
+      ctx->enable();
+    }
+    return false;
+  }
+
+  auto output = std::dynamic_pointer_cast<ci::audio::OutputDeviceNode>(
+      ctx->getOutput());
+  if (!output || output->getDevice() != device) {
+    if (sampler_) {
+      sampler_->disconnectAllOutputs();
+    }
+    ctx->setOutput(ctx->createOutputDeviceNode(device));
+    if (sampler_) {
+      sampler_ >> ctx->getOutput();
     }
+  }
+
+  if (was_enabled) {
+    ctx->enable();
+  }
+  return true;
+}
+
+std::string Player::GetOutputDeviceName() const {
+  auto output = std::dynamic_pointer_cast<ci::audio::OutputDeviceNode>(
+      ci::audio::Context::master()->getOutput());
+  return output ? output->getDevice()->getName() : "";
+}
 
-    // Create buffer player from file
-    ci::audio::BufferPlayerNodeRef buffer_player =
-        ctx->makeNode(new ci::audio::BufferPlayerNode());
-    buffer_player->loadBuffer(source_file);
+size_t Player::GetFramesPerBlock() const {
+  return ci::audio::Context::master()->getFramesPerBlock();
+}
+
+double Player::GetBlockLatency() const {
+  auto ctx = ci::audio::Context::master();
+  return static_cast<double>(ctx->getFramesPerBlock()) / ctx->getSampleRate();
+}
+
+std::vector<std::string> Player::GetOutputDeviceNames() {
+  std::vector<std::string> names;
+  for (const ci::audio::DeviceRef& device :
+       ci::audio::Device::getOutputDevices()) {
+    names.push_back(device->getName());
+  }
+  return names;
+}
+
+bool Player::SetReverb(const std::string& impulse_file, float wet_gain) {
+  // Impulses are held whole in memory and never cached, since they are
+  // loaded once and convolved from their spectra
+  auto ctx = ci::audio::Context::master();
+  SampleLoader loader(static_cast<size_t>(ctx->getSampleRate()));
+  SampleBufferRef impulse =
+      loader.LoadSampleFile(ci::app::getAssetPath(impulse_file));
+  if (!impulse) {
+    return false;
+  }
+
+  reverb_ = std::make_shared<ConvolutionReverb>(
+      *impulse, kReverbChannels, ctx->getSampleRate(), wet_gain);
+  if (sampler_) {
+    sampler_->SetReverb(reverb_);
+  }
+  return true;
+}
 
-    // Create a gain node for volume control (init at max volume)
-    ci::audio::GainNodeRef gain = ctx->makeNode(new ci::audio::GainNode(1));
+void Player::RemoveReverb() {
+  reverb_ = nullptr;
+  if (sampler_) {
+    sampler_->SetReverb(nullptr);
+  }
+}
 
-    // Connect player components to audio graph
-    buffer_player >> gain >> ctx->getOutput();
+bool Player::HasReverb() const {
+  return reverb_ != nullptr;
+}
 
-    // Map the player components to a note semitone
-    music::Note note = note_file.first;
-    int semitone = note.GetSemitoneIndex();
+InstrumentRef Player::LoadInstrument(
+    const std::string& name,
+    const std::map<music::Note, std::string>& note_files,
+    const std::string& instrument_directory) const {
+  auto instrument = std::make_shared<Instrument>();
+  instrument->name_ = name;
+  instrument->load_duration_ = 0;
 
-    NoteVoice components{gain, buffer_player, false};
-    voices[semitone] = components;
+  // Find every sound file in the assets directory. Files that can't be found
+  // are not playable. With a sample stride, files closer than the stride to
+  // the last file kept are skipped, and their notes are pitch-shifted
+  std::map<music::Note, ci::fs::path> note_paths;
+  int last_semitone = 0;
+  for (const auto& note_file : note_files) {
+    std::string sourcefile_path = instrument_directory + note_file.second;
+    ci::fs::path path = ci::app::getAssetPath(sourcefile_path);
+    instrument->notes_.push_back(note_file.first);
+    int semitone = note_file.first.GetSemitoneIndex();
+    bool is_skipped =
+        !note_paths.empty() &&
+        semitone - last_semitone < static_cast<int>(sample_stride_);
+    if (!path.empty() && ci::fs::exists(path) && !is_skipped) {
+      note_paths[note_file.first] = path;
+      instrument->note_paths_[semitone] = path.string();
+      last_semitone = semitone;
+    }
   }
+
+  // With lazy loading, notes are loaded one at a time once the instrument is
+  // set and the view is known
+  if (!lazy_loading_) {
+    // Decode every note in parallel. Files that can't be decoded are not
+    // playable
+    std::shared_ptr<SampleLoader> loader = MakeLoader();
+    instrument->samples_ = loader->LoadSamples(note_paths);
+    instrument->load_duration_ = loader->GetLastLoadDuration();
+    for (auto note_path = instrument->note_paths_.begin();
+         note_path != instrument->note_paths_.end();) {
+      if (instrument->samples_.count(note_path->first) == 0) {
+        note_path = instrument->note_paths_.erase(note_path);
+      } else {
+        ++note_path;
+      }
+    }
+  }
+  return instrument;
+}
+
+void Player::SetInstrument(const InstrumentRef& instrument) {
+  auto ctx = ci::audio::Context::master();
+  instrument_ = instrument;
+  resident_lowest_semitone_ = 0;
+  resident_highest_semitone_ = -1;
+
+  // Lazily loaded notes are loaded on the prefetcher's thread. Notes of the
+  // previous instrument that are still loading are discarded without
+  // waiting for them
+  is_prefetching_ = lazy_loading_;
+  if (is_prefetching_) {
+    std::shared_ptr<SampleLoader> loader = MakeLoader();
+    std::map<int, std::string> note_paths = instrument->note_paths_;
+    SamplePrefetcher::LoadFunction load_sample = [loader, note_paths](
+        int semitone) {
+      return loader->LoadSampleFile(note_paths.at(semitone));
+    };
+    if (prefetcher_) {
+      prefetcher_->Reset(load_sample);
+    } else {
+      prefetcher_.reset(new SamplePrefetcher(load_sample));
+    }
+  } else if (prefetcher_) {
+    prefetcher_->Reset([](int) { return SampleBufferRef(); });
+  }
+
+  // Create the sampler and connect it to the audio graph the first time an
+  // instrument is set. Later instruments reuse the same node, and are
+  // swapped in without locking out the audio thread, so the previous
+  // instrument fades out instead of being cut off. Lazily loaded notes are
+  // handed over in Update()
+  if (!sampler_) {
+    sampler_ = ctx->makeNode(new SamplerNode(resonate_duration_));
+    sampler_->SetPolyphony(polyphony_);
+    sampler_->SetStealPolicy(steal_policy_);
+    sampler_->SetAttackDuration(attack_duration_);
+    sampler_->SetRenderThreadCount(render_thread_count_);
+    if (is_sustain_down_) {
+      sampler_->PostEvent(NoteEvent::SustainOn());
+    }
+    sampler_->SetMaxPitchShift(Sampler::kMaxPitchShift);
+    sampler_->SetReverb(reverb_);
+    sampler_->SetSamples(instrument->samples_);
+    for (size_t layer = 0; layer < layers_.size(); layer++) {
+      sampler_->SetLayerRange(layer, layers_[layer].lowest_semitone_,
+                              layers_[layer].highest_semitone_);
+      sampler_->SetLayerGain(layer, layers_[layer].gain_);
+      if (layer > 0) {
+        sampler_->SetSamples(layers_[layer].samples_, layer);
+        layers_[layer].is_swap_pending_ = false;
+      }
+    }
+    sampler_ >> ctx->getOutput();
+    sampler_->enable();
+    is_swap_pending_ = false;
+  } else {
+    is_swap_pending_ = true;
+    Update();
+  }
+
   ctx->enable();
-  voices_ = voices;
 }
 
-void Player::PlayNote(const music::Note& note) {
-  int semitone = note.GetSemitoneIndex();
+const InstrumentRef& Player::GetInstrument() const {
+  return instrument_;
+}
 
-  if (voices_.find(semitone) != voices_.end()) {
-    NoteVoice& voice = voices_.at(semitone);
-    ci::audio::BufferPlayerNodeRef buffer_player = voice.buffer_player_;
+void Player::LoadRange(Instrument& instrument, int lowest_semitone,
+                       int highest_semitone) const {
+  for (const auto& sample_pair : LoadSampleFiles(
+           GetRangePaths(instrument, lowest_semitone, highest_semitone))) {
+    instrument.samples_[sample_pair.first] = sample_pair.second;
+  }
+}
 
-    // Set voice to start playing sound
-    if (!(voice.is_playing_)) {
-      voice.is_playing_ = true;
-      ci::audio::GainNodeRef gain = voice.gain_;
-      gain->getParam()->setValue(1); // Turn gain/volume up all the way
-      buffer_player->start();
+std::map<music::Note, ci::fs::path> Player::GetRangePaths(
+    const Instrument& instrument, int lowest_semitone,
+    int highest_semitone) const {
+  // Notes without a sample of their own load the sample they are shifted
+  // from, which may lie outside of the range
+  std::map<music::Note, ci::fs::path> note_paths;
+  for (int semitone = lowest_semitone; semitone <= highest_semitone;
+       semitone++) {
+    int sample_semitone = FindNearestSample(
+        semitone, Sampler::kMaxPitchShift, [&instrument](int candidate) {
+          return instrument.note_paths_.count(candidate) > 0;
+        });
+    if (sample_semitone >= 0 &&
+        instrument.samples_.count(sample_semitone) == 0) {
+      note_paths[music::Note(sample_semitone, music::Accidental::Sharp)] =
+          instrument.note_paths_.at(sample_semitone);
     }
   }
+  return note_paths;
 }
 
-void Player::StopNote(const music::Note& note) {
-  int semitone = note.GetSemitoneIndex();
+std::map<int, SampleBufferRef> Player::LoadSampleFiles(
+    const std::map<music::Note, ci::fs::path>& note_paths) const {
+  if (note_paths.empty()) {
+    return std::map<int, SampleBufferRef>();
+  }
+  return MakeLoader()->LoadSamples(note_paths);
+}
 
-  if (voices_.find(semitone) != voices_.end()) {
-    NoteVoice& voice = voices_.at(semitone);
-    ci::audio::BufferPlayerNodeRef buffer_player = voice.buffer_player_;
+bool Player::SetLayer(size_t layer, const InstrumentRef& instrument,
+                      int lowest_semitone, int highest_semitone, float gain) {
+  if (layer == 0 || layer >= layers_.size()) {
+    return false;
+  }
 
-    if (voice.is_playing_) {
-      voice.is_playing_ = false;
+  // The layer holds its own references to the instrument's samples, so
+  // notes the current instrument unloads as the view moves keep playing in
+  // the layer
+  LoadRange(*instrument, lowest_semitone, highest_semitone);
+  layers_[layer].instrument_ = instrument;
+  layers_[layer].samples_ = instrument->samples_;
+  SetLayerRange(layer, lowest_semitone, highest_semitone);
+  SetLayerGain(layer, gain);
 
-      ci::audio::GainNodeRef gain = voice.gain_;
-      auto param = gain->getParam();
+  // A refused swap is retried in Update(). Without a sampler, the samples
+  // are handed over when it is created
+  layers_[layer].is_swap_pending_ =
+      sampler_ && !sampler_->SwapSamples(layers_[layer].samples_,
+                                         kCrossfadeDuration, layer);
+  return true;
+}
 
-      // Only apply ramp if the node isn't already subject to another event
-      if (param->getNumEvents() == 0) {
-        // Fade the sound to 0 over a set duration
-        gain->getParam()->applyRamp(0, resonate_duration_);
-      }
+void Player::RemoveLayer(size_t layer) {
+  if (layer == 0 || layer >= layers_.size()) {
+    return;
+  }
+
+  layers_[layer].instrument_ = nullptr;
+  layers_[layer].samples_.clear();
+  layers_[layer].is_swap_pending_ =
+      sampler_ && !sampler_->SwapSamples(layers_[layer].samples_,
+                                         kCrossfadeDuration, layer);
+}
+
+InstrumentRef Player::GetLayerInstrument(size_t layer) const {
+  if (layer == 0) {
+    return instrument_;
+  }
+  return layer < layers_.size() ? layers_[layer].instrument_ : nullptr;
+}
+
+void Player::SetLayerRange(size_t layer, int lowest_semitone,
+                           int highest_semitone) {
+  if (layer >= layers_.size()) {
+    return;
+  }
 
-      // Tell buffer player to stop after the note completely fades away,
-      // preventing unnecessary computational load
-      auto ctx = ci::audio::Context::master();
-      buffer_player->stop(ctx->getNumProcessedSeconds() + resonate_duration_);
+  layers_[layer].lowest_semitone_ = lowest_semitone;
+  layers_[layer].highest_semitone_ = highest_semitone;
+  if (sampler_) {
+    sampler_->SetLayerRange(layer, lowest_semitone, highest_semitone);
+  }
+}
+
+void Player::SetLayerGain(size_t layer, float gain) {
+  if (layer >= layers_.size()) {
+    return;
+  }
+
+  layers_[layer].gain_ = gain;
+  if (sampler_) {
+    sampler_->SetLayerGain(layer, gain);
+  }
+}
+
+void Player::SetUpVoices(const std::map<music::Note, std::string>& note_files,
+                         const std::string& instrument_directory) {
+  SetInstrument(LoadInstrument("", note_files, instrument_directory));
+}
+
+void Player::SetView(int lowest_semitone, int highest_semitone) {
+  if (!is_prefetching_) {
+    return;
+  }
+
+  int direction = lowest_semitone - view_lowest_semitone_;
+  view_lowest_semitone_ = lowest_semitone;
+  view_highest_semitone_ = highest_semitone;
+  int reach = static_cast<int>(neighbor_octaves_) * kSemitonesPerOctave;
+  resident_lowest_semitone_ = lowest_semitone - reach;
+  resident_highest_semitone_ = highest_semitone + reach;
+
+  // Load the notes in view first, then the neighbors in the direction the
+  // view is moving, since those are the next to be shown. Notes without a
+  // sample load the sample they are shifted from
+  std::vector<int> requests;
+  auto request = [&](int semitone) {
+    int sample_semitone = FindSampleSemitone(semitone);
+    if (sample_semitone >= 0 &&
+        instrument_->samples_.count(sample_semitone) == 0 &&
+        std::find(requests.begin(), requests.end(), sample_semitone) ==
+            requests.end()) {
+      requests.push_back(sample_semitone);
     }
+  };
+  for (int semitone = lowest_semitone; semitone <= highest_semitone;
+       semitone++) {
+    request(semitone);
+  }
+  for (int distance = 1; distance <= reach; distance++) {
+    request(direction >= 0 ? highest_semitone + distance
+                           : lowest_semitone - distance);
   }
+  for (int distance = 1; distance <= reach; distance++) {
+    request(direction >= 0 ? lowest_semitone - distance
+                           : highest_semitone + distance);
+  }
+  prefetcher_->Request(requests);
 }
 
-void Player::SetResonateDuration(double resonate_duration) {
-  // If the new resonate duration is shorter than the current duration,
-  // update any enabled voices to fade away with the new, shorter duration
-  if (resonate_duration < resonate_duration_) {
-    for (const auto& voice_pair : voices_) {
-      NoteVoice voice = voice_pair.second;
-
-      // Only update params for voices that are "resonating", i.e. enabled but
-      // not playing
-      if (voice.buffer_player_->isEnabled() && !voice.is_playing_) {
-        ci::audio::GainNodeRef gain = voice.gain_;
-        auto gain_param = gain->getParam();
-        gain_param->reset();  // reset param to avoid overlapping events
-        gain_param->applyRamp(0, resonate_duration);
+void Player::Update() {
+  if (!sampler_) {
+    return;
+  }
+  sampler_->CollectRetiredSamples();
+
+  // Layers whose swap was refused are retried once the audio thread has
+  // caught up
+  for (size_t layer = 1; layer < layers_.size(); layer++) {
+    if (layers_[layer].is_swap_pending_) {
+      layers_[layer].is_swap_pending_ = !sampler_->SwapSamples(
+          layers_[layer].samples_, kCrossfadeDuration, layer);
+    }
+  }
+
+  // Hand finished notes to the audio thread in a single batch. Notes that
+  // left the range while loading are dropped. Notes of an instrument that
+  // is waiting to be swapped in are handed over with the swap
+  if (is_prefetching_) {
+    std::map<int, SampleBufferRef> samples;
+    for (const auto& sample_pair : prefetcher_->TakeLoaded()) {
+      int semitone = sample_pair.first;
+      if (!sample_pair.second) {
+        // The sound file can't be read, so don't request it again
+        instrument_->note_paths_.erase(semitone);
+      } else if (IsResident(semitone)) {
+        samples[semitone] = sample_pair.second;
+        instrument_->samples_[semitone] = sample_pair.second;
       }
     }
+    if (!samples.empty() && !is_swap_pending_) {
+      sampler_->AddSamples(samples);
+    }
+  }
+
+  // The previous instrument keeps playing until the notes in view of a
+  // lazily loaded instrument are ready. A refused swap is retried once the
+  // audio thread has caught up
+  if (is_swap_pending_) {
+    if (!is_prefetching_ || IsViewLoaded()) {
+      is_swap_pending_ =
+          !sampler_->SwapSamples(instrument_->samples_, kCrossfadeDuration);
+    }
+    return;
+  }
+
+  if (!is_prefetching_) {
+    return;
+  }
+  if (is_sequence_starting_ && sampler_->IsPlayingSequence()) {
+    is_sequence_starting_ = false;
+  }
+  std::vector<int> evictions;
+  for (const auto& sample_pair : instrument_->samples_) {
+    if (!IsResident(sample_pair.first)) {
+      evictions.push_back(sample_pair.first);
+    }
+  }
+  if (!evictions.empty()) {
+    // Notes that are still resonating are retried on the next update
+    for (int semitone : sampler_->UnloadSamples(evictions)) {
+      instrument_->samples_.erase(semitone);
+    }
+  }
+}
+
+bool Player::IsLoadingInstrument() const {
+  return is_swap_pending_;
+}
+
+void Player::PlayNote(const music::Note& note) {
+  if (sampler_) {
+    sampler_->PostEvent(NoteEvent::NoteOn(note.GetSemitoneIndex(),
+                                          LatencyHistogram::Now()));
+  }
+}
+
+void Player::PlayChord(const std::vector<music::Note>& notes) {
+  if (!sampler_) {
+    return;
+  }
+
+  uint64_t post_time = LatencyHistogram::Now();
+  std::vector<NoteEvent> events;
+  events.reserve(notes.size());
+  for (const music::Note& note : notes) {
+    events.push_back(NoteEvent::NoteOn(note.GetSemitoneIndex(), post_time));
+  }
+  sampler_->PostEvents(events.data(), events.size());
+}
+
+void Player::StopNote(const music::Note& note) {
+  if (sampler_) {
+    // The sampler fades the note away over the resonate duration, and stops
+    // rendering it once it is silent
+    sampler_->PostEvent(NoteEvent::NoteOff(note.GetSemitoneIndex()));
+  }
+}
+
+void Player::SetResonateDuration(double resonate_duration) {
+  // The sampler shortens any resonating notes if the new duration is shorter
+  if (sampler_) {
+    sampler_->PostEvent(NoteEvent::ResonateChange(resonate_duration));
   }
 
   resonate_duration_ = resonate_duration; // Update state
 }
 
+void Player::SetPolyphony(size_t polyphony) {
+  if (sampler_) {
+    sampler_->SetPolyphony(polyphony);
+  }
+  polyphony_ = polyphony;
+}
+
+void Player::SetStealPolicy(StealPolicy steal_policy) {
+  if (sampler_) {
+    sampler_->SetStealPolicy(steal_policy);
+  }
+  steal_policy_ = steal_policy;
+}
+
+void Player::SetAttackDuration(double attack_duration) {
+  if (sampler_) {
+    sampler_->SetAttackDuration(attack_duration);
+  }
+  attack_duration_ = attack_duration;
+}
+
+void Player::SetRenderThreadCount(size_t thread_count) {
+  if (sampler_) {
+    sampler_->SetRenderThreadCount(thread_count);
+  }
+  render_thread_count_ = thread_count;
+}
+
 double Player::GetResonateDuration() const {
   return resonate_duration_;
 }
 
+void Player::SetSustain(bool is_down) {
+  if (sampler_ && is_down != is_sustain_down_) {
+    sampler_->PostEvent(is_down ? NoteEvent::SustainOn()
+                                : NoteEvent::SustainOff());
+  }
+  is_sustain_down_ = is_down;
+}
+
+bool Player::IsSustainDown() const {
+  return is_sustain_down_;
+}
+
+std::map<music::Note, ci::fs::path> Player::GetSequencePaths(
+    const std::vector<TimedNoteEvent>& events) const {
+  std::map<music::Note, ci::fs::path> note_paths;
+  if (!instrument_) {
+    return note_paths;
+  }
+
+  for (const TimedNoteEvent& timed_event : events) {
+    if (timed_event.event_.type_ == NoteEvent::Type::NoteOn) {
+      int semitone = timed_event.event_.semitone_;
+      std::map<music::Note, ci::fs::path> paths =
+          GetRangePaths(*instrument_, semitone, semitone);
+      note_paths.insert(paths.begin(), paths.end());
+    }
+  }
+  return note_paths;
+}
+
+bool Player::PlaySequence(const std::vector<TimedNoteEvent>& events,
+                          const std::map<int, SampleBufferRef>& samples) {
+  if (!sampler_) {
+    return false;
+  }
+
+  // The samples are handed over before the performance, so its first notes
+  // find them. An instrument waiting to be swapped in takes them with it
+  std::map<int, SampleBufferRef> added_samples;
+  for (const auto& sample_pair : samples) {
+    if (instrument_->samples_.insert(sample_pair).second) {
+      added_samples.insert(sample_pair);
+    }
+  }
+  if (!added_samples.empty() && !is_swap_pending_) {
+    sampler_->AddSamples(added_samples);
+  }
+  if (!sampler_->PlaySequence(events)) {
+    return false;
+  }
+
+  sequence_lowest_semitone_ = static_cast<int>(Sampler::kSemitoneCount);
+  sequence_highest_semitone_ = -1;
+  for (const TimedNoteEvent& timed_event : events) {
+    if (timed_event.event_.type_ == NoteEvent::Type::NoteOn) {
+      int semitone = timed_event.event_.semitone_;
+      sequence_lowest_semitone_ = std::min(sequence_lowest_semitone_, semitone);
+      sequence_highest_semitone_ =
+          std::max(sequence_highest_semitone_, semitone);
+    }
+  }
+  is_sequence_starting_ = true;
+  return true;
+}
+
+bool Player::StopSequence() {
+  if (!sampler_ || !sampler_->StopSequence()) {
+    return false;
+  }
+  is_sequence_starting_ = false;
+  return true;
+}
+
+bool Player::IsPlayingSequence() const {
+  return sampler_ && sampler_->IsPlayingSequence();
+}
+
+std::vector<NoteEvent> Player::TakeSequenceEvents() {
+  if (!sampler_) {
+    return std::vector<NoteEvent>();
+  }
+  return sampler_->TakeSequenceEvents();
+}
+
+double Player::GetLastLoadDuration() const {
+  return instrument_ ? instrument_->load_duration_ : 0;
+}
+
 std::vector<music::Note> Player::GetPlayableNotes() const {
   std::vector<music::Note> notes;
+  if (!instrument_) {
+    return notes;
+  }
+
   music::Accidental priority = music::Accidental::Sharp;
-  for (const auto& note_file : voices_) {
-    int semitone = note_file.first;
-    notes.emplace_back(semitone, priority);
+  for (const auto& note_path : instrument_->note_paths_) {
+    notes.emplace_back(note_path.first, priority);
   }
   return notes;
 }
 
+size_t Player::GetLoadedNoteCount() const {
+  return instrument_ ? instrument_->samples_.size() : 0;
+}
+
+uint64_t Player::GetStreamUnderrunCount() const {
+  return sampler_ ? sampler_->GetStreamUnderrunCount() : 0;
+}
+
+const LatencyHistogram* Player::GetLatencyHistogram() const {
+  return sampler_ ? &sampler_->GetLatencyHistogram() : nullptr;
+}
+
+const LoadMeter* Player::GetLoadMeter() const {
+  return sampler_ ? &sampler_->GetLoadMeter() : nullptr;
+}
+
+bool Player::IsResident(int semitone) const {
+  if (IsInRange(semitone, resident_lowest_semitone_,
+                resident_highest_semitone_)) {
+    return true;
+  }
+  return (is_sequence_starting_ || sampler_->IsPlayingSequence()) &&
+         IsInRange(semitone, sequence_lowest_semitone_,
+                   sequence_highest_semitone_);
+}
+
+bool Player::IsInRange(int semitone, int lowest_semitone,
+                       int highest_semitone) const {
+  if (semitone >= lowest_semitone && semitone <= highest_semitone) {
+    return true;
+  }
+
+  // A sample just outside the range may play the notes at its edge
+  int reach = Sampler::kMaxPitchShift;
+  int lowest = std::max(lowest_semitone, semitone - reach);
+  int highest = std::min(highest_semitone, semitone + reach);
+  for (int note = lowest; note <= highest; note++) {
+    if (FindSampleSemitone(note) == semitone) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int Player::FindSampleSemitone(int semitone) const {
+  return FindNearestSample(
+      semitone, Sampler::kMaxPitchShift, [this](int candidate) {
+        return instrument_->note_paths_.count(candidate) > 0;
+      });
+}
+
+bool Player::IsViewLoaded() const {
+  // SetView() hasn't been called since the instrument was set
+  if (resident_lowest_semitone_ > resident_highest_semitone_) {
+    return false;
+  }
+
+  for (int semitone = view_lowest_semitone_;
+       semitone <= view_highest_semitone_; semitone++) {
+    int sample_semitone = FindSampleSemitone(semitone);
+    if (sample_semitone >= 0 &&
+        instrument_->samples_.count(sample_semitone) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::shared_ptr<SampleLoader> Player::MakeLoader() const {
+  auto ctx = ci::audio::Context::master();
+  auto loader = std::make_shared<SampleLoader>(ctx->getSampleRate());
+  loader->SetCacheDirectory(SampleLoader::GetDefaultCacheDirectory());
+  loader->SetStreaming(stream_head_duration_);
+  loader->SetStorage(storage_format_, is_downmixed_);
+  return loader;
+}
+
 }  // namespace audio
 
 }  // namespace synther
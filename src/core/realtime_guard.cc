@@ -0,0 +1,117 @@
+#include "core/realtime_guard.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace synther {
+
+namespace audio {
+
+namespace {
+
+// Trivially constructed, so reading them never allocates, even from inside
+// operator new
+thread_local int guard_depth = 0;
+std::atomic<uint64_t> violation_count(0);
+std::atomic<bool> is_aborting_on_violation(true);
+
+}  // namespace
+
+RealtimeGuard::RealtimeGuard() {
+  guard_depth++;
+}
+
+RealtimeGuard::~RealtimeGuard() {
+  guard_depth--;
+}
+
+bool RealtimeGuard::IsActive() {
+  return guard_depth > 0;
+}
+
+bool RealtimeGuard::IsChecking() {
+#ifdef SYNTHER_CHECK_REALTIME
+  return true;
+#else
+  return false;
+#endif
+}
+
+void RealtimeGuard::CheckAllocation() {
+  if (guard_depth == 0) {
+    return;
+  }
+
+  violation_count.fetch_add(1, std::memory_order_relaxed);
+  if (is_aborting_on_violation.load(std::memory_order_relaxed)) {
+    // Written without formatting, which could allocate again
+    std::fputs("synther: memory allocated or freed on the audio thread\n",
+               stderr);
+    std::abort();
+  }
+}
+
+uint64_t RealtimeGuard::GetViolationCount() {
+  return violation_count.load(std::memory_order_relaxed);
+}
+
+void RealtimeGuard::ResetViolationCount() {
+  violation_count.store(0, std::memory_order_relaxed);
+}
+
+void RealtimeGuard::SetAbortOnViolation(bool is_aborting) {
+  is_aborting_on_violation.store(is_aborting, std::memory_order_relaxed);
+}
+
+}  // namespace audio
+
+}  // namespace synther
+
+#ifdef SYNTHER_CHECK_REALTIME
+
+// The array and nothrow forms are replaced too, so no allocation made through
+// the standard library bypasses the check
+void* operator new(std::size_t size) {
+  synther::audio::RealtimeGuard::CheckAllocation();
+  void* pointer = std::malloc(size == 0 ? 1 : size);
+  if (!pointer) {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+void* operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  synther::audio::RealtimeGuard::CheckAllocation();
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  return operator new(size, std::nothrow);
+}
+
+void operator delete(void* pointer) noexcept {
+  if (pointer) {
+    synther::audio::RealtimeGuard::CheckAllocation();
+  }
+  std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+  operator delete(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+  operator delete(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+  operator delete(pointer);
+}
+
+#endif  // SYNTHER_CHECK_REALTIME
@@ -0,0 +1,251 @@
+#include "core/render_workers.h"
+
+#include <chrono>
+
+#include "core/parallel_for.h"
+#include "core/realtime_guard.h"
+
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#include <mach/thread_policy.h>
+#include <pthread.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace synther {
+
+namespace audio {
+
+namespace {
+
+const uint64_t kIndexMask = 0xFFFF;
+
+}  // namespace
+
+constexpr size_t RenderWorkers::kMaxTasks;
+constexpr int RenderWorkers::kCountShift;
+constexpr int RenderWorkers::kJobShift;
+constexpr int RenderWorkers::kIdleSleepThresholdMilliseconds;
+constexpr int RenderWorkers::kIdleSleepMicroseconds;
+
+RenderWorkers::RenderWorkers(size_t num_workers, const Task& task,
+                             bool is_pinned)
+    : task_(task),
+      is_stopping_(false),
+      helped_task_count_(0),
+      job_(0),
+      scheduling_version_(0),
+      caller_policy_(0),
+      caller_priority_(0),
+      caller_period_(0),
+      caller_computation_(0),
+      caller_constraint_(0),
+      claim_(0),
+      finished_count_(0) {
+  // Every worker takes a core of its own from the second one on. The audio
+  // thread belongs to the device and isn't pinned, and the first core is
+  // left out since it usually handles the most interrupts
+  size_t core_count = GetHardwareThreadCount();
+  for (size_t worker = 0; worker < num_workers; worker++) {
+    threads_.emplace_back([this, is_pinned, worker, core_count]() {
+      if (is_pinned) {
+        PinToCore((worker + 1) % core_count);
+      }
+      Work();
+    });
+  }
+}
+
+RenderWorkers::~RenderWorkers() {
+  is_stopping_.store(true);
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+void RenderWorkers::Run(size_t count) {
+  if (count == 0) {
+    return;
+  }
+
+  // Devices may render from a new thread after they are reconfigured
+  if (std::this_thread::get_id() != caller_) {
+    caller_ = std::this_thread::get_id();
+    PublishCallerScheduling();
+  }
+
+  // Tasks of this job can only be claimed once the claim word is published,
+  // so no worker finishes one before the count is reset
+  finished_count_.store(0, std::memory_order_relaxed);
+  job_++;
+  uint64_t claim = (job_ << kJobShift) |
+                   (static_cast<uint64_t>(count) << kCountShift);
+  claim_.store(claim, std::memory_order_release);
+
+  RunTasks(claim, false);
+  // Tasks claimed by workers may still be running. Yielding lets a worker
+  // of the same real-time priority finish its task on a shared core
+  while (finished_count_.load(std::memory_order_acquire) < count) {
+    std::this_thread::yield();
+  }
+}
+
+size_t RenderWorkers::GetWorkerCount() const {
+  return threads_.size();
+}
+
+uint64_t RenderWorkers::GetHelpedTaskCount() const {
+  return helped_task_count_.load(std::memory_order_relaxed);
+}
+
+void RenderWorkers::RunTasks(uint64_t claim, bool is_worker) {
+  uint64_t job = claim >> kJobShift;
+  while (claim >> kJobShift == job) {
+    uint64_t index = claim & kIndexMask;
+    uint64_t count = (claim >> kCountShift) & kIndexMask;
+    if (index >= count) {
+      break;
+    }
+
+    // Fails if another thread claimed the task first, or a new job started,
+    // in which case claim is reloaded
+    if (claim_.compare_exchange_weak(claim, claim + 1,
+                                     std::memory_order_acq_rel,
+                                     std::memory_order_acquire)) {
+      task_(static_cast<size_t>(index));
+      if (is_worker) {
+        helped_task_count_.fetch_add(1, std::memory_order_relaxed);
+      }
+      finished_count_.fetch_add(1, std::memory_order_release);
+      claim++;
+    }
+  }
+}
+
+void RenderWorkers::Work() {
+  RealtimeGuard guard;
+  auto idle_start = std::chrono::steady_clock::now();
+  uint64_t copied_version = 0;
+  while (!is_stopping_.load(std::memory_order_relaxed)) {
+    uint64_t version = scheduling_version_.load(std::memory_order_acquire);
+    if (version != copied_version && version % 2 == 0 &&
+        CopyCallerScheduling(version)) {
+      copied_version = version;
+    }
+
+    uint64_t claim = claim_.load(std::memory_order_acquire);
+    if ((claim & kIndexMask) < ((claim >> kCountShift) & kIndexMask)) {
+      RunTasks(claim, true);
+      idle_start = std::chrono::steady_clock::now();
+      continue;
+    }
+
+    if (std::chrono::steady_clock::now() - idle_start <
+        std::chrono::milliseconds(kIdleSleepThresholdMilliseconds)) {
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(
+          std::chrono::microseconds(kIdleSleepMicroseconds));
+    }
+  }
+}
+
+void RenderWorkers::PublishCallerScheduling() {
+  Scheduling scheduling = GetThreadScheduling();
+  uint64_t version = scheduling_version_.load(std::memory_order_relaxed);
+  scheduling_version_.store(version + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  caller_policy_.store(scheduling.policy_, std::memory_order_relaxed);
+  caller_priority_.store(scheduling.priority_, std::memory_order_relaxed);
+  caller_period_.store(scheduling.period_, std::memory_order_relaxed);
+  caller_computation_.store(scheduling.computation_,
+                            std::memory_order_relaxed);
+  caller_constraint_.store(scheduling.constraint_, std::memory_order_relaxed);
+  scheduling_version_.store(version + 2, std::memory_order_release);
+}
+
+bool RenderWorkers::CopyCallerScheduling(uint64_t version) {
+  Scheduling scheduling{caller_policy_.load(std::memory_order_relaxed),
+                        caller_priority_.load(std::memory_order_relaxed),
+                        caller_period_.load(std::memory_order_relaxed),
+                        caller_computation_.load(std::memory_order_relaxed),
+                        caller_constraint_.load(std::memory_order_relaxed)};
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (scheduling_version_.load(std::memory_order_relaxed) != version) {
+    return false;
+  }
+  SetThreadScheduling(scheduling);
+  return true;
+}
+
+RenderWorkers::Scheduling RenderWorkers::GetThreadScheduling() {
+  Scheduling scheduling{0, 0, 0, 0, 0};
+#if defined(__APPLE__)
+  thread_time_constraint_policy_data_t policy;
+  mach_msg_type_number_t count = THREAD_TIME_CONSTRAINT_POLICY_COUNT;
+  boolean_t is_default = false;
+  kern_return_t result = thread_policy_get(
+      pthread_mach_thread_np(pthread_self()), THREAD_TIME_CONSTRAINT_POLICY,
+      reinterpret_cast<thread_policy_t>(&policy), &count, &is_default);
+  // Threads without a time constraint report the default one
+  if (result == KERN_SUCCESS && !is_default) {
+    scheduling.period_ = policy.period;
+    scheduling.computation_ = policy.computation;
+    scheduling.constraint_ = policy.constraint;
+  }
+#elif defined(__linux__)
+  sched_param param;
+  if (pthread_getschedparam(pthread_self(), &scheduling.policy_, &param) ==
+      0) {
+    scheduling.priority_ = param.sched_priority;
+  }
+#endif
+  return scheduling;
+}
+
+void RenderWorkers::SetThreadScheduling(const Scheduling& scheduling) {
+  // Raising a thread may need privileges, so a failure leaves it as it is
+#if defined(__APPLE__)
+  thread_t thread = pthread_mach_thread_np(pthread_self());
+  if (scheduling.period_ != 0) {
+    thread_time_constraint_policy_data_t policy;
+    policy.period = scheduling.period_;
+    policy.computation = scheduling.computation_;
+    policy.constraint = scheduling.constraint_;
+    policy.preemptible = true;
+    thread_policy_set(thread, THREAD_TIME_CONSTRAINT_POLICY,
+                      reinterpret_cast<thread_policy_t>(&policy),
+                      THREAD_TIME_CONSTRAINT_POLICY_COUNT);
+  } else {
+    thread_standard_policy_data_t policy;
+    policy.no_data = 0;
+    thread_policy_set(thread, THREAD_STANDARD_POLICY,
+                      reinterpret_cast<thread_policy_t>(&policy),
+                      THREAD_STANDARD_POLICY_COUNT);
+  }
+#elif defined(__linux__)
+  sched_param param;
+  param.sched_priority = scheduling.priority_;
+  pthread_setschedparam(pthread_self(), scheduling.policy_, &param);
+#else
+  (void)scheduling;
+#endif
+}
+
+void RenderWorkers::PinToCore(size_t core) {
+#ifdef __linux__
+  cpu_set_t cores;
+  CPU_ZERO(&cores);
+  CPU_SET(core, &cores);
+  // Pinning is only a hint, so a failure leaves the thread unpinned
+  pthread_setaffinity_np(pthread_self(), sizeof(cores), &cores);
+#else
+  (void)core;
+#endif
+}
+
+}  // namespace audio
+
+}  // namespace synther
@@ -0,0 +1,148 @@
+#include "core/resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "core/mix_kernel.h"
+
+namespace synther {
+
+namespace audio {
+
+namespace {
+
+/**
+ * The zeroth-order modified Bessel function of the first kind, which shapes
+ *   the Kaiser window
+ */
+double BesselI0(double x) {
+  double sum = 1;
+  double term = 1;
+  for (int k = 1; k < 50 && term > 1e-12 * sum; k++) {
+    double factor = x / (2 * k);
+    term *= factor * factor;
+    sum += term;
+  }
+  return sum;
+}
+
+size_t GreatestCommonDivisor(size_t first, size_t second) {
+  while (second != 0) {
+    size_t remainder = first % second;
+    first = second;
+    second = remainder;
+  }
+  return first;
+}
+
+}  // namespace
+
+constexpr size_t Resampler::kDefaultTapCount;
+constexpr size_t Resampler::kMaxPhases;
+constexpr double Resampler::kCutoff;
+constexpr double Resampler::kKaiserBeta;
+constexpr size_t Resampler::kTapAlignment;
+
+Resampler::Resampler(size_t input_rate, size_t output_rate, size_t tap_count)
+    : input_rate_(input_rate), output_rate_(output_rate) {
+  size_t divisor = GreatestCommonDivisor(input_rate, output_rate);
+  upsample_factor_ = output_rate / divisor;
+  downsample_factor_ = input_rate / divisor;
+  phase_count_ = std::min(upsample_factor_, kMaxPhases);
+
+  // When downsampling, the cutoff falls below the input's Nyquist frequency,
+  // which widens the sinc. More taps keep the transition band as narrow
+  double scale = std::min(1.0, static_cast<double>(output_rate) / input_rate);
+  size_t scaled_tap_count =
+      static_cast<size_t>(std::ceil(std::max<size_t>(tap_count, 2) / scale));
+  tap_count_ = (scaled_tap_count + kTapAlignment - 1) / kTapAlignment *
+               kTapAlignment;
+
+  // Tap k of a phase weighs the input frame k - (tap_count_ / 2 - 1) frames
+  // after the frame just before the output position
+  const double kPi = 3.14159265358979323846;
+  double cutoff = kCutoff * scale;
+  double half_width = tap_count_ / 2.0;
+  taps_.resize(phase_count_ * tap_count_);
+  for (size_t phase = 0; phase < phase_count_; phase++) {
+    double fraction = static_cast<double>(phase) / phase_count_;
+    float* phase_taps = taps_.data() + phase * tap_count_;
+    double sum = 0;
+    for (size_t tap = 0; tap < tap_count_; tap++) {
+      double distance = static_cast<double>(tap) - (half_width - 1) - fraction;
+      double sinc = distance == 0
+                        ? 1
+                        : std::sin(kPi * cutoff * distance) /
+                              (kPi * cutoff * distance);
+      double window_position = distance / half_width;
+      double window = 0;
+      if (std::abs(window_position) < 1) {
+        window = BesselI0(kKaiserBeta *
+                          std::sqrt(1 - window_position * window_position)) /
+                 BesselI0(kKaiserBeta);
+      }
+      double weight = cutoff * sinc * window;
+      phase_taps[tap] = static_cast<float>(weight);
+      sum += weight;
+    }
+
+    // Every phase passes a constant signal through unchanged
+    for (size_t tap = 0; tap < tap_count_; tap++) {
+      phase_taps[tap] = static_cast<float>(phase_taps[tap] / sum);
+    }
+  }
+}
+
+size_t Resampler::GetOutputFrames(size_t input_frames) const {
+  uint64_t frames = static_cast<uint64_t>(input_frames) * output_rate_;
+  return static_cast<size_t>((frames + input_rate_ - 1) / input_rate_);
+}
+
+void Resampler::Process(const float* input, size_t input_frames,
+                        float* output) const {
+  size_t output_frames = GetOutputFrames(input_frames);
+  if (input_rate_ == output_rate_) {
+    std::copy(input, input + input_frames, output);
+    return;
+  }
+
+  // Surround the input with silence, so every output frame reads a full run
+  // of taps without checking the bounds
+  std::vector<float> padded(input_frames + 2 * tap_count_, 0.0f);
+  std::copy(input, input + input_frames, padded.begin() + tap_count_);
+
+  for (size_t frame = 0; frame < output_frames; frame++) {
+    uint64_t position = static_cast<uint64_t>(frame) * downsample_factor_;
+    uint64_t input_frame = position / upsample_factor_;
+    uint64_t remainder = position % upsample_factor_;
+
+    // Exact when every position has its own phase, otherwise the nearest
+    uint64_t phase = remainder;
+    if (phase_count_ != upsample_factor_) {
+      phase = (remainder * phase_count_ + upsample_factor_ / 2) /
+              upsample_factor_;
+      if (phase == phase_count_) {
+        phase = 0;
+        input_frame++;
+      }
+    }
+
+    const float* window =
+        padded.data() + input_frame + tap_count_ - (tap_count_ / 2 - 1);
+    output[frame] =
+        DotProduct(taps_.data() + phase * tap_count_, window, tap_count_);
+  }
+}
+
+size_t Resampler::GetPhaseCount() const {
+  return phase_count_;
+}
+
+size_t Resampler::GetTapCount() const {
+  return tap_count_;
+}
+
+}  // namespace audio
+
+}  // namespace synther
@@ -0,0 +1,176 @@
+#include "core/sample_buffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "core/mix_kernel.h"
+
+namespace synther {
+
+namespace audio {
+
+namespace {
+
+/**
+ * Converts a float sample to the nearest 16-bit sample, clipping samples
+ *   outside of the [-1, 1] range
+ */
+int16_t ToPcm(float sample) {
+  long pcm = std::lround(sample / kPcmScale);
+  return static_cast<int16_t>(std::min(std::max(pcm, -32768L), 32767L));
+}
+
+}  // namespace
+
+constexpr size_t SampleBuffer::kPaddingFrames;
+constexpr float SampleBuffer::kMonoTolerance;
+
+SampleBuffer::SampleBuffer(size_t num_channels, size_t num_frames,
+                           SampleFormat format)
+    : num_channels_(num_channels),
+      num_frames_(num_frames),
+      channel_stride_(num_frames + kPaddingFrames),
+      format_(format) {
+  // Share ownership of the vector while pointing at its samples
+  size_t storage_size = GetStorageSize(num_channels, num_frames);
+  if (format == SampleFormat::Int16) {
+    auto storage = std::make_shared<std::vector<int16_t>>(storage_size, 0);
+    data_ = std::shared_ptr<void>(storage, storage->data());
+  } else {
+    auto storage = std::make_shared<std::vector<float>>(storage_size, 0.0f);
+    data_ = std::shared_ptr<void>(storage, storage->data());
+  }
+}
+
+SampleBuffer::SampleBuffer(size_t num_channels, size_t num_frames,
+                           std::shared_ptr<void> data, SampleFormat format)
+    : num_channels_(num_channels),
+      num_frames_(num_frames),
+      channel_stride_(num_frames + kPaddingFrames),
+      format_(format),
+      data_(std::move(data)) {
+}
+
+float* SampleBuffer::GetChannel(size_t channel) {
+  return static_cast<float*>(data_.get()) + channel * channel_stride_;
+}
+
+const float* SampleBuffer::GetChannel(size_t channel) const {
+  return static_cast<const float*>(data_.get()) + channel * channel_stride_;
+}
+
+int16_t* SampleBuffer::GetPcmChannel(size_t channel) {
+  return static_cast<int16_t*>(data_.get()) + channel * channel_stride_;
+}
+
+const int16_t* SampleBuffer::GetPcmChannel(size_t channel) const {
+  return static_cast<const int16_t*>(data_.get()) + channel * channel_stride_;
+}
+
+void SampleBuffer::CopyFrames(size_t channel, size_t first_frame,
+                              size_t num_frames, float* output) const {
+  if (format_ == SampleFormat::Int16) {
+    const int16_t* samples = GetPcmChannel(channel) + first_frame;
+    for (size_t frame = 0; frame < num_frames; frame++) {
+      output[frame] = samples[frame] * kPcmScale;
+    }
+  } else {
+    const float* samples = GetChannel(channel) + first_frame;
+    std::copy(samples, samples + num_frames, output);
+  }
+}
+
+SampleFormat SampleBuffer::GetFormat() const {
+  return format_;
+}
+
+size_t SampleBuffer::GetNumChannels() const {
+  return num_channels_;
+}
+
+size_t SampleBuffer::GetNumFrames() const {
+  return num_frames_;
+}
+
+void SampleBuffer::SetStreamSource(const StreamSourceRef& stream_source) {
+  stream_source_ = stream_source;
+}
+
+const StreamSourceRef& SampleBuffer::GetStreamSource() const {
+  return stream_source_;
+}
+
+size_t SampleBuffer::GetTotalFrames() const {
+  return stream_source_ ? stream_source_->GetNumFrames() : num_frames_;
+}
+
+size_t SampleBuffer::GetMemorySize() const {
+  return GetStorageSize(num_channels_, num_frames_) * GetSampleSize(format_);
+}
+
+bool SampleBuffer::IsMonoCompatible() const {
+  // Compare in blocks, so samples of every format are read the same way
+  const size_t kBlockFrames = 1024;
+  std::vector<float> first(kBlockFrames);
+  std::vector<float> other(kBlockFrames);
+  for (size_t frame = 0; frame < num_frames_; frame += kBlockFrames) {
+    size_t block_frames = std::min(kBlockFrames, num_frames_ - frame);
+    CopyFrames(0, frame, block_frames, first.data());
+    for (size_t channel = 1; channel < num_channels_; channel++) {
+      CopyFrames(channel, frame, block_frames, other.data());
+      for (size_t index = 0; index < block_frames; index++) {
+        if (std::abs(first[index] - other[index]) > kMonoTolerance) {
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+std::shared_ptr<SampleBuffer> SampleBuffer::Convert(SampleFormat format,
+                                                    bool is_downmixed) const {
+  size_t num_channels = is_downmixed ? std::min<size_t>(num_channels_, 1)
+                                     : num_channels_;
+  auto converted =
+      std::make_shared<SampleBuffer>(num_channels, num_frames_, format);
+
+  // Only the frames are converted, since the padding is already silent
+  std::vector<float> mix(num_frames_);
+  std::vector<float> samples(num_frames_);
+  for (size_t channel = 0; channel < num_channels; channel++) {
+    CopyFrames(channel, 0, num_frames_, mix.data());
+    if (is_downmixed && num_channels_ > 1) {
+      for (size_t source = 1; source < num_channels_; source++) {
+        CopyFrames(source, 0, num_frames_, samples.data());
+        for (size_t frame = 0; frame < num_frames_; frame++) {
+          mix[frame] += samples[frame];
+        }
+      }
+      for (float& sample : mix) {
+        sample /= static_cast<float>(num_channels_);
+      }
+    }
+
+    if (format == SampleFormat::Int16) {
+      std::transform(mix.begin(), mix.end(),
+                     converted->GetPcmChannel(channel), ToPcm);
+    } else {
+      std::copy(mix.begin(), mix.end(), converted->GetChannel(channel));
+    }
+  }
+  return converted;
+}
+
+size_t SampleBuffer::GetStorageSize(size_t num_channels, size_t num_frames) {
+  return num_channels * (num_frames + kPaddingFrames);
+}
+
+size_t SampleBuffer::GetSampleSize(SampleFormat format) {
+  return format == SampleFormat::Int16 ? sizeof(int16_t) : sizeof(float);
+}
+
+}  // namespace audio
+
+}  // namespace synther
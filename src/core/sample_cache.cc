@@ -0,0 +1,344 @@
+#include "core/sample_cache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "core/mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <sys/utime.h>
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <utime.h>
+#endif
+
+namespace synther {
+
+namespace audio {
+
+namespace {
+
+const char kMagic[8] = {'S', 'Y', 'N', 'P', 'C', 'M', '\0', '\0'};
+// Increase when the layout of entries changes, to ignore older entries
+const uint16_t kFormatVersion = 2;
+const char* kExtension = ".pcm";
+
+// The header is 32 bytes, which keeps the samples that follow it aligned
+struct EntryHeader {
+  char magic_[8];
+  uint16_t version_;
+  // The SampleFormat of the samples
+  uint16_t format_;
+  uint32_t num_channels_;
+  uint64_t num_frames_;
+  uint64_t padding_frames_;
+};
+
+// Samples are only streamed if they are at least this much longer than their
+// heads, since streaming a short tail saves little memory
+const size_t kMinStreamedFrames = 1 << 16;
+
+/**
+ * Checks that an entry's header matches this build, and that the entry holds
+ *   every frame the header describes
+ */
+bool IsValidEntry(const EntryHeader& header, size_t file_size) {
+  if (std::memcmp(header.magic_, kMagic, sizeof(kMagic)) != 0 ||
+      header.version_ != kFormatVersion ||
+      header.format_ > static_cast<uint16_t>(SampleFormat::Int16) ||
+      header.padding_frames_ != SampleBuffer::kPaddingFrames) {
+    return false;
+  }
+  size_t data_size =
+      SampleBuffer::GetStorageSize(header.num_channels_,
+                                   static_cast<size_t>(header.num_frames_)) *
+      SampleBuffer::GetSampleSize(static_cast<SampleFormat>(header.format_));
+  return file_size == sizeof(EntryHeader) + data_size;
+}
+
+// An entry found in the cache directory
+struct EntryFile {
+  std::string path_;
+  uint64_t size_;
+  // When the entry was last stored or loaded, in units of the platform
+  int64_t used_time_;
+};
+
+/**
+ * Finds every entry in a directory. Temporary files of entries being stored
+ *   don't end in kExtension, so they are left alone
+ */
+std::vector<EntryFile> ListEntries(const std::string& directory) {
+  std::vector<EntryFile> entries;
+#ifdef _WIN32
+  WIN32_FIND_DATAA data;
+  HANDLE find =
+      FindFirstFileA((directory + "/*" + kExtension).c_str(), &data);
+  if (find == INVALID_HANDLE_VALUE) {
+    return entries;
+  }
+  do {
+    if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+      uint64_t size = (static_cast<uint64_t>(data.nFileSizeHigh) << 32) |
+                      data.nFileSizeLow;
+      int64_t used_time =
+          (static_cast<int64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+          data.ftLastWriteTime.dwLowDateTime;
+      entries.push_back({directory + "/" + data.cFileName, size, used_time});
+    }
+  } while (FindNextFileA(find, &data));
+  FindClose(find);
+#else
+  DIR* listing = opendir(directory.c_str());
+  if (!listing) {
+    return entries;
+  }
+  size_t extension_size = std::strlen(kExtension);
+  while (dirent* file = readdir(listing)) {
+    std::string name = file->d_name;
+    if (name.size() <= extension_size ||
+        name.compare(name.size() - extension_size, extension_size,
+                     kExtension) != 0) {
+      continue;
+    }
+    std::string path = directory + "/" + name;
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) {
+      continue;
+    }
+#ifdef __APPLE__
+    const struct timespec& modified = info.st_mtimespec;
+#else
+    const struct timespec& modified = info.st_mtim;
+#endif
+    int64_t used_time =
+        static_cast<int64_t>(modified.tv_sec) * 1000000000 + modified.tv_nsec;
+    entries.push_back({path, static_cast<uint64_t>(info.st_size), used_time});
+  }
+  closedir(listing);
+#endif
+  return entries;
+}
+
+/**
+ * Marks an entry as used now, so it is pruned after entries used earlier
+ */
+void TouchEntry(const std::string& path) {
+#ifdef _WIN32
+  _utime(path.c_str(), nullptr);
+#else
+  utime(path.c_str(), nullptr);
+#endif
+}
+
+// 64-bit FNV-1a, which is fast and well distributed for file contents
+const uint64_t kFnvOffsetBasis = 14695981039346656037ULL;
+const uint64_t kFnvPrime = 1099511628211ULL;
+const size_t kReadChunkSize = 1 << 16;
+
+}  // namespace
+
+constexpr uint64_t SampleCache::kDefaultByteBudget;
+
+SampleCache::SampleCache(const std::string& directory, uint64_t byte_budget)
+    : directory_(directory), byte_budget_(byte_budget) {
+}
+
+std::string SampleCache::ComputeKey(const std::string& source_path,
+                                    size_t sample_rate, SampleFormat format,
+                                    bool is_downmixed) {
+  std::ifstream source(source_path, std::ios::binary);
+  if (!source.is_open()) {
+    return "";
+  }
+
+  uint64_t hash = kFnvOffsetBasis;
+  std::vector<char> chunk(kReadChunkSize);
+  while (source) {
+    source.read(chunk.data(), chunk.size());
+    std::streamsize bytes_read = source.gcount();
+    for (std::streamsize index = 0; index < bytes_read; index++) {
+      hash ^= static_cast<unsigned char>(chunk[index]);
+      hash *= kFnvPrime;
+    }
+  }
+
+  std::ostringstream key;
+  key << std::hex << std::setw(16) << std::setfill('0') << hash << std::dec
+      << "-" << sample_rate;
+  if (format == SampleFormat::Int16) {
+    key << "-pcm16";
+  }
+  if (is_downmixed) {
+    key << "-mono";
+  }
+  return key.str();
+}
+
+SampleBufferRef SampleCache::Load(const std::string& key) const {
+  auto file = std::make_shared<MappedFile>(GetPath(key));
+  if (!file->IsOpen()) {
+    return nullptr;
+  }
+
+  EntryHeader header;
+  bool is_valid = file->GetSize() >= sizeof(EntryHeader);
+  if (is_valid) {
+    std::memcpy(&header, file->GetData(), sizeof(header));
+    is_valid = IsValidEntry(header, file->GetSize());
+  }
+  if (!is_valid) {
+    // The entry is truncated or was written by a different build, and would
+    // never be read again
+    file.reset();
+    std::remove(GetPath(key).c_str());
+    return nullptr;
+  }
+  TouchEntry(GetPath(key));
+  size_t num_channels = header.num_channels_;
+  size_t num_frames = static_cast<size_t>(header.num_frames_);
+  SampleFormat format = static_cast<SampleFormat>(header.format_);
+
+  file->Prefault();
+  // The samples keep the mapping alive for as long as they are in use
+  void* data = file->GetData() + sizeof(header);
+  return std::make_shared<SampleBuffer>(
+      num_channels, num_frames, std::shared_ptr<void>(file, data), format);
+}
+
+SampleBufferRef SampleCache::LoadHead(const std::string& key,
+                                      size_t head_frames) const {
+  std::ifstream entry(GetPath(key), std::ios::binary | std::ios::ate);
+  if (!entry.is_open()) {
+    return nullptr;
+  }
+  size_t file_size = static_cast<size_t>(entry.tellg());
+  entry.seekg(0);
+
+  EntryHeader header;
+  if (!entry.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      !IsValidEntry(header, file_size)) {
+    entry.close();
+    std::remove(GetPath(key).c_str());
+    return nullptr;
+  }
+  size_t num_channels = header.num_channels_;
+  size_t num_frames = static_cast<size_t>(header.num_frames_);
+  SampleFormat format = static_cast<SampleFormat>(header.format_);
+  if (num_channels > StreamSource::kMaxChannels ||
+      num_frames < head_frames + kMinStreamedFrames) {
+    return Load(key);
+  }
+
+  // The head keeps the entry's format, and is read without conversion
+  auto source = std::make_shared<StreamSource>(
+      GetPath(key), sizeof(header), num_channels, num_frames, format);
+  auto head = std::make_shared<SampleBuffer>(num_channels, head_frames, format);
+  size_t sample_size = SampleBuffer::GetSampleSize(format);
+  size_t channel_stride = num_frames + SampleBuffer::kPaddingFrames;
+  for (size_t channel = 0; channel < num_channels; channel++) {
+    char* head_channel =
+        format == SampleFormat::Int16
+            ? reinterpret_cast<char*>(head->GetPcmChannel(channel))
+            : reinterpret_cast<char*>(head->GetChannel(channel));
+    entry.seekg(static_cast<std::streamoff>(
+        sizeof(header) + channel * channel_stride * sample_size));
+    if (!entry.read(head_channel,
+                    static_cast<std::streamsize>(head_frames * sample_size))) {
+      return nullptr;
+    }
+  }
+  head->SetStreamSource(source);
+  TouchEntry(GetPath(key));
+  return head;
+}
+
+bool SampleCache::Store(const std::string& key,
+                        const SampleBuffer& sample) const {
+  EntryHeader header;
+  std::memcpy(header.magic_, kMagic, sizeof(kMagic));
+  header.version_ = kFormatVersion;
+  header.format_ = static_cast<uint16_t>(sample.GetFormat());
+  header.num_channels_ = static_cast<uint32_t>(sample.GetNumChannels());
+  header.num_frames_ = sample.GetNumFrames();
+  header.padding_frames_ = SampleBuffer::kPaddingFrames;
+
+  // Several loader threads may store entries at once, so each writes its own
+  // temporary file
+  std::ostringstream temporary_path;
+  temporary_path << GetPath(key) << ".tmp"
+                 << std::hash<std::thread::id>()(std::this_thread::get_id());
+
+  {
+    std::ofstream entry(temporary_path.str(), std::ios::binary);
+    if (!entry.is_open()) {
+      return false;
+    }
+    entry.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    size_t channel_size =
+        (sample.GetNumFrames() + SampleBuffer::kPaddingFrames) *
+        SampleBuffer::GetSampleSize(sample.GetFormat());
+    for (size_t channel = 0; channel < sample.GetNumChannels(); channel++) {
+      const char* samples =
+          sample.GetFormat() == SampleFormat::Int16
+              ? reinterpret_cast<const char*>(sample.GetPcmChannel(channel))
+              : reinterpret_cast<const char*>(sample.GetChannel(channel));
+      entry.write(samples, channel_size);
+    }
+    if (!entry) {
+      entry.close();
+      std::remove(temporary_path.str().c_str());
+      return false;
+    }
+  }
+
+  if (std::rename(temporary_path.str().c_str(), GetPath(key).c_str()) != 0) {
+    std::remove(temporary_path.str().c_str());
+    return false;
+  }
+  Prune(GetPath(key));
+  return true;
+}
+
+std::string SampleCache::GetPath(const std::string& key) const {
+  return directory_ + "/" + key + kExtension;
+}
+
+void SampleCache::Prune(const std::string& kept_path) const {
+  std::vector<EntryFile> entries = ListEntries(directory_);
+  uint64_t total_size = 0;
+  for (const EntryFile& entry : entries) {
+    total_size += entry.size_;
+  }
+  if (total_size <= byte_budget_) {
+    return;
+  }
+
+  std::sort(entries.begin(), entries.end(),
+            [](const EntryFile& lhs, const EntryFile& rhs) {
+              return lhs.used_time_ < rhs.used_time_;
+            });
+  for (const EntryFile& entry : entries) {
+    if (total_size <= byte_budget_) {
+      break;
+    }
+    if (entry.path_ != kept_path && std::remove(entry.path_.c_str()) == 0) {
+      total_size -= entry.size_;
+    }
+  }
+}
+
+}  // namespace audio
+
+}  // namespace synther
@@ -0,0 +1,189 @@
+#include "core/sample_loader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "cinder/audio/audio.h"
+#include "core/parallel_for.h"
+#include "core/resampler.h"
+
+namespace synther {
+
+namespace audio {
+
+SampleLoader::SampleLoader(size_t sample_rate, size_t num_threads)
+    : sample_rate_(sample_rate),
+      num_threads_(num_threads == 0 ? GetHardwareThreadCount() : num_threads),
+      stream_head_frames_(0),
+      format_(SampleFormat::Float32),
+      is_downmixed_(false),
+      last_load_duration_(0),
+      last_cache_hit_count_(0) {
+}
+
+void SampleLoader::SetCacheDirectory(const ci::fs::path& directory) {
+  try {
+    ci::fs::create_directories(directory);
+  } catch (const std::exception& e) {
+    // Load without a cache
+    cache_.reset();
+    return;
+  }
+  cache_.reset(new SampleCache(directory.string()));
+}
+
+void SampleLoader::SetStreaming(double head_duration) {
+  stream_head_frames_ = static_cast<size_t>(head_duration * sample_rate_);
+}
+
+void SampleLoader::SetStorage(SampleFormat format, bool is_downmixed) {
+  format_ = format;
+  is_downmixed_ = is_downmixed;
+}
+
+SampleBufferRef SampleLoader::LoadSample(
+    const ci::DataSourceRef& source) const {
+  // Decode at the file's own rate, and convert with the polyphase resampler
+  // once rather than on every block
+  ci::audio::BufferRef buffer;
+  size_t file_rate;
+  try {
+    ci::audio::SourceFileRef source_file = ci::audio::load(source);
+    buffer = source_file->loadBuffer();
+    file_rate = source_file->getSampleRate();
+  } catch (const std::exception& e) {
+    return nullptr;
+  }
+  if (file_rate == 0) {
+    return nullptr;
+  }
+
+  // Copy the decoded channels into a buffer owned by the sampler, converting
+  // them to the loader's rate
+  Resampler resampler(file_rate, sample_rate_);
+  auto sample = std::make_shared<SampleBuffer>(
+      buffer->getNumChannels(),
+      resampler.GetOutputFrames(buffer->getNumFrames()));
+  for (size_t channel = 0; channel < buffer->getNumChannels(); channel++) {
+    resampler.Process(buffer->getChannel(channel), buffer->getNumFrames(),
+                      sample->GetChannel(channel));
+  }
+
+  // Convert once the decode is complete, since the resampler works on floats
+  bool is_mono = is_downmixed_ && sample->GetNumChannels() > 1 &&
+                 sample->IsMonoCompatible();
+  if (format_ != SampleFormat::Float32 || is_mono) {
+    return sample->Convert(format_, is_mono);
+  }
+  return sample;
+}
+
+SampleBufferRef SampleLoader::LoadSampleFile(const ci::fs::path& path,
+                                             bool* is_cached) const {
+  std::string key;
+  if (cache_) {
+    key = SampleCache::ComputeKey(path.string(), sample_rate_, format_,
+                                  is_downmixed_);
+    if (!key.empty()) {
+      SampleBufferRef sample = stream_head_frames_ > 0
+                                   ? cache_->LoadHead(key, stream_head_frames_)
+                                   : cache_->Load(key);
+      if (sample) {
+        if (is_cached) {
+          *is_cached = true;
+        }
+        return sample;
+      }
+    }
+  }
+
+  ci::DataSourceRef source;
+  try {
+    source = ci::loadFile(path);
+  } catch (const std::exception& e) {
+    // The sound file is unreadable
+    return nullptr;
+  }
+  SampleBufferRef sample = LoadSample(source);
+
+  if (sample && !key.empty()) {
+    // A failed write only means the file is decoded again next time
+    bool is_stored = cache_->Store(key, *sample);
+    if (is_stored && stream_head_frames_ > 0) {
+      // Stream from the new entry rather than keeping the whole decode
+      SampleBufferRef head = cache_->LoadHead(key, stream_head_frames_);
+      if (head) {
+        return head;
+      }
+    }
+  }
+  return sample;
+}
+
+std::map<int, SampleBufferRef> SampleLoader::LoadSamples(
+    const std::map<music::Note, ci::fs::path>& note_paths) {
+  auto start = std::chrono::steady_clock::now();
+
+  // Every worker writes only to its own slot, so no locking is needed
+  std::vector<std::pair<int, ci::fs::path>> jobs;
+  for (const auto& note_path : note_paths) {
+    jobs.emplace_back(note_path.first.GetSemitoneIndex(), note_path.second);
+  }
+  std::vector<SampleBufferRef> decoded(jobs.size());
+  std::atomic<size_t> cache_hit_count(0);
+
+  ParallelFor(jobs.size(), num_threads_, [&](size_t index) {
+    bool is_cached = false;
+    decoded[index] = LoadSampleFile(jobs[index].second, &is_cached);
+    if (is_cached) {
+      cache_hit_count++;
+    }
+  });
+
+  std::map<int, SampleBufferRef> samples;
+  for (size_t index = 0; index < jobs.size(); index++) {
+    if (decoded[index]) {
+      samples[jobs[index].first] = decoded[index];
+    }
+  }
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  last_load_duration_ = elapsed.count();
+  last_cache_hit_count_ = cache_hit_count;
+  return samples;
+}
+
+std::map<music::Note, ci::fs::path> SampleLoader::ResolvePaths(
+    const std::map<music::Note, std::string>& note_files,
+    const ci::fs::path& instrument_directory) {
+  std::map<music::Note, ci::fs::path> note_paths;
+  for (const auto& note_file : note_files) {
+    note_paths.emplace(note_file.first,
+                       instrument_directory / note_file.second);
+  }
+  return note_paths;
+}
+
+ci::fs::path SampleLoader::GetDefaultCacheDirectory() {
+  return ci::fs::temp_directory_path() / "synther" / "samples";
+}
+
+size_t SampleLoader::GetNumThreads() const {
+  return num_threads_;
+}
+
+double SampleLoader::GetLastLoadDuration() const {
+  return last_load_duration_;
+}
+
+size_t SampleLoader::GetLastCacheHitCount() const {
+  return last_cache_hit_count_;
+}
+
+}  // namespace audio
+
+}  // namespace synther
@@ -0,0 +1,90 @@
+#include "core/sample_prefetcher.h"
+
+namespace synther {
+
+namespace audio {
+
+constexpr int SamplePrefetcher::kNotLoading;
+
+SamplePrefetcher::SamplePrefetcher(const LoadFunction& load_sample)
+    : load_sample_(load_sample),
+      loading_(kNotLoading),
+      generation_(0),
+      is_stopping_(false),
+      worker_(&SamplePrefetcher::Run, this) {
+}
+
+SamplePrefetcher::~SamplePrefetcher() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_stopping_ = true;
+  }
+  wake_.notify_one();
+  worker_.join();
+}
+
+void SamplePrefetcher::Reset(const LoadFunction& load_sample) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  load_sample_ = load_sample;
+  pending_.clear();
+  loaded_.clear();
+  loading_ = kNotLoading;
+  generation_++;
+}
+
+void SamplePrefetcher::Request(const std::vector<int>& semitones) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.clear();
+    for (int semitone : semitones) {
+      if (semitone != loading_ && loaded_.count(semitone) == 0) {
+        pending_.push_back(semitone);
+      }
+    }
+  }
+  wake_.notify_one();
+}
+
+std::map<int, SampleBufferRef> SamplePrefetcher::TakeLoaded() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<int, SampleBufferRef> loaded;
+  loaded.swap(loaded_);
+  return loaded;
+}
+
+bool SamplePrefetcher::IsIdle() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return pending_.empty() && loading_ == kNotLoading;
+}
+
+void SamplePrefetcher::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    wake_.wait(lock, [this]() { return is_stopping_ || !pending_.empty(); });
+    if (is_stopping_) {
+      return;
+    }
+
+    int semitone = pending_.front();
+    pending_.pop_front();
+    loading_ = semitone;
+    uint64_t generation = generation_;
+    LoadFunction load_sample = load_sample_;
+
+    // Load without holding the lock, so requests are never blocked by disk
+    // access or decoding
+    lock.unlock();
+    SampleBufferRef sample = load_sample(semitone);
+    lock.lock();
+
+    // Samples of an instrument that was switched away from are discarded
+    if (generation == generation_) {
+      loaded_[semitone] = sample;
+      loading_ = kNotLoading;
+    }
+  }
+}
+
+}  // namespace audio
+
+}  // namespace synther
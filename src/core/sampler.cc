@@ -0,0 +1,1030 @@
+#include "core/sampler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "core/realtime_guard.h"
+#include "core/zone_map.h"
+
+namespace synther {
+
+namespace audio {
+
+namespace {
+
+/**
+ * Resamples one channel of a pitch-shifted voice with linear interpolation
+ * @tparam Sample the type that the voice's sample stores samples as
+ * @param input the sample frames from the voice's position onwards
+ * @param scale scales the input to the [-1, 1] range
+ * @param available the number of frames that may be read from input. Frames
+ *   past them are silent
+ * @param fraction how far the voice's position is past the first frame
+ * @param rate the number of input frames per output frame
+ * @param output receives num_frames resampled frames
+ * @param num_frames the number of frames to resample
+ */
+template <typename Sample>
+void Interpolate(const Sample* input, float scale, size_t available,
+                 double fraction, double rate, float* output,
+                 size_t num_frames) {
+  for (size_t frame = 0; frame < num_frames; frame++) {
+    double position = fraction + rate * static_cast<double>(frame);
+    size_t index = static_cast<size_t>(position);
+    float weight = static_cast<float>(position - static_cast<double>(index));
+    float current = index < available ? input[index] * scale : 0.0f;
+    float next = index + 1 < available ? input[index + 1] * scale : 0.0f;
+    output[frame] = current + (next - current) * weight;
+  }
+}
+
+}  // namespace
+
+constexpr size_t Sampler::kSemitoneCount;
+constexpr size_t Sampler::kMaxLayers;
+constexpr size_t Sampler::kMaxPolyphony;
+constexpr size_t Sampler::kDefaultPolyphony;
+constexpr double Sampler::kStealFadeDuration;
+constexpr size_t Sampler::kStealFadeVoices;
+constexpr size_t Sampler::kEventQueueCapacity;
+constexpr size_t Sampler::kMaxBlockFrames;
+constexpr int Sampler::kMaxPitchShift;
+constexpr size_t Sampler::kMaxReadFrames;
+constexpr size_t Sampler::kMaxStreams;
+constexpr size_t Sampler::kStreamRingFrames;
+constexpr size_t Sampler::kMaxPendingSwaps;
+constexpr size_t Sampler::kMaxPendingSequences;
+constexpr size_t Sampler::kMaxRenderThreads;
+constexpr size_t Sampler::kMinChunkVoices;
+constexpr size_t Sampler::kMaxChunkChannels;
+constexpr double Sampler::kDefaultSampleRate;
+constexpr double Sampler::kNanosecondsPerSecond;
+
+Sampler::Sampler(double resonate_duration, size_t polyphony,
+                 StealPolicy steal_policy)
+    : layers_(kMaxLayers),
+      max_pitch_shift_(0),
+      voices_(kMaxPolyphony, polyphony, steal_policy, kStealFadeVoices),
+      events_(kEventQueueCapacity),
+      mix_sources_(kMaxPolyphony + kStealFadeVoices),
+      shifted_frames_((kMaxPolyphony + kStealFadeVoices) * kMaxBlockFrames),
+      sample_rate_(kDefaultSampleRate),
+      resonate_duration_(resonate_duration),
+      attack_duration_(0),
+      is_sustain_down_(false),
+      pending_sets_(kMaxPendingSwaps),
+      retired_sets_(kMaxPendingSwaps),
+      fading_sets_(kMaxLayers, nullptr),
+      pending_swap_count_(0),
+      pending_sequences_(kMaxPendingSequences),
+      retired_sequences_(kMaxPendingSequences),
+      pending_sequence_count_(0),
+      sequence_(nullptr),
+      sequence_index_(0),
+      sequence_frame_(0),
+      sequence_notes_(kSemitoneCount, 0),
+      is_sequence_sustain_down_(false),
+      is_sequence_playing_(false),
+      sequence_events_(kEventQueueCapacity),
+      streams_(kMaxStreams, kStreamRingFrames),
+      stream_used_(kMaxStreams, 0),
+      stream_frames_(kMaxStreams * StreamSource::kMaxChannels *
+                     kMaxReadFrames),
+      stream_next_frames_(kMaxStreams, 0),
+      stream_last_frames_(kMaxStreams * StreamSource::kMaxChannels, 0.0f),
+      chunked_block_(),
+      chunk_frames_((kMaxRenderThreads - 1) * kMaxChunkChannels *
+                    kMaxBlockFrames),
+      chunk_sources_(kMaxRenderThreads - 1) {
+  for (Layer& layer : layers_) {
+    layer.samples_.resize(kSemitoneCount);
+    layer.zones_.assign(kSemitoneCount, -1);
+    layer.lowest_semitone_ = 0;
+    layer.highest_semitone_ = static_cast<int>(kSemitoneCount) - 1;
+    layer.gain_ = 1;
+  }
+  voices_.SetStealFade(kStealFadeDuration * sample_rate_);
+}
+
+Sampler::~Sampler() {
+  // The I/O thread may still read the sets' samples until the stream pool is
+  // destroyed, which happens after the retired samples are destroyed
+  std::vector<SampleSet*> sets;
+  SampleSet* set;
+  while (pending_sets_.TryPop(set)) {
+    sets.push_back(set);
+  }
+  while (retired_sets_.TryPop(set)) {
+    sets.push_back(set);
+  }
+  for (SampleSet* fading_set : fading_sets_) {
+    if (fading_set) {
+      sets.push_back(fading_set);
+    }
+  }
+  for (SampleSet* retired_set : sets) {
+    for (const SampleBufferRef& sample : retired_set->samples_) {
+      RetireSample(sample);
+    }
+    delete retired_set;
+  }
+
+  Sequence* sequence;
+  while (pending_sequences_.TryPop(sequence)) {
+    delete sequence;
+  }
+  while (retired_sequences_.TryPop(sequence)) {
+    delete sequence;
+  }
+  delete sequence_;
+}
+
+void Sampler::SetSampleRate(double sample_rate) {
+  sample_rate_ = sample_rate;
+  voices_.SetStealFade(kStealFadeDuration * sample_rate_);
+}
+
+void Sampler::SetSamples(const std::map<int, SampleBufferRef>& samples,
+                         size_t layer) {
+  if (layer >= kMaxLayers) {
+    return;
+  }
+  ApplySwaps();
+
+  // Stop every voice of the layer, since voices may point into the samples
+  // being replaced
+  size_t index = 0;
+  while (index < voices_.GetActiveCount()) {
+    if (voices_.GetActive(index).layer_ == layer) {
+      voices_.Free(index);
+    } else {
+      index++;
+    }
+  }
+
+  PurgeRetiredSamples();
+  for (SampleBufferRef& sample : layers_[layer].samples_) {
+    RetireSample(sample);
+    sample = nullptr;
+  }
+  for (const auto& sample_pair : samples) {
+    AddSample(sample_pair.first, sample_pair.second, layer);
+  }
+  MapZones(layer);
+}
+
+bool Sampler::SwapSamples(const std::map<int, SampleBufferRef>& samples,
+                          double crossfade_duration, size_t layer) {
+  if (pending_swap_count_ >= kMaxPendingSwaps || layer >= kMaxLayers) {
+    return false;
+  }
+
+  // Build the whole set on this thread, so the audio thread only swaps
+  // vectors
+  std::unique_ptr<SampleSet> set(new SampleSet());
+  set->samples_.resize(kSemitoneCount);
+  set->crossfade_duration_ = crossfade_duration;
+  set->layer_ = layer;
+  for (const auto& sample_pair : samples) {
+    const SampleBufferRef& sample = sample_pair.second;
+    int semitone = sample_pair.first;
+    if (sample && sample->GetNumChannels() > 0 &&
+        sample->GetNumFrames() > 0 && semitone >= 0 &&
+        semitone < static_cast<int>(kSemitoneCount)) {
+      set->samples_[semitone] = sample;
+      if (sample->GetStreamSource()) {
+        streams_.Start();
+      }
+    }
+  }
+
+  // The queue holds kMaxPendingSwaps sets, so this never fails
+  pending_sets_.TryPush(set.release());
+  pending_swap_count_++;
+  return true;
+}
+
+void Sampler::CollectRetiredSamples() {
+  SampleSet* set;
+  while (retired_sets_.TryPop(set)) {
+    collected_sets_.emplace_back(set);
+    pending_swap_count_--;
+  }
+
+  // The streams of voices that faded out may take a moment to close
+  auto is_unused = [this](const std::unique_ptr<SampleSet>& collected_set) {
+    for (const SampleBufferRef& sample : collected_set->samples_) {
+      if (sample && streams_.IsReading(sample->GetStreamSource().get())) {
+        return false;
+      }
+    }
+    return true;
+  };
+  collected_sets_.erase(std::remove_if(collected_sets_.begin(),
+                                       collected_sets_.end(), is_unused),
+                        collected_sets_.end());
+}
+
+void Sampler::AddSample(int semitone, const SampleBufferRef& sample,
+                        size_t layer) {
+  ApplySwaps();
+
+  bool is_playable = sample && sample->GetNumChannels() > 0 &&
+                     sample->GetNumFrames() > 0;
+  if (!is_playable || semitone < 0 ||
+      semitone >= static_cast<int>(kSemitoneCount) || layer >= kMaxLayers ||
+      layers_[layer].samples_[semitone] == sample) {
+    return;
+  }
+
+  // Voices point into the sample being replaced, so they can't keep playing.
+  // This includes the voices of other notes that play it pitch-shifted.
+  // Voices of other layers hold the sample through their own layer
+  SampleBufferRef& replaced = layers_[layer].samples_[semitone];
+  size_t index = 0;
+  while (index < voices_.GetActiveCount()) {
+    const Voice& voice = voices_.GetActive(index);
+    if (voice.layer_ == layer && voice.sample_ == replaced.get()) {
+      voices_.Free(index);
+    } else {
+      index++;
+    }
+  }
+
+  PurgeRetiredSamples();
+  RetireSample(replaced);
+  replaced = sample;
+  if (sample->GetStreamSource()) {
+    streams_.Start();
+  }
+  MapZones(layer);
+}
+
+bool Sampler::UnloadSample(int semitone, size_t layer) {
+  if (semitone < 0 || semitone >= static_cast<int>(kSemitoneCount) ||
+      layer >= kMaxLayers) {
+    return true;
+  }
+  ApplySwaps();
+  PurgeRetiredSamples();
+  SampleBufferRef& sample = layers_[layer].samples_[semitone];
+  if (sample && (IsPlaying(sample.get()) ||
+                 streams_.IsReading(sample->GetStreamSource().get()))) {
+    return false;
+  }
+  sample = nullptr;
+  MapZones(layer);
+  return true;
+}
+
+void Sampler::SetLayerRange(size_t layer, int lowest_semitone,
+                            int highest_semitone) {
+  if (layer < kMaxLayers) {
+    layers_[layer].lowest_semitone_ = lowest_semitone;
+    layers_[layer].highest_semitone_ = highest_semitone;
+  }
+}
+
+void Sampler::SetLayerGain(size_t layer, float gain) {
+  if (layer < kMaxLayers) {
+    layers_[layer].gain_ = std::min(std::max(gain, 0.0f), 1.0f);
+  }
+}
+
+float Sampler::GetLayerGain(size_t layer) const {
+  return layer < kMaxLayers ? layers_[layer].gain_ : 0.0f;
+}
+
+void Sampler::SetMaxPitchShift(int max_shift) {
+  max_pitch_shift_ = std::min(std::max(max_shift, 0), kMaxPitchShift);
+  for (size_t layer = 0; layer < kMaxLayers; layer++) {
+    MapZones(layer);
+  }
+}
+
+bool Sampler::IsSounding(int semitone) const {
+  for (size_t index = 0; index < voices_.GetActiveCount(); index++) {
+    if (voices_.GetActive(index).semitone_ == semitone) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Sampler::PostEvent(const NoteEvent& event) {
+  return events_.TryPush(event);
+}
+
+bool Sampler::PostEvents(const NoteEvent* events, size_t count) {
+  return events_.TryPushAll(events, count);
+}
+
+bool Sampler::PlaySequence(const std::vector<TimedNoteEvent>& events) {
+  std::unique_ptr<Sequence> sequence(new Sequence());
+  sequence->events_.reserve(events.size());
+  for (const TimedNoteEvent& timed_event : events) {
+    double time = std::max(timed_event.time_, 0.0);
+    uint64_t frame = static_cast<uint64_t>(std::llround(time * sample_rate_));
+    sequence->events_.push_back({frame, timed_event.event_});
+  }
+  std::stable_sort(
+      sequence->events_.begin(), sequence->events_.end(),
+      [](const ScheduledEvent& lhs, const ScheduledEvent& rhs) {
+        return lhs.frame_ < rhs.frame_;
+      });
+  return PublishSequence(std::move(sequence));
+}
+
+bool Sampler::StopSequence() {
+  return PublishSequence(std::unique_ptr<Sequence>(new Sequence()));
+}
+
+bool Sampler::IsPlayingSequence() const {
+  return is_sequence_playing_.load(std::memory_order_relaxed);
+}
+
+std::vector<NoteEvent> Sampler::TakeSequenceEvents() {
+  Sequence* sequence;
+  while (retired_sequences_.TryPop(sequence)) {
+    delete sequence;
+    pending_sequence_count_--;
+  }
+
+  std::vector<NoteEvent> events;
+  sequence_events_.Drain(
+      [&events](const NoteEvent& event) { events.push_back(event); });
+  return events;
+}
+
+void Sampler::SetPolyphony(size_t polyphony) {
+  voices_.SetPolyphony(polyphony);
+}
+
+void Sampler::SetStealPolicy(StealPolicy steal_policy) {
+  voices_.SetStealPolicy(steal_policy);
+}
+
+void Sampler::SetAttackDuration(double attack_duration) {
+  attack_duration_ = std::max(attack_duration, 0.0);
+}
+
+void Sampler::SetReverb(const ConvolutionReverbRef& reverb) {
+  reverb_ = reverb;
+}
+
+const ConvolutionReverbRef& Sampler::GetReverb() const {
+  return reverb_;
+}
+
+void Sampler::SetRenderThreadCount(size_t thread_count) {
+  thread_count = std::min(std::max<size_t>(thread_count, 1), kMaxRenderThreads);
+  if (thread_count == GetRenderThreadCount()) {
+    return;
+  }
+
+  SwapRenderWorkers(MakeRenderWorkers(thread_count));
+}
+
+std::unique_ptr<RenderWorkers> Sampler::MakeRenderWorkers(
+    size_t thread_count) {
+  thread_count = std::min(std::max<size_t>(thread_count, 1), kMaxRenderThreads);
+  std::unique_ptr<RenderWorkers> workers;
+  if (thread_count > 1) {
+    workers.reset(new RenderWorkers(
+        thread_count - 1, [this](size_t chunk) { MixChunk(chunk); }));
+  }
+  return workers;
+}
+
+std::unique_ptr<RenderWorkers> Sampler::SwapRenderWorkers(
+    std::unique_ptr<RenderWorkers> workers) {
+  render_workers_.swap(workers);
+  return workers;
+}
+
+size_t Sampler::GetRenderThreadCount() const {
+  return render_workers_ ? render_workers_->GetWorkerCount() + 1 : 1;
+}
+
+void Sampler::Render(float* output, size_t num_channels,
+                     size_t num_frames) noexcept {
+  RealtimeGuard guard;
+  uint64_t render_time = LatencyHistogram::Now();
+
+  // Apply everything posted before this block, so events posted together are
+  // heard together
+  ApplySwaps();
+  events_.Drain([this](const NoteEvent& event) { HandleEvent(event); });
+  ApplySequences();
+
+  std::fill(output, output + num_channels * num_frames, 0.0f);
+
+  // Voices may only read kMaxBlockFrames past the end of their samples, so
+  // longer blocks are rendered in pieces. Pieces also end on the frame of
+  // every event of the performance, which is applied before that frame is
+  // rendered. Each piece is timed as if the buffer started playing when
+  // Render() was called
+  size_t offset = 0;
+  while (offset < num_frames) {
+    size_t block_frames = ApplySequenceEvents(
+        std::min(kMaxBlockFrames, num_frames - offset));
+    uint64_t block_time =
+        render_time + static_cast<uint64_t>(offset * kNanosecondsPerSecond /
+                                            sample_rate_);
+    RenderBlock(output + offset, num_channels, num_frames, block_frames,
+                block_time);
+    offset += block_frames;
+  }
+
+  if (reverb_) {
+    reverb_->Process(output, num_channels, num_frames);
+  }
+
+  uint64_t busy_time = LatencyHistogram::Now() - render_time;
+  uint64_t budget_time =
+      static_cast<uint64_t>(num_frames * kNanosecondsPerSecond / sample_rate_);
+  load_meter_.Record(busy_time, budget_time);
+}
+
+size_t Sampler::GetActiveVoiceCount() const {
+  return voices_.GetActiveCount();
+}
+
+size_t Sampler::GetStolenVoiceCount() const {
+  return voices_.GetStolenCount();
+}
+
+uint64_t Sampler::GetStreamUnderrunCount() const {
+  return streams_.GetUnderrunCount();
+}
+
+LatencyHistogram& Sampler::GetLatencyHistogram() {
+  return latencies_;
+}
+
+LoadMeter& Sampler::GetLoadMeter() {
+  return load_meter_;
+}
+
+void Sampler::ApplySwaps() {
+  SampleSet* set;
+  while (pending_sets_.TryPop(set)) {
+    // Only one set of replaced samples is played per layer, so voices of the
+    // layer still fading from an earlier swap are stopped. Other layers keep
+    // fading
+    SampleSet*& fading_set = fading_sets_[set->layer_];
+    if (fading_set) {
+      size_t index = 0;
+      while (index < voices_.GetActiveCount()) {
+        const Voice& voice = voices_.GetActive(index);
+        if (voice.semitone_ < 0 && voice.layer_ == set->layer_) {
+          voices_.Free(index);
+        } else {
+          index++;
+        }
+      }
+      retired_sets_.TryPush(fading_set);
+    }
+
+    // Sounding voices of the layer keep playing the replaced samples while
+    // they fade. They no longer belong to any note, so events for the new
+    // samples don't affect them
+    double fade_frames = set->crossfade_duration_ * sample_rate_;
+    for (size_t index = 0; index < voices_.GetActiveCount(); index++) {
+      Voice& voice = voices_.GetActive(index);
+      if (voice.layer_ != set->layer_) {
+        continue;
+      }
+      voice.semitone_ = -1;
+      voice.is_held_ = false;
+      voice.is_sustained_ = false;
+      voice.envelope_.FadeOut(fade_frames);
+    }
+
+    layers_[set->layer_].samples_.swap(set->samples_);
+    fading_set = set;
+    MapZones(set->layer_);
+  }
+
+  for (size_t layer = 0; layer < kMaxLayers; layer++) {
+    if (!fading_sets_[layer] || IsLayerFading(layer)) {
+      continue;
+    }
+
+    // Every fading voice of the layer is silent, so hand the replaced
+    // samples back to be destroyed off the audio thread
+    retired_sets_.TryPush(fading_sets_[layer]);
+    fading_sets_[layer] = nullptr;
+  }
+}
+
+bool Sampler::IsLayerFading(size_t layer) const {
+  for (size_t index = 0; index < voices_.GetActiveCount(); index++) {
+    const Voice& voice = voices_.GetActive(index);
+    if (voice.semitone_ < 0 && voice.layer_ == layer) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Sampler::PublishSequence(std::unique_ptr<Sequence> sequence) {
+  Sequence* retired;
+  while (retired_sequences_.TryPop(retired)) {
+    delete retired;
+    pending_sequence_count_--;
+  }
+  if (pending_sequence_count_ >= kMaxPendingSequences) {
+    return false;
+  }
+
+  // The queue holds kMaxPendingSequences performances, so this never fails
+  pending_sequence_count_++;
+  pending_sequences_.TryPush(sequence.release());
+  return true;
+}
+
+void Sampler::ApplySequences() {
+  Sequence* sequence;
+  while (pending_sequences_.TryPop(sequence)) {
+    // Notes held by an earlier performance are released even if it has
+    // ended, since they may still be sounding
+    ReleaseSequence();
+    if (sequence_) {
+      retired_sequences_.TryPush(sequence_);
+    }
+    sequence_ = sequence;
+    sequence_index_ = 0;
+    sequence_frame_ = 0;
+    is_sequence_playing_.store(!sequence->events_.empty(),
+                               std::memory_order_relaxed);
+  }
+}
+
+size_t Sampler::ApplySequenceEvents(size_t max_frames) {
+  if (!sequence_) {
+    return max_frames;
+  }
+
+  // Events on the same frame are applied together, so a dense chord only
+  // splits the block once
+  const std::vector<ScheduledEvent>& events = sequence_->events_;
+  while (sequence_index_ < events.size() &&
+         events[sequence_index_].frame_ <= sequence_frame_) {
+    ApplySequenceEvent(events[sequence_index_].event_);
+    sequence_index_++;
+  }
+
+  // Notes the performance leaves held keep sounding until the next
+  // performance starts or it is stopped
+  if (sequence_index_ == events.size()) {
+    retired_sequences_.TryPush(sequence_);
+    sequence_ = nullptr;
+    is_sequence_playing_.store(false, std::memory_order_relaxed);
+    return max_frames;
+  }
+
+  uint64_t next_frames = events[sequence_index_].frame_ - sequence_frame_;
+  size_t frames = max_frames;
+  if (next_frames < frames) {
+    frames = static_cast<size_t>(next_frames);
+  }
+  sequence_frame_ += frames;
+  return frames;
+}
+
+void Sampler::ApplySequenceEvent(const NoteEvent& event) {
+  bool is_note = event.semitone_ >= 0 &&
+                 event.semitone_ < static_cast<int>(kSemitoneCount);
+  switch (event.type_) {
+    case NoteEvent::Type::NoteOn:
+    case NoteEvent::Type::NoteOff:
+      if (is_note) {
+        sequence_notes_[event.semitone_] =
+            event.type_ == NoteEvent::Type::NoteOn;
+        // The events are only shown, so they are dropped if nobody takes them
+        sequence_events_.TryPush(event);
+      }
+      break;
+    case NoteEvent::Type::SustainOn:
+      is_sequence_sustain_down_ = true;
+      break;
+    case NoteEvent::Type::SustainOff:
+      is_sequence_sustain_down_ = false;
+      break;
+    case NoteEvent::Type::ResonateChange:
+      break;
+  }
+  HandleEvent(event);
+}
+
+void Sampler::ReleaseSequence() {
+  for (size_t semitone = 0; semitone < kSemitoneCount; semitone++) {
+    if (sequence_notes_[semitone]) {
+      ApplySequenceEvent(NoteEvent::NoteOff(static_cast<int>(semitone)));
+    }
+  }
+  if (is_sequence_sustain_down_) {
+    ApplySequenceEvent(NoteEvent::SustainOff());
+  }
+}
+
+void Sampler::MapZones(size_t layer) {
+  const std::vector<SampleBufferRef>& samples = layers_[layer].samples_;
+  auto has_sample = [&samples](int semitone) {
+    return semitone >= 0 && semitone < static_cast<int>(kSemitoneCount) &&
+           samples[semitone];
+  };
+  for (size_t semitone = 0; semitone < kSemitoneCount; semitone++) {
+    layers_[layer].zones_[semitone] = FindNearestSample(
+        static_cast<int>(semitone), max_pitch_shift_, has_sample);
+  }
+}
+
+bool Sampler::IsPlaying(const SampleBuffer* sample) const {
+  for (size_t index = 0; index < voices_.GetActiveCount(); index++) {
+    if (voices_.GetActive(index).sample_ == sample) {
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t Sampler::GetReadFrames(const Voice& voice, size_t num_frames) const {
+  if (voice.rate_ == 1) {
+    return num_frames;
+  }
+  double last_position =
+      voice.fraction_ + voice.rate_ * static_cast<double>(num_frames - 1);
+  return static_cast<size_t>(last_position) + 2;
+}
+
+void Sampler::HandleEvent(const NoteEvent& event) {
+  switch (event.type_) {
+    case NoteEvent::Type::NoteOn:
+      StartNote(event.semitone_, event.post_time_);
+      break;
+    case NoteEvent::Type::NoteOff:
+      ReleaseNote(event.semitone_);
+      break;
+    case NoteEvent::Type::ResonateChange:
+      ChangeResonateDuration(event.value_);
+      break;
+    case NoteEvent::Type::SustainOn:
+      is_sustain_down_ = true;
+      break;
+    case NoteEvent::Type::SustainOff:
+      ReleaseSustainedNotes();
+      break;
+  }
+}
+
+void Sampler::StartNote(int semitone, uint64_t post_time) {
+  if (semitone < 0 || semitone >= static_cast<int>(kSemitoneCount)) {
+    return;
+  }
+
+  // A held note is not struck again until it has been released
+  for (size_t index = 0; index < voices_.GetActiveCount(); index++) {
+    const Voice& voice = voices_.GetActive(index);
+    if (voice.semitone_ == semitone && voice.is_held_) {
+      return;
+    }
+  }
+
+  for (size_t layer = 0; layer < kMaxLayers; layer++) {
+    const Layer& note_layer = layers_[layer];
+    int sample_semitone = note_layer.zones_[semitone];
+    if (sample_semitone < 0 || semitone < note_layer.lowest_semitone_ ||
+        semitone > note_layer.highest_semitone_) {
+      continue;
+    }
+
+    const SampleBuffer* sample = note_layer.samples_[sample_semitone].get();
+    Voice& voice = voices_.Allocate();
+    voice.sample_ = sample;
+    voice.layer_ = layer;
+    voice.semitone_ = semitone;
+    voice.position_ = 0;
+    voice.envelope_.Start(attack_duration_ * sample_rate_);
+    voice.is_held_ = true;
+    voice.is_sustained_ = false;
+    voice.rate_ = GetPitchRate(semitone, sample_semitone);
+    voice.fraction_ = 0;
+    // A layered note is heard when its first voice is, so its latency is
+    // only measured once
+    voice.strike_time_ = post_time;
+    post_time = 0;
+
+    // The head is played from memory while the stream reads ahead from the
+    // end of the head. A stolen voice's stream is closed at the end of the
+    // block
+    voice.stream_ = -1;
+    if (sample->GetStreamSource()) {
+      voice.stream_ = streams_.Open(sample->GetStreamSource().get(),
+                                    sample->GetNumFrames());
+      if (voice.stream_ >= 0) {
+        stream_next_frames_[voice.stream_] = sample->GetNumFrames();
+      }
+    }
+  }
+}
+
+void Sampler::ReleaseNote(int semitone) {
+  for (size_t index = 0; index < voices_.GetActiveCount(); index++) {
+    Voice& voice = voices_.GetActive(index);
+    if (voice.semitone_ == semitone && voice.is_held_) {
+      voice.is_held_ = false;
+      if (is_sustain_down_) {
+        voice.is_sustained_ = true;
+      } else {
+        StartRelease(voice);
+      }
+    }
+  }
+}
+
+void Sampler::ReleaseSustainedNotes() {
+  is_sustain_down_ = false;
+  for (size_t index = 0; index < voices_.GetActiveCount(); index++) {
+    Voice& voice = voices_.GetActive(index);
+    if (voice.is_sustained_) {
+      voice.is_sustained_ = false;
+      StartRelease(voice);
+    }
+  }
+}
+
+void Sampler::ChangeResonateDuration(double resonate_duration) {
+  bool is_shorter = resonate_duration < resonate_duration_;
+  resonate_duration_ = resonate_duration;
+
+  // Only voices that are fading need to be updated, and only if they would
+  // otherwise keep resonating for longer than the new duration
+  if (is_shorter) {
+    for (size_t index = 0; index < voices_.GetActiveCount(); index++) {
+      Voice& voice = voices_.GetActive(index);
+      if (voice.envelope_.IsReleased()) {
+        voice.envelope_.FadeOut(resonate_duration_ * sample_rate_);
+      }
+    }
+  }
+}
+
+void Sampler::StartRelease(Voice& voice) const {
+  voice.envelope_.Release(resonate_duration_ * sample_rate_);
+}
+
+void Sampler::RetireSample(const SampleBufferRef& sample) {
+  if (sample && sample->GetStreamSource()) {
+    retired_samples_.push_back(sample);
+  }
+}
+
+void Sampler::PurgeRetiredSamples() {
+  auto is_unused = [this](const SampleBufferRef& sample) {
+    return !streams_.IsReading(sample->GetStreamSource().get());
+  };
+  retired_samples_.erase(std::remove_if(retired_samples_.begin(),
+                                        retired_samples_.end(), is_unused),
+                         retired_samples_.end());
+}
+
+void Sampler::ReadStream(const Voice& voice, size_t read_frames) {
+  const SampleBuffer* sample = voice.sample_;
+  const size_t kChannels = StreamSource::kMaxChannels;
+  float* frames =
+      stream_frames_.data() + voice.stream_ * kChannels * kMaxReadFrames;
+
+  // A block may start in the head and end in the streamed part
+  size_t head_frames = 0;
+  if (voice.position_ < sample->GetNumFrames()) {
+    head_frames = std::min(read_frames,
+                           sample->GetNumFrames() - voice.position_);
+  }
+  for (size_t channel = 0; channel < sample->GetNumChannels(); channel++) {
+    sample->CopyFrames(channel, voice.position_, head_frames,
+                       frames + channel * kMaxReadFrames);
+  }
+
+  // A pitch-shifted voice reads the frame after its block to interpolate,
+  // which is the first frame it reads in the next block. The stream has
+  // already consumed it, so it is kept from the previous block
+  size_t copied = head_frames;
+  size_t first_frame = voice.position_ + head_frames;
+  size_t& next_frame = stream_next_frames_[voice.stream_];
+  float* last_frames = stream_last_frames_.data() + voice.stream_ * kChannels;
+  if (copied < read_frames && first_frame < next_frame) {
+    for (size_t channel = 0; channel < sample->GetNumChannels(); channel++) {
+      frames[channel * kMaxReadFrames + copied] = last_frames[channel];
+    }
+    copied++;
+    first_frame++;
+  }
+  if (copied < read_frames) {
+    streams_.Consume(voice.stream_, first_frame, read_frames - copied,
+                     frames + copied, kMaxReadFrames);
+    next_frame = first_frame + read_frames - copied;
+    for (size_t channel = 0; channel < sample->GetNumChannels(); channel++) {
+      last_frames[channel] = frames[channel * kMaxReadFrames + read_frames - 1];
+    }
+  }
+}
+
+void Sampler::RecordLatencies(size_t first_voice, size_t last_voice,
+                              size_t num_frames, uint64_t block_time) {
+  for (size_t index = first_voice; index < last_voice; index++) {
+    Voice& voice = voices_.GetActive(index);
+    if (voice.strike_time_ == 0) {
+      continue;
+    }
+
+    // Voices that are still silent, such as samples with leading silence or
+    // a rising attack, are checked again in the next block
+    const MixSource& source = mix_sources_[index];
+    for (size_t frame = 0; frame < num_frames; frame++) {
+      float sample = source.pcm_samples_
+                         ? source.pcm_samples_[frame] * kPcmScale
+                         : source.samples_[frame];
+      float gain = source.gain_ + source.gain_step_ * static_cast<float>(frame);
+      if (sample * gain != 0.0f) {
+        uint64_t frame_time =
+            block_time + static_cast<uint64_t>(frame * kNanosecondsPerSecond /
+                                               sample_rate_);
+        latencies_.Record(frame_time > voice.strike_time_
+                              ? frame_time - voice.strike_time_
+                              : 0);
+        voice.strike_time_ = 0;
+        break;
+      }
+    }
+  }
+}
+
+void Sampler::RenderBlock(float* output, size_t num_channels,
+                          size_t channel_stride, size_t num_frames,
+                          uint64_t block_time) {
+  size_t voice_count = voices_.GetActiveCount();
+
+  // Voices past the head of a streamed sample read the block from their
+  // streams before mixing
+  for (size_t index = 0; index < voice_count; index++) {
+    const Voice& voice = voices_.GetActive(index);
+    if (voice.stream_ >= 0) {
+      stream_used_[voice.stream_] = 1;
+      size_t read_frames = GetReadFrames(voice, num_frames);
+      if (voice.position_ + read_frames > voice.sample_->GetNumFrames()) {
+        ReadStream(voice, read_frames);
+      }
+    }
+  }
+
+  // Dense blocks are split into a chunk of voices per thread
+  size_t chunk_count = 1;
+  if (render_workers_ && num_channels <= kMaxChunkChannels) {
+    chunk_count = std::min(GetRenderThreadCount(),
+                           voice_count / kMinChunkVoices);
+  }
+  if (chunk_count > 1) {
+    chunked_block_ = ChunkedBlock{output, num_channels, channel_stride,
+                                  num_frames, block_time, voice_count,
+                                  chunk_count};
+    render_workers_->Run(chunk_count);
+
+    // Chunks are added in order, whichever thread mixed them
+    for (size_t channel = 0; channel < num_channels; channel++) {
+      for (size_t chunk = 1; chunk < chunk_count; chunk++) {
+        const float* frames =
+            chunk_frames_.data() +
+            ((chunk - 1) * kMaxChunkChannels + channel) * kMaxBlockFrames;
+        chunk_sources_[chunk - 1] = MixSource{frames, 1.0f, 0.0f, nullptr};
+      }
+      MixVoices(chunk_sources_.data(), chunk_count - 1,
+                output + channel * channel_stride, num_frames);
+    }
+  } else {
+    MixVoiceRange(0, voice_count, output, num_channels, channel_stride,
+                  num_frames, block_time);
+  }
+
+  // Advance every voice past the block, freeing the voices that have finished
+  size_t index = 0;
+  while (index < voices_.GetActiveCount()) {
+    Voice& voice = voices_.GetActive(index);
+    voice.envelope_.Advance(num_frames);
+    double advance =
+        voice.fraction_ + voice.rate_ * static_cast<double>(num_frames);
+    size_t whole_frames = static_cast<size_t>(advance);
+    voice.position_ += whole_frames;
+    voice.fraction_ = advance - static_cast<double>(whole_frames);
+
+    // A voice is finished once its sample runs out or its release has
+    // reached silence. Voices without a stream stop at the end of the head
+    size_t end_frame = voice.stream_ >= 0 ? voice.sample_->GetTotalFrames()
+                                          : voice.sample_->GetNumFrames();
+    if (voice.position_ < end_frame && !voice.envelope_.IsFinished()) {
+      index++;
+    } else {
+      // The last active voice moves into this index, so don't advance
+      voices_.Free(index);
+    }
+  }
+
+  // Close the streams of voices that finished, were stolen or were stopped
+  if (streams_.IsStarted()) {
+    for (size_t stream = 0; stream < kMaxStreams; stream++) {
+      int stream_index = static_cast<int>(stream);
+      if (streams_.IsOpen(stream_index) && !stream_used_[stream]) {
+        streams_.Close(stream_index);
+      }
+      stream_used_[stream] = 0;
+    }
+  }
+}
+
+void Sampler::MixVoiceRange(size_t first_voice, size_t last_voice,
+                            float* output, size_t num_channels,
+                            size_t channel_stride, size_t num_frames,
+                            uint64_t block_time) {
+  // Mix one channel of every voice at a time. Mono samples are mixed into
+  // every channel, and pitch-shifted voices are resampled before mixing.
+  // 16-bit samples are converted as they are mixed or resampled
+  for (size_t channel = 0; channel < num_channels; channel++) {
+    for (size_t index = first_voice; index < last_voice; index++) {
+      const Voice& voice = voices_.GetActive(index);
+      const SampleBuffer* sample = voice.sample_;
+      size_t source_channel = std::min(channel, sample->GetNumChannels() - 1);
+      size_t read_frames = GetReadFrames(voice, num_frames);
+      float* shifted = shifted_frames_.data() + index * kMaxBlockFrames;
+      float gain = layers_[voice.layer_].gain_;
+      MixSource& source = mix_sources_[index];
+      source = MixSource{nullptr, gain * voice.envelope_.GetLevel(),
+                         gain * voice.envelope_.GetStep(), nullptr};
+
+      if (voice.stream_ >= 0 &&
+          voice.position_ + read_frames > sample->GetNumFrames()) {
+        source.samples_ = stream_frames_.data() +
+                          (voice.stream_ * StreamSource::kMaxChannels +
+                           source_channel) * kMaxReadFrames;
+        if (voice.rate_ != 1) {
+          Interpolate(source.samples_, 1.0f, read_frames, voice.fraction_,
+                      voice.rate_, shifted, num_frames);
+          source.samples_ = shifted;
+        }
+        continue;
+      }
+
+      size_t available = sample->GetNumFrames() +
+                         SampleBuffer::kPaddingFrames - voice.position_;
+      if (sample->GetFormat() == SampleFormat::Int16) {
+        const int16_t* samples =
+            sample->GetPcmChannel(source_channel) + voice.position_;
+        if (voice.rate_ != 1) {
+          Interpolate(samples, kPcmScale, available, voice.fraction_,
+                      voice.rate_, shifted, num_frames);
+          source.samples_ = shifted;
+        } else {
+          source.pcm_samples_ = samples;
+        }
+      } else {
+        const float* samples =
+            sample->GetChannel(source_channel) + voice.position_;
+        if (voice.rate_ != 1) {
+          Interpolate(samples, 1.0f, available, voice.fraction_, voice.rate_,
+                      shifted, num_frames);
+          samples = shifted;
+        }
+        source.samples_ = samples;
+      }
+    }
+    MixVoices(mix_sources_.data() + first_voice, last_voice - first_voice,
+              output + channel * channel_stride, num_frames);
+
+    // The first channel of every voice is enough to tell when it is heard
+    if (channel == 0) {
+      RecordLatencies(first_voice, last_voice, num_frames, block_time);
+    }
+  }
+}
+
+void Sampler::MixChunk(size_t chunk) {
+  const ChunkedBlock& block = chunked_block_;
+  size_t first_voice = chunk * block.voice_count_ / block.chunk_count_;
+  size_t last_voice = (chunk + 1) * block.voice_count_ / block.chunk_count_;
+  if (chunk == 0) {
+    MixVoiceRange(first_voice, last_voice, block.output_, block.num_channels_,
+                  block.channel_stride_, block.num_frames_,
+                  block.block_time_);
+    return;
+  }
+
+  float* frames =
+      chunk_frames_.data() + (chunk - 1) * kMaxChunkChannels * kMaxBlockFrames;
+  std::fill(frames, frames + block.num_channels_ * kMaxBlockFrames, 0.0f);
+  MixVoiceRange(first_voice, last_voice, frames, block.num_channels_,
+                kMaxBlockFrames, block.num_frames_, block.block_time_);
+}
+
+}  // namespace audio
+
+}  // namespace synther
@@ -0,0 +1,154 @@
+#include "core/sampler_node.h"
+
+#include <mutex>
+
+#include "cinder/audio/Context.h"
+
+namespace synther {
+
+namespace audio {
+
+SamplerNode::SamplerNode(double resonate_duration, const Format& format)
+    : ci::audio::InputNode(format), sampler_(resonate_duration) {
+}
+
+void SamplerNode::SetSamples(const std::map<int, SampleBufferRef>& samples,
+                             size_t layer) {
+  std::lock_guard<std::mutex> lock(getContext()->getMutex());
+  sampler_.SetSamples(samples, layer);
+}
+
+bool SamplerNode::SwapSamples(const std::map<int, SampleBufferRef>& samples,
+                              double crossfade_duration, size_t layer) {
+  return sampler_.SwapSamples(samples, crossfade_duration, layer);
+}
+
+void SamplerNode::CollectRetiredSamples() {
+  sampler_.CollectRetiredSamples();
+}
+
+void SamplerNode::AddSamples(const std::map<int, SampleBufferRef>& samples,
+                             size_t layer) {
+  std::lock_guard<std::mutex> lock(getContext()->getMutex());
+  for (const auto& sample_pair : samples) {
+    sampler_.AddSample(sample_pair.first, sample_pair.second, layer);
+  }
+}
+
+std::vector<int> SamplerNode::UnloadSamples(const std::vector<int>& semitones,
+                                            size_t layer) {
+  std::vector<int> unloaded;
+  std::lock_guard<std::mutex> lock(getContext()->getMutex());
+  for (int semitone : semitones) {
+    if (sampler_.UnloadSample(semitone, layer)) {
+      unloaded.push_back(semitone);
+    }
+  }
+  return unloaded;
+}
+
+void SamplerNode::SetLayerRange(size_t layer, int lowest_semitone,
+                                int highest_semitone) {
+  std::lock_guard<std::mutex> lock(getContext()->getMutex());
+  sampler_.SetLayerRange(layer, lowest_semitone, highest_semitone);
+}
+
+void SamplerNode::SetLayerGain(size_t layer, float gain) {
+  std::lock_guard<std::mutex> lock(getContext()->getMutex());
+  sampler_.SetLayerGain(layer, gain);
+}
+
+void SamplerNode::SetMaxPitchShift(int max_shift) {
+  std::lock_guard<std::mutex> lock(getContext()->getMutex());
+  sampler_.SetMaxPitchShift(max_shift);
+}
+
+bool SamplerNode::PostEvent(const NoteEvent& event) {
+  return sampler_.PostEvent(event);
+}
+
+bool SamplerNode::PostEvents(const NoteEvent* events, size_t count) {
+  return sampler_.PostEvents(events, count);
+}
+
+bool SamplerNode::PlaySequence(const std::vector<TimedNoteEvent>& events) {
+  return sampler_.PlaySequence(events);
+}
+
+bool SamplerNode::StopSequence() {
+  return sampler_.StopSequence();
+}
+
+bool SamplerNode::IsPlayingSequence() const {
+  return sampler_.IsPlayingSequence();
+}
+
+std::vector<NoteEvent> SamplerNode::TakeSequenceEvents() {
+  return sampler_.TakeSequenceEvents();
+}
+
+void SamplerNode::SetPolyphony(size_t polyphony) {
+  std::lock_guard<std::mutex> lock(getContext()->getMutex());
+  sampler_.SetPolyphony(polyphony);
+}
+
+void SamplerNode::SetStealPolicy(StealPolicy steal_policy) {
+  std::lock_guard<std::mutex> lock(getContext()->getMutex());
+  sampler_.SetStealPolicy(steal_policy);
+}
+
+void SamplerNode::SetAttackDuration(double attack_duration) {
+  std::lock_guard<std::mutex> lock(getContext()->getMutex());
+  sampler_.SetAttackDuration(attack_duration);
+}
+
+void SamplerNode::SetRenderThreadCount(size_t thread_count) {
+  if (thread_count == sampler_.GetRenderThreadCount()) {
+    return;
+  }
+
+  // The workers are started before the lock is taken, and the replaced ones
+  // are stopped after it is released, so the audio thread never waits for
+  // threads to start or join
+  std::unique_ptr<RenderWorkers> workers =
+      sampler_.MakeRenderWorkers(thread_count);
+  {
+    std::lock_guard<std::mutex> lock(getContext()->getMutex());
+    workers = sampler_.SwapRenderWorkers(std::move(workers));
+  }
+}
+
+void SamplerNode::SetReverb(const ConvolutionReverbRef& reverb) {
+  // The replaced reverb is destroyed once the lock is released, so the audio
+  // thread doesn't wait for its tail thread to stop
+  ConvolutionReverbRef previous = sampler_.GetReverb();
+  std::lock_guard<std::mutex> lock(getContext()->getMutex());
+  sampler_.SetReverb(reverb);
+}
+
+uint64_t SamplerNode::GetStreamUnderrunCount() const {
+  // The counter is atomic, so the audio thread doesn't need to be locked out
+  return sampler_.GetStreamUnderrunCount();
+}
+
+LatencyHistogram& SamplerNode::GetLatencyHistogram() {
+  // The histogram is atomic, so the audio thread doesn't need to be locked out
+  return sampler_.GetLatencyHistogram();
+}
+
+LoadMeter& SamplerNode::GetLoadMeter() {
+  return sampler_.GetLoadMeter();
+}
+
+void SamplerNode::initialize() {
+  sampler_.SetSampleRate(getSampleRate());
+}
+
+void SamplerNode::process(ci::audio::Buffer* buffer) {
+  sampler_.Render(buffer->getData(), buffer->getNumChannels(),
+                  buffer->getNumFrames());
+}
+
+}  // namespace audio
+
+}  // namespace synther
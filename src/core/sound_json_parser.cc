@@ -77,8 +77,7 @@ std::vector<music::Note> SoundJsonParser::GetNotes() const {
   return notes;
 }
 
-music::Note SoundJsonParser::ParseNoteString(
-    const std::string& note_string) const {
+music::Note SoundJsonParser::ParseNoteString(const std::string& note_string) {
   if (note_string.length() < 2) {
     throw std::invalid_argument("note_string does not represent a valid note");
   }
@@ -0,0 +1,224 @@
+#include "core/stream_pool.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace synther {
+
+namespace audio {
+
+constexpr size_t StreamPool::kChunkFrames;
+constexpr int StreamPool::kIdleSleepMicroseconds;
+
+StreamPool::StreamPool(size_t num_streams, size_t ring_frames)
+    : ring_frames_(2 * kChunkFrames),
+      underrun_count_(0),
+      is_stopping_(false),
+      is_started_(false) {
+  // Ring positions are found by masking, so the size is a power of two
+  while (ring_frames_ < ring_frames) {
+    ring_frames_ *= 2;
+  }
+
+  for (size_t index = 0; index < num_streams; index++) {
+    std::unique_ptr<Stream> stream(new Stream());
+    stream->state_.store(kFree);
+    stream->source_.store(nullptr);
+    stream->read_frame_.store(0);
+    stream->write_frame_.store(0);
+    stream->is_open_ = false;
+    streams_.push_back(std::move(stream));
+  }
+}
+
+StreamPool::~StreamPool() {
+  is_stopping_.store(true);
+  if (io_thread_.joinable()) {
+    io_thread_.join();
+  }
+}
+
+void StreamPool::Start() {
+  if (IsStarted()) {
+    return;
+  }
+
+  for (auto& stream : streams_) {
+    stream->ring_.assign(StreamSource::kMaxChannels * ring_frames_, 0.0f);
+  }
+  io_thread_ = std::thread(&StreamPool::Run, this);
+  is_started_.store(true, std::memory_order_release);
+}
+
+bool StreamPool::IsStarted() const {
+  return is_started_.load(std::memory_order_acquire);
+}
+
+int StreamPool::Open(const StreamSource* source, size_t first_frame) {
+  if (IsStarted()) {
+    for (size_t index = 0; index < streams_.size(); index++) {
+      Stream& stream = *streams_[index];
+      if (!stream.is_open_ &&
+          stream.state_.load(std::memory_order_acquire) == kFree) {
+        stream.source_.store(source, std::memory_order_relaxed);
+        stream.read_frame_.store(first_frame, std::memory_order_relaxed);
+        stream.write_frame_.store(first_frame, std::memory_order_relaxed);
+        stream.is_open_ = true;
+        // Publishes the source and positions to the I/O thread
+        stream.state_.store(kOpening, std::memory_order_release);
+        return static_cast<int>(index);
+      }
+    }
+  }
+
+  // The voice will fall silent at the end of its head
+  underrun_count_.fetch_add(1, std::memory_order_relaxed);
+  return -1;
+}
+
+bool StreamPool::Consume(int stream_index, size_t first_frame,
+                         size_t num_frames, float* output,
+                         size_t output_stride) {
+  Stream& stream = *streams_[stream_index];
+  const StreamSource* source =
+      stream.source_.load(std::memory_order_relaxed);
+  size_t write_frame = stream.write_frame_.load(std::memory_order_acquire);
+
+  // Frames past the end of the sample are silent, and frames the I/O thread
+  // has not reached yet are silenced
+  size_t sample_end = std::min(first_frame + num_frames,
+                               source->GetNumFrames());
+  size_t available_end = std::max(std::min(sample_end, write_frame),
+                                  first_frame);
+  size_t available = available_end - first_frame;
+  size_t mask = ring_frames_ - 1;
+
+  for (size_t channel = 0; channel < source->GetNumChannels(); channel++) {
+    const float* ring = stream.ring_.data() + channel * ring_frames_;
+    float* channel_output = output + channel * output_stride;
+
+    // Copy the available frames in at most two runs around the end of the
+    // ring
+    size_t ring_position = first_frame & mask;
+    size_t first_run = std::min(available, ring_frames_ - ring_position);
+    std::copy(ring + ring_position, ring + ring_position + first_run,
+              channel_output);
+    std::copy(ring, ring + (available - first_run),
+              channel_output + first_run);
+    std::fill(channel_output + available, channel_output + num_frames, 0.0f);
+  }
+
+  // The consumed frames may now be overwritten
+  stream.read_frame_.store(first_frame + num_frames,
+                           std::memory_order_release);
+
+  bool is_complete = available_end >= sample_end;
+  if (!is_complete) {
+    underrun_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+  return is_complete;
+}
+
+void StreamPool::Close(int stream_index) {
+  Stream& stream = *streams_[stream_index];
+  stream.is_open_ = false;
+  stream.state_.store(kClosing, std::memory_order_release);
+}
+
+bool StreamPool::IsOpen(int stream_index) const {
+  return streams_[stream_index]->is_open_;
+}
+
+bool StreamPool::IsReading(const StreamSource* source) const {
+  // The state is loaded first, so a stream that isn't free is seen with the
+  // source it was opened with
+  for (const auto& stream : streams_) {
+    if (stream->state_.load(std::memory_order_acquire) != kFree &&
+        stream->source_.load(std::memory_order_relaxed) == source) {
+      return true;
+    }
+  }
+  return false;
+}
+
+uint64_t StreamPool::GetUnderrunCount() const {
+  return underrun_count_.load(std::memory_order_relaxed);
+}
+
+size_t StreamPool::GetNumStreams() const {
+  return streams_.size();
+}
+
+void StreamPool::Run() {
+  while (!is_stopping_.load()) {
+    bool has_filled = false;
+    for (auto& stream_pointer : streams_) {
+      Stream& stream = *stream_pointer;
+      int state = stream.state_.load(std::memory_order_acquire);
+
+      if (state == kOpening) {
+        stream.file_.open(
+            stream.source_.load(std::memory_order_relaxed)->GetPath(),
+            std::ios::binary);
+        // Fails if the audio thread closed the stream in the meantime, which
+        // is handled on the next pass
+        stream.state_.compare_exchange_strong(state, kStreaming,
+                                              std::memory_order_acq_rel);
+      }
+      if (state == kOpening || state == kStreaming) {
+        has_filled = Fill(stream) || has_filled;
+      } else if (state == kClosing) {
+        stream.file_.close();
+        stream.file_.clear();
+        stream.state_.store(kFree, std::memory_order_release);
+      }
+    }
+
+    if (!has_filled) {
+      std::this_thread::sleep_for(
+          std::chrono::microseconds(kIdleSleepMicroseconds));
+    }
+  }
+}
+
+bool StreamPool::Fill(Stream& stream) {
+  const StreamSource* source = stream.source_.load(std::memory_order_relaxed);
+  size_t read_frame = stream.read_frame_.load(std::memory_order_acquire);
+  size_t write_frame = stream.write_frame_.load(std::memory_order_relaxed);
+
+  // After an underrun the audio thread has moved past the streamed frames,
+  // so skip ahead to where it is reading
+  write_frame = std::max(write_frame, read_frame);
+
+  size_t free_frames = read_frame + ring_frames_ - write_frame;
+  size_t remaining = source->GetNumFrames() - std::min(write_frame,
+                                                       source->GetNumFrames());
+  size_t chunk = std::min(kChunkFrames, remaining);
+  if (chunk == 0 || free_frames < chunk || !stream.file_.is_open()) {
+    return false;
+  }
+
+  size_t mask = ring_frames_ - 1;
+  size_t ring_position = write_frame & mask;
+  size_t first_run = std::min(chunk, ring_frames_ - ring_position);
+  for (size_t channel = 0; channel < source->GetNumChannels(); channel++) {
+    float* ring = stream.ring_.data() + channel * ring_frames_;
+    // A file that can't be read plays as silence rather than stale frames
+    if (!source->Read(stream.file_, channel, write_frame, first_run,
+                      ring + ring_position)) {
+      std::fill(ring + ring_position, ring + ring_position + first_run, 0.0f);
+    }
+    if (!source->Read(stream.file_, channel, write_frame + first_run,
+                      chunk - first_run, ring)) {
+      std::fill(ring, ring + (chunk - first_run), 0.0f);
+    }
+  }
+
+  // Publishes the new frames to the audio thread
+  stream.write_frame_.store(write_frame + chunk, std::memory_order_release);
+  return true;
+}
+
+}  // namespace audio
+
+}  // namespace synther
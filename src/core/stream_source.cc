@@ -0,0 +1,69 @@
+#include "core/stream_source.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "core/mix_kernel.h"
+#include "core/sample_buffer.h"
+
+namespace synther {
+
+namespace audio {
+
+constexpr size_t StreamSource::kMaxChannels;
+
+StreamSource::StreamSource(const std::string& path, size_t data_offset,
+                           size_t num_channels, size_t num_frames,
+                           SampleFormat format)
+    : path_(path),
+      data_offset_(data_offset),
+      num_channels_(num_channels),
+      num_frames_(num_frames),
+      format_(format) {
+}
+
+bool StreamSource::Read(std::istream& file, size_t channel,
+                        size_t first_frame, size_t num_frames,
+                        float* output) const {
+  size_t sample_size = SampleBuffer::GetSampleSize(format_);
+  size_t channel_stride = num_frames_ + SampleBuffer::kPaddingFrames;
+  size_t offset =
+      data_offset_ + (channel * channel_stride + first_frame) * sample_size;
+  std::streamsize size =
+      static_cast<std::streamsize>(num_frames * sample_size);
+
+  file.clear();
+  file.seekg(static_cast<std::streamoff>(offset));
+  file.read(reinterpret_cast<char*>(output), size);
+  if (file.gcount() != size) {
+    return false;
+  }
+
+  // 16-bit samples are read into the front of the output, and widened from
+  // the back so no sample is overwritten before it is converted
+  if (format_ == SampleFormat::Int16) {
+    const char* bytes = reinterpret_cast<const char*>(output);
+    for (size_t frame = num_frames; frame > 0; frame--) {
+      int16_t pcm;
+      std::memcpy(&pcm, bytes + (frame - 1) * sizeof(pcm), sizeof(pcm));
+      output[frame - 1] = pcm * kPcmScale;
+    }
+  }
+  return true;
+}
+
+const std::string& StreamSource::GetPath() const {
+  return path_;
+}
+
+size_t StreamSource::GetNumChannels() const {
+  return num_channels_;
+}
+
+size_t StreamSource::GetNumFrames() const {
+  return num_frames_;
+}
+
+}  // namespace audio
+
+}  // namespace synther
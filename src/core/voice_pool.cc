@@ -0,0 +1,177 @@
+#include "core/voice_pool.h"
+
+#include <algorithm>
+
+namespace synther {
+
+namespace audio {
+
+VoicePool::VoicePool(size_t capacity, size_t polyphony,
+                     StealPolicy steal_policy, size_t fade_capacity)
+    : voices_(std::max<size_t>(capacity, 1) + fade_capacity,
+              Voice{nullptr, 0, 0, 0, Envelope(), false, false, false, 0, -1,
+                    1, 0, 0}),
+      capacity_(std::max<size_t>(capacity, 1)),
+      steal_policy_(steal_policy),
+      steal_fade_frames_(0),
+      next_order_(0),
+      stolen_count_(0),
+      fading_count_(0) {
+  // Every voice starts out free. Reserve the active list up front so that
+  // activating voices never reallocates
+  free_voices_.reserve(voices_.size());
+  active_voices_.reserve(voices_.size());
+  for (size_t index = voices_.size(); index > 0; index--) {
+    free_voices_.push_back(index - 1);
+  }
+
+  SetPolyphony(polyphony);
+}
+
+void VoicePool::SetPolyphony(size_t polyphony) {
+  polyphony_ = std::min(std::max<size_t>(polyphony, 1), capacity_);
+
+  while (active_voices_.size() - fading_count_ > polyphony_) {
+    Steal();
+  }
+}
+
+size_t VoicePool::GetPolyphony() const {
+  return polyphony_;
+}
+
+void VoicePool::SetStealPolicy(StealPolicy steal_policy) {
+  steal_policy_ = steal_policy;
+}
+
+void VoicePool::SetStealFade(double fade_frames) {
+  steal_fade_frames_ = fade_frames;
+}
+
+Voice& VoicePool::Allocate() {
+  if (active_voices_.size() - fading_count_ >= polyphony_) {
+    Steal();
+  }
+
+  // Once every reserved voice is fading, the quietest of them is cut off
+  if (free_voices_.empty()) {
+    Free(FindFadingVoice());
+  }
+
+  size_t voice_index = free_voices_.back();
+  free_voices_.pop_back();
+  active_voices_.push_back(voice_index);
+
+  Voice& voice = voices_[voice_index];
+  voice.order_ = next_order_++;
+  voice.is_stolen_ = false;
+  return voice;
+}
+
+void VoicePool::Free(size_t active_index) {
+  if (voices_[active_voices_[active_index]].is_stolen_) {
+    fading_count_--;
+  }
+  free_voices_.push_back(active_voices_[active_index]);
+
+  // Swap the freed voice with the last one to remove it in O(1)
+  active_voices_[active_index] = active_voices_.back();
+  active_voices_.pop_back();
+}
+
+void VoicePool::Clear() {
+  while (!active_voices_.empty()) {
+    Free(active_voices_.size() - 1);
+  }
+}
+
+size_t VoicePool::GetActiveCount() const {
+  return active_voices_.size();
+}
+
+Voice& VoicePool::GetActive(size_t active_index) {
+  return voices_[active_voices_[active_index]];
+}
+
+const Voice& VoicePool::GetActive(size_t active_index) const {
+  return voices_[active_voices_[active_index]];
+}
+
+size_t VoicePool::GetStolenCount() const {
+  return stolen_count_;
+}
+
+void VoicePool::Steal() {
+  size_t active_index = FindVoiceToSteal();
+  stolen_count_++;
+  if (steal_fade_frames_ < 1) {
+    Free(active_index);
+    return;
+  }
+
+  // The voice no longer belongs to its note, so it isn't released again or
+  // held by the pedal while it fades
+  Voice& voice = voices_[active_voices_[active_index]];
+  voice.is_stolen_ = true;
+  voice.is_held_ = false;
+  voice.is_sustained_ = false;
+  voice.envelope_.FadeOut(steal_fade_frames_);
+  fading_count_++;
+}
+
+size_t VoicePool::FindVoiceToSteal() const {
+  // Voices that are already fading out can't be stolen again
+  size_t steal_index = active_voices_.size();
+  for (size_t index = 0; index < active_voices_.size(); index++) {
+    const Voice& candidate = voices_[active_voices_[index]];
+    if (candidate.is_stolen_) {
+      continue;
+    }
+    if (steal_index == active_voices_.size()) {
+      steal_index = index;
+      continue;
+    }
+    const Voice& current = voices_[active_voices_[steal_index]];
+
+    // Released voices are always stolen before held voices
+    if (candidate.is_held_ != current.is_held_) {
+      if (!candidate.is_held_) {
+        steal_index = index;
+      }
+      continue;
+    }
+
+    bool is_better = false;
+    switch (steal_policy_) {
+      case StealPolicy::Oldest:
+        is_better = candidate.order_ < current.order_;
+        break;
+      case StealPolicy::Quietest:
+        is_better = candidate.envelope_.GetLevel() <
+                    current.envelope_.GetLevel();
+        break;
+    }
+    if (is_better) {
+      steal_index = index;
+    }
+  }
+  return steal_index;
+}
+
+size_t VoicePool::FindFadingVoice() const {
+  size_t fading_index = active_voices_.size();
+  for (size_t index = 0; index < active_voices_.size(); index++) {
+    const Voice& candidate = voices_[active_voices_[index]];
+    if (candidate.is_stolen_ &&
+        (fading_index == active_voices_.size() ||
+         candidate.envelope_.GetLevel() <
+             voices_[active_voices_[fading_index]].envelope_.GetLevel())) {
+      fading_index = index;
+    }
+  }
+  return fading_index;
+}
+
+}  // namespace audio
+
+}  // namespace synther
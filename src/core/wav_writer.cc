@@ -0,0 +1,59 @@
+#include "core/wav_writer.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace synther {
+
+namespace audio {
+
+namespace {
+
+// WAV files are little-endian regardless of the platform
+void WriteLittleEndian(std::ostream& out, uint32_t value, size_t byte_count) {
+  for (size_t byte = 0; byte < byte_count; byte++) {
+    out.put(static_cast<char>((value >> (8 * byte)) & 0xFF));
+  }
+}
+
+const uint16_t kIeeeFloatFormat = 3;
+const uint16_t kBitsPerSample = 32;
+const uint32_t kFormatChunkSize = 16;
+// Size of the RIFF header fields that follow the RIFF chunk size
+const uint32_t kHeaderSize = 4 + (8 + kFormatChunkSize) + 8;
+
+}  // namespace
+
+void WriteWav(std::ostream& out, const std::vector<float>& interleaved_samples,
+              size_t num_channels, size_t sample_rate) {
+  uint32_t bytes_per_frame =
+      static_cast<uint32_t>(num_channels * kBitsPerSample / 8);
+  uint32_t data_size =
+      static_cast<uint32_t>(interleaved_samples.size() * kBitsPerSample / 8);
+
+  out.write("RIFF", 4);
+  WriteLittleEndian(out, kHeaderSize + data_size, 4);
+  out.write("WAVE", 4);
+
+  out.write("fmt ", 4);
+  WriteLittleEndian(out, kFormatChunkSize, 4);
+  WriteLittleEndian(out, kIeeeFloatFormat, 2);
+  WriteLittleEndian(out, static_cast<uint32_t>(num_channels), 2);
+  WriteLittleEndian(out, static_cast<uint32_t>(sample_rate), 4);
+  WriteLittleEndian(out, static_cast<uint32_t>(sample_rate) * bytes_per_frame,
+                    4);
+  WriteLittleEndian(out, bytes_per_frame, 2);
+  WriteLittleEndian(out, kBitsPerSample, 2);
+
+  out.write("data", 4);
+  WriteLittleEndian(out, data_size, 4);
+  for (float sample : interleaved_samples) {
+    uint32_t bits;
+    std::memcpy(&bits, &sample, sizeof(bits));
+    WriteLittleEndian(out, bits, 4);
+  }
+}
+
+}  // namespace audio
+
+}  // namespace synther
@@ -1,9 +1,18 @@
 #include "visualizer/synther_app.h"
 
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
 #include <string>
 
 #include "cinder/gl/gl.h"
+#include "core/midi_file_parser.h"
 #include "core/music_note.h"
+#include "core/parallel_for.h"
 #include "core/sound_json_parser.h"
 
 namespace synther {
@@ -14,12 +23,24 @@ SyntherApp::SyntherApp()
     : piano_(glm::dvec2(kSidePadding, kTopPadding + kInstrumentTextHeight +
                                           kInstrumentTextPadding),
              kWindowWidth - 2 * kSidePadding, kPianoHeight),
-      player_(kStandardResonation) {
+      player_(kStandardResonation, kPolyphony, audio::StealPolicy::Oldest),
+      instrument_cache_(kInstrumentCacheBudget),
+      loading_layer_(0) {
   ci::app::setWindowSize((int)kWindowWidth, (int)kWindowHeight);
 }
 
 void SyntherApp::setup() {
-  // Set up instrument, keyboard, and keybinds
+  // Set up instrument, keyboard, and keybinds. The instrument is loaded in
+  // the background, and notes are loaded as the view reaches them
+  player_.SetLazyLoading(true, kNeighborOctaves);
+  player_.SetStreaming(kStreamHeadDuration);
+  player_.SetSampleStride(kSampleStride);
+  player_.SetStorage(kSampleFormat, kIsDownmixed);
+  size_t render_thread_count = audio::GetHardwareThreadCount();
+  if (render_thread_count > kMaxRenderThreads) {
+    render_thread_count = kMaxRenderThreads;
+  }
+  player_.SetRenderThreadCount(render_thread_count);
   SetupInstrument(kDefaultSoundJson);
 
   // Setup sustain pedal
@@ -31,6 +52,48 @@ void SyntherApp::setup() {
                          secondary, kSustainPedalLabel, kMainFontName);
 }
 
+void SyntherApp::update() {
+  // Switch to an instrument that finished loading in the background
+  if (loading_instrument_.valid() &&
+      loading_instrument_.wait_for(std::chrono::seconds(0)) ==
+          std::future_status::ready) {
+    audio::InstrumentRef instrument = loading_instrument_.get();
+    if (instrument) {
+      // Samples decoded for a cached instrument are merged on this thread,
+      // since the instrument may be playing. It is inserted again, since it
+      // may have grown
+      instrument->samples_.insert(loading_samples_.begin(),
+                                  loading_samples_.end());
+      instrument_cache_.Insert(loading_directory_, instrument);
+      if (loading_layer_ == 0) {
+        SwitchInstrument(instrument);
+      } else {
+        SetInstrumentLayer(loading_layer_, instrument);
+      }
+    }
+  }
+
+  // Play a MIDI file once its notes are decoded. Samples decoded for an
+  // instrument that has since been switched away from are dropped
+  if (loading_sequence_.valid() &&
+      loading_sequence_.wait_for(std::chrono::seconds(0)) ==
+          std::future_status::ready) {
+    std::map<int, audio::SampleBufferRef> samples = loading_sequence_.get();
+    if (player_.GetInstrument() != sequence_instrument_) {
+      samples.clear();
+    }
+    player_.PlaySequence(loading_events_, samples);
+    loading_events_.clear();
+    sequence_instrument_ = nullptr;
+  }
+
+  player_.Update();
+  ShowSequenceNotes();
+
+  // Lazily loaded notes grow the current instrument
+  instrument_cache_.Trim();
+}
+
 void SyntherApp::draw() {
   ci::Color8u background_color(ci::Color(kBackgroundColor.c_str()));
   ci::gl::clear(background_color);
@@ -41,6 +104,67 @@ void SyntherApp::draw() {
       instrument_, instrument_text_center, kInstrumentTextColor,
       ci::Font(kInstrumentFontName, kInstrumentTextHeight));
 
+  // Draw loading indicator while the previous instrument is still playing
+  if (loading_instrument_.valid() || player_.IsLoadingInstrument()) {
+    glm::dvec2 loading_text_center(kWindowWidth / 2,
+                                   kTopPadding + kInstrumentTextHeight);
+    ci::gl::drawStringCentered(kLoadingText, loading_text_center,
+                               kStatusTextColor,
+                               ci::Font(kMainFontName, kLoadingTextHeight));
+  }
+
+  // Draw instrument cache status
+  std::stringstream cache_status;
+  cache_status << "Instruments cached: " << instrument_cache_.GetSize()
+               << "  Hits: " << instrument_cache_.GetHitCount()
+               << "  Misses: " << instrument_cache_.GetMissCount()
+               << "  Resident: "
+               << instrument_cache_.GetResidentBytes() / kBytesPerMegabyte
+               << " MB";
+  ci::gl::drawString(cache_status.str(),
+                     glm::dvec2(kSidePadding, kWindowHeight - kBottomPadding),
+                     kStatusTextColor);
+
+  // Draw key-to-sound latencies
+  ci::gl::drawString(GetLatencyReport(),
+                     glm::dvec2(kSidePadding, kWindowHeight - kBottomPadding -
+                                                  kStatusLineHeight),
+                     kStatusTextColor);
+
+  // Draw audio thread load
+  const audio::LoadMeter* load_meter = player_.GetLoadMeter();
+  if (load_meter) {
+    std::stringstream load_status;
+    load_status << "Audio load: " << std::fixed << std::setprecision(1)
+                << load_meter->GetLoad() * kPercent << "%  Peak: "
+                << load_meter->GetPeakLoad() * kPercent
+                << "%  Late blocks: " << load_meter->GetLateBlockCount();
+    ci::gl::drawString(
+        load_status.str(),
+        glm::dvec2(kSidePadding,
+                   kWindowHeight - kBottomPadding - 2 * kStatusLineHeight),
+        kStatusTextColor);
+  }
+
+  // Draw output device, block size and the instruments of the layers
+  auto layer_name = [this](size_t layer) {
+    audio::InstrumentRef instrument = player_.GetLayerInstrument(layer);
+    return instrument ? instrument->name_ : std::string("off");
+  };
+  std::stringstream output_status;
+  output_status << "Output: " << player_.GetOutputDeviceName() << "  Block: "
+                << player_.GetFramesPerBlock() << " frames ("
+                << std::fixed << std::setprecision(1)
+                << player_.GetBlockLatency() * kMillisecondsPerSecond
+                << " ms)  Reverb: " << (player_.HasReverb() ? "on" : "off")
+                << "  Layer: " << layer_name(kStackLayer)
+                << "  Split: " << layer_name(kSplitLayer);
+  ci::gl::drawString(
+      output_status.str(),
+      glm::dvec2(kSidePadding,
+                 kWindowHeight - kBottomPadding - 3 * kStatusLineHeight),
+      kStatusTextColor);
+
   sustain_pedal_.Draw();
   piano_.Draw();
 }
@@ -79,6 +203,29 @@ void SyntherApp::keyDown(ci::app::KeyEvent event) {
     case ci::app::KeyEvent::KEY_SPACE:
       ToggleSustainPedal();
       break;
+    case ci::app::KeyEvent::KEY_LEFTBRACKET:
+      player_.SetOutputDevice(player_.GetOutputDeviceName(),
+                              player_.GetFramesPerBlock() / 2);
+      break;
+    case ci::app::KeyEvent::KEY_RIGHTBRACKET:
+      player_.SetOutputDevice(player_.GetOutputDeviceName(),
+                              player_.GetFramesPerBlock() * 2);
+      break;
+    case ci::app::KeyEvent::KEY_m:
+      SelectNextOutputDevice();
+      break;
+    case ci::app::KeyEvent::KEY_v:
+      ToggleReverb();
+      break;
+    case ci::app::KeyEvent::KEY_b:
+      ToggleLayer(kStackLayer);
+      break;
+    case ci::app::KeyEvent::KEY_z:
+      ToggleLayer(kSplitLayer);
+      break;
+    case ci::app::KeyEvent::KEY_x:
+      ToggleMidiPlayback();
+      break;
   }
 }
 
@@ -90,6 +237,10 @@ void SyntherApp::keyUp(ci::app::KeyEvent event) {
   }
 }
 
+void SyntherApp::cleanup() {
+  std::cout << GetLatencyReport() << std::endl;
+}
+
 std::string SyntherApp::RequestInstrumentDirectory() {
   ci::fs::path assets_directory = ci::app::getAssetPath(".");
   ci::fs::path sounds_directory = ci::app::getAssetPath("sounds");
@@ -104,42 +255,235 @@ void SyntherApp::HandleShiftView(int displacement) {
   UpdateKeybindsAndLabels();
 }
 
-void SyntherApp::SetupInstrument(const std::string& asset_directory) {
-  std::string json_path = asset_directory + kJsonFilename;
+void SyntherApp::SetupInstrument(const std::string& asset_directory,
+                                 size_t layer) {
+  // Only one instrument is loaded at a time
+  if (loading_instrument_.valid()) {
+    return;
+  }
 
-  // Load json and build parser
-  std::fstream json(ci::app::getAssetPath(json_path).string());
-  if (!json.is_open()) {
+  // Switch to a cached instrument without reading any files
+  audio::InstrumentRef instrument = instrument_cache_.Find(asset_directory);
+  if (instrument && layer == 0) {
+    SwitchInstrument(instrument);
     return;
   }
-  audio::SoundJsonParser parser(json);
 
+  loading_directory_ = asset_directory;
+  loading_layer_ = layer;
+  loading_samples_.clear();
+  int lowest_semitone = kLowestSemitone;
+  if (layer == kSplitLayer) {
+    lowest_semitone = kSplitSemitone;
+  }
+
+  // Layers aren't lazily loaded, so the notes a cached instrument is missing
+  // are decoded in the background. The instrument itself is left alone until
+  // update(), since it may be playing
+  if (instrument) {
+    std::map<music::Note, ci::fs::path> note_paths =
+        player_.GetRangePaths(*instrument, lowest_semitone, kHighestSemitone);
+    loading_instrument_ = std::async(
+        std::launch::async,
+        [this, instrument, note_paths]() -> audio::InstrumentRef {
+          loading_samples_ = player_.LoadSampleFiles(note_paths);
+          return instrument;
+        });
+    return;
+  }
+
+  // Parse the json and load the sound files in the background, so the window
+  // stays responsive and the current instrument keeps playing. Layers aren't
+  // lazily loaded, so every note they play is loaded here as well
+  std::string json_path = asset_directory + kJsonFilename;
+  loading_instrument_ = std::async(
+      std::launch::async,
+      [this, asset_directory, json_path, layer,
+       lowest_semitone]() -> audio::InstrumentRef {
+        std::fstream json(ci::app::getAssetPath(json_path).string());
+        if (!json.is_open()) {
+          return audio::InstrumentRef();
+        }
+        audio::SoundJsonParser parser(json);
+        audio::InstrumentRef instrument = player_.LoadInstrument(
+            parser.GetInstrumentName(), parser.GetNoteFiles(),
+            asset_directory);
+        if (layer != 0) {
+          player_.LoadRange(*instrument, lowest_semitone, kHighestSemitone);
+        }
+        return instrument;
+      });
+}
+
+void SyntherApp::SwitchInstrument(const audio::InstrumentRef& instrument) {
   // Update state
-  instrument_ = parser.GetInstrumentName();
-  player_.SetUpVoices(parser.GetNoteFiles(), asset_directory);
-
-  // Update keyboard to match size of new instrument
-  const std::vector<music::Note>& notes = parser.GetNotes();
-  auto first_note = std::min_element(notes.begin(), notes.end());
-  int note_count = notes.size();
-  piano_.SetKeys(first_note->GetSemitoneIndex(), note_count,
-                 kViewWhitekeyCount);
+  instrument_ = instrument->name_;
+  player_.SetInstrument(instrument);
+
+  // Update keyboard to span the range of the new instrument. Notes missing
+  // from the range play the nearest sample, pitch-shifted
+  const std::vector<music::Note>& notes = instrument->notes_;
+  auto note_range = std::minmax_element(notes.begin(), notes.end());
+  int first_semitone = note_range.first->GetSemitoneIndex();
+  size_t key_count = note_range.second->GetSemitoneIndex() - first_semitone + 1;
+  piano_.SetKeys(first_semitone, key_count, kViewWhitekeyCount);
   UpdateKeybindsAndLabels();
 }
 
+void SyntherApp::SetInstrumentLayer(size_t layer,
+                                    const audio::InstrumentRef& instrument) {
+  if (layer == kSplitLayer) {
+    player_.SetLayer(layer, instrument, kSplitSemitone, kHighestSemitone, 1);
+    player_.SetLayerRange(0, kLowestSemitone, kSplitSemitone - 1);
+  } else {
+    player_.SetLayer(layer, instrument, kLowestSemitone, kHighestSemitone,
+                     kStackLayerGain);
+  }
+}
+
+void SyntherApp::ToggleLayer(size_t layer) {
+  if (!player_.GetLayerInstrument(layer)) {
+    SetupInstrument(RequestInstrumentDirectory(), layer);
+    return;
+  }
+
+  player_.RemoveLayer(layer);
+  if (layer == kSplitLayer) {
+    player_.SetLayerRange(0, kLowestSemitone, kHighestSemitone);
+  }
+}
+
 void SyntherApp::ToggleSustainPedal() {
-  if (player_.GetResonateDuration() == kStandardResonation) {
+  if (!player_.IsSustainDown()) {
     sustain_pedal_.Press();
-    player_.SetResonateDuration(kSustainedResonation);
+    player_.SetSustain(true);
   } else {
     sustain_pedal_.Release();
-    player_.SetResonateDuration(kStandardResonation);
+    player_.SetSustain(false);
+  }
+}
+
+void SyntherApp::SelectNextOutputDevice() {
+  std::vector<std::string> device_names = audio::Player::GetOutputDeviceNames();
+  if (device_names.empty()) {
+    return;
+  }
+
+  auto current = std::find(device_names.begin(), device_names.end(),
+                           player_.GetOutputDeviceName());
+  size_t current_index = current - device_names.begin();
+  // Devices that can't run at the current sample rate are skipped
+  for (size_t step = 1; step <= device_names.size(); step++) {
+    size_t next_index = (current_index + step) % device_names.size();
+    if (player_.SetOutputDevice(device_names[next_index],
+                                player_.GetFramesPerBlock())) {
+      return;
+    }
+  }
+}
+
+void SyntherApp::ToggleReverb() {
+  if (player_.HasReverb()) {
+    player_.RemoveReverb();
+  } else {
+    player_.SetReverb(kReverbImpulse, kReverbWetGain);
+  }
+}
+
+void SyntherApp::ToggleMidiPlayback() {
+  if (player_.IsPlayingSequence()) {
+    player_.StopSequence();
+    return;
+  }
+  if (loading_sequence_.valid()) {
+    return;
+  }
+
+  ci::fs::path midi_path =
+      getOpenFilePath(ci::app::getAssetPath(kScoreDirectory), {"mid", "midi"});
+  if (midi_path.empty()) {
+    return;
+  }
+  std::ifstream midi(midi_path.string(), std::ios::binary);
+  if (!midi.is_open()) {
+    return;
+  }
+  try {
+    audio::MidiFileParser parser(midi);
+    loading_events_ = parser.GetEvents();
+  } catch (const std::invalid_argument& error) {
+    std::cerr << midi_path.string() << ": " << error.what() << std::endl;
+    return;
+  }
+
+  // With lazy loading, only the notes near the view are loaded, so the rest
+  // of the notes the file plays are decoded in the background
+  sequence_instrument_ = player_.GetInstrument();
+  std::map<music::Note, ci::fs::path> note_paths =
+      player_.GetSequencePaths(loading_events_);
+  loading_sequence_ = std::async(
+      std::launch::async,
+      [this, note_paths]() -> std::map<int, audio::SampleBufferRef> {
+        return player_.LoadSampleFiles(note_paths);
+      });
+}
+
+void SyntherApp::ShowSequenceNotes() {
+  // Notes outside the instrument's range are played, but have no key
+  int first_semitone = 0;
+  int key_count = static_cast<int>(piano_.GetKeyCount());
+  if (key_count > 0) {
+    first_semitone = piano_.GetPianoKey(0).GetNote().GetSemitoneIndex();
+  }
+
+  for (const audio::NoteEvent& event : player_.TakeSequenceEvents()) {
+    int key_index = event.semitone_ - first_semitone;
+    if (key_index < 0 || key_index >= key_count) {
+      continue;
+    }
+    music::Note note(event.semitone_, music::Accidental::Sharp);
+    if (event.type_ == audio::NoteEvent::Type::NoteOn) {
+      piano_.PressKey(note);
+    } else {
+      piano_.ReleaseKey(note);
+    }
   }
 }
 
 void SyntherApp::UpdateKeybindsAndLabels() {
-  keybinder_.SetKeyBinds(piano_.GetPianoKeysInView());
+  std::vector<PianoKey> keys_in_view = piano_.GetPianoKeysInView();
+  keybinder_.SetKeyBinds(keys_in_view);
   piano_.SetKeyLabels(keybinder_.GetNoteChars());
+
+  if (!keys_in_view.empty()) {
+    auto key_range = std::minmax_element(
+        keys_in_view.begin(), keys_in_view.end(),
+        [](const PianoKey& first, const PianoKey& second) {
+          return first.GetNote() < second.GetNote();
+        });
+    player_.SetView(key_range.first->GetNote().GetSemitoneIndex(),
+                    key_range.second->GetNote().GetSemitoneIndex());
+  }
+}
+
+std::string SyntherApp::GetLatencyReport() const {
+  std::stringstream report;
+  report << "Key-to-sound latency: ";
+  const audio::LatencyHistogram* latencies = player_.GetLatencyHistogram();
+  if (!latencies || latencies->GetCount() == 0) {
+    report << "no notes played";
+    return report.str();
+  }
+
+  report << latencies->GetCount() << " notes  p50: "
+         << latencies->GetPercentile(50) / kNanosecondsPerMillisecond
+         << " ms  p99: "
+         << latencies->GetPercentile(99) / kNanosecondsPerMillisecond
+         << " ms  Max: "
+         << latencies->GetMax() / kNanosecondsPerMillisecond << " ms  + "
+         << player_.GetBlockLatency() * kMillisecondsPerSecond
+         << " ms output block";
+  return report.str();
 }
 
 }  // namespace visualizer
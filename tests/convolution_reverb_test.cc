@@ -0,0 +1,209 @@
+#include "core/convolution_reverb.h"
+
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "core/mix_kernel.h"
+#include "core/sample_buffer.h"
+
+using synther::audio::ConvolutionReverb;
+using synther::audio::SampleBuffer;
+using synther::audio::SampleFormat;
+
+namespace {
+
+const double kSampleRate = 44100;
+
+// Reports the share of one core taken by a stereo reverb at 64-frame blocks.
+// The tail is convolved inline, so the work of the tail thread is counted
+void RunReverbBenchmark(double impulse_seconds) {
+  const size_t num_frames = 64;
+  const size_t num_channels = 2;
+  const size_t block_count = 20000;
+
+  size_t impulse_frames = static_cast<size_t>(impulse_seconds * kSampleRate);
+  SampleBuffer impulse(1, impulse_frames);
+  std::mt19937 generator(1);
+  std::uniform_real_distribution<float> sample(-1.0f, 1.0f);
+  for (size_t frame = 0; frame < impulse_frames; frame++) {
+    impulse.GetChannel(0)[frame] = sample(generator);
+  }
+  ConvolutionReverb reverb(impulse, num_channels, kSampleRate, 0.5f, 1.0f,
+                           false);
+  std::vector<float> buffer(num_channels * num_frames);
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t block = 0; block < block_count; block++) {
+    for (float& value : buffer) {
+      value = sample(generator);
+    }
+    reverb.Process(buffer.data(), num_channels, num_frames);
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  double audio_seconds = block_count * num_frames / kSampleRate;
+  double cpu_share = elapsed.count() / audio_seconds;
+  std::cout << synther::audio::GetMixKernelName() << ", " << impulse_seconds
+            << " s stereo impulse: " << 100 * cpu_share
+            << "% of one core, " << 100 * cpu_share / impulse_seconds
+            << "% per second of impulse (checksum " << buffer[0] << ")"
+            << std::endl;
+  REQUIRE(cpu_share < 1);
+}
+
+const size_t kEchoImpulseFrames = 10000;
+const size_t kEchoSpacing = 1000;
+
+// An impulse with a decaying echo every kEchoSpacing frames
+SampleBuffer MakeEchoImpulse() {
+  SampleBuffer impulse(1, kEchoImpulseFrames);
+  for (size_t frame = 0; frame < kEchoImpulseFrames; frame += kEchoSpacing) {
+    impulse.GetChannel(0)[frame] =
+        1.0f / static_cast<float>(frame + kEchoSpacing);
+  }
+  return impulse;
+}
+
+// Reverberates a unit impulse in 64-frame blocks, optionally paced like an
+// audio device
+std::vector<float> RenderEchoes(ConvolutionReverb& reverb, bool is_paced) {
+  const size_t num_frames = 64;
+  std::vector<float> output;
+  std::vector<float> buffer(num_frames);
+  for (size_t block = 0; block < 200; block++) {
+    std::fill(buffer.begin(), buffer.end(), 0.0f);
+    if (block == 0) {
+      buffer[0] = 1;
+    }
+    reverb.Process(buffer.data(), 1, num_frames);
+    output.insert(output.end(), buffer.begin(), buffer.end());
+    if (is_paced) {
+      std::this_thread::sleep_for(std::chrono::microseconds(
+          static_cast<int>(num_frames * 1e6 / kSampleRate)));
+    }
+  }
+  return output;
+}
+
+// Every echo is heard once, a head partition late
+void RequireEchoes(const std::vector<float>& output) {
+  for (size_t frame = 0; frame < kEchoImpulseFrames; frame += kEchoSpacing) {
+    REQUIRE(output[64 + frame] ==
+            Approx(static_cast<float>(kEchoSpacing) / (frame + kEchoSpacing)));
+    REQUIRE(output[64 + frame + 1] == Approx(0.0f).margin(1e-4));
+  }
+}
+
+}  // namespace
+
+TEST_CASE("ConvolutionReverb mixes reverberated and dry signals",
+          "[process][getlatency]") {
+  const size_t num_frames = 256;
+
+  SECTION("A unit impulse delays the wet signal by the latency") {
+    SampleBuffer impulse(1, 1);
+    impulse.GetChannel(0)[0] = 1;
+    ConvolutionReverb reverb(impulse, 1, kSampleRate, 0.5f, 1.0f, false);
+    std::vector<float> buffer(num_frames, 0.0f);
+    buffer[0] = 1;
+    reverb.Process(buffer.data(), 1, num_frames);
+
+    size_t latency = reverb.GetLatency();
+    REQUIRE(latency == 64);
+    REQUIRE(buffer[0] == Approx(1.0f));
+    REQUIRE(buffer[latency] == Approx(0.5f));
+    REQUIRE(buffer[1] == Approx(0.0f).margin(1e-6));
+  }
+
+  SECTION("Mono impulses reverberate every channel") {
+    SampleBuffer impulse(1, 3);
+    impulse.GetChannel(0)[2] = 1;
+    ConvolutionReverb reverb(impulse, 2, kSampleRate, 1.0f, 0.0f, false);
+    std::vector<float> buffer(2 * num_frames, 0.0f);
+    buffer[0] = 1;
+    buffer[num_frames + 10] = -1;
+    reverb.Process(buffer.data(), 2, num_frames);
+
+    REQUIRE(buffer[0] == Approx(0.0f).margin(1e-6));
+    REQUIRE(buffer[64 + 2] == Approx(1.0f));
+    REQUIRE(buffer[num_frames + 64 + 12] == Approx(-1.0f));
+  }
+
+  SECTION("Every channel of a stereo impulse is used") {
+    SampleBuffer impulse(2, 2);
+    impulse.GetChannel(0)[0] = 1;
+    impulse.GetChannel(1)[1] = 1;
+    ConvolutionReverb reverb(impulse, 2, kSampleRate, 1.0f, 0.0f, false);
+    std::vector<float> buffer(2 * num_frames, 0.0f);
+    buffer[0] = 1;
+    buffer[num_frames] = 1;
+    reverb.Process(buffer.data(), 2, num_frames);
+
+    REQUIRE(buffer[64] == Approx(1.0f));
+    REQUIRE(buffer[num_frames + 64] == Approx(0.0f).margin(1e-6));
+    REQUIRE(buffer[num_frames + 65] == Approx(1.0f));
+  }
+
+  SECTION("Channels past the reverb's are left dry") {
+    SampleBuffer impulse(1, 1);
+    impulse.GetChannel(0)[0] = 1;
+    ConvolutionReverb reverb(impulse, 1, kSampleRate, 1.0f, 0.0f, false);
+    std::vector<float> buffer(2 * num_frames, 0.25f);
+    reverb.Process(buffer.data(), 2, num_frames);
+    REQUIRE(buffer[num_frames] == 0.25f);
+    REQUIRE(buffer[2 * num_frames - 1] == 0.25f);
+  }
+
+  SECTION("16-bit impulses are converted") {
+    SampleBuffer impulse(1, 1, SampleFormat::Int16);
+    impulse.GetPcmChannel(0)[0] = 16384;
+    ConvolutionReverb reverb(impulse, 1, kSampleRate, 1.0f, 0.0f, false);
+    std::vector<float> buffer(num_frames, 0.0f);
+    buffer[0] = 1;
+    reverb.Process(buffer.data(), 1, num_frames);
+    REQUIRE(buffer[64] == Approx(0.5f));
+  }
+}
+
+TEST_CASE("ConvolutionReverb convolves long tails",
+          "[process][getunderruncount]") {
+  // A decaying echo every 1000 frames, far past the head. The tail is
+  // convolved inline, so the output doesn't depend on thread scheduling
+  ConvolutionReverb reverb(MakeEchoImpulse(), 1, kSampleRate, 1000.0f, 0.0f,
+                           false, 64, 256);
+  REQUIRE(reverb.GetImpulseFrames() == kEchoImpulseFrames);
+
+  std::vector<float> output = RenderEchoes(reverb, false);
+  REQUIRE(reverb.GetUnderrunCount() == 0);
+  RequireEchoes(output);
+}
+
+TEST_CASE("Reverberating on a tail thread in real time", "[.][benchmark]") {
+  // Rendered in real time, so the tail thread has as long as it would have
+  // with an audio device
+  ConvolutionReverb reverb(MakeEchoImpulse(), 1, kSampleRate, 1000.0f, 0.0f,
+                           true, 64, 256);
+  std::vector<float> output = RenderEchoes(reverb, true);
+  std::cout << "Tail underruns: " << reverb.GetUnderrunCount() << std::endl;
+  REQUIRE(reverb.GetUnderrunCount() == 0);
+  RequireEchoes(output);
+}
+
+TEST_CASE("Reverberating stereo at 64-frame blocks", "[.][benchmark]") {
+  SECTION("1 second impulse") {
+    RunReverbBenchmark(1);
+  }
+
+  SECTION("2 second impulse") {
+    RunReverbBenchmark(2);
+  }
+
+  SECTION("4 second impulse") {
+    RunReverbBenchmark(4);
+  }
+}
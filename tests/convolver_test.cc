@@ -0,0 +1,162 @@
+#include "core/convolver.h"
+
+#include <algorithm>
+#include <atomic>
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+using synther::audio::Convolver;
+
+namespace {
+
+std::vector<float> RandomSignal(size_t num_frames, unsigned seed) {
+  std::mt19937 generator(seed);
+  std::uniform_real_distribution<float> sample(-1.0f, 1.0f);
+  std::vector<float> signal(num_frames);
+  for (float& value : signal) {
+    value = sample(generator);
+  }
+  return signal;
+}
+
+// Convolves a signal one output frame at a time
+std::vector<float> DirectConvolution(const std::vector<float>& signal,
+                                     const std::vector<float>& impulse) {
+  std::vector<float> output(signal.size(), 0.0f);
+  for (size_t frame = 0; frame < signal.size(); frame++) {
+    double sum = 0;
+    for (size_t tap = 0; tap < impulse.size() && tap <= frame; tap++) {
+      sum += static_cast<double>(impulse[tap]) * signal[frame - tap];
+    }
+    output[frame] = static_cast<float>(sum);
+  }
+  return output;
+}
+
+// Checks the output of a convolver against the direct convolution, delayed
+// by the convolver's latency
+void RequireMatchesDirect(const std::vector<float>& output,
+                          const std::vector<float>& expected,
+                          size_t latency) {
+  for (size_t frame = 0; frame < output.size(); frame++) {
+    float delayed = frame < latency ? 0.0f : expected[frame - latency];
+    REQUIRE(output[frame] == Approx(delayed).margin(1e-3));
+  }
+}
+
+}  // namespace
+
+TEST_CASE("Convolver convolves on the rendering thread", "[process]") {
+  std::vector<float> signal = RandomSignal(8192, 1);
+
+  SECTION("Impulses within the head") {
+    std::vector<float> impulse = RandomSignal(300, 2);
+    Convolver convolver(impulse.data(), impulse.size(), false, 64, 256);
+    std::vector<float> output(signal.size());
+    convolver.Process(signal.data(), output.data(), signal.size());
+    RequireMatchesDirect(output, DirectConvolution(signal, impulse), 64);
+  }
+
+  SECTION("Impulses with a tail") {
+    std::vector<float> impulse = RandomSignal(3000, 3);
+    Convolver convolver(impulse.data(), impulse.size(), false, 64, 256);
+    std::vector<float> output(signal.size());
+    convolver.Process(signal.data(), output.data(), signal.size());
+    RequireMatchesDirect(output, DirectConvolution(signal, impulse), 64);
+    REQUIRE(convolver.GetUnderrunCount() == 0);
+  }
+
+  SECTION("Blocks that don't line up with partitions") {
+    std::vector<float> impulse = RandomSignal(2000, 4);
+    Convolver convolver(impulse.data(), impulse.size(), false, 32, 128);
+    std::vector<float> output(signal.size());
+    size_t block_sizes[] = {1, 17, 100, 64, 333, 5};
+    size_t frame = 0;
+    for (size_t block = 0; frame < signal.size(); block++) {
+      size_t num_frames = std::min(block_sizes[block % 6],
+                                   signal.size() - frame);
+      convolver.Process(signal.data() + frame, output.data() + frame,
+                        num_frames);
+      frame += num_frames;
+    }
+    RequireMatchesDirect(output, DirectConvolution(signal, impulse), 32);
+  }
+
+  SECTION("Output may overwrite the input") {
+    std::vector<float> impulse = RandomSignal(1000, 5);
+    Convolver convolver(impulse.data(), impulse.size(), false, 64, 128);
+    std::vector<float> buffer = signal;
+    for (size_t frame = 0; frame < buffer.size(); frame += 100) {
+      convolver.Process(buffer.data() + frame, buffer.data() + frame,
+                        std::min<size_t>(100, buffer.size() - frame));
+    }
+    RequireMatchesDirect(buffer, DirectConvolution(signal, impulse), 64);
+  }
+
+  SECTION("Partition sizes are rounded up to powers of two") {
+    std::vector<float> impulse = RandomSignal(500, 6);
+    Convolver convolver(impulse.data(), impulse.size(), false, 48, 16);
+    REQUIRE(convolver.GetLatency() == 64);
+    std::vector<float> output(signal.size());
+    convolver.Process(signal.data(), output.data(), signal.size());
+    RequireMatchesDirect(output, DirectConvolution(signal, impulse), 64);
+  }
+
+  SECTION("Empty impulses are silent") {
+    Convolver convolver(nullptr, 0, false);
+    std::vector<float> output(signal.size(), 1.0f);
+    convolver.Process(signal.data(), output.data(), signal.size());
+    REQUIRE(std::all_of(output.begin(), output.end(),
+                        [](float sample) { return sample == 0.0f; }));
+  }
+}
+
+TEST_CASE("Convolver convolves its tail on another thread",
+          "[process][processtail][getunderruncount]") {
+  std::vector<float> signal = RandomSignal(4096, 7);
+  std::vector<float> impulse = RandomSignal(2500, 8);
+  Convolver convolver(impulse.data(), impulse.size(), true, 32, 128);
+  std::vector<float> output(signal.size());
+
+  SECTION("Tails convolved in time are heard") {
+    std::atomic<bool> is_stopping(false);
+    std::thread tail_thread([&convolver, &is_stopping]() {
+      while (!is_stopping.load()) {
+        if (!convolver.ProcessTail()) {
+          std::this_thread::yield();
+        }
+      }
+    });
+
+    // The tail has a whole partition to keep up, so the blocks are paced to
+    // leave it plenty of time
+    for (size_t frame = 0; frame < signal.size(); frame += 32) {
+      convolver.Process(signal.data() + frame, output.data() + frame, 32);
+      std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+    is_stopping.store(true);
+    tail_thread.join();
+
+    REQUIRE(convolver.GetUnderrunCount() == 0);
+    RequireMatchesDirect(output, DirectConvolution(signal, impulse), 32);
+  }
+
+  SECTION("Late tails are left out and counted") {
+    convolver.Process(signal.data(), output.data(), signal.size());
+    // The first two tail partitions are covered by the head
+    REQUIRE(convolver.GetUnderrunCount() == signal.size() / 128 - 2);
+
+    // A tail thread that catches up again is heard from then on
+    size_t processed_count = 0;
+    while (convolver.ProcessTail()) {
+      processed_count++;
+    }
+    REQUIRE(processed_count == signal.size() / 128);
+    std::vector<float> silence(1024, 0.0f);
+    convolver.Process(silence.data(), output.data(), 128);
+    REQUIRE(convolver.GetUnderrunCount() == signal.size() / 128 - 2);
+  }
+}
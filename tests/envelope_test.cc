@@ -0,0 +1,91 @@
+#include "core/envelope.h"
+
+#include <catch2/catch.hpp>
+
+using synther::audio::Envelope;
+
+TEST_CASE("Envelope rises over the attack and holds at full gain",
+          "[start][advance]") {
+  Envelope envelope;
+
+  SECTION("New envelopes are finished and silent") {
+    REQUIRE(envelope.IsFinished());
+    REQUIRE(envelope.GetLevel() == 0);
+  }
+
+  SECTION("Attack ramps from silence") {
+    envelope.Start(100);
+    REQUIRE(envelope.GetLevel() == 0);
+    REQUIRE(envelope.GetStep() == Approx(0.01f));
+    REQUIRE(!envelope.IsFinished());
+
+    envelope.Advance(50);
+    REQUIRE(envelope.GetLevel() == Approx(0.5f));
+  }
+
+  SECTION("Attack ending mid-block sustains at full gain") {
+    envelope.Start(100);
+    envelope.Advance(64);
+    envelope.Advance(64);
+    REQUIRE(envelope.GetLevel() == 1);
+    REQUIRE(envelope.GetStep() == 0);
+    REQUIRE(!envelope.IsReleased());
+  }
+
+  SECTION("Attacks shorter than a frame start at full gain") {
+    envelope.Start(0);
+    REQUIRE(envelope.GetLevel() == 1);
+    REQUIRE(envelope.GetStep() == 0);
+  }
+}
+
+TEST_CASE("Envelope falls to silence over the release",
+          "[release][fadeout][isfinished]") {
+  Envelope envelope;
+  envelope.Start(0);
+
+  SECTION("Release ramps from full gain") {
+    envelope.Release(200);
+    REQUIRE(envelope.IsReleased());
+    REQUIRE(envelope.GetStep() == Approx(-0.005f));
+    envelope.Advance(100);
+    REQUIRE(envelope.GetLevel() == Approx(0.5f));
+    REQUIRE(!envelope.IsFinished());
+  }
+
+  SECTION("Release ending mid-block finishes the envelope") {
+    envelope.Release(100);
+    envelope.Advance(64);
+    REQUIRE(!envelope.IsFinished());
+    envelope.Advance(64);
+    REQUIRE(envelope.GetLevel() == 0);
+    REQUIRE(envelope.IsFinished());
+  }
+
+  SECTION("Release during the attack starts from the current level") {
+    envelope.Start(100);
+    envelope.Advance(20);
+    envelope.Release(10);
+    REQUIRE(envelope.GetStep() == Approx(-0.02f));
+  }
+
+  SECTION("Instant releases silence the next frame") {
+    envelope.Release(0);
+    REQUIRE(envelope.GetLevel() == 0);
+    REQUIRE(envelope.IsFinished());
+  }
+
+  SECTION("Fades only speed up releases") {
+    envelope.Release(1000);
+    envelope.FadeOut(100);
+    REQUIRE(envelope.GetStep() == Approx(-0.01f));
+    envelope.FadeOut(500);
+    REQUIRE(envelope.GetStep() == Approx(-0.01f));
+  }
+
+  SECTION("Fades release held envelopes") {
+    envelope.FadeOut(100);
+    REQUIRE(envelope.IsReleased());
+    REQUIRE(envelope.GetStep() == Approx(-0.01f));
+  }
+}
@@ -0,0 +1,60 @@
+#include "core/event_list_parser.h"
+
+#include <catch2/catch.hpp>
+#include <sstream>
+#include <vector>
+
+#include "core/note_event.h"
+
+using synther::audio::EventListParser;
+using synther::audio::NoteEvent;
+using synther::audio::TimedNoteEvent;
+
+TEST_CASE("Correctly parses timed note events", "[getevents]") {
+  SECTION("Note events are mapped to semitones") {
+    std::stringstream json(R"({"events": [
+        {"time": 0.0, "type": "noteOn", "note": "A0"},
+        {"time": 0.5, "type": "noteOff", "note": "Cs4"}]})");
+    EventListParser parser(json);
+    std::vector<TimedNoteEvent> events = parser.GetEvents();
+
+    REQUIRE(events.size() == 2);
+    REQUIRE(events[0].time_ == 0.0);
+    REQUIRE(events[0].event_.type_ == NoteEvent::Type::NoteOn);
+    REQUIRE(events[0].event_.semitone_ == 9);
+    REQUIRE(events[1].time_ == 0.5);
+    REQUIRE(events[1].event_.type_ == NoteEvent::Type::NoteOff);
+    REQUIRE(events[1].event_.semitone_ == 49);
+  }
+
+  SECTION("Sustain events press and lift the pedal") {
+    std::stringstream json(R"({"events": [
+        {"time": 1.0, "type": "sustain", "down": true},
+        {"time": 2.0, "type": "sustain", "down": false}]})");
+    EventListParser parser(json);
+    std::vector<TimedNoteEvent> events = parser.GetEvents();
+
+    REQUIRE(events.size() == 2);
+    REQUIRE(events[0].event_.type_ == NoteEvent::Type::SustainOn);
+    REQUIRE(events[1].event_.type_ == NoteEvent::Type::SustainOff);
+  }
+
+  SECTION("Events are sorted by time, keeping the order of ties") {
+    std::stringstream json(R"({"events": [
+        {"time": 1.0, "type": "noteOff", "note": "C4"},
+        {"time": 1.0, "type": "noteOn", "note": "C4"},
+        {"time": 0.0, "type": "noteOn", "note": "C4"}]})");
+    EventListParser parser(json);
+    std::vector<TimedNoteEvent> events = parser.GetEvents();
+
+    REQUIRE(events[0].time_ == 0.0);
+    REQUIRE(events[1].event_.type_ == NoteEvent::Type::NoteOff);
+    REQUIRE(events[2].event_.type_ == NoteEvent::Type::NoteOn);
+  }
+
+  SECTION("Unknown event types throw an exception") {
+    std::stringstream json(R"({"events": [{"time": 0.0, "type": "bend"}]})");
+    EventListParser parser(json);
+    REQUIRE_THROWS_AS(parser.GetEvents(), std::invalid_argument);
+  }
+}
@@ -0,0 +1,100 @@
+#include "core/event_queue.h"
+
+#include <catch2/catch.hpp>
+#include <thread>
+#include <vector>
+
+using synther::audio::EventQueue;
+
+TEST_CASE("EventQueue pops items in the order they were pushed",
+          "[trypush][trypop][getcapacity]") {
+  SECTION("Capacity is rounded up to a power of two") {
+    EventQueue<int> queue(5);
+    REQUIRE(queue.GetCapacity() == 8);
+  }
+
+  SECTION("Popping an empty queue fails") {
+    EventQueue<int> queue(4);
+    int item = 0;
+    REQUIRE(!queue.TryPop(item));
+  }
+
+  SECTION("Items are popped first-in first-out") {
+    EventQueue<int> queue(4);
+    REQUIRE(queue.TryPush(1));
+    REQUIRE(queue.TryPush(2));
+    int item = 0;
+    REQUIRE(queue.TryPop(item));
+    REQUIRE(item == 1);
+    REQUIRE(queue.TryPop(item));
+    REQUIRE(item == 2);
+  }
+
+  SECTION("Pushing onto a full queue fails") {
+    EventQueue<int> queue(2);
+    REQUIRE(queue.TryPush(1));
+    REQUIRE(queue.TryPush(2));
+    REQUIRE(!queue.TryPush(3));
+  }
+
+  SECTION("Slots are reused after the queue wraps around") {
+    EventQueue<int> queue(2);
+    int item = 0;
+    for (int value = 0; value < 10; value++) {
+      REQUIRE(queue.TryPush(value));
+      REQUIRE(queue.TryPop(item));
+      REQUIRE(item == value);
+    }
+  }
+}
+
+TEST_CASE("EventQueue publishes batches atomically", "[trypushall][drain]") {
+  EventQueue<int> queue(4);
+
+  SECTION("Batch larger than the free space is rejected entirely") {
+    REQUIRE(queue.TryPush(0));
+    int batch[] = {1, 2, 3, 4};
+    REQUIRE(!queue.TryPushAll(batch, 4));
+
+    std::vector<int> drained;
+    queue.Drain([&drained](int item) { drained.push_back(item); });
+    REQUIRE(drained == std::vector<int>{0});
+  }
+
+  SECTION("Drain pops every published item in order") {
+    int batch[] = {1, 2, 3};
+    REQUIRE(queue.TryPushAll(batch, 3));
+
+    std::vector<int> drained;
+    size_t count =
+        queue.Drain([&drained](int item) { drained.push_back(item); });
+    REQUIRE(count == 3);
+    REQUIRE(drained == std::vector<int>{1, 2, 3});
+    REQUIRE(queue.Drain([](int) {}) == 0);
+  }
+}
+
+TEST_CASE("EventQueue transfers items between two threads", "[threads]") {
+  const int item_count = 100000;
+  EventQueue<int> queue(64);
+
+  std::thread producer([&queue, item_count]() {
+    for (int value = 0; value < item_count;) {
+      if (queue.TryPush(value)) {
+        value++;
+      }
+    }
+  });
+
+  int expected = 0;
+  bool is_ordered = true;
+  while (expected < item_count) {
+    queue.Drain([&expected, &is_ordered](int item) {
+      is_ordered = is_ordered && item == expected;
+      expected++;
+    });
+  }
+  producer.join();
+
+  REQUIRE(is_ordered);
+}
@@ -0,0 +1,98 @@
+#include "core/fft.h"
+
+#include <catch2/catch.hpp>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using synther::audio::Fft;
+
+namespace {
+
+// Transforms a signal one bin at a time, in double precision
+void ReferenceTransform(const std::vector<float>& signal,
+                        std::vector<double>& real, std::vector<double>& imag) {
+  const double kPi = 3.14159265358979323846;
+  size_t size = signal.size();
+  real.assign(size / 2 + 1, 0);
+  imag.assign(size / 2 + 1, 0);
+  for (size_t bin = 0; bin <= size / 2; bin++) {
+    for (size_t index = 0; index < size; index++) {
+      double angle = -2 * kPi * static_cast<double>(bin * index) /
+                     static_cast<double>(size);
+      real[bin] += signal[index] * std::cos(angle);
+      imag[bin] += signal[index] * std::sin(angle);
+    }
+  }
+}
+
+std::vector<float> RandomSignal(size_t size) {
+  std::mt19937 generator(static_cast<unsigned>(size));
+  std::uniform_real_distribution<float> sample(-1.0f, 1.0f);
+  std::vector<float> signal(size);
+  for (float& value : signal) {
+    value = sample(generator);
+  }
+  return signal;
+}
+
+}  // namespace
+
+TEST_CASE("Fft sizes its spectra", "[getsize][getbincount]") {
+  Fft fft(128);
+  REQUIRE(fft.GetSize() == 128);
+  REQUIRE(fft.GetBinCount() == 65);
+}
+
+TEST_CASE("Fft transforms real signals", "[forward][inverse]") {
+  size_t sizes[] = {2, 4, 8, 64, 128, 2048};
+
+  SECTION("Spectra match the discrete Fourier transform") {
+    for (size_t size : sizes) {
+      Fft fft(size);
+      std::vector<float> signal = RandomSignal(size);
+      std::vector<float> real(fft.GetBinCount());
+      std::vector<float> imag(fft.GetBinCount());
+      fft.Forward(signal.data(), real.data(), imag.data());
+
+      std::vector<double> expected_real;
+      std::vector<double> expected_imag;
+      ReferenceTransform(signal, expected_real, expected_imag);
+      double margin = 1e-5 * static_cast<double>(size);
+      for (size_t bin = 0; bin < fft.GetBinCount(); bin++) {
+        REQUIRE(real[bin] == Approx(expected_real[bin]).margin(margin));
+        REQUIRE(imag[bin] == Approx(expected_imag[bin]).margin(margin));
+      }
+    }
+  }
+
+  SECTION("The inverse restores the signal scaled by the size") {
+    for (size_t size : sizes) {
+      Fft fft(size);
+      std::vector<float> signal = RandomSignal(size);
+      std::vector<float> real(fft.GetBinCount());
+      std::vector<float> imag(fft.GetBinCount());
+      std::vector<float> output(size);
+      fft.Forward(signal.data(), real.data(), imag.data());
+      fft.Inverse(real.data(), imag.data(), output.data());
+
+      for (size_t index = 0; index < size; index++) {
+        REQUIRE(output[index] / static_cast<float>(size) ==
+                Approx(signal[index]).margin(1e-5));
+      }
+    }
+  }
+
+  SECTION("An impulse has a flat spectrum") {
+    Fft fft(16);
+    std::vector<float> impulse(16, 0.0f);
+    impulse[0] = 1;
+    std::vector<float> real(fft.GetBinCount());
+    std::vector<float> imag(fft.GetBinCount());
+    fft.Forward(impulse.data(), real.data(), imag.data());
+    for (size_t bin = 0; bin < fft.GetBinCount(); bin++) {
+      REQUIRE(real[bin] == Approx(1.0f));
+      REQUIRE(imag[bin] == Approx(0.0f).margin(1e-6));
+    }
+  }
+}
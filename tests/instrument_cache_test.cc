@@ -0,0 +1,100 @@
+#include "core/instrument_cache.h"
+
+#include <catch2/catch.hpp>
+#include <memory>
+
+#include "core/sample_buffer.h"
+
+using synther::audio::Instrument;
+using synther::audio::InstrumentCache;
+using synther::audio::InstrumentRef;
+using synther::audio::SampleBuffer;
+
+namespace {
+
+// Builds an instrument with one mono sample of roughly the given size
+InstrumentRef MakeInstrument(const std::string& name, size_t num_frames) {
+  auto instrument = std::make_shared<Instrument>();
+  instrument->name_ = name;
+  instrument->samples_[60] = std::make_shared<SampleBuffer>(1, num_frames);
+  return instrument;
+}
+
+// The memory taken by an instrument built by MakeInstrument()
+size_t GetInstrumentSize(size_t num_frames) {
+  return SampleBuffer::GetStorageSize(1, num_frames) * sizeof(float);
+}
+
+}  // namespace
+
+TEST_CASE("InstrumentCache finds inserted instruments",
+          "[find][insert][gethitcount][getmisscount]") {
+  InstrumentCache cache(GetInstrumentSize(1000) * 10);
+
+  SECTION("Empty cache misses") {
+    REQUIRE(cache.Find("sounds/piano/") == nullptr);
+    REQUIRE(cache.GetMissCount() == 1);
+    REQUIRE(cache.GetHitCount() == 0);
+  }
+
+  SECTION("Inserted instrument hits") {
+    InstrumentRef piano = MakeInstrument("Piano", 1000);
+    cache.Insert("sounds/piano/", piano);
+    REQUIRE(cache.Find("sounds/piano/") == piano);
+    REQUIRE(cache.GetHitCount() == 1);
+    REQUIRE(cache.GetMissCount() == 0);
+  }
+
+  SECTION("Inserting an existing key replaces the instrument") {
+    cache.Insert("sounds/piano/", MakeInstrument("Old Piano", 1000));
+    InstrumentRef piano = MakeInstrument("Piano", 1000);
+    cache.Insert("sounds/piano/", piano);
+    REQUIRE(cache.GetSize() == 1);
+    REQUIRE(cache.Find("sounds/piano/") == piano);
+  }
+}
+
+TEST_CASE("InstrumentCache drops least recently used instruments",
+          "[insert][trim][setbytebudget][getresidentbytes]") {
+  size_t instrument_size = GetInstrumentSize(1000);
+  InstrumentCache cache(instrument_size * 2);
+  cache.Insert("piano", MakeInstrument("Piano", 1000));
+  cache.Insert("cello", MakeInstrument("Cello", 1000));
+
+  SECTION("Resident bytes count every cached sample") {
+    REQUIRE(cache.GetResidentBytes() == instrument_size * 2);
+  }
+
+  SECTION("The least recently inserted instrument is dropped") {
+    cache.Insert("flute", MakeInstrument("Flute", 1000));
+    REQUIRE(cache.GetSize() == 2);
+    REQUIRE(cache.Find("piano") == nullptr);
+    REQUIRE(cache.Find("cello") != nullptr);
+  }
+
+  SECTION("Found instruments become the most recently used") {
+    cache.Find("piano");
+    cache.Insert("flute", MakeInstrument("Flute", 1000));
+    REQUIRE(cache.Find("cello") == nullptr);
+    REQUIRE(cache.Find("piano") != nullptr);
+  }
+
+  SECTION("The most recent instrument is kept even if it exceeds the budget") {
+    cache.Insert("organ", MakeInstrument("Organ", 10000));
+    REQUIRE(cache.GetSize() == 1);
+    REQUIRE(cache.Find("organ") != nullptr);
+  }
+
+  SECTION("Instruments that grow are trimmed") {
+    InstrumentRef cello = cache.Find("cello");
+    cello->samples_[62] = std::make_shared<SampleBuffer>(1, 1000);
+    cache.Trim();
+    REQUIRE(cache.Find("piano") == nullptr);
+  }
+
+  SECTION("Shrinking the budget drops instruments") {
+    cache.SetByteBudget(instrument_size);
+    REQUIRE(cache.GetSize() == 1);
+    REQUIRE(cache.GetResidentBytes() == instrument_size);
+  }
+}
@@ -0,0 +1,79 @@
+#include "core/latency_histogram.h"
+
+#include <catch2/catch.hpp>
+#include <cstdint>
+
+using synther::audio::LatencyHistogram;
+
+TEST_CASE("LatencyHistogram counts recorded latencies",
+          "[record][getcount][getmax][reset]") {
+  LatencyHistogram histogram;
+
+  SECTION("New histograms are empty") {
+    REQUIRE(histogram.GetCount() == 0);
+    REQUIRE(histogram.GetMax() == 0);
+    REQUIRE(histogram.GetPercentile(50) == 0);
+  }
+
+  SECTION("Every latency is counted and the longest is kept") {
+    histogram.Record(3000);
+    histogram.Record(9000000);
+    histogram.Record(500);
+    REQUIRE(histogram.GetCount() == 3);
+    REQUIRE(histogram.GetMax() == 9000000);
+  }
+
+  SECTION("Resetting forgets every latency") {
+    histogram.Record(3000);
+    histogram.Reset();
+    REQUIRE(histogram.GetCount() == 0);
+    REQUIRE(histogram.GetMax() == 0);
+    REQUIRE(histogram.GetPercentile(99) == 0);
+  }
+}
+
+TEST_CASE("LatencyHistogram reports percentiles", "[getpercentile]") {
+  LatencyHistogram histogram;
+
+  SECTION("Short latencies are exact") {
+    for (uint64_t latency = 1; latency <= 60; latency++) {
+      histogram.Record(latency);
+    }
+    REQUIRE(histogram.GetPercentile(50) == 30);
+    REQUIRE(histogram.GetPercentile(100) == 60);
+    REQUIRE(histogram.GetPercentile(0) == 1);
+  }
+
+  SECTION("Long latencies are within the bucket precision") {
+    // One millisecond to a hundred milliseconds
+    for (uint64_t latency = 1; latency <= 100; latency++) {
+      histogram.Record(latency * 1000000);
+    }
+    double precision = 1.0 / LatencyHistogram::kSubBucketCount;
+    REQUIRE(histogram.GetPercentile(50) ==
+            Approx(50000000).epsilon(precision));
+    REQUIRE(histogram.GetPercentile(99) ==
+            Approx(99000000).epsilon(precision));
+    REQUIRE(histogram.GetPercentile(50) >= 50000000);
+  }
+
+  SECTION("Percentiles never exceed the longest latency") {
+    histogram.Record(1000001);
+    REQUIRE(histogram.GetPercentile(99) == 1000001);
+  }
+
+  SECTION("Latencies past the last bucket are clamped") {
+    histogram.Record(UINT64_MAX);
+    histogram.Record(1);
+    REQUIRE(histogram.GetMax() == UINT64_MAX);
+    REQUIRE(histogram.GetPercentile(100) >
+            (uint64_t(1) << (LatencyHistogram::kMaxExponent - 1)));
+  }
+}
+
+TEST_CASE("LatencyHistogram clock never reads 0", "[now]") {
+  uint64_t first = LatencyHistogram::Now();
+  uint64_t second = LatencyHistogram::Now();
+  REQUIRE(first != 0);
+  REQUIRE(second >= first);
+}
@@ -0,0 +1,77 @@
+#include "core/load_meter.h"
+
+#include <catch2/catch.hpp>
+
+using synther::audio::LoadMeter;
+
+TEST_CASE("LoadMeter measures blocks against their budgets",
+          "[record][getpeakload][getlateblockcount][reset]") {
+  LoadMeter meter;
+
+  SECTION("New meters are idle") {
+    REQUIRE(meter.GetLoad() == 0);
+    REQUIRE(meter.GetPeakLoad() == 0);
+    REQUIRE(meter.GetBlockCount() == 0);
+  }
+
+  SECTION("The peak is the busiest block") {
+    meter.Record(250, 1000);
+    meter.Record(750, 1000);
+    meter.Record(500, 1000);
+    REQUIRE(meter.GetPeakLoad() == Approx(0.75));
+    REQUIRE(meter.GetBlockCount() == 3);
+    REQUIRE(meter.GetLateBlockCount() == 0);
+  }
+
+  SECTION("Blocks that take longer than they play are late") {
+    meter.Record(1500, 1000);
+    meter.Record(1000, 1000);
+    REQUIRE(meter.GetLateBlockCount() == 1);
+    REQUIRE(meter.GetPeakLoad() == Approx(1.5));
+  }
+
+  SECTION("Resetting starts a new measurement") {
+    meter.Record(1500, 1000);
+    meter.Reset();
+    REQUIRE(meter.GetPeakLoad() == 0);
+    REQUIRE(meter.GetLateBlockCount() == 0);
+    REQUIRE(meter.GetBlockCount() == 0);
+    REQUIRE(meter.GetLoad() > 0);
+  }
+}
+
+TEST_CASE("LoadMeter smooths the load over its time constant",
+          "[record][getload]") {
+  // One second of audio in blocks of 10 milliseconds
+  const uint64_t budget = 10000000;
+
+  SECTION("A steady load is approached after a few time constants") {
+    LoadMeter meter(0.1);
+    for (size_t block = 0; block < 100; block++) {
+      meter.Record(budget / 2, budget);
+    }
+    REQUIRE(meter.GetLoad() == Approx(0.5).margin(1e-3));
+  }
+
+  SECTION("A single busy block barely moves a slow meter") {
+    LoadMeter meter(1.0);
+    meter.Record(budget, budget);
+    REQUIRE(meter.GetLoad() == Approx(0.01).margin(1e-3));
+  }
+
+  SECTION("Smoothing doesn't depend on the block size") {
+    LoadMeter small_blocks(0.1);
+    LoadMeter large_blocks(0.1);
+    for (size_t block = 0; block < 10; block++) {
+      small_blocks.Record(budget / 4, budget);
+    }
+    large_blocks.Record(10 * budget / 4, 10 * budget);
+    REQUIRE(small_blocks.GetLoad() == Approx(large_blocks.GetLoad()));
+  }
+
+  SECTION("No time constant follows every block") {
+    LoadMeter meter(0);
+    meter.Record(budget / 4, budget);
+    REQUIRE(meter.GetLoad() == Approx(0.25));
+  }
+}
@@ -0,0 +1,170 @@
+#include "core/midi_file_parser.h"
+
+#include <catch2/catch.hpp>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "core/note_event.h"
+
+using synther::audio::MidiFileParser;
+using synther::audio::NoteEvent;
+using synther::audio::TimedNoteEvent;
+
+namespace {
+
+std::string Bytes(const std::vector<int>& values) {
+  std::string bytes;
+  for (int value : values) {
+    bytes.push_back(static_cast<char>(value));
+  }
+  return bytes;
+}
+
+std::string Word(uint32_t value, size_t size) {
+  std::string bytes;
+  for (size_t index = size; index > 0; index--) {
+    bytes.push_back(static_cast<char>((value >> (8 * (index - 1))) & 0xFF));
+  }
+  return bytes;
+}
+
+// Builds a MIDI file with a track chunk around every track's events, each
+// of which is ended by an End of Track meta event
+std::string MakeMidiFile(uint32_t format, uint32_t division,
+                         const std::vector<std::string>& tracks) {
+  std::string file = "MThd" + Word(6, 4) + Word(format, 2) +
+                     Word(static_cast<uint32_t>(tracks.size()), 2) +
+                     Word(division, 2);
+  for (const std::string& track : tracks) {
+    std::string events = track + Bytes({0x00, 0xFF, 0x2F, 0x00});
+    file += "MTrk" + Word(static_cast<uint32_t>(events.size()), 4) + events;
+  }
+  return file;
+}
+
+std::vector<TimedNoteEvent> ParseMidi(const std::string& file) {
+  std::stringstream midi(file);
+  MidiFileParser parser(midi);
+  return parser.GetEvents();
+}
+
+}  // namespace
+
+TEST_CASE("Parses the notes of MIDI files", "[getevents]") {
+  SECTION("Notes are timed by the default tempo") {
+    // 96 ticks per quarter note at 120 bpm. C4 on, then off a quarter later
+    std::vector<TimedNoteEvent> events = ParseMidi(MakeMidiFile(
+        0, 96, {Bytes({0x00, 0x90, 60, 100, 0x60, 0x80, 60, 0})}));
+
+    REQUIRE(events.size() == 2);
+    REQUIRE(events[0].time_ == 0.0);
+    REQUIRE(events[0].event_.type_ == NoteEvent::Type::NoteOn);
+    REQUIRE(events[0].event_.semitone_ == 48);
+    REQUIRE(events[1].time_ == Approx(0.5));
+    REQUIRE(events[1].event_.type_ == NoteEvent::Type::NoteOff);
+    REQUIRE(events[1].event_.semitone_ == 48);
+  }
+
+  SECTION("Note On with no velocity releases the note") {
+    std::vector<TimedNoteEvent> events = ParseMidi(MakeMidiFile(
+        0, 96, {Bytes({0x00, 0x91, 69, 80, 0x30, 0x91, 69, 0})}));
+
+    REQUIRE(events.size() == 2);
+    REQUIRE(events[1].time_ == Approx(0.25));
+    REQUIRE(events[1].event_.type_ == NoteEvent::Type::NoteOff);
+    REQUIRE(events[1].event_.semitone_ == 57);
+  }
+
+  SECTION("Running status repeats the last status byte") {
+    std::vector<TimedNoteEvent> events = ParseMidi(MakeMidiFile(
+        0, 96, {Bytes({0x00, 0x90, 60, 100, 0x00, 64, 100, 0x00, 67, 100,
+                       0x60, 60, 0, 0x00, 64, 0, 0x00, 67, 0})}));
+
+    REQUIRE(events.size() == 6);
+    REQUIRE(events[2].time_ == 0.0);
+    REQUIRE(events[2].event_.type_ == NoteEvent::Type::NoteOn);
+    REQUIRE(events[2].event_.semitone_ == 55);
+    REQUIRE(events[5].time_ == Approx(0.5));
+    REQUIRE(events[5].event_.type_ == NoteEvent::Type::NoteOff);
+  }
+
+  SECTION("The sustain controller presses and lifts the pedal") {
+    std::vector<TimedNoteEvent> events = ParseMidi(MakeMidiFile(
+        0, 96, {Bytes({0x00, 0xB0, 64, 127, 0x60, 0xB0, 64, 0, 0x00, 0xB0,
+                       7, 100})}));
+
+    REQUIRE(events.size() == 2);
+    REQUIRE(events[0].event_.type_ == NoteEvent::Type::SustainOn);
+    REQUIRE(events[1].event_.type_ == NoteEvent::Type::SustainOff);
+    REQUIRE(events[1].time_ == Approx(0.5));
+  }
+
+  SECTION("Tempo changes in one track time the notes of every track") {
+    // 60 bpm from the second quarter note on
+    std::string tempo_track = Bytes({0x60, 0xFF, 0x51, 0x03, 0x0F, 0x42,
+                                     0x40});
+    std::string note_track =
+        Bytes({0x60, 0x90, 60, 100, 0x60, 0x80, 60, 0, 0x60, 0x90, 62, 100});
+    std::vector<TimedNoteEvent> events =
+        ParseMidi(MakeMidiFile(1, 96, {tempo_track, note_track}));
+
+    REQUIRE(events.size() == 3);
+    REQUIRE(events[0].time_ == Approx(0.5));
+    REQUIRE(events[1].time_ == Approx(1.5));
+    REQUIRE(events[2].time_ == Approx(2.5));
+  }
+
+  SECTION("Tracks are merged in time order") {
+    std::vector<TimedNoteEvent> events = ParseMidi(
+        MakeMidiFile(1, 96, {Bytes({0x60, 0x90, 60, 100}),
+                             Bytes({0x30, 0x90, 64, 100, 0x30, 0x90, 67,
+                                    100})}));
+
+    REQUIRE(events.size() == 3);
+    REQUIRE(events[0].event_.semitone_ == 52);
+    REQUIRE(events[1].event_.semitone_ == 48);
+    REQUIRE(events[2].event_.semitone_ == 55);
+  }
+
+  SECTION("SMPTE divisions time ticks by frames") {
+    // 25 frames per second of 40 ticks, so every tick is a millisecond
+    std::vector<TimedNoteEvent> events = ParseMidi(MakeMidiFile(
+        0, 0xE728, {Bytes({0x87, 0x68, 0x90, 60, 100})}));
+
+    REQUIRE(events.size() == 1);
+    REQUIRE(events[0].time_ == Approx(1.0));
+  }
+
+  SECTION("Other events and chunks are skipped") {
+    std::string track = Bytes({0x00, 0xFF, 0x03, 0x04, 'N', 'a', 'm', 'e',
+                               0x00, 0xF0, 0x02, 0x43, 0xF7, 0x00, 0xC0,
+                               0x05, 0x00, 0xE0, 0x00, 0x40, 0x00, 0x90, 60,
+                               100});
+    std::string file = MakeMidiFile(0, 96, {track}) + "XFIH" + Word(2, 4) +
+                       Bytes({0x01, 0x02});
+    std::vector<TimedNoteEvent> events = ParseMidi(file);
+
+    REQUIRE(events.size() == 1);
+    REQUIRE(events[0].event_.type_ == NoteEvent::Type::NoteOn);
+  }
+}
+
+TEST_CASE("Rejects malformed MIDI files", "[getevents]") {
+  SECTION("Files without a MIDI header") {
+    REQUIRE_THROWS_AS(ParseMidi("RIFF0000WAVE"), std::invalid_argument);
+  }
+
+  SECTION("Truncated tracks") {
+    std::string file = MakeMidiFile(0, 96, {Bytes({0x00, 0x90, 60, 100})});
+    REQUIRE_THROWS_AS(ParseMidi(file.substr(0, file.size() - 6)),
+                      std::invalid_argument);
+  }
+
+  SECTION("Data bytes before any status byte") {
+    REQUIRE_THROWS_AS(ParseMidi(MakeMidiFile(0, 96, {Bytes({0x00, 60, 100})})),
+                      std::invalid_argument);
+  }
+}
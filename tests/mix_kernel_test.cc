@@ -0,0 +1,307 @@
+#include "core/mix_kernel.h"
+
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using synther::audio::ComplexMultiplyAccumulateScalar;
+using synther::audio::DotProductScalar;
+using synther::audio::kPcmScale;
+using synther::audio::MixSource;
+using synther::audio::MixVoices;
+using synther::audio::MixVoicesScalar;
+
+namespace {
+
+typedef void (*MixFunction)(const MixSource*, size_t, float*, size_t);
+typedef float (*DotFunction)(const float*, const float*, size_t);
+typedef void (*ComplexFunction)(const float*, const float*, const float*,
+                                const float*, float*, float*, size_t);
+
+// Random voices with ramps that cross both ends of the [0, 1] gain range.
+// Every pcm_interval-th voice stores 16-bit samples, or none if it is 0
+struct RandomVoices {
+  RandomVoices(size_t voice_count, size_t num_frames,
+               size_t pcm_interval = 0) {
+    std::mt19937 generator(voice_count * 1000 + num_frames);
+    std::uniform_real_distribution<float> sample(-1.0f, 1.0f);
+    std::uniform_int_distribution<int16_t> pcm_sample(INT16_MIN, INT16_MAX);
+    std::uniform_real_distribution<float> gain(0.0f, 1.0f);
+    std::uniform_real_distribution<float> step(-0.05f, 0.05f);
+
+    samples_.resize(voice_count, std::vector<float>(num_frames));
+    pcm_samples_.resize(voice_count, std::vector<int16_t>(num_frames));
+    for (size_t index = 0; index < voice_count; index++) {
+      bool is_pcm = pcm_interval > 0 && index % pcm_interval == 0;
+      for (size_t frame = 0; frame < num_frames; frame++) {
+        samples_[index][frame] = sample(generator);
+        pcm_samples_[index][frame] = pcm_sample(generator);
+      }
+      sources_.push_back(MixSource{samples_[index].data(), gain(generator),
+                                   step(generator),
+                                   is_pcm ? pcm_samples_[index].data()
+                                          : nullptr});
+    }
+  }
+
+  std::vector<std::vector<float>> samples_;
+  std::vector<std::vector<int16_t>> pcm_samples_;
+  std::vector<MixSource> sources_;
+};
+
+// Checks that a kernel matches the scalar reference for a range of sizes
+void RequireMatchesScalar(MixFunction mix) {
+  size_t frame_counts[] = {1, 3, 4, 15, 16, 64, 67, 256};
+  size_t voice_counts[] = {0, 1, 7, 128};
+
+  for (size_t num_frames : frame_counts) {
+    for (size_t voice_count : voice_counts) {
+      // Mix float and 16-bit voices together
+      RandomVoices voices(voice_count, num_frames, 2);
+      std::vector<float> expected(num_frames, 0.25f);
+      std::vector<float> actual(num_frames, 0.25f);
+
+      MixVoicesScalar(voices.sources_.data(), voice_count, expected.data(),
+                      num_frames);
+      mix(voices.sources_.data(), voice_count, actual.data(), num_frames);
+
+      for (size_t frame = 0; frame < num_frames; frame++) {
+        REQUIRE(actual[frame] == Approx(expected[frame]).margin(1e-4));
+      }
+    }
+  }
+}
+
+// Checks that a dot product kernel matches the scalar reference
+void RequireDotMatchesScalar(DotFunction dot) {
+  size_t counts[] = {0, 1, 3, 8, 15, 16, 33, 256};
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+
+  for (size_t count : counts) {
+    std::vector<float> first(count);
+    std::vector<float> second(count);
+    for (size_t index = 0; index < count; index++) {
+      first[index] = value(generator);
+      second[index] = value(generator);
+    }
+    float expected = DotProductScalar(first.data(), second.data(), count);
+    REQUIRE(dot(first.data(), second.data(), count) ==
+            Approx(expected).margin(1e-4));
+  }
+}
+
+// Checks that a complex multiply-accumulate kernel matches the scalar
+// reference
+void RequireComplexMatchesScalar(ComplexFunction multiply_accumulate) {
+  size_t counts[] = {0, 1, 3, 8, 15, 16, 33, 65, 1025};
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+
+  for (size_t count : counts) {
+    // Inputs, then the expected and actual real and imaginary outputs
+    std::vector<std::vector<float>> arrays(8, std::vector<float>(count));
+    for (size_t index = 0; index < count; index++) {
+      for (size_t array = 0; array < 4; array++) {
+        arrays[array][index] = value(generator);
+      }
+      arrays[4][index] = arrays[6][index] = value(generator);
+      arrays[5][index] = arrays[7][index] = value(generator);
+    }
+
+    ComplexMultiplyAccumulateScalar(
+        arrays[0].data(), arrays[1].data(), arrays[2].data(),
+        arrays[3].data(), arrays[4].data(), arrays[5].data(), count);
+    multiply_accumulate(arrays[0].data(), arrays[1].data(), arrays[2].data(),
+                        arrays[3].data(), arrays[6].data(), arrays[7].data(),
+                        count);
+    for (size_t index = 0; index < count; index++) {
+      REQUIRE(arrays[6][index] == Approx(arrays[4][index]).margin(1e-5));
+      REQUIRE(arrays[7][index] == Approx(arrays[5][index]).margin(1e-5));
+    }
+  }
+}
+
+// Mixes blocks like the sampler and reports the share of the real-time budget
+void RunMixBenchmark(size_t pcm_interval) {
+  const size_t voice_count = 128;
+  const size_t num_frames = 64;
+  const size_t block_count = 100000;
+  const double sample_rate = 44100;
+
+  RandomVoices voices(voice_count, num_frames, pcm_interval);
+  std::vector<float> output(num_frames);
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t block = 0; block < block_count; block++) {
+    // Two channels per block, like the sampler
+    for (size_t channel = 0; channel < 2; channel++) {
+      MixVoices(voices.sources_.data(), voice_count, output.data(),
+                num_frames);
+    }
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  double seconds_per_block = elapsed.count() / block_count;
+  double budget = num_frames / sample_rate;
+  std::cout << synther::audio::GetMixKernelName()
+            << (pcm_interval > 0 ? " (16-bit): " : ": ")
+            << seconds_per_block * 1e9 << " ns per block, "
+            << 100 * seconds_per_block / budget << "% of the real-time budget"
+            << " (checksum " << output[0] << ")" << std::endl;
+  REQUIRE(seconds_per_block < budget);
+}
+
+}  // namespace
+
+TEST_CASE("Scalar kernel applies a clamped linear gain ramp",
+          "[mixvoicesscalar]") {
+  std::vector<float> samples(8, 1.0f);
+  std::vector<float> output(8, 0.0f);
+
+  SECTION("Ramp down stops at zero") {
+    MixSource source{samples.data(), 0.5f, -0.25f};
+    MixVoicesScalar(&source, 1, output.data(), 4);
+    REQUIRE(output[0] == Approx(0.5f));
+    REQUIRE(output[1] == Approx(0.25f));
+    REQUIRE(output[2] == 0.0f);
+    REQUIRE(output[3] == 0.0f);
+  }
+
+  SECTION("Ramp up stops at one") {
+    MixSource source{samples.data(), 0.5f, 0.25f};
+    MixVoicesScalar(&source, 1, output.data(), 4);
+    REQUIRE(output[1] == Approx(0.75f));
+    REQUIRE(output[2] == 1.0f);
+    REQUIRE(output[3] == 1.0f);
+  }
+
+  SECTION("Sources are added to the existing output") {
+    MixSource sources[] = {{samples.data(), 1.0f, 0.0f},
+                           {samples.data(), 0.5f, 0.0f}};
+    output.assign(8, 1.0f);
+    MixVoicesScalar(sources, 2, output.data(), 8);
+    REQUIRE(output[7] == Approx(2.5f));
+  }
+
+  SECTION("16-bit samples are scaled to the float range") {
+    int16_t pcm_samples[] = {16384, -32768, 32767, 0};
+    MixSource source{nullptr, 1.0f, 0.0f, pcm_samples};
+    MixVoicesScalar(&source, 1, output.data(), 4);
+    REQUIRE(output[0] == Approx(0.5f));
+    REQUIRE(output[1] == -1.0f);
+    REQUIRE(output[2] == Approx(32767 * kPcmScale));
+    REQUIRE(output[3] == 0.0f);
+  }
+}
+
+TEST_CASE("Vectorized kernels match the scalar reference", "[mixvoices]") {
+  SECTION("Dispatched kernel") {
+    RequireMatchesScalar(MixVoices);
+  }
+
+#ifdef SYNTHER_MIX_SSE2
+  SECTION("SSE2 kernel") {
+    RequireMatchesScalar(synther::audio::MixVoicesSse2);
+  }
+#endif
+
+#ifdef SYNTHER_MIX_AVX2
+  SECTION("AVX2 kernel") {
+    RequireMatchesScalar(synther::audio::MixVoicesAvx2);
+  }
+#endif
+
+#ifdef SYNTHER_MIX_NEON
+  SECTION("NEON kernel") {
+    RequireMatchesScalar(synther::audio::MixVoicesNeon);
+  }
+#endif
+}
+
+TEST_CASE("Vectorized dot products match the scalar reference",
+          "[dotproduct]") {
+  SECTION("Scalar kernel") {
+    float first[] = {1, 2, 3};
+    float second[] = {4, -5, 6};
+    REQUIRE(DotProductScalar(first, second, 3) == Approx(12.0f));
+  }
+
+  SECTION("Dispatched kernel") {
+    RequireDotMatchesScalar(synther::audio::DotProduct);
+  }
+
+#ifdef SYNTHER_MIX_SSE2
+  SECTION("SSE2 kernel") {
+    RequireDotMatchesScalar(synther::audio::DotProductSse2);
+  }
+#endif
+
+#ifdef SYNTHER_MIX_AVX2
+  SECTION("AVX2 kernel") {
+    RequireDotMatchesScalar(synther::audio::DotProductAvx2);
+  }
+#endif
+
+#ifdef SYNTHER_MIX_NEON
+  SECTION("NEON kernel") {
+    RequireDotMatchesScalar(synther::audio::DotProductNeon);
+  }
+#endif
+}
+
+TEST_CASE("Vectorized complex multiply-accumulates match the scalar "
+          "reference", "[complexmultiplyaccumulate]") {
+  SECTION("Scalar kernel") {
+    // (1 + 2i)(3 - i) = 5 + 5i, added to 1 - i
+    float first_real[] = {1};
+    float first_imag[] = {2};
+    float second_real[] = {3};
+    float second_imag[] = {-1};
+    float output_real[] = {1};
+    float output_imag[] = {-1};
+    ComplexMultiplyAccumulateScalar(first_real, first_imag, second_real,
+                                    second_imag, output_real, output_imag, 1);
+    REQUIRE(output_real[0] == Approx(6.0f));
+    REQUIRE(output_imag[0] == Approx(4.0f));
+  }
+
+  SECTION("Dispatched kernel") {
+    RequireComplexMatchesScalar(synther::audio::ComplexMultiplyAccumulate);
+  }
+
+#ifdef SYNTHER_MIX_SSE2
+  SECTION("SSE2 kernel") {
+    RequireComplexMatchesScalar(
+        synther::audio::ComplexMultiplyAccumulateSse2);
+  }
+#endif
+
+#ifdef SYNTHER_MIX_AVX2
+  SECTION("AVX2 kernel") {
+    RequireComplexMatchesScalar(
+        synther::audio::ComplexMultiplyAccumulateAvx2);
+  }
+#endif
+
+#ifdef SYNTHER_MIX_NEON
+  SECTION("NEON kernel") {
+    RequireComplexMatchesScalar(
+        synther::audio::ComplexMultiplyAccumulateNeon);
+  }
+#endif
+}
+
+TEST_CASE("Mixing 128 stereo voices at 64-frame blocks", "[.][benchmark]") {
+  SECTION("Float samples") {
+    RunMixBenchmark(0);
+  }
+
+  SECTION("16-bit samples") {
+    RunMixBenchmark(1);
+  }
+}
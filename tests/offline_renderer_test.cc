@@ -0,0 +1,90 @@
+#include "core/offline_renderer.h"
+
+#include <catch2/catch.hpp>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "core/note_event.h"
+#include "core/sample_buffer.h"
+
+using synther::audio::NoteEvent;
+using synther::audio::OfflineRenderer;
+using synther::audio::OfflineRenderStats;
+using synther::audio::SampleBuffer;
+using synther::audio::TimedNoteEvent;
+
+namespace {
+
+// Builds a mono sample where every frame has the same value
+std::shared_ptr<SampleBuffer> MakeConstantSample(size_t num_frames,
+                                                 float value) {
+  auto sample = std::make_shared<SampleBuffer>(1, num_frames);
+  std::fill(sample->GetChannel(0), sample->GetChannel(0) + num_frames, value);
+  return sample;
+}
+
+}  // namespace
+
+TEST_CASE("OfflineRenderer applies events on their exact frame", "[render]") {
+  OfflineRenderer renderer(1000, 2, 0.0);
+  renderer.SetSamples({{60, MakeConstantSample(10000, 1.0f)}});
+
+  SECTION("Note starts and stops on the frames of its events") {
+    std::vector<TimedNoteEvent> events{{0.1, NoteEvent::NoteOn(60)},
+                                       {0.2, NoteEvent::NoteOff(60)}};
+    OfflineRenderStats stats = renderer.Render(events, 1.0);
+    const std::vector<float>& output = renderer.GetOutput();
+
+    // Output is interleaved stereo, so frame f starts at index 2f
+    REQUIRE(output[2 * 99] == 0.0f);
+    REQUIRE(output[2 * 100] == 1.0f);
+    REQUIRE(output[2 * 100 + 1] == 1.0f);
+    REQUIRE(output[2 * 199] == 1.0f);
+    REQUIRE(output[2 * 200] == 0.0f);
+    REQUIRE(stats.rendered_seconds_ >= 0.2);
+  }
+
+  SECTION("Rendering stops once every voice is silent") {
+    std::vector<TimedNoteEvent> events{{0.0, NoteEvent::NoteOn(60)},
+                                       {0.1, NoteEvent::NoteOff(60)}};
+    OfflineRenderStats stats = renderer.Render(events, 5.0);
+    REQUIRE(stats.rendered_seconds_ < 0.2);
+  }
+
+  SECTION("Rendering stops after the longest tail") {
+    std::vector<TimedNoteEvent> events{{0.0, NoteEvent::NoteOn(60)}};
+    OfflineRenderStats stats = renderer.Render(events, 0.5);
+    REQUIRE(stats.rendered_seconds_ == Approx(0.5));
+  }
+
+  SECTION("Rendering twice produces identical output") {
+    std::vector<TimedNoteEvent> events{{0.0, NoteEvent::NoteOn(60)},
+                                       {0.05, NoteEvent::NoteOff(60)}};
+    renderer.Render(events, 1.0);
+    std::vector<float> first = renderer.GetOutput();
+    renderer.Render(events, 1.0);
+    REQUIRE(renderer.GetOutput() == first);
+  }
+}
+
+TEST_CASE("OfflineRenderer writes a float WAV file", "[writewav]") {
+  OfflineRenderer renderer(1000, 2, 0.0);
+  renderer.SetSamples({{60, MakeConstantSample(100, 0.5f)}});
+  renderer.Render({{0.0, NoteEvent::NoteOn(60)}}, 0.01);
+
+  std::stringstream wav;
+  renderer.WriteWav(wav);
+  std::string bytes = wav.str();
+
+  REQUIRE(bytes.size() == 44 + 10 * 2 * sizeof(float));
+  REQUIRE(bytes.substr(0, 4) == "RIFF");
+  REQUIRE(bytes.substr(8, 4) == "WAVE");
+  REQUIRE(bytes.substr(36, 4) == "data");
+
+  float first_sample;
+  std::memcpy(&first_sample, bytes.data() + 44, sizeof(first_sample));
+  REQUIRE(first_sample == 0.5f);
+}
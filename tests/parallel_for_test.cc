@@ -0,0 +1,39 @@
+#include "core/parallel_for.h"
+
+#include <atomic>
+#include <catch2/catch.hpp>
+#include <vector>
+
+using synther::audio::GetHardwareThreadCount;
+using synther::audio::ParallelFor;
+
+TEST_CASE("ParallelFor runs every task exactly once", "[parallelfor]") {
+  SECTION("No tasks") {
+    std::atomic<int> calls(0);
+    ParallelFor(0, 4, [&](size_t) { calls++; });
+    REQUIRE(calls == 0);
+  }
+
+  SECTION("Single thread") {
+    std::vector<int> runs(100, 0);
+    ParallelFor(runs.size(), 1, [&](size_t index) { runs[index]++; });
+    REQUIRE(runs == std::vector<int>(100, 1));
+  }
+
+  SECTION("More threads than tasks") {
+    std::vector<int> runs(3, 0);
+    ParallelFor(runs.size(), 16, [&](size_t index) { runs[index]++; });
+    REQUIRE(runs == std::vector<int>(3, 1));
+  }
+
+  SECTION("One thread per hardware thread") {
+    std::vector<int> runs(1000, 0);
+    ParallelFor(runs.size(), 0, [&](size_t index) { runs[index]++; });
+    REQUIRE(runs == std::vector<int>(1000, 1));
+  }
+}
+
+TEST_CASE("GetHardwareThreadCount is at least one",
+          "[gethardwarethreadcount]") {
+  REQUIRE(GetHardwareThreadCount() >= 1);
+}
@@ -0,0 +1,71 @@
+#include "core/realtime_guard.h"
+
+#include <catch2/catch.hpp>
+#include <future>
+#include <thread>
+
+using synther::audio::RealtimeGuard;
+
+TEST_CASE("RealtimeGuard marks the current thread", "[isactive]") {
+  REQUIRE(!RealtimeGuard::IsActive());
+
+  SECTION("Guards nest") {
+    RealtimeGuard outer;
+    {
+      RealtimeGuard inner;
+      REQUIRE(RealtimeGuard::IsActive());
+    }
+    REQUIRE(RealtimeGuard::IsActive());
+  }
+
+  SECTION("Other threads are not marked") {
+    // The other thread holds its guard until this thread has checked
+    std::promise<void> is_guarded;
+    std::promise<void> is_checked;
+    std::future<void> checked = is_checked.get_future();
+    bool is_other_active = false;
+    std::thread other([&is_guarded, &checked, &is_other_active]() {
+      RealtimeGuard guard;
+      is_other_active = RealtimeGuard::IsActive();
+      is_guarded.set_value();
+      checked.wait();
+    });
+    is_guarded.get_future().wait();
+    bool is_main_active = RealtimeGuard::IsActive();
+    is_checked.set_value();
+    other.join();
+    REQUIRE(is_other_active);
+    REQUIRE(!is_main_active);
+  }
+
+  REQUIRE(!RealtimeGuard::IsActive());
+}
+
+TEST_CASE("RealtimeGuard reports allocations under a guard",
+          "[checkallocation][getviolationcount]") {
+  // Only builds with the replaced allocation functions can check
+  if (!RealtimeGuard::IsChecking()) {
+    return;
+  }
+  RealtimeGuard::SetAbortOnViolation(false);
+  RealtimeGuard::ResetViolationCount();
+
+  SECTION("Allocations outside a guard are allowed") {
+    void* value = ::operator new(sizeof(int));
+    ::operator delete(value);
+    REQUIRE(RealtimeGuard::GetViolationCount() == 0);
+  }
+
+  SECTION("Allocating and freeing under a guard are both reported") {
+    {
+      RealtimeGuard guard;
+      // Called directly, since allocations in new expressions may be elided
+      void* value = ::operator new(sizeof(int));
+      ::operator delete(value);
+    }
+    REQUIRE(RealtimeGuard::GetViolationCount() == 2);
+  }
+
+  RealtimeGuard::ResetViolationCount();
+  RealtimeGuard::SetAbortOnViolation(true);
+}
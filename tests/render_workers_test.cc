@@ -0,0 +1,168 @@
+#include "core/render_workers.h"
+
+#include <algorithm>
+#include <atomic>
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/note_event.h"
+#include "core/parallel_for.h"
+#include "core/sample_buffer.h"
+#include "core/sampler.h"
+
+using synther::audio::GetHardwareThreadCount;
+using synther::audio::NoteEvent;
+using synther::audio::RenderWorkers;
+using synther::audio::SampleBuffer;
+using synther::audio::Sampler;
+
+namespace {
+
+// Reports how much of the real-time budget a stereo sampler spends on
+// 64-frame blocks as its polyphony grows, and how many voices every core
+// could mix before blocks are late. Every voice is pitch-shifted, which is
+// the most expensive kind of voice
+void RunPolyphonyBenchmark(size_t thread_count) {
+  const size_t num_frames = 64;
+  const size_t block_count = 4000;
+  const double sample_rate = 44100;
+  const size_t voice_counts[] = {32, 64, 128, 256};
+
+  auto sample = std::make_shared<SampleBuffer>(2, 600000);
+  for (size_t channel = 0; channel < 2; channel++) {
+    for (size_t frame = 0; frame < sample->GetNumFrames(); frame++) {
+      sample->GetChannel(channel)[frame] =
+          static_cast<float>(frame % 100) / 100.0f;
+    }
+  }
+  std::vector<float> output(2 * num_frames);
+  // Threads beyond the number of cores only take turns
+  size_t core_count = std::min(thread_count, GetHardwareThreadCount());
+
+  for (size_t voice_count : voice_counts) {
+    Sampler sampler(100.0, Sampler::kMaxPolyphony);
+    sampler.SetSampleRate(sample_rate);
+    sampler.SetMaxPitchShift(Sampler::kMaxPitchShift);
+    sampler.SetSamples({{60, sample}});
+    sampler.SetRenderThreadCount(thread_count);
+
+    // Released notes keep ringing, so every strike adds a voice
+    for (size_t voice = 0; voice < voice_count; voice++) {
+      int semitone = 61 + static_cast<int>(voice % 12);
+      sampler.PostEvent(NoteEvent::NoteOn(semitone));
+      sampler.PostEvent(NoteEvent::NoteOff(semitone));
+    }
+    sampler.Render(output.data(), 2, num_frames);
+    sampler.GetLoadMeter().Reset();
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t block = 0; block < block_count; block++) {
+      sampler.Render(output.data(), 2, num_frames);
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    REQUIRE(sampler.GetActiveVoiceCount() == voice_count);
+    double load = elapsed.count() / (block_count * num_frames / sample_rate);
+    std::cout << thread_count << " threads, " << voice_count << " voices: "
+              << 100 * load << "% of the real-time budget, "
+              << sampler.GetLoadMeter().GetLateBlockCount()
+              << " late blocks, about "
+              << static_cast<size_t>(voice_count / load / core_count)
+              << " voices per core before the deadline (checksum "
+              << output[0] << ")" << std::endl;
+  }
+}
+
+}  // namespace
+
+TEST_CASE("RenderWorkers runs every task exactly once", "[run]") {
+  std::vector<std::atomic<int>> runs(64);
+  auto count_run = [&runs](size_t index) { runs[index]++; };
+  auto require_runs = [&runs](size_t count, int expected) {
+    for (size_t index = 0; index < runs.size(); index++) {
+      REQUIRE(runs[index].load() == (index < count ? expected : 0));
+    }
+  };
+  for (std::atomic<int>& run : runs) {
+    run.store(0);
+  }
+
+  SECTION("No tasks") {
+    RenderWorkers workers(2, count_run);
+    workers.Run(0);
+    require_runs(0, 0);
+  }
+
+  SECTION("No workers") {
+    RenderWorkers workers(0, count_run);
+    REQUIRE(workers.GetWorkerCount() == 0);
+    workers.Run(10);
+    require_runs(10, 1);
+    REQUIRE(workers.GetHelpedTaskCount() == 0);
+  }
+
+  SECTION("Unpinned workers") {
+    RenderWorkers workers(3, count_run, false);
+    REQUIRE(workers.GetWorkerCount() == 3);
+    workers.Run(64);
+    require_runs(64, 1);
+  }
+
+  SECTION("Jobs of different sizes in quick succession") {
+    RenderWorkers workers(3, count_run);
+    size_t counts[] = {4, 1, 64, 2, 3};
+    for (int round = 0; round < 200; round++) {
+      for (size_t count : counts) {
+        workers.Run(count);
+      }
+    }
+    for (size_t index = 0; index < runs.size(); index++) {
+      int expected = 200 * (1 + (index < 1) + (index < 2) + (index < 3) +
+                            (index < 4));
+      REQUIRE(runs[index].load() == expected);
+    }
+  }
+
+  SECTION("Jobs from a new calling thread") {
+    // The workers copy the scheduling of every thread that calls Run()
+    RenderWorkers workers(2, count_run);
+    workers.Run(8);
+    std::thread caller([&workers]() { workers.Run(8); });
+    caller.join();
+    workers.Run(8);
+    require_runs(8, 3);
+  }
+}
+
+TEST_CASE("RenderWorkers share tasks with the calling thread",
+          "[run][gethelpedtaskcount]") {
+  // Every task waits until another thread has started one, so a single
+  // thread can't finish a job on its own before a worker joins in
+  std::atomic<size_t> started(0);
+  RenderWorkers workers(2, [&started](size_t) {
+    started++;
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::milliseconds(100);
+    while (started.load() < 2 && std::chrono::steady_clock::now() < deadline) {
+    }
+  });
+
+  workers.Run(2);
+  REQUIRE(started.load() == 2);
+  REQUIRE(workers.GetHelpedTaskCount() >= 1);
+}
+
+TEST_CASE("Mixing voices on several threads", "[.][benchmark]") {
+  size_t thread_counts[] = {1, 2, 4};
+  for (size_t thread_count : thread_counts) {
+    SECTION(std::to_string(thread_count) + " threads") {
+      RunPolyphonyBenchmark(thread_count);
+    }
+  }
+}
@@ -0,0 +1,135 @@
+#include "core/resampler.h"
+
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "core/mix_kernel.h"
+
+using synther::audio::Resampler;
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+
+// Builds a sine wave with unit amplitude
+std::vector<float> MakeSine(double frequency, double sample_rate,
+                            size_t num_frames) {
+  std::vector<float> samples(num_frames);
+  for (size_t frame = 0; frame < num_frames; frame++) {
+    samples[frame] =
+        static_cast<float>(std::sin(2 * kPi * frequency * frame / sample_rate));
+  }
+  return samples;
+}
+
+}  // namespace
+
+TEST_CASE("Resampler sizes the converted buffer",
+          "[getoutputframes][getphasecount]") {
+  SECTION("One second stays one second") {
+    Resampler resampler(44100, 48000);
+    REQUIRE(resampler.GetOutputFrames(44100) == 48000);
+  }
+
+  SECTION("Partial frames are rounded up") {
+    Resampler resampler(48000, 44100);
+    REQUIRE(resampler.GetOutputFrames(1) == 1);
+    REQUIRE(resampler.GetOutputFrames(0) == 0);
+  }
+
+  SECTION("Every position between input frames has its own phase") {
+    Resampler resampler(44100, 48000);
+    REQUIRE(resampler.GetPhaseCount() == 160);
+  }
+
+  SECTION("Ratios with too many positions share phases") {
+    Resampler resampler(44100, 47999);
+    REQUIRE(resampler.GetPhaseCount() == Resampler::kMaxPhases);
+  }
+}
+
+TEST_CASE("Resampler converts between sample rates", "[process]") {
+  SECTION("Matching rates copy the input") {
+    std::vector<float> input = MakeSine(440, 44100, 1000);
+    Resampler resampler(44100, 44100);
+    std::vector<float> output(resampler.GetOutputFrames(input.size()));
+    resampler.Process(input.data(), input.size(), output.data());
+    REQUIRE(output == input);
+  }
+
+  SECTION("Constant signals pass through unchanged") {
+    std::vector<float> input(1000, 0.5f);
+    Resampler resampler(44100, 48000);
+    std::vector<float> output(resampler.GetOutputFrames(input.size()));
+    resampler.Process(input.data(), input.size(), output.data());
+    for (size_t frame = 100; frame < output.size() - 100; frame++) {
+      REQUIRE(output[frame] == Approx(0.5f).margin(1e-5));
+    }
+  }
+
+  SECTION("Upsampled tones keep their pitch") {
+    std::vector<float> input = MakeSine(440, 44100, 44100);
+    Resampler resampler(44100, 48000);
+    std::vector<float> output(resampler.GetOutputFrames(input.size()));
+    resampler.Process(input.data(), input.size(), output.data());
+
+    std::vector<float> expected = MakeSine(440, 48000, output.size());
+    for (size_t frame = 100; frame < output.size() - 100; frame++) {
+      REQUIRE(output[frame] == Approx(expected[frame]).margin(1e-3));
+    }
+  }
+
+  SECTION("Downsampled tones keep their pitch") {
+    std::vector<float> input = MakeSine(1000, 48000, 48000);
+    Resampler resampler(48000, 44100);
+    std::vector<float> output(resampler.GetOutputFrames(input.size()));
+    resampler.Process(input.data(), input.size(), output.data());
+
+    std::vector<float> expected = MakeSine(1000, 44100, output.size());
+    for (size_t frame = 100; frame < output.size() - 100; frame++) {
+      REQUIRE(output[frame] == Approx(expected[frame]).margin(1e-3));
+    }
+  }
+
+  SECTION("Tones above the new Nyquist frequency are removed") {
+    std::vector<float> input = MakeSine(15000, 48000, 48000);
+    Resampler resampler(48000, 22050);
+    std::vector<float> output(resampler.GetOutputFrames(input.size()));
+    resampler.Process(input.data(), input.size(), output.data());
+
+    double energy = 0;
+    for (size_t frame = 100; frame < output.size() - 100; frame++) {
+      energy += output[frame] * output[frame];
+    }
+    double rms = std::sqrt(energy / (output.size() - 200));
+    REQUIRE(rms < 1e-3);
+  }
+}
+
+TEST_CASE("Resampling a minute of audio from 44.1 to 48 kHz",
+          "[.][benchmark]") {
+  const size_t input_rate = 44100;
+  const size_t output_rate = 48000;
+  const size_t num_frames = 60 * input_rate;
+
+  std::vector<float> input = MakeSine(440, input_rate, num_frames);
+  Resampler resampler(input_rate, output_rate);
+  std::vector<float> output(resampler.GetOutputFrames(num_frames));
+
+  auto start = std::chrono::steady_clock::now();
+  resampler.Process(input.data(), input.size(), output.data());
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  double frames_per_second = output.size() / elapsed.count();
+  std::cout << synther::audio::GetMixKernelName() << ": "
+            << frames_per_second / 1e6 << " million frames per second, "
+            << frames_per_second / output_rate << "x real time with "
+            << resampler.GetTapCount() << " taps"
+            << " (checksum " << output[output.size() / 3] << ")"
+            << std::endl;
+  REQUIRE(frames_per_second > 100 * output_rate);
+}
@@ -0,0 +1,96 @@
+#include "core/sample_buffer.h"
+
+#include <catch2/catch.hpp>
+#include <cstdint>
+#include <memory>
+
+#include "core/mix_kernel.h"
+
+using synther::audio::kPcmScale;
+using synther::audio::SampleBuffer;
+using synther::audio::SampleFormat;
+
+TEST_CASE("SampleBuffer measures the memory of its format",
+          "[getmemorysize][getsamplesize]") {
+  const size_t kFrames = 1000;
+  size_t storage_size = SampleBuffer::GetStorageSize(2, kFrames);
+
+  SECTION("Float samples take four bytes") {
+    SampleBuffer sample(2, kFrames);
+    REQUIRE(sample.GetFormat() == SampleFormat::Float32);
+    REQUIRE(sample.GetMemorySize() == storage_size * 4);
+  }
+
+  SECTION("16-bit samples take two bytes") {
+    SampleBuffer sample(2, kFrames, SampleFormat::Int16);
+    REQUIRE(sample.GetMemorySize() == storage_size * 2);
+  }
+}
+
+TEST_CASE("SampleBuffer converts to compact formats", "[convert]") {
+  SampleBuffer sample(2, 4);
+  float left[] = {0.5f, -1.0f, 2.0f, 0.25f};
+  float right[] = {0.5f, 0.0f, 1.0f, -0.25f};
+  std::copy(left, left + 4, sample.GetChannel(0));
+  std::copy(right, right + 4, sample.GetChannel(1));
+
+  SECTION("16-bit samples round to the nearest step and clip") {
+    auto converted = sample.Convert(SampleFormat::Int16, false);
+    REQUIRE(converted->GetFormat() == SampleFormat::Int16);
+    REQUIRE(converted->GetNumChannels() == 2);
+    const int16_t* channel = converted->GetPcmChannel(0);
+    REQUIRE(channel[0] == 16384);
+    REQUIRE(channel[1] == -32768);
+    REQUIRE(channel[2] == 32767);
+    REQUIRE(channel[3] == 8192);
+    REQUIRE(converted->GetPcmChannel(1)[3] == -8192);
+    REQUIRE(channel[4] == 0);
+  }
+
+  SECTION("Downmixing averages the channels") {
+    auto converted = sample.Convert(SampleFormat::Float32, true);
+    REQUIRE(converted->GetNumChannels() == 1);
+    REQUIRE(converted->GetNumFrames() == 4);
+    REQUIRE(converted->GetChannel(0)[0] == 0.5f);
+    REQUIRE(converted->GetChannel(0)[1] == -0.5f);
+    REQUIRE(converted->GetChannel(0)[3] == 0.0f);
+  }
+
+  SECTION("Converted samples read back as floats") {
+    auto converted = sample.Convert(SampleFormat::Int16, true);
+    float frames[4];
+    converted->CopyFrames(0, 0, 4, frames);
+    REQUIRE(frames[0] == 0.5f);
+    REQUIRE(frames[1] == -0.5f);
+    REQUIRE(frames[2] == 32767 * kPcmScale);
+    REQUIRE(converted->GetMemorySize() * 4 == sample.GetMemorySize());
+  }
+}
+
+TEST_CASE("SampleBuffer detects channels that hold the same audio",
+          "[ismonocompatible]") {
+  SampleBuffer sample(2, 3000);
+  for (size_t frame = 0; frame < 3000; frame++) {
+    float value = static_cast<float>(frame % 100) / 100;
+    sample.GetChannel(0)[frame] = value;
+    sample.GetChannel(1)[frame] = value;
+  }
+
+  SECTION("Identical channels") {
+    REQUIRE(sample.IsMonoCompatible());
+  }
+
+  SECTION("Differences below the tolerance") {
+    sample.GetChannel(1)[2500] += SampleBuffer::kMonoTolerance / 2;
+    REQUIRE(sample.IsMonoCompatible());
+  }
+
+  SECTION("Differences above the tolerance") {
+    sample.GetChannel(1)[2500] += 2 * SampleBuffer::kMonoTolerance;
+    REQUIRE(!sample.IsMonoCompatible());
+  }
+
+  SECTION("Mono samples") {
+    REQUIRE(SampleBuffer(1, 100).IsMonoCompatible());
+  }
+}
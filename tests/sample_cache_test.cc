@@ -0,0 +1,254 @@
+#include "core/sample_cache.h"
+
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using synther::audio::SampleBuffer;
+using synther::audio::SampleBufferRef;
+using synther::audio::SampleCache;
+using synther::audio::SampleFormat;
+
+namespace {
+
+void WriteFile(const std::string& path, const std::string& contents) {
+  std::ofstream file(path, std::ios::binary);
+  file << contents;
+}
+
+bool FileExists(const std::string& path) {
+  return std::ifstream(path).is_open();
+}
+
+void MakeDirectory(const std::string& path) {
+#ifdef _WIN32
+  _mkdir(path.c_str());
+#else
+  mkdir(path.c_str(), 0755);
+#endif
+}
+
+void RemoveDirectory(const std::string& path) {
+#ifdef _WIN32
+  _rmdir(path.c_str());
+#else
+  rmdir(path.c_str());
+#endif
+}
+
+}  // namespace
+
+TEST_CASE("SampleCache keys depend on file contents and sample rate",
+          "[computekey]") {
+  const std::string source_path = "sample_cache_test_source.mp3";
+  WriteFile(source_path, "first recording");
+  std::string key = SampleCache::ComputeKey(source_path, 44100);
+
+  SECTION("Same file and rate") {
+    REQUIRE(SampleCache::ComputeKey(source_path, 44100) == key);
+  }
+
+  SECTION("Different sample rate") {
+    REQUIRE(SampleCache::ComputeKey(source_path, 48000) != key);
+  }
+
+  SECTION("Edited file") {
+    WriteFile(source_path, "second recording");
+    REQUIRE(SampleCache::ComputeKey(source_path, 44100) != key);
+  }
+
+  SECTION("Different storage") {
+    REQUIRE(SampleCache::ComputeKey(source_path, 44100,
+                                    SampleFormat::Int16) != key);
+    REQUIRE(SampleCache::ComputeKey(source_path, 44100, SampleFormat::Float32,
+                                    true) != key);
+  }
+
+  SECTION("Missing file") {
+    REQUIRE(SampleCache::ComputeKey("missing_file.mp3", 44100).empty());
+  }
+
+  std::remove(source_path.c_str());
+}
+
+TEST_CASE("SampleCache loads the samples it stored", "[store][load]") {
+  SampleCache cache(".");
+  const std::string key = "sample_cache_test_entry";
+
+  SampleBuffer sample(2, 1000);
+  for (size_t frame = 0; frame < sample.GetNumFrames(); frame++) {
+    sample.GetChannel(0)[frame] = static_cast<float>(frame);
+    sample.GetChannel(1)[frame] = -static_cast<float>(frame);
+  }
+
+  SECTION("Missing entry") {
+    REQUIRE(cache.Load(key) == nullptr);
+  }
+
+  SECTION("Stored entry keeps samples and padding") {
+    REQUIRE(cache.Store(key, sample));
+    SampleBufferRef loaded = cache.Load(key);
+    REQUIRE(loaded != nullptr);
+    REQUIRE(loaded->GetNumChannels() == 2);
+    REQUIRE(loaded->GetNumFrames() == 1000);
+    for (size_t frame = 0; frame < 1000; frame++) {
+      REQUIRE(loaded->GetChannel(0)[frame] == static_cast<float>(frame));
+      REQUIRE(loaded->GetChannel(1)[frame] == -static_cast<float>(frame));
+    }
+    for (size_t frame = 1000; frame < 1000 + SampleBuffer::kPaddingFrames;
+         frame++) {
+      REQUIRE(loaded->GetChannel(0)[frame] == 0.0f);
+      REQUIRE(loaded->GetChannel(1)[frame] == 0.0f);
+    }
+  }
+
+  SECTION("Loaded samples outlive the cache file") {
+    REQUIRE(cache.Store(key, sample));
+    SampleBufferRef loaded = cache.Load(key);
+    std::remove(cache.GetPath(key).c_str());
+    REQUIRE(loaded->GetChannel(0)[999] == 999.0f);
+  }
+
+  SECTION("16-bit entries keep their format") {
+    SampleBuffer pcm_sample(1, 1000, SampleFormat::Int16);
+    pcm_sample.GetPcmChannel(0)[999] = -1234;
+    REQUIRE(cache.Store(key, pcm_sample));
+    SampleBufferRef loaded = cache.Load(key);
+    REQUIRE(loaded != nullptr);
+    REQUIRE(loaded->GetFormat() == SampleFormat::Int16);
+    REQUIRE(loaded->GetPcmChannel(0)[999] == -1234);
+    REQUIRE(loaded->GetMemorySize() == pcm_sample.GetMemorySize());
+  }
+
+  SECTION("Truncated entry is ignored and removed") {
+    REQUIRE(cache.Store(key, sample));
+    WriteFile(cache.GetPath(key), "SYNPCM");
+    REQUIRE(cache.Load(key) == nullptr);
+    REQUIRE(!FileExists(cache.GetPath(key)));
+  }
+
+  SECTION("Entry of another version is ignored and removed") {
+    // The version follows the 8-byte magic
+    REQUIRE(cache.Store(key, sample));
+    {
+      std::fstream entry(cache.GetPath(key),
+                         std::ios::binary | std::ios::in | std::ios::out);
+      entry.seekp(8);
+      entry.put(1);
+    }
+    REQUIRE(cache.LoadHead(key, 100) == nullptr);
+    REQUIRE(!FileExists(cache.GetPath(key)));
+  }
+
+  std::remove(cache.GetPath(key).c_str());
+}
+
+TEST_CASE("SampleCache streams long samples past their heads",
+          "[loadhead]") {
+  SampleCache cache(".");
+  const std::string key = "sample_cache_test_stream";
+
+  SECTION("Long samples keep only their heads in memory") {
+    SampleBuffer sample(2, 100000);
+    sample.GetChannel(1)[50] = 0.5f;
+    REQUIRE(cache.Store(key, sample));
+
+    SampleBufferRef head = cache.LoadHead(key, 1000);
+    REQUIRE(head != nullptr);
+    REQUIRE(head->GetNumFrames() == 1000);
+    REQUIRE(head->GetTotalFrames() == 100000);
+    REQUIRE(head->GetChannel(1)[50] == 0.5f);
+    REQUIRE(head->GetStreamSource()->GetNumChannels() == 2);
+    REQUIRE(head->GetStreamSource()->GetPath() == cache.GetPath(key));
+  }
+
+  SECTION("16-bit heads stay 16-bit") {
+    SampleBuffer sample(1, 100000, SampleFormat::Int16);
+    sample.GetPcmChannel(0)[50] = 16384;
+    REQUIRE(cache.Store(key, sample));
+
+    SampleBufferRef head = cache.LoadHead(key, 1000);
+    REQUIRE(head != nullptr);
+    REQUIRE(head->GetFormat() == SampleFormat::Int16);
+    REQUIRE(head->GetPcmChannel(0)[50] == 16384);
+    REQUIRE(head->GetStreamSource() != nullptr);
+  }
+
+  SECTION("Short samples are loaded whole") {
+    SampleBuffer sample(1, 2000);
+    REQUIRE(cache.Store(key, sample));
+
+    SampleBufferRef whole = cache.LoadHead(key, 1000);
+    REQUIRE(whole != nullptr);
+    REQUIRE(whole->GetNumFrames() == 2000);
+    REQUIRE(whole->GetStreamSource() == nullptr);
+  }
+
+  SECTION("Missing entry") {
+    REQUIRE(cache.LoadHead(key, 1000) == nullptr);
+  }
+
+  std::remove(cache.GetPath(key).c_str());
+}
+
+TEST_CASE("SampleCache keeps its directory within a byte budget",
+          "[store][load][prune]") {
+  const std::string directory = "sample_cache_test_budget";
+  MakeDirectory(directory);
+  SampleBuffer sample(1, 1000);
+  SampleCache unbounded(directory);
+  REQUIRE(unbounded.Store("a", sample));
+  std::ifstream entry(unbounded.GetPath("a"), std::ios::binary | std::ios::ate);
+  uint64_t entry_size = static_cast<uint64_t>(entry.tellg());
+  entry.close();
+
+  // Entries are told apart by when they were used, so they are used a few
+  // milliseconds apart
+  auto wait = []() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  };
+  SampleCache cache(directory, 2 * entry_size + entry_size / 2);
+
+  SECTION("The least recently used entries are removed first") {
+    wait();
+    REQUIRE(cache.Store("b", sample));
+    wait();
+    REQUIRE(cache.Load("a") != nullptr);
+    wait();
+    REQUIRE(cache.Store("c", sample));
+    REQUIRE(FileExists(cache.GetPath("a")));
+    REQUIRE(!FileExists(cache.GetPath("b")));
+    REQUIRE(FileExists(cache.GetPath("c")));
+  }
+
+  SECTION("The stored entry is kept however small the budget") {
+    SampleCache tiny(directory, 1);
+    wait();
+    REQUIRE(tiny.Store("b", sample));
+    REQUIRE(!FileExists(cache.GetPath("a")));
+    REQUIRE(FileExists(cache.GetPath("b")));
+  }
+
+  SECTION("Entries within the budget are kept") {
+    wait();
+    REQUIRE(cache.Store("b", sample));
+    REQUIRE(FileExists(cache.GetPath("a")));
+    REQUIRE(FileExists(cache.GetPath("b")));
+  }
+
+  for (const char* key : {"a", "b", "c"}) {
+    std::remove(cache.GetPath(key).c_str());
+  }
+  RemoveDirectory(directory);
+}
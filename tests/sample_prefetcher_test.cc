@@ -0,0 +1,126 @@
+#include "core/sample_prefetcher.h"
+
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using synther::audio::SampleBuffer;
+using synther::audio::SampleBufferRef;
+using synther::audio::SamplePrefetcher;
+
+namespace {
+
+void WaitUntilIdle(const SamplePrefetcher& prefetcher) {
+  while (!prefetcher.IsIdle()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+}  // namespace
+
+TEST_CASE("SamplePrefetcher loads requested notes in the background",
+          "[request][takeloaded][isidle]") {
+  std::mutex order_mutex;
+  std::vector<int> load_order;
+  SamplePrefetcher prefetcher([&](int semitone) -> SampleBufferRef {
+    std::lock_guard<std::mutex> lock(order_mutex);
+    load_order.push_back(semitone);
+    // Odd semitones have no sound file
+    if (semitone % 2 == 1) {
+      return nullptr;
+    }
+    return std::make_shared<SampleBuffer>(1, semitone + 1);
+  });
+
+  SECTION("Idle before any request") {
+    REQUIRE(prefetcher.IsIdle());
+    REQUIRE(prefetcher.TakeLoaded().empty());
+  }
+
+  SECTION("Notes are loaded in the order they were requested") {
+    prefetcher.Request({60, 64, 62});
+    WaitUntilIdle(prefetcher);
+    REQUIRE(load_order == std::vector<int>{60, 64, 62});
+
+    auto loaded = prefetcher.TakeLoaded();
+    REQUIRE(loaded.size() == 3);
+    REQUIRE(loaded[64]->GetNumFrames() == 65);
+    REQUIRE(prefetcher.TakeLoaded().empty());
+  }
+
+  SECTION("Notes that fail to load map to nullptr") {
+    prefetcher.Request({61});
+    WaitUntilIdle(prefetcher);
+    auto loaded = prefetcher.TakeLoaded();
+    REQUIRE(loaded.size() == 1);
+    REQUIRE(loaded[61] == nullptr);
+  }
+
+  SECTION("Loaded notes are not loaded again until taken") {
+    prefetcher.Request({60});
+    WaitUntilIdle(prefetcher);
+    prefetcher.Request({60, 62});
+    WaitUntilIdle(prefetcher);
+    REQUIRE(load_order == std::vector<int>{60, 62});
+  }
+}
+
+TEST_CASE("SamplePrefetcher requests replace notes that have not started",
+          "[request]") {
+  std::promise<void> started;
+  std::promise<void> gate;
+  std::shared_future<void> gate_opened = gate.get_future().share();
+  std::vector<int> load_order;
+
+  SamplePrefetcher prefetcher([&](int semitone) -> SampleBufferRef {
+    load_order.push_back(semitone);
+    if (semitone == 1) {
+      started.set_value();
+      gate_opened.wait();
+    }
+    return std::make_shared<SampleBuffer>(1, 1);
+  });
+
+  prefetcher.Request({1, 2, 3});
+  started.get_future().wait();
+
+  // Note 1 is already loading, so only note 4 is left to load
+  prefetcher.Request({4, 1});
+  gate.set_value();
+  WaitUntilIdle(prefetcher);
+
+  REQUIRE(load_order == std::vector<int>{1, 4});
+  REQUIRE(prefetcher.TakeLoaded().size() == 2);
+}
+
+TEST_CASE("SamplePrefetcher discards loads started before a reset",
+          "[reset]") {
+  std::promise<void> started;
+  std::promise<void> gate;
+  std::shared_future<void> gate_opened = gate.get_future().share();
+
+  SamplePrefetcher prefetcher([&](int semitone) -> SampleBufferRef {
+    started.set_value();
+    gate_opened.wait();
+    return std::make_shared<SampleBuffer>(1, semitone);
+  });
+  prefetcher.Request({1, 2});
+  started.get_future().wait();
+
+  // Switch instruments while note 1 of the old instrument is loading
+  prefetcher.Reset([](int semitone) -> SampleBufferRef {
+    return std::make_shared<SampleBuffer>(2, semitone);
+  });
+  REQUIRE(prefetcher.IsIdle());
+  prefetcher.Request({1});
+  gate.set_value();
+  WaitUntilIdle(prefetcher);
+
+  auto loaded = prefetcher.TakeLoaded();
+  REQUIRE(loaded.size() == 1);
+  REQUIRE(loaded[1]->GetNumChannels() == 2);
+}
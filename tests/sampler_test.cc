@@ -0,0 +1,1111 @@
+#include "core/sampler.h"
+
+#include <atomic>
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/note_event.h"
+#include "core/realtime_guard.h"
+#include "core/sample_buffer.h"
+#include "core/sample_cache.h"
+
+using synther::audio::ConvolutionReverb;
+using synther::audio::LatencyHistogram;
+using synther::audio::LoadMeter;
+using synther::audio::NoteEvent;
+using synther::audio::RealtimeGuard;
+using synther::audio::RenderWorkers;
+using synther::audio::SampleBuffer;
+using synther::audio::SampleBufferRef;
+using synther::audio::SampleCache;
+using synther::audio::SampleFormat;
+using synther::audio::Sampler;
+using synther::audio::TimedNoteEvent;
+
+namespace {
+
+// Builds a mono sample where every frame has the same value
+SampleBufferRef MakeConstantSample(size_t num_frames, float value) {
+  auto sample = std::make_shared<SampleBuffer>(1, num_frames);
+  std::fill(sample->GetChannel(0), sample->GetChannel(0) + num_frames, value);
+  return sample;
+}
+
+// Builds a mono sample whose frames rise from 0 to 1, so the frame being
+// played can be told from its value
+SampleBufferRef MakeRampSample(size_t num_frames) {
+  auto sample = std::make_shared<SampleBuffer>(1, num_frames);
+  for (size_t frame = 0; frame < num_frames; frame++) {
+    sample->GetChannel(0)[frame] = static_cast<float>(frame) / num_frames;
+  }
+  return sample;
+}
+
+}  // namespace
+
+TEST_CASE("Sampler only renders notes that are sounding",
+          "[noteon][render][getactivevoicecount]") {
+  Sampler sampler(1.0);
+  sampler.SetSampleRate(100);
+  sampler.SetSamples({{60, MakeConstantSample(1000, 0.5f)},
+                      {62, MakeConstantSample(1000, 0.25f)}});
+  std::vector<float> output(2 * 10, 1.0f);
+
+  SECTION("Renders silence when no notes are playing") {
+    sampler.Render(output.data(), 2, 10);
+    REQUIRE(sampler.GetActiveVoiceCount() == 0);
+    for (float sample : output) {
+      REQUIRE(sample == 0.0f);
+    }
+  }
+
+  SECTION("Mixes every playing note into every channel") {
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.PostEvent(NoteEvent::NoteOn(62));
+    sampler.Render(output.data(), 2, 10);
+    REQUIRE(sampler.GetActiveVoiceCount() == 2);
+    for (float sample : output) {
+      REQUIRE(sample == Approx(0.75f));
+    }
+  }
+
+  SECTION("Ignores semitones without a sample") {
+    sampler.PostEvent(NoteEvent::NoteOn(61));
+    sampler.PostEvent(NoteEvent::NoteOn(-1));
+    sampler.PostEvent(NoteEvent::NoteOn(1000));
+    sampler.Render(output.data(), 2, 10);
+    REQUIRE(sampler.GetActiveVoiceCount() == 0);
+  }
+}
+
+TEST_CASE("Sampler fades released notes over the resonate duration",
+          "[noteoff][setresonateduration][render]") {
+  Sampler sampler(1.0);
+  sampler.SetSampleRate(100);
+  sampler.SetSamples({{60, MakeConstantSample(1000, 1.0f)}});
+  std::vector<float> output(100);
+
+  SECTION("Released note fades to silence and stops sounding") {
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.PostEvent(NoteEvent::NoteOff(60));
+    sampler.Render(output.data(), 1, 50);
+    REQUIRE(output[0] == Approx(1.0f));
+    REQUIRE(output[49] < output[0]);
+    REQUIRE(sampler.GetActiveVoiceCount() == 1);
+
+    sampler.Render(output.data(), 1, 100);
+    REQUIRE(output[99] == 0.0f);
+    REQUIRE(sampler.GetActiveVoiceCount() == 0);
+  }
+
+  SECTION("Shorter resonate duration shortens fading notes") {
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.PostEvent(NoteEvent::NoteOff(60));
+    sampler.PostEvent(NoteEvent::ResonateChange(0.1));
+    sampler.Render(output.data(), 1, 20);
+    REQUIRE(output[19] == 0.0f);
+    REQUIRE(sampler.GetActiveVoiceCount() == 0);
+  }
+
+  SECTION("Note stops sounding when its sample ends") {
+    sampler.SetSamples({{60, MakeConstantSample(30, 1.0f)}});
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.Render(output.data(), 1, 50);
+    REQUIRE(output[29] == 1.0f);
+    REQUIRE(output[30] == 0.0f);
+    REQUIRE(sampler.GetActiveVoiceCount() == 0);
+  }
+}
+
+TEST_CASE("Sampler raises struck notes over the attack duration",
+          "[setattackduration][render]") {
+  Sampler sampler(0.1);
+  sampler.SetSampleRate(100);
+  sampler.SetSamples({{60, MakeConstantSample(1000, 1.0f)}});
+  sampler.SetAttackDuration(0.1);
+  std::vector<float> output(64);
+
+  SECTION("Gain rises from silence and holds part-way through the block") {
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.Render(output.data(), 1, 64);
+    REQUIRE(output[0] == 0.0f);
+    REQUIRE(output[5] == Approx(0.5f));
+    REQUIRE(output[10] == 1.0f);
+    REQUIRE(output[63] == 1.0f);
+  }
+
+  SECTION("Notes released during the attack fade from their current gain") {
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.Render(output.data(), 1, 5);
+    sampler.PostEvent(NoteEvent::NoteOff(60));
+    sampler.Render(output.data(), 1, 64);
+    REQUIRE(output[0] == Approx(0.5f));
+    REQUIRE(output[5] == Approx(0.25f));
+    REQUIRE(output[10] == 0.0f);
+    REQUIRE(sampler.GetActiveVoiceCount() == 0);
+  }
+
+  SECTION("The attack only applies to notes struck after it is set") {
+    sampler.SetAttackDuration(0);
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.Render(output.data(), 1, 64);
+    REQUIRE(output[0] == 1.0f);
+  }
+}
+
+TEST_CASE("Sampler sustains notes released while the pedal is down",
+          "[sustainon][sustainoff][render]") {
+  Sampler sampler(0.1);
+  sampler.SetSampleRate(100);
+  sampler.SetSamples({{60, MakeConstantSample(1000, 1.0f)},
+                      {62, MakeConstantSample(1000, 0.5f)}});
+  std::vector<float> output(20);
+
+  SECTION("Released notes keep sounding at full gain") {
+    sampler.PostEvent(NoteEvent::SustainOn());
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.PostEvent(NoteEvent::NoteOff(60));
+    sampler.Render(output.data(), 1, 20);
+    sampler.Render(output.data(), 1, 20);
+    REQUIRE(output[19] == 1.0f);
+    REQUIRE(sampler.IsSounding(60));
+  }
+
+  SECTION("Lifting the pedal releases only the sustained notes") {
+    sampler.PostEvent(NoteEvent::SustainOn());
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.PostEvent(NoteEvent::NoteOn(62));
+    sampler.PostEvent(NoteEvent::NoteOff(60));
+    sampler.PostEvent(NoteEvent::SustainOff());
+    sampler.Render(output.data(), 1, 20);
+    REQUIRE(output[0] == Approx(1.5f));
+    REQUIRE(output[19] == Approx(0.5f));
+    REQUIRE(!sampler.IsSounding(60));
+    REQUIRE(sampler.IsSounding(62));
+  }
+
+  SECTION("Notes released after the pedal is lifted fade as usual") {
+    sampler.PostEvent(NoteEvent::SustainOn());
+    sampler.PostEvent(NoteEvent::SustainOff());
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.PostEvent(NoteEvent::NoteOff(60));
+    sampler.Render(output.data(), 1, 20);
+    REQUIRE(output[10] == 0.0f);
+    REQUIRE(sampler.GetActiveVoiceCount() == 0);
+  }
+
+  SECTION("Struck notes keep their sustained voices ringing") {
+    sampler.PostEvent(NoteEvent::SustainOn());
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.PostEvent(NoteEvent::NoteOff(60));
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.Render(output.data(), 1, 20);
+    REQUIRE(sampler.GetActiveVoiceCount() == 2);
+    REQUIRE(output[19] == Approx(2.0f));
+  }
+}
+
+TEST_CASE("Sampler gives every strike of a note its own voice",
+          "[noteon][noteoff][setpolyphony][getstolenvoicecount]") {
+  Sampler sampler(1.0);
+  sampler.SetSampleRate(100);
+  sampler.SetSamples({{60, MakeConstantSample(1000, 1.0f)},
+                      {62, MakeConstantSample(1000, 1.0f)}});
+  std::vector<float> output(10);
+
+  SECTION("Striking a resonating note keeps its tail ringing") {
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.PostEvent(NoteEvent::NoteOff(60));
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.Render(output.data(), 1, 10);
+    REQUIRE(sampler.GetActiveVoiceCount() == 2);
+    REQUIRE(output[0] == Approx(2.0f));
+  }
+
+  SECTION("Striking a held note again does nothing") {
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.Render(output.data(), 1, 10);
+    REQUIRE(sampler.GetActiveVoiceCount() == 1);
+  }
+
+  SECTION("Releasing a note releases only its held voice") {
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.PostEvent(NoteEvent::NoteOn(62));
+    sampler.PostEvent(NoteEvent::NoteOff(60));
+    sampler.PostEvent(NoteEvent::ResonateChange(0));
+    sampler.Render(output.data(), 1, 10);
+    REQUIRE(sampler.GetActiveVoiceCount() == 1);
+  }
+
+  SECTION("Voices are stolen once the polyphony is reached") {
+    sampler.SetPolyphony(2);
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.PostEvent(NoteEvent::NoteOff(60));
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.PostEvent(NoteEvent::NoteOff(60));
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.Render(output.data(), 1, 10);
+    REQUIRE(sampler.GetActiveVoiceCount() == 2);
+    REQUIRE(sampler.GetStolenVoiceCount() == 1);
+  }
+
+  SECTION("Stolen voices ramp to silence instead of clicking") {
+    // The steal fade lasts 5 frames, and the new note is silent
+    sampler.SetSampleRate(1000);
+    sampler.SetSamples({{60, MakeConstantSample(1000, 1.0f)},
+                        {62, MakeConstantSample(1000, 0.0f)}});
+    sampler.SetPolyphony(1);
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.Render(output.data(), 1, 10);
+    sampler.PostEvent(NoteEvent::NoteOn(62));
+    sampler.Render(output.data(), 1, 10);
+
+    REQUIRE(sampler.GetStolenVoiceCount() == 1);
+    REQUIRE(output[0] == Approx(1.0f));
+    for (size_t frame = 1; frame < 5; frame++) {
+      REQUIRE(output[frame] < output[frame - 1]);
+    }
+    REQUIRE(output[4] == Approx(0.2f));
+    REQUIRE(output[5] == Approx(0.0f).margin(1e-6));
+    REQUIRE(output[9] == Approx(0.0f).margin(1e-6));
+    REQUIRE(sampler.GetActiveVoiceCount() == 1);
+  }
+}
+
+TEST_CASE("Sampler applies queued events at the start of a block",
+          "[postevent][postevents][render]") {
+  Sampler sampler(1.0);
+  sampler.SetSampleRate(100);
+  sampler.SetSamples({{60, MakeConstantSample(1000, 1.0f)},
+                      {64, MakeConstantSample(1000, 1.0f)},
+                      {67, MakeConstantSample(1000, 1.0f)}});
+  std::vector<float> output(10);
+
+  SECTION("Posted events are not applied until the next block") {
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    REQUIRE(sampler.GetActiveVoiceCount() == 0);
+    sampler.Render(output.data(), 1, 10);
+    REQUIRE(sampler.GetActiveVoiceCount() == 1);
+  }
+
+  SECTION("Chords posted together start in the same block") {
+    NoteEvent chord[] = {NoteEvent::NoteOn(60), NoteEvent::NoteOn(64),
+                         NoteEvent::NoteOn(67)};
+    REQUIRE(sampler.PostEvents(chord, 3));
+    sampler.Render(output.data(), 1, 10);
+    REQUIRE(sampler.GetActiveVoiceCount() == 3);
+    REQUIRE(output[0] == Approx(3.0f));
+  }
+
+  SECTION("Events are rejected once the queue is full") {
+    for (size_t count = 0; count < Sampler::kEventQueueCapacity; count++) {
+      REQUIRE(sampler.PostEvent(NoteEvent::NoteOff(60)));
+    }
+    REQUIRE(!sampler.PostEvent(NoteEvent::NoteOn(60)));
+    sampler.Render(output.data(), 1, 10);
+    REQUIRE(sampler.PostEvent(NoteEvent::NoteOn(60)));
+  }
+}
+
+TEST_CASE("Sampler plays sequences on the exact frame of every event",
+          "[playsequence][stopsequence][isplayingsequence]"
+          "[takesequenceevents][render]") {
+  Sampler sampler(0.0);
+  sampler.SetSampleRate(100);
+  sampler.SetSamples({{60, MakeConstantSample(1000, 1.0f)},
+                      {64, MakeConstantSample(1000, 0.5f)}});
+  std::vector<float> output(100);
+
+  SECTION("Events land on their frame within a block") {
+    REQUIRE(sampler.PlaySequence({{0.03, NoteEvent::NoteOn(60)},
+                                  {0.07, NoteEvent::NoteOff(60)}}));
+    sampler.Render(output.data(), 1, 10);
+    REQUIRE(output[2] == 0.0f);
+    REQUIRE(output[3] == 1.0f);
+    REQUIRE(output[6] == 1.0f);
+    REQUIRE(output[7] == 0.0f);
+  }
+
+  SECTION("Timing doesn't depend on the block size") {
+    std::vector<TimedNoteEvent> events{{0.01, NoteEvent::NoteOn(60)},
+                                       {0.045, NoteEvent::NoteOn(64)},
+                                       {0.05, NoteEvent::NoteOff(60)},
+                                       {0.12, NoteEvent::NoteOff(64)}};
+    REQUIRE(sampler.PlaySequence(events));
+    sampler.Render(output.data(), 1, 20);
+    std::vector<float> whole(output.begin(), output.begin() + 20);
+
+    Sampler split_sampler(0.0);
+    split_sampler.SetSampleRate(100);
+    split_sampler.SetSamples({{60, MakeConstantSample(1000, 1.0f)},
+                              {64, MakeConstantSample(1000, 0.5f)}});
+    REQUIRE(split_sampler.PlaySequence(events));
+    std::vector<float> split;
+    size_t block_sizes[] = {3, 1, 7, 2, 7};
+    for (size_t block_frames : block_sizes) {
+      split_sampler.Render(output.data(), 1, block_frames);
+      split.insert(split.end(), output.begin(),
+                   output.begin() + block_frames);
+    }
+    REQUIRE(split == whole);
+  }
+
+  SECTION("An event on every frame is applied on its frame") {
+    std::vector<TimedNoteEvent> events;
+    for (size_t frame = 0; frame < 400; frame++) {
+      double time = frame / 100.0;
+      events.push_back({time, frame % 2 == 0 ? NoteEvent::NoteOn(60)
+                                             : NoteEvent::NoteOff(60)});
+    }
+    REQUIRE(sampler.PlaySequence(events));
+    for (size_t block = 0; block < 4; block++) {
+      sampler.Render(output.data(), 1, 100);
+      for (size_t frame = 0; frame < 100; frame++) {
+        REQUIRE(output[frame] == (frame % 2 == 0 ? 1.0f : 0.0f));
+      }
+    }
+
+    std::vector<NoteEvent> played = sampler.TakeSequenceEvents();
+    REQUIRE(played.size() == 400);
+    REQUIRE(played[0].type_ == NoteEvent::Type::NoteOn);
+    REQUIRE(played[399].type_ == NoteEvent::Type::NoteOff);
+    REQUIRE(sampler.TakeSequenceEvents().empty());
+  }
+
+  SECTION("Sequences play until their last event") {
+    REQUIRE(sampler.PlaySequence({{0.0, NoteEvent::NoteOn(60)},
+                                  {0.15, NoteEvent::NoteOff(60)}}));
+    REQUIRE(!sampler.IsPlayingSequence());
+    sampler.Render(output.data(), 1, 10);
+    REQUIRE(sampler.IsPlayingSequence());
+    sampler.Render(output.data(), 1, 10);
+    REQUIRE(!sampler.IsPlayingSequence());
+    REQUIRE(sampler.GetActiveVoiceCount() == 0);
+  }
+
+  SECTION("Stopping releases the notes the sequence holds") {
+    REQUIRE(sampler.PlaySequence({{0.0, NoteEvent::NoteOn(60)},
+                                  {0.0, NoteEvent::SustainOn()},
+                                  {10.0, NoteEvent::NoteOff(60)}}));
+    sampler.Render(output.data(), 1, 10);
+    REQUIRE(sampler.GetActiveVoiceCount() == 1);
+
+    REQUIRE(sampler.StopSequence());
+    sampler.Render(output.data(), 1, 10);
+    REQUIRE(!sampler.IsPlayingSequence());
+    REQUIRE(sampler.GetActiveVoiceCount() == 0);
+    std::vector<NoteEvent> played = sampler.TakeSequenceEvents();
+    REQUIRE(played.size() == 2);
+    REQUIRE(played[1].type_ == NoteEvent::Type::NoteOff);
+    REQUIRE(played[1].semitone_ == 60);
+  }
+
+  SECTION("Notes held at the end keep sounding until the next sequence") {
+    REQUIRE(sampler.PlaySequence({{0.0, NoteEvent::NoteOn(60)}}));
+    sampler.Render(output.data(), 1, 10);
+    REQUIRE(!sampler.IsPlayingSequence());
+    REQUIRE(sampler.GetActiveVoiceCount() == 1);
+
+    REQUIRE(sampler.PlaySequence({{0.0, NoteEvent::NoteOn(64)}}));
+    sampler.Render(output.data(), 1, 10);
+    REQUIRE(sampler.GetActiveVoiceCount() == 1);
+    REQUIRE(output[0] == 0.5f);
+  }
+
+  SECTION("Sequences are refused until earlier ones are collected") {
+    for (size_t count = 0; count < Sampler::kMaxPendingSequences; count++) {
+      REQUIRE(sampler.PlaySequence({{1.0, NoteEvent::NoteOn(60)}}));
+    }
+    REQUIRE(!sampler.PlaySequence({{1.0, NoteEvent::NoteOn(60)}}));
+    sampler.Render(output.data(), 1, 10);
+    REQUIRE(sampler.PlaySequence({{1.0, NoteEvent::NoteOn(60)}}));
+  }
+}
+
+TEST_CASE("Sampler measures how long struck notes take to be heard",
+          "[postevent][render][getlatencyhistogram]") {
+  Sampler sampler(1.0);
+  sampler.SetSampleRate(100);
+
+  // Silent for 20 frames, which is 200 milliseconds at this rate
+  auto sample = std::make_shared<SampleBuffer>(1, 1000);
+  std::fill(sample->GetChannel(0) + 20, sample->GetChannel(0) + 1000, 1.0f);
+  sampler.SetSamples({{60, sample}, {62, MakeConstantSample(1000, 1.0f)}});
+  std::vector<float> output(10);
+  LatencyHistogram& latencies = sampler.GetLatencyHistogram();
+
+  SECTION("Notes without a post time are not measured") {
+    sampler.PostEvent(NoteEvent::NoteOn(62));
+    sampler.Render(output.data(), 1, 10);
+    REQUIRE(latencies.GetCount() == 0);
+  }
+
+  SECTION("Notes are measured once, at their first audible frame") {
+    sampler.PostEvent(NoteEvent::NoteOn(62, LatencyHistogram::Now()));
+    sampler.Render(output.data(), 1, 10);
+    sampler.Render(output.data(), 1, 10);
+    REQUIRE(latencies.GetCount() == 1);
+    REQUIRE(latencies.GetMax() < 100000000);
+  }
+
+  SECTION("Leading silence counts towards the latency") {
+    sampler.PostEvent(NoteEvent::NoteOn(60, LatencyHistogram::Now()));
+    sampler.Render(output.data(), 1, 10);
+    REQUIRE(latencies.GetCount() == 0);
+
+    // The first audible frame is 10 frames into this block
+    std::vector<float> long_output(30);
+    sampler.Render(long_output.data(), 1, 30);
+    REQUIRE(latencies.GetCount() == 1);
+    REQUIRE(latencies.GetMax() >= 100000000);
+  }
+}
+
+TEST_CASE("Sampler meters every rendered block", "[render][getloadmeter]") {
+  Sampler sampler(1.0);
+  sampler.SetSampleRate(100);
+  sampler.SetSamples({{60, MakeConstantSample(1000, 1.0f)}});
+  sampler.PostEvent(NoteEvent::NoteOn(60));
+  std::vector<float> output(2 * 10);
+
+  for (size_t block = 0; block < 3; block++) {
+    sampler.Render(output.data(), 2, 10);
+  }
+
+  // A block of 10 frames plays for 100 milliseconds at this rate
+  LoadMeter& meter = sampler.GetLoadMeter();
+  REQUIRE(meter.GetBlockCount() == 3);
+  REQUIRE(meter.GetLateBlockCount() == 0);
+  REQUIRE(meter.GetPeakLoad() < 1);
+}
+
+TEST_CASE("Sampler loads and unloads samples one note at a time",
+          "[addsample][unloadsample][issounding]") {
+  Sampler sampler(1.0);
+  sampler.SetSampleRate(100);
+  sampler.SetSamples({{60, MakeConstantSample(1000, 0.5f)}});
+  std::vector<float> output(10);
+
+  SECTION("Added samples play alongside existing voices") {
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.Render(output.data(), 1, 10);
+    sampler.AddSample(62, MakeConstantSample(1000, 0.25f));
+    sampler.PostEvent(NoteEvent::NoteOn(62));
+    sampler.Render(output.data(), 1, 10);
+    REQUIRE(sampler.GetActiveVoiceCount() == 2);
+    REQUIRE(output[0] == Approx(0.75f));
+  }
+
+  SECTION("Replacing a sample stops the voices playing it") {
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.Render(output.data(), 1, 10);
+    sampler.AddSample(60, MakeConstantSample(1000, 0.25f));
+    REQUIRE(!sampler.IsSounding(60));
+  }
+
+  SECTION("Silent notes are unloaded") {
+    REQUIRE(sampler.UnloadSample(60));
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.Render(output.data(), 1, 10);
+    REQUIRE(sampler.GetActiveVoiceCount() == 0);
+  }
+
+  SECTION("Sounding notes keep their samples until they fade away") {
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.PostEvent(NoteEvent::NoteOff(60));
+    sampler.Render(output.data(), 1, 10);
+    REQUIRE(sampler.IsSounding(60));
+    REQUIRE(!sampler.UnloadSample(60));
+
+    // The note fades over 100 frames
+    std::vector<float> tail(100);
+    sampler.Render(tail.data(), 1, 100);
+    REQUIRE(!sampler.IsSounding(60));
+    REQUIRE(sampler.UnloadSample(60));
+  }
+}
+
+TEST_CASE("Sampler plays notes without samples by pitch-shifting",
+          "[setmaxpitchshift][render]") {
+  Sampler sampler(1.0);
+  sampler.SetSampleRate(100);
+  SampleBufferRef ramp = MakeRampSample(1000);
+  sampler.SetSamples({{60, ramp}});
+  std::vector<float> output(300);
+
+  SECTION("Notes are only played from their own samples by default") {
+    sampler.PostEvent(NoteEvent::NoteOn(61));
+    sampler.Render(output.data(), 1, 10);
+    REQUIRE(sampler.GetActiveVoiceCount() == 0);
+  }
+
+  SECTION("Samples are not shifted further than the maximum") {
+    sampler.SetMaxPitchShift(2);
+    sampler.PostEvent(NoteEvent::NoteOn(63));
+    sampler.Render(output.data(), 1, 10);
+    REQUIRE(sampler.GetActiveVoiceCount() == 0);
+  }
+
+  SECTION("A note an octave up plays its sample twice as fast") {
+    sampler.SetMaxPitchShift(12);
+    sampler.PostEvent(NoteEvent::NoteOn(72));
+    sampler.Render(output.data(), 1, 300);
+    for (size_t frame = 0; frame < 300; frame++) {
+      REQUIRE(output[frame] == Approx(2.0f * frame / 1000).margin(1e-5));
+    }
+  }
+
+  SECTION("A note a semitone up interpolates between frames") {
+    sampler.SetMaxPitchShift(1);
+    sampler.PostEvent(NoteEvent::NoteOn(61));
+    sampler.Render(output.data(), 1, 300);
+    double rate = std::pow(2.0, 1.0 / 12);
+    for (size_t frame = 0; frame < 300; frame++) {
+      REQUIRE(output[frame] == Approx(rate * frame / 1000).margin(1e-5));
+    }
+  }
+
+  SECTION("Equally near notes prefer the sample above") {
+    sampler.AddSample(62, MakeConstantSample(1000, 0.5f));
+    sampler.SetMaxPitchShift(1);
+    sampler.PostEvent(NoteEvent::NoteOn(61));
+    sampler.Render(output.data(), 1, 10);
+    REQUIRE(output[5] == Approx(0.5f));
+  }
+
+  SECTION("Samples played by other notes are not unloaded") {
+    sampler.SetMaxPitchShift(1);
+    sampler.PostEvent(NoteEvent::NoteOn(61));
+    sampler.Render(output.data(), 1, 10);
+    REQUIRE(!sampler.UnloadSample(60));
+    REQUIRE(sampler.IsSounding(61));
+  }
+}
+
+TEST_CASE("Sampler plays layered and split instruments",
+          "[setsamples][setlayerrange][setlayergain][render]") {
+  Sampler sampler(0.1);
+  sampler.SetSampleRate(100);
+  SampleBufferRef shared = MakeConstantSample(1000, 0.5f);
+  sampler.SetSamples({{60, shared}});
+  sampler.SetSamples({{60, MakeConstantSample(1000, 0.25f)}}, 1);
+  std::vector<float> output(20);
+
+  SECTION("Layers on the same notes are mixed at their own gains") {
+    sampler.SetLayerGain(1, 0.5f);
+    REQUIRE(sampler.GetLayerGain(1) == 0.5f);
+    sampler.PostEvent(NoteEvent::NoteOn(60, LatencyHistogram::Now()));
+    sampler.Render(output.data(), 1, 20);
+    REQUIRE(output[0] == Approx(0.625f));
+    REQUIRE(sampler.GetActiveVoiceCount() == 2);
+    // A layered note is measured once
+    REQUIRE(sampler.GetLatencyHistogram().GetCount() == 1);
+
+    sampler.PostEvent(NoteEvent::NoteOff(60));
+    sampler.Render(output.data(), 1, 20);
+    REQUIRE(sampler.GetActiveVoiceCount() == 0);
+
+    sampler.SetLayerGain(1, 2.0f);
+    REQUIRE(sampler.GetLayerGain(1) == 1.0f);
+  }
+
+  SECTION("Split layers each play their own notes") {
+    sampler.SetMaxPitchShift(Sampler::kMaxPitchShift);
+    sampler.SetLayerRange(0, 0, 59);
+    sampler.SetLayerRange(1, 60, 127);
+    sampler.PostEvent(NoteEvent::NoteOn(59));
+    sampler.Render(output.data(), 1, 20);
+    REQUIRE(sampler.GetActiveVoiceCount() == 1);
+    REQUIRE(output[10] == Approx(0.5f));
+
+    sampler.PostEvent(NoteEvent::NoteOff(59));
+    sampler.PostEvent(NoteEvent::NoteOn(61));
+    sampler.Render(output.data(), 1, 20);
+    sampler.Render(output.data(), 1, 20);
+    REQUIRE(sampler.GetActiveVoiceCount() == 1);
+    REQUIRE(output[0] == Approx(0.25f));
+  }
+
+  SECTION("Swapping a layer only fades out that layer's notes") {
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.Render(output.data(), 1, 20);
+    REQUIRE(sampler.SwapSamples({}, 0.05, 1));
+    sampler.Render(output.data(), 1, 20);
+    REQUIRE(output[19] == Approx(0.5f));
+    REQUIRE(sampler.GetActiveVoiceCount() == 1);
+  }
+
+  SECTION("Swapping layers back to back keeps every layer fading") {
+    // Layer 0 fades over 100 frames, and layer 1 over 20 frames from the
+    // block after
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.Render(output.data(), 1, 20);
+    REQUIRE(sampler.SwapSamples({}, 1.0, 0));
+    sampler.Render(output.data(), 1, 20);
+    REQUIRE(output[19] == Approx(0.5f * 0.81f + 0.25f));
+    REQUIRE(sampler.SwapSamples({}, 0.2, 1));
+    sampler.Render(output.data(), 1, 20);
+    REQUIRE(output[0] == Approx(0.5f * 0.8f + 0.25f));
+    REQUIRE(output[19] == Approx(0.5f * 0.61f + 0.25f * 0.05f));
+
+    sampler.Render(output.data(), 1, 20);
+    REQUIRE(output[0] == Approx(0.5f * 0.6f));
+    REQUIRE(sampler.GetActiveVoiceCount() == 1);
+  }
+
+  SECTION("Layers may share samples") {
+    sampler.SetSamples({{60, shared}}, 1);
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.Render(output.data(), 1, 20);
+    REQUIRE(output[0] == Approx(1.0f));
+
+    // Replacing the sample in one layer keeps the other layer sounding
+    sampler.AddSample(60, MakeConstantSample(1000, 0.25f), 1);
+    REQUIRE(sampler.GetActiveVoiceCount() == 1);
+    REQUIRE(!sampler.UnloadSample(60, 0));
+    REQUIRE(sampler.UnloadSample(60, 1));
+  }
+
+  SECTION("Layers out of range are ignored") {
+    sampler.SetSamples({{62, shared}}, Sampler::kMaxLayers);
+    REQUIRE(!sampler.SwapSamples({}, 0, Sampler::kMaxLayers));
+    sampler.PostEvent(NoteEvent::NoteOn(62));
+    sampler.Render(output.data(), 1, 20);
+    REQUIRE(sampler.GetActiveVoiceCount() == 0);
+  }
+}
+
+TEST_CASE("Sampler swaps every sample without locking",
+          "[swapsamples][collectretiredsamples][render]") {
+  Sampler sampler(1.0);
+  sampler.SetSampleRate(100);
+  SampleBufferRef old_sample = MakeConstantSample(1000, 1.0f);
+  sampler.SetSamples({{60, old_sample}});
+  std::vector<float> output(10);
+  sampler.PostEvent(NoteEvent::NoteOn(60));
+  sampler.Render(output.data(), 1, 10);
+
+  SECTION("New notes play the swapped samples") {
+    REQUIRE(sampler.SwapSamples({{60, MakeConstantSample(1000, 0.25f)}}, 0));
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.Render(output.data(), 1, 10);
+    REQUIRE(sampler.GetActiveVoiceCount() == 1);
+    REQUIRE(output[0] == Approx(0.25f));
+  }
+
+  SECTION("Sounding notes fade out over the crossfade") {
+    // The crossfade lasts 20 frames
+    REQUIRE(sampler.SwapSamples({}, 0.2));
+    sampler.Render(output.data(), 1, 10);
+    REQUIRE(output[0] == Approx(1.0f));
+    REQUIRE(output[9] == Approx(0.55f));
+    REQUIRE(!sampler.IsSounding(60));
+
+    sampler.Render(output.data(), 1, 10);
+    REQUIRE(output[9] == Approx(0.05f));
+    sampler.Render(output.data(), 1, 10);
+    REQUIRE(sampler.GetActiveVoiceCount() == 0);
+  }
+
+  SECTION("Replaced samples are destroyed once collected") {
+    std::weak_ptr<const SampleBuffer> weak_sample = old_sample;
+    old_sample.reset();
+    REQUIRE(sampler.SwapSamples({}, 0));
+    sampler.CollectRetiredSamples();
+    REQUIRE(!weak_sample.expired());
+
+    // The faded voice is freed in the first block, and the replaced samples
+    // are handed back at the start of the next one
+    sampler.Render(output.data(), 1, 10);
+    sampler.Render(output.data(), 1, 10);
+    sampler.CollectRetiredSamples();
+    REQUIRE(weak_sample.expired());
+  }
+
+  SECTION("Swaps are refused until earlier swaps are collected") {
+    for (size_t swap = 0; swap < Sampler::kMaxPendingSwaps; swap++) {
+      REQUIRE(sampler.SwapSamples({}, 0));
+    }
+    REQUIRE(!sampler.SwapSamples({}, 0));
+
+    sampler.Render(output.data(), 1, 10);
+    sampler.Render(output.data(), 1, 10);
+    sampler.CollectRetiredSamples();
+    REQUIRE(sampler.SwapSamples({}, 0));
+  }
+}
+
+TEST_CASE("Sampler renders without allocating", "[render]") {
+  if (!RealtimeGuard::IsChecking()) {
+    return;
+  }
+
+  // Every kind of voice: float and 16-bit, pitch-shifted, stolen, sustained
+  // and fading out of a swapped instrument, through a reverb that convolves
+  // its tail on the audio thread
+  SampleBufferRef pcm_sample =
+      MakeRampSample(1000)->Convert(SampleFormat::Int16, false);
+  Sampler sampler(0.5, 4);
+  sampler.SetSampleRate(100);
+  sampler.SetMaxPitchShift(Sampler::kMaxPitchShift);
+  sampler.SetAttackDuration(0.05);
+  sampler.SetSamples({{60, MakeRampSample(1000)}, {64, pcm_sample}});
+  sampler.SetReverb(std::make_shared<ConvolutionReverb>(
+      *MakeRampSample(3000), 2, 100, 0.5f, 1.0f, false, 64, 256));
+  std::vector<float> output(2 * 64);
+
+  // A dense performance plays alongside the posted events, and is stopped
+  // before the swap
+  std::vector<TimedNoteEvent> events;
+  for (int event = 0; event < 300; event++) {
+    int semitone = 50 + event % 24;
+    events.push_back({event * 0.005, event % 3 == 2
+                                         ? NoteEvent::NoteOff(semitone - 1)
+                                         : NoteEvent::NoteOn(semitone)});
+  }
+  REQUIRE(sampler.PlaySequence(events));
+
+  RealtimeGuard::SetAbortOnViolation(false);
+  RealtimeGuard::ResetViolationCount();
+  for (int semitone = 55; semitone < 70; semitone++) {
+    sampler.PostEvent(NoteEvent::NoteOn(semitone, LatencyHistogram::Now()));
+    sampler.PostEvent(semitone % 2 ? NoteEvent::SustainOn()
+                                   : NoteEvent::SustainOff());
+    sampler.Render(output.data(), 2, 64);
+    sampler.PostEvent(NoteEvent::NoteOff(semitone));
+    sampler.PostEvent(NoteEvent::ResonateChange(0.1));
+    sampler.Render(output.data(), 2, 64);
+  }
+  REQUIRE(sampler.StopSequence());
+  REQUIRE(sampler.SwapSamples({{60, MakeConstantSample(1000, 0.5f)}}, 0.1));
+  sampler.Render(output.data(), 2, 64);
+  sampler.Render(output.data(), 2, 64);
+  uint64_t violation_count = RealtimeGuard::GetViolationCount();
+  RealtimeGuard::SetAbortOnViolation(true);
+
+  REQUIRE(violation_count == 0);
+  sampler.CollectRetiredSamples();
+}
+
+TEST_CASE("Sampler mixes dense blocks on several threads",
+          "[render][setrenderthreadcount]") {
+  // Released notes keep ringing, so every strike adds a voice. Pitch-shifted
+  // and 16-bit voices are spread over every chunk
+  auto strike_voices = [](Sampler& sampler, size_t voice_count) {
+    for (size_t voice = 0; voice < voice_count; voice++) {
+      int semitone = 50 + static_cast<int>(voice % 20);
+      sampler.PostEvent(NoteEvent::NoteOn(semitone, LatencyHistogram::Now()));
+      sampler.PostEvent(NoteEvent::NoteOff(semitone));
+    }
+  };
+  auto set_up = [](Sampler& sampler, size_t thread_count) {
+    sampler.SetSampleRate(1000);
+    sampler.SetMaxPitchShift(Sampler::kMaxPitchShift);
+    sampler.SetSamples(
+        {{60, MakeRampSample(5000)},
+         {64, MakeRampSample(5000)->Convert(SampleFormat::Int16, false)}});
+    sampler.SetRenderThreadCount(thread_count);
+  };
+  const size_t voice_count = 200;
+
+  SECTION("Thread counts are clamped") {
+    Sampler sampler(1.0);
+    REQUIRE(sampler.GetRenderThreadCount() == 1);
+    sampler.SetRenderThreadCount(0);
+    REQUIRE(sampler.GetRenderThreadCount() == 1);
+    sampler.SetRenderThreadCount(100);
+    REQUIRE(sampler.GetRenderThreadCount() == Sampler::kMaxRenderThreads);
+    sampler.SetRenderThreadCount(1);
+    REQUIRE(sampler.GetRenderThreadCount() == 1);
+  }
+
+  SECTION("Workers are made apart from the sampler and swapped in") {
+    Sampler sampler(1.0);
+    std::unique_ptr<RenderWorkers> workers = sampler.MakeRenderWorkers(3);
+    REQUIRE(workers->GetWorkerCount() == 2);
+    REQUIRE(sampler.GetRenderThreadCount() == 1);
+    REQUIRE(sampler.SwapRenderWorkers(std::move(workers)) == nullptr);
+    REQUIRE(sampler.GetRenderThreadCount() == 3);
+
+    std::unique_ptr<RenderWorkers> previous =
+        sampler.SwapRenderWorkers(sampler.MakeRenderWorkers(1));
+    REQUIRE(previous->GetWorkerCount() == 2);
+    REQUIRE(sampler.GetRenderThreadCount() == 1);
+  }
+
+  SECTION("The mix matches the mix of a single thread") {
+    Sampler serial(10.0, Sampler::kMaxPolyphony);
+    Sampler parallel(10.0, Sampler::kMaxPolyphony);
+    set_up(serial, 1);
+    set_up(parallel, 4);
+    std::vector<float> serial_output(2 * 300);
+    std::vector<float> parallel_output(2 * 300);
+    for (size_t block = 0; block < 10; block++) {
+      strike_voices(serial, voice_count / 10);
+      strike_voices(parallel, voice_count / 10);
+      serial.Render(serial_output.data(), 2, 300);
+      parallel.Render(parallel_output.data(), 2, 300);
+      REQUIRE(parallel.GetActiveVoiceCount() == serial.GetActiveVoiceCount());
+      for (size_t frame = 0; frame < serial_output.size(); frame++) {
+        REQUIRE(parallel_output[frame] ==
+                Approx(serial_output[frame]).margin(1e-4));
+      }
+    }
+
+    // Every voice's latency is recorded once, whichever thread mixed it
+    REQUIRE(parallel.GetLatencyHistogram().GetCount() == voice_count);
+  }
+
+  SECTION("Blocks are mixed without allocating") {
+    if (!RealtimeGuard::IsChecking()) {
+      return;
+    }
+    Sampler sampler(10.0, Sampler::kMaxPolyphony);
+    set_up(sampler, 4);
+    std::vector<float> output(2 * 64);
+
+    RealtimeGuard::SetAbortOnViolation(false);
+    RealtimeGuard::ResetViolationCount();
+    for (size_t block = 0; block < 20; block++) {
+      strike_voices(sampler, voice_count / 20);
+      sampler.Render(output.data(), 2, 64);
+    }
+    uint64_t violation_count = RealtimeGuard::GetViolationCount();
+    RealtimeGuard::SetAbortOnViolation(true);
+
+    REQUIRE(violation_count == 0);
+  }
+}
+
+TEST_CASE("Sampler passes its mix through a reverb", "[render][setreverb]") {
+  Sampler sampler(1.0);
+  sampler.SetSampleRate(100);
+  sampler.SetSamples({{60, MakeConstantSample(1000, 0.5f)}});
+  // An echo 10 frames after the latency of the reverb
+  SampleBuffer impulse(1, 11);
+  impulse.GetChannel(0)[10] = 1;
+  auto reverb = std::make_shared<ConvolutionReverb>(impulse, 2, 100, 0.5f,
+                                                    1.0f, false);
+  size_t echo_frame = reverb->GetLatency() + 10;
+  std::vector<float> output(2 * 256);
+
+  SECTION("The echo is mixed with the dry voice") {
+    sampler.SetReverb(reverb);
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.Render(output.data(), 2, 256);
+    REQUIRE(output[echo_frame - 1] == Approx(0.5f));
+    REQUIRE(output[echo_frame] == Approx(0.75f));
+    REQUIRE(output[256 + echo_frame] == Approx(0.75f));
+  }
+
+  SECTION("Removing the reverb renders the dry mix") {
+    sampler.SetReverb(reverb);
+    sampler.SetReverb(nullptr);
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.Render(output.data(), 2, 256);
+    REQUIRE(output[echo_frame] == Approx(0.5f));
+  }
+}
+
+TEST_CASE("Sampler plays 16-bit samples like float samples", "[render]") {
+  const size_t kFrames = 1000;
+  SampleBufferRef ramp = MakeRampSample(kFrames);
+  Sampler float_sampler(1.0);
+  Sampler pcm_sampler(1.0);
+  float_sampler.SetSamples({{60, ramp}});
+  pcm_sampler.SetSamples({{60, ramp->Convert(SampleFormat::Int16, false)}});
+  float_sampler.SetMaxPitchShift(12);
+  pcm_sampler.SetMaxPitchShift(12);
+
+  auto require_matching = [&](int semitone) {
+    float_sampler.PostEvent(NoteEvent::NoteOn(semitone));
+    pcm_sampler.PostEvent(NoteEvent::NoteOn(semitone));
+    std::vector<float> expected(2 * 256);
+    std::vector<float> actual(2 * 256);
+    for (size_t block = 0; block < 5; block++) {
+      float_sampler.Render(expected.data(), 2, 256);
+      pcm_sampler.Render(actual.data(), 2, 256);
+      for (size_t index = 0; index < actual.size(); index++) {
+        REQUIRE(actual[index] == Approx(expected[index]).margin(1e-4));
+      }
+    }
+  };
+
+  SECTION("Unshifted notes are converted as they are mixed") {
+    require_matching(60);
+  }
+
+  SECTION("Pitch-shifted notes are converted as they are resampled") {
+    require_matching(65);
+  }
+}
+
+TEST_CASE("Sampler streams samples past their heads",
+          "[render][getstreamunderruncount]") {
+  // Store a ramp long enough to be streamed, so every frame is recognizable
+  const size_t kFrames = 100000;
+  const size_t kHeadFrames = 4096;
+  SampleBuffer ramp(1, kFrames);
+  for (size_t frame = 0; frame < kFrames; frame++) {
+    ramp.GetChannel(0)[frame] = static_cast<float>(frame) / kFrames;
+  }
+  SampleCache cache(".");
+  const std::string key = "sampler_test_stream";
+  REQUIRE(cache.Store(key, ramp));
+  SampleBufferRef head = cache.LoadHead(key, kHeadFrames);
+  REQUIRE(head->GetStreamSource() != nullptr);
+
+  Sampler sampler(1.0);
+  sampler.SetSampleRate(44100);
+  sampler.SetSamples({{60, head}});
+  sampler.PostEvent(NoteEvent::NoteOn(60));
+
+  SECTION("Streamed frames continue from the head") {
+    // Render in real time, as the audio thread would
+    std::vector<float> output(512);
+    bool is_matching = true;
+    for (size_t offset = 0; offset < kFrames; offset += output.size()) {
+      sampler.Render(output.data(), 1, output.size());
+      for (size_t frame = 0; frame < output.size(); frame++) {
+        float expected = offset + frame < kFrames
+                             ? static_cast<float>(offset + frame) / kFrames
+                             : 0.0f;
+        is_matching = is_matching && output[frame] == expected;
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    REQUIRE(is_matching);
+    REQUIRE(sampler.GetStreamUnderrunCount() == 0);
+    REQUIRE(sampler.GetActiveVoiceCount() == 0);
+  }
+
+  SECTION("Pitch-shifted streams read twice as fast") {
+    // Silence the note and play its sample an octave up instead
+    sampler.SetMaxPitchShift(12);
+    sampler.PostEvent(NoteEvent::ResonateChange(0));
+    sampler.PostEvent(NoteEvent::NoteOff(60));
+    sampler.PostEvent(NoteEvent::NoteOn(72));
+
+    std::vector<float> output(512);
+    bool is_matching = true;
+    for (size_t offset = 0; offset < kFrames / 2; offset += output.size()) {
+      sampler.Render(output.data(), 1, output.size());
+      for (size_t frame = 0; frame < output.size(); frame++) {
+        size_t source_frame = 2 * (offset + frame);
+        float expected = source_frame < kFrames
+                             ? static_cast<float>(source_frame) / kFrames
+                             : 0.0f;
+        is_matching = is_matching && output[frame] == Approx(expected);
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(400));
+    }
+    REQUIRE(is_matching);
+    REQUIRE(sampler.GetStreamUnderrunCount() == 0);
+  }
+
+  SECTION("16-bit streams are converted as they are read") {
+    const std::string pcm_key = "sampler_test_stream_pcm";
+    REQUIRE(cache.Store(pcm_key, *ramp.Convert(SampleFormat::Int16, false)));
+    SampleBufferRef pcm_head = cache.LoadHead(pcm_key, kHeadFrames);
+    REQUIRE(pcm_head->GetStreamSource() != nullptr);
+    sampler.SetSamples({{60, pcm_head}});
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+
+    std::vector<float> output(512);
+    bool is_matching = true;
+    for (size_t offset = 0; offset < kFrames; offset += output.size()) {
+      sampler.Render(output.data(), 1, output.size());
+      for (size_t frame = 0; frame < output.size(); frame++) {
+        float expected = offset + frame < kFrames
+                             ? static_cast<float>(offset + frame) / kFrames
+                             : 0.0f;
+        is_matching = is_matching &&
+                      output[frame] == Approx(expected).margin(1e-4);
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    REQUIRE(is_matching);
+    REQUIRE(sampler.GetStreamUnderrunCount() == 0);
+
+    sampler.SetSamples({});
+    std::remove(cache.GetPath(pcm_key).c_str());
+  }
+
+  SECTION("Streamed samples are kept until their streams close") {
+    std::vector<float> output(512);
+    sampler.Render(output.data(), 1, output.size());
+    sampler.PostEvent(NoteEvent::NoteOff(60));
+    sampler.PostEvent(NoteEvent::ResonateChange(0));
+    sampler.Render(output.data(), 1, output.size());
+    REQUIRE(!sampler.IsSounding(60));
+
+    // The stream is closed at the end of the next block, and released by the
+    // I/O thread shortly after
+    sampler.Render(output.data(), 1, output.size());
+    while (!sampler.UnloadSample(60)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+  std::remove(cache.GetPath(key).c_str());
+}
+
+TEST_CASE("Sampler swaps streamed samples while streams are opening",
+          "[swapsamples][collectretiredsamples][render]") {
+  // The pool is started by the first swap, so it races the audio thread
+  // opening streams of earlier swaps, as it would with a device running
+  SampleCache cache(".");
+  const std::string key = "sampler_test_swap_stream";
+  REQUIRE(cache.Store(key, *MakeConstantSample(100000, 0.5f)));
+  SampleBufferRef head = cache.LoadHead(key, 4096);
+  REQUIRE(head->GetStreamSource() != nullptr);
+  std::weak_ptr<const SampleBuffer> weak_head = head;
+
+  Sampler sampler(0.0);
+  sampler.SetSampleRate(44100);
+  std::atomic<bool> is_stopping(false);
+  std::atomic<bool> has_sounded(false);
+  std::thread audio_thread([&sampler, &is_stopping, &has_sounded]() {
+    std::vector<float> output(256);
+    while (!is_stopping.load()) {
+      sampler.Render(output.data(), 1, output.size());
+      if (output[0] != 0.0f) {
+        has_sounded.store(true);
+      }
+      std::this_thread::yield();
+    }
+  });
+
+  for (int swap = 0; swap < 200; swap++) {
+    while (!sampler.SwapSamples({{60, head}}, 0)) {
+      sampler.CollectRetiredSamples();
+      std::this_thread::yield();
+    }
+    sampler.PostEvent(NoteEvent::NoteOn(60));
+    sampler.CollectRetiredSamples();
+  }
+
+  // Once the samples are swapped out, every stream of them closes
+  head.reset();
+  while (!sampler.SwapSamples({}, 0)) {
+    sampler.CollectRetiredSamples();
+    std::this_thread::yield();
+  }
+  while (!weak_head.expired()) {
+    sampler.CollectRetiredSamples();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  is_stopping.store(true);
+  audio_thread.join();
+
+  REQUIRE(has_sounded.load());
+  std::remove(cache.GetPath(key).c_str());
+}
@@ -0,0 +1,154 @@
+#include "core/voice_pool.h"
+
+#include <catch2/catch.hpp>
+
+using synther::audio::StealPolicy;
+using synther::audio::Voice;
+using synther::audio::VoicePool;
+
+namespace {
+
+// Activates a voice for a semitone with the given gain and held state. The
+// gain is reached part-way through a 100-frame attack
+Voice& AllocateVoice(VoicePool& pool, int semitone, float gain, bool is_held) {
+  Voice& voice = pool.Allocate();
+  voice.semitone_ = semitone;
+  voice.envelope_.Start(100);
+  voice.envelope_.Advance(static_cast<size_t>(gain * 100));
+  voice.is_held_ = is_held;
+  return voice;
+}
+
+// Finds the active voice that plays the given semitone, or nullptr
+Voice* FindSemitone(VoicePool& pool, int semitone) {
+  for (size_t index = 0; index < pool.GetActiveCount(); index++) {
+    if (pool.GetActive(index).semitone_ == semitone) {
+      return &pool.GetActive(index);
+    }
+  }
+  return nullptr;
+}
+
+// Checks whether any active voice in the pool plays the given semitone
+bool HasSemitone(VoicePool& pool, int semitone) {
+  return FindSemitone(pool, semitone) != nullptr;
+}
+
+}  // namespace
+
+TEST_CASE("VoicePool allocates and frees voices",
+          "[allocate][free][clear][getactivecount]") {
+  VoicePool pool(8, 4, StealPolicy::Oldest);
+
+  SECTION("Allocated voices become active") {
+    AllocateVoice(pool, 60, 1, true);
+    AllocateVoice(pool, 60, 1, true);
+    REQUIRE(pool.GetActiveCount() == 2);
+  }
+
+  SECTION("Freeing a voice moves the last voice into its place") {
+    AllocateVoice(pool, 60, 1, true);
+    AllocateVoice(pool, 62, 1, true);
+    AllocateVoice(pool, 64, 1, true);
+    pool.Free(0);
+    REQUIRE(pool.GetActiveCount() == 2);
+    REQUIRE(pool.GetActive(0).semitone_ == 64);
+    REQUIRE(pool.GetActive(1).semitone_ == 62);
+  }
+
+  SECTION("Clear frees every voice") {
+    AllocateVoice(pool, 60, 1, true);
+    AllocateVoice(pool, 62, 1, true);
+    pool.Clear();
+    REQUIRE(pool.GetActiveCount() == 0);
+  }
+
+  SECTION("Polyphony is clamped to the capacity") {
+    pool.SetPolyphony(100);
+    REQUIRE(pool.GetPolyphony() == 8);
+    pool.SetPolyphony(0);
+    REQUIRE(pool.GetPolyphony() == 1);
+  }
+}
+
+TEST_CASE("VoicePool steals voices once the polyphony is reached",
+          "[allocate][setpolyphony][setstealpolicy][getstolencount]") {
+  VoicePool pool(8, 3, StealPolicy::Oldest);
+
+  SECTION("Oldest policy steals the oldest voice") {
+    AllocateVoice(pool, 60, 1, true);
+    AllocateVoice(pool, 62, 1, true);
+    AllocateVoice(pool, 64, 1, true);
+    AllocateVoice(pool, 65, 1, true);
+    REQUIRE(pool.GetActiveCount() == 3);
+    REQUIRE(pool.GetStolenCount() == 1);
+    REQUIRE(!HasSemitone(pool, 60));
+  }
+
+  SECTION("Quietest policy steals the quietest voice") {
+    pool.SetStealPolicy(StealPolicy::Quietest);
+    AllocateVoice(pool, 60, 1.0f, true);
+    AllocateVoice(pool, 62, 0.2f, true);
+    AllocateVoice(pool, 64, 0.6f, true);
+    AllocateVoice(pool, 65, 1.0f, true);
+    REQUIRE(!HasSemitone(pool, 62));
+    REQUIRE(HasSemitone(pool, 60));
+  }
+
+  SECTION("Released voices are stolen before held voices") {
+    AllocateVoice(pool, 60, 1, true);
+    AllocateVoice(pool, 62, 1, false);
+    AllocateVoice(pool, 64, 1, true);
+    AllocateVoice(pool, 65, 1, true);
+    REQUIRE(!HasSemitone(pool, 62));
+    REQUIRE(HasSemitone(pool, 60));
+  }
+
+  SECTION("Lowering the polyphony steals the excess voices") {
+    AllocateVoice(pool, 60, 1, true);
+    AllocateVoice(pool, 62, 1, true);
+    AllocateVoice(pool, 64, 1, true);
+    pool.SetPolyphony(1);
+    REQUIRE(pool.GetActiveCount() == 1);
+    REQUIRE(pool.GetStolenCount() == 2);
+    REQUIRE(HasSemitone(pool, 64));
+  }
+}
+
+TEST_CASE("VoicePool fades stolen voices out",
+          "[allocate][setstealfade][getstolencount]") {
+  VoicePool pool(2, 2, StealPolicy::Oldest, 1);
+  pool.SetStealFade(10);
+  AllocateVoice(pool, 60, 1, true);
+  AllocateVoice(pool, 62, 1, true);
+
+  SECTION("Stolen voices fade in a reserved voice") {
+    AllocateVoice(pool, 64, 1, true);
+    REQUIRE(pool.GetActiveCount() == 3);
+    REQUIRE(pool.GetStolenCount() == 1);
+
+    Voice* stolen = FindSemitone(pool, 60);
+    REQUIRE(stolen->is_stolen_);
+    REQUIRE(!stolen->is_held_);
+    REQUIRE(stolen->envelope_.IsReleased());
+    REQUIRE(stolen->envelope_.GetStep() == Approx(-0.1f));
+  }
+
+  SECTION("Fading voices aren't stolen again or counted as sounding") {
+    AllocateVoice(pool, 64, 1, true);
+    pool.Free(pool.GetActiveCount() - 1);
+    AllocateVoice(pool, 65, 1, true);
+    REQUIRE(pool.GetStolenCount() == 1);
+    REQUIRE(HasSemitone(pool, 62));
+  }
+
+  SECTION("The quietest fading voice is cut off once the reserve is full") {
+    AllocateVoice(pool, 64, 1, true);
+    FindSemitone(pool, 60)->envelope_.Advance(5);
+    AllocateVoice(pool, 65, 1, true);
+    REQUIRE(pool.GetActiveCount() == 3);
+    REQUIRE(pool.GetStolenCount() == 2);
+    REQUIRE(!HasSemitone(pool, 60));
+    REQUIRE(FindSemitone(pool, 62)->is_stolen_);
+  }
+}